@@ -0,0 +1,445 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#include <string.h>
+#include "cr-arena.h"
+#include "cr-utils.h"
+
+/**
+ *@CRArena:
+ *
+ *The definition of the #CRArena class.
+ *Allocations are served from the tail of the current block;
+ *when it is full, a new block is chained in front of it.
+ *Requests bigger than a quarter of a block get a block of
+ *their own so that they don't waste the tail of the current one.
+ *Blocks double in size, up to ARENA_MAX_BLOCK_SIZE, so that
+ *big stylesheets live in a handful of blocks and cr_arena_owns()
+ *stays cheap.
+ *
+ *The parser builds and drops a lot of short lived nodes (tokens
+ *that are looked ahead then given back, partial productions, ...).
+ *Nodes freed while their arena is current are kept on a free list
+ *per size so that they are recycled by the next allocations of
+ *the same size instead of piling up in the arena.
+ *
+ *Every node handed out by cr_arena_node_try_alloc() follows a
+ *small header that says whether it lives in an arena, so that
+ *cr_arena_node_free() knows what to do with it whatever the
+ *current arena of the calling thread is: a statement unlinked
+ *from a stylesheet parsed in an arena may be destroyed long
+ *after the parsing is done.
+ */
+
+#define PRIVATE(a_obj) (a_obj)->priv
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+#define ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+
+/*the alignment of every chunk handed out by the arena*/
+#define ARENA_ALIGNMENT 16
+
+#define ARENA_ALIGN(a_size) \
+(((a_size) + ARENA_ALIGNMENT - 1) & ~((gsize) ARENA_ALIGNMENT - 1))
+
+/*the room kept in front of every node for its CRArenaNodeHeader*/
+#define ARENA_NODE_HEADER_SIZE ARENA_ALIGN (sizeof (CRArenaNodeHeader))
+
+/*nodes up to that size are recycled through the free lists*/
+#define ARENA_MAX_RECYCLED_SIZE 256
+
+#define ARENA_NR_FREE_LISTS (ARENA_MAX_RECYCLED_SIZE / ARENA_ALIGNMENT)
+
+#define ARENA_FREE_LIST_INDEX(a_size) \
+(ARENA_ALIGN (a_size) / ARENA_ALIGNMENT - 1)
+
+typedef struct _CRArenaBlock CRArenaBlock;
+
+typedef struct _CRArenaNodeHeader CRArenaNodeHeader;
+
+struct _CRArenaBlock {
+        CRArenaBlock *next;
+        guchar *start;
+        guchar *end;
+        guchar *cur;
+};
+
+struct _CRArenaNodeHeader {
+        /*
+         *TRUE if the node was carved out of an arena,
+         *FALSE if it comes from g_try_malloc().
+         */
+        gboolean in_arena;
+};
+
+struct _CRArenaPriv {
+        /*the size of the next regular block*/
+        gsize block_size;
+
+        /*
+         *the chain of blocks, the most recent one first.
+         *New chunks are carved out of the first one.
+         */
+        CRArenaBlock *blocks;
+
+        /*the number of bytes held by all the blocks*/
+        gsize nr_bytes;
+
+        /*
+         *the chunks given back by cr_arena_node_free(), by size.
+         *Each free chunk starts with a pointer to the next one.
+         */
+        gpointer free_lists[ARENA_NR_FREE_LISTS];
+};
+
+static GPrivate gv_current_arena = G_PRIVATE_INIT (NULL);
+
+static CRArenaBlock *
+new_block (CRArena * a_this, gsize a_size)
+{
+        CRArenaBlock *result = NULL;
+        gsize header_size = ARENA_ALIGN (sizeof (CRArenaBlock)),
+                size = a_size;
+
+        if (!size) {
+                size = PRIVATE (a_this)->block_size;
+                if (PRIVATE (a_this)->block_size < ARENA_MAX_BLOCK_SIZE)
+                        PRIVATE (a_this)->block_size *= 2;
+        }
+
+        result = g_try_malloc (header_size + size);
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        result->next = NULL;
+        result->start = (guchar *) result + header_size;
+        result->end = result->start + size;
+        result->cur = result->start;
+        PRIVATE (a_this)->nr_bytes += header_size + size;
+        return result;
+}
+
+/********************
+ *Public methods
+ ********************/
+
+/**
+ * cr_arena_new:
+ *@a_block_size: the size of the first block the arena carves
+ *its chunks from, or 0 to use the default size (64KiB).
+ *
+ *Instanciates a new #CRArena. No memory is allocated until
+ *the first chunk is requested.
+ *
+ *Returns the new arena, or NULL in case of error.
+ */
+CRArena *
+cr_arena_new (gsize a_block_size)
+{
+        CRArena *result = NULL;
+
+        result = g_try_malloc (sizeof (CRArena));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRArena));
+
+        PRIVATE (result) = g_try_malloc (sizeof (CRArenaPriv));
+        if (!PRIVATE (result)) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (result);
+                return NULL;
+        }
+        memset (PRIVATE (result), 0, sizeof (CRArenaPriv));
+        PRIVATE (result)->block_size = a_block_size ?
+                ARENA_ALIGN (a_block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+
+        return result;
+}
+
+/**
+ * cr_arena_alloc:
+ *@a_this: the current instance of #CRArena.
+ *@a_size: the size of the chunk to allocate.
+ *
+ *Allocates a chunk of @a_size bytes in the arena. The chunk
+ *is zeroed and aligned for any basic type. It lives until
+ *the arena is destroyed.
+ *
+ *Returns the chunk, or NULL in case of error.
+ */
+gpointer
+cr_arena_alloc (CRArena * a_this, gsize a_size)
+{
+        CRArenaBlock *block = NULL;
+        gpointer result = NULL;
+        gboolean dedicated = FALSE;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
+
+        a_size = ARENA_ALIGN (a_size ? a_size : 1);
+        block = PRIVATE (a_this)->blocks;
+
+        if (!block || (gsize) (block->end - block->cur) < a_size) {
+                CRArenaBlock *new = NULL;
+
+                dedicated = a_size > PRIVATE (a_this)->block_size / 4;
+                new = new_block (a_this, dedicated ? a_size : 0);
+                if (!new)
+                        return NULL;
+                if (block && dedicated) {
+                        /*
+                         *keep carving the current block: chain the
+                         *dedicated one behind it.
+                         */
+                        new->next = block->next;
+                        block->next = new;
+                } else {
+                        new->next = block;
+                        PRIVATE (a_this)->blocks = new;
+                }
+                block = new;
+        }
+
+        result = block->cur;
+        block->cur += a_size;
+        memset (result, 0, a_size);
+        return result;
+}
+
+/**
+ * cr_arena_owns:
+ *@a_this: the current instance of #CRArena.
+ *@a_ptr: the pointer to check.
+ *
+ *Returns TRUE if @a_ptr points into one of the blocks of the
+ *arena, FALSE otherwise.
+ */
+gboolean
+cr_arena_owns (CRArena const *a_this, gconstpointer a_ptr)
+{
+        CRArenaBlock const *cur = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), FALSE);
+
+        for (cur = PRIVATE (a_this)->blocks; cur; cur = cur->next) {
+                if ((guchar const *) a_ptr >= cur->start
+                    && (guchar const *) a_ptr < cur->end)
+                        return TRUE;
+        }
+        return FALSE;
+}
+
+/**
+ * cr_arena_get_nr_bytes:
+ *@a_this: the current instance of #CRArena.
+ *
+ *Returns the number of bytes allocated from the system
+ *by the arena so far.
+ */
+gsize
+cr_arena_get_nr_bytes (CRArena const *a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->nr_bytes;
+}
+
+/**
+ * cr_arena_merge:
+ *@a_this: the current instance of #CRArena.
+ *@a_other: the arena to merge into @a_this. It is destroyed.
+ *
+ *Hands the blocks of @a_other over to @a_this, so that the
+ *chunks allocated in @a_other live until @a_this is destroyed.
+ *This is how nodes built by several threads, each with an arena
+ *of its own, end up owned by a single stylesheet.
+ *The blocks are chained behind the current block of @a_this,
+ *which keeps being carved first. The free chunks of @a_other
+ *are not recycled.
+ */
+void
+cr_arena_merge (CRArena * a_this, CRArena * a_other)
+{
+        CRArenaBlock *tail = NULL;
+
+        g_return_if_fail (a_this && PRIVATE (a_this)
+                          && a_other && PRIVATE (a_other)
+                          && a_this != a_other);
+
+        tail = PRIVATE (a_other)->blocks;
+        if (tail) {
+                while (tail->next)
+                        tail = tail->next;
+                if (PRIVATE (a_this)->blocks) {
+                        tail->next = PRIVATE (a_this)->blocks->next;
+                        PRIVATE (a_this)->blocks->next =
+                                PRIVATE (a_other)->blocks;
+                } else {
+                        PRIVATE (a_this)->blocks =
+                                PRIVATE (a_other)->blocks;
+                }
+                PRIVATE (a_this)->nr_bytes += PRIVATE (a_other)->nr_bytes;
+                PRIVATE (a_other)->blocks = NULL;
+        }
+        cr_arena_destroy (a_other);
+}
+
+/**
+ * cr_arena_get_current:
+ *
+ *Returns the current arena of the calling thread, or NULL
+ *if the thread allocates its nodes with the system allocator.
+ */
+CRArena *
+cr_arena_get_current (void)
+{
+        return g_private_get (&gv_current_arena);
+}
+
+/**
+ * cr_arena_set_current:
+ *@a_this: the new current arena of the calling thread, or NULL
+ *to go back to the system allocator.
+ *
+ *Sets the arena the nodes built, and destroyed, by the calling
+ *thread are allocated in. Callers are expected to restore the
+ *previous arena when they are done.
+ *
+ *Returns the previous current arena.
+ */
+CRArena *
+cr_arena_set_current (CRArena * a_this)
+{
+        CRArena *result = NULL;
+
+        result = g_private_get (&gv_current_arena);
+        g_private_set (&gv_current_arena, a_this);
+        return result;
+}
+
+/**
+ * cr_arena_node_try_alloc:
+ *@a_size: the size of the node.
+ *
+ *Allocates a node of the css object model, in the current arena
+ *if any, with g_try_malloc() otherwise. Unlike what cr_arena_alloc()
+ *does, the node is not zeroed. It must be freed with
+ *cr_arena_node_free().
+ *
+ *Returns the node, or NULL in case of error.
+ */
+gpointer
+cr_arena_node_try_alloc (gsize a_size)
+{
+        CRArena *arena = g_private_get (&gv_current_arena);
+        CRArenaNodeHeader *header = NULL;
+        gpointer *free_list = NULL,
+                result = NULL;
+
+        if (!arena) {
+                header = g_try_malloc (ARENA_NODE_HEADER_SIZE + a_size);
+                if (!header)
+                        return NULL;
+                header->in_arena = FALSE;
+                return (guchar *) header + ARENA_NODE_HEADER_SIZE;
+        }
+
+        if (a_size && a_size <= ARENA_MAX_RECYCLED_SIZE) {
+                free_list = &PRIVATE (arena)->free_lists
+                        [ARENA_FREE_LIST_INDEX (a_size)];
+                if (*free_list) {
+                        result = *free_list;
+                        *free_list = *(gpointer *) result;
+                        return result;
+                }
+        }
+        header = cr_arena_alloc (arena, ARENA_NODE_HEADER_SIZE + a_size);
+        if (!header)
+                return NULL;
+        header->in_arena = TRUE;
+        return (guchar *) header + ARENA_NODE_HEADER_SIZE;
+}
+
+/**
+ * cr_arena_node_free:
+ *@a_size: the size of the node, as given to cr_arena_node_try_alloc().
+ *@a_ptr: the node to free.
+ *
+ *Frees a node allocated by cr_arena_node_try_alloc(), from any
+ *thread. A node allocated with g_try_malloc() is given back to the
+ *system. A node that lives in an arena is never given back on its
+ *own: the memory goes away with its arena. If that arena is the
+ *current one of the calling thread, the node is recycled for the
+ *next nodes of the same size.
+ */
+void
+cr_arena_node_free (gsize a_size, gpointer a_ptr)
+{
+        CRArena *arena = NULL;
+        CRArenaNodeHeader *header = NULL;
+        gpointer *free_list = NULL;
+
+        if (!a_ptr)
+                return;
+        header = (CRArenaNodeHeader *)
+                ((guchar *) a_ptr - ARENA_NODE_HEADER_SIZE);
+        if (header->in_arena == FALSE) {
+                g_free (header);
+                return;
+        }
+        arena = g_private_get (&gv_current_arena);
+        if (!arena || !cr_arena_owns (arena, a_ptr))
+                return;
+        if (a_size && a_size <= ARENA_MAX_RECYCLED_SIZE) {
+                free_list = &PRIVATE (arena)->free_lists
+                        [ARENA_FREE_LIST_INDEX (a_size)];
+                *(gpointer *) a_ptr = *free_list;
+                *free_list = a_ptr;
+        }
+}
+
+/**
+ * cr_arena_destroy:
+ *@a_this: the current instance of #CRArena.
+ *
+ *Gives all the blocks of the arena back to the system,
+ *and destroys the arena.
+ */
+void
+cr_arena_destroy (CRArena * a_this)
+{
+        CRArenaBlock *cur = NULL,
+                *next = NULL;
+
+        g_return_if_fail (a_this && PRIVATE (a_this));
+
+        for (cur = PRIVATE (a_this)->blocks; cur; cur = next) {
+                next = cur->next;
+                g_free (cur);
+        }
+        g_free (PRIVATE (a_this));
+        g_free (a_this);
+}
@@ -0,0 +1,76 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#ifndef __CR_ARENA_H__
+#define __CR_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRArena class.
+ */
+
+typedef struct _CRArena CRArena ;
+typedef struct _CRArenaPriv CRArenaPriv ;
+
+/**
+ *A bump allocator.
+ *Memory is carved out of a few large blocks and is only
+ *given back to the system when the whole arena is destroyed.
+ *
+ *While an arena is the current one of a thread (see
+ *cr_arena_set_current()), the css object model nodes built by
+ *that thread (statements, declarations, terms, selectors,
+ *strings, numbers, ...) are allocated in it, and destroying
+ *them gives nothing back.
+ */
+struct _CRArena
+{
+        CRArenaPriv *priv ;
+} ;
+
+CRArena * cr_arena_new (gsize a_block_size) ;
+
+gpointer cr_arena_alloc (CRArena *a_this, gsize a_size) ;
+
+gboolean cr_arena_owns (CRArena const *a_this, gconstpointer a_ptr) ;
+
+gsize cr_arena_get_nr_bytes (CRArena const *a_this) ;
+
+void cr_arena_merge (CRArena *a_this, CRArena *a_other) ;
+
+CRArena * cr_arena_get_current (void) ;
+
+CRArena * cr_arena_set_current (CRArena *a_this) ;
+
+gpointer cr_arena_node_try_alloc (gsize a_size) ;
+
+void cr_arena_node_free (gsize a_size, gpointer a_ptr) ;
+
+void cr_arena_destroy (CRArena *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_ARENA_H__*/
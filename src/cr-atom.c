@@ -0,0 +1,71 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#include "cr-atom.h"
+
+/**
+ *@CRAtom:
+ *
+ *The atom table is the quark table of glib, so atoms
+ *are shared with g_intern_string() and may be used from
+ *several threads.
+ */
+
+/**
+ * cr_atom_from_string:
+ *@a_str: the string to intern.
+ *
+ *Returns the atom of @a_str, adding it to the atom table
+ *if needed, or NULL if @a_str is NULL.
+ */
+CRAtom
+cr_atom_from_string (const gchar * a_str)
+{
+        if (!a_str)
+                return NULL;
+        return g_intern_string (a_str);
+}
+
+/**
+ * cr_atom_lookup:
+ *@a_str: the string to look up.
+ *
+ *Looks up the atom of @a_str without adding it to the atom
+ *table. This is the way to go for strings that don't come from
+ *a stylesheet, like the names and attributes of the xml nodes
+ *being styled: if a string has no atom, no selector nor property
+ *name can be equal to it.
+ *
+ *Returns the atom of @a_str, or NULL if @a_str has never been interned.
+ */
+CRAtom
+cr_atom_lookup (const gchar * a_str)
+{
+        GQuark quark = 0;
+
+        if (!a_str)
+                return NULL;
+        quark = g_quark_try_string (a_str);
+        if (!quark)
+                return NULL;
+        return g_quark_to_string (quark);
+}
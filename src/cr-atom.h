@@ -0,0 +1,50 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#ifndef __CR_ATOM_H__
+#define __CR_ATOM_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRAtom type.
+ */
+
+/**
+ *An interned string.
+ *All the atoms of a given string are the same pointer, so two
+ *atoms are equal if and only if they are the same pointer.
+ *An atom is a regular null terminated string that lives as long
+ *as the process does. It must never be modified nor freed.
+ */
+typedef const gchar * CRAtom ;
+
+CRAtom cr_atom_from_string (const gchar *a_str) ;
+
+CRAtom cr_atom_lookup (const gchar *a_str) ;
+
+G_END_DECLS
+
+#endif /*__CR_ATOM_H__*/
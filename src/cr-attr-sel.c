@@ -21,7 +21,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "cr-attr-sel.h"
+#include "cr-arena.h"
 
 /**
  * CRAttrSel:
@@ -43,7 +45,12 @@ cr_attr_sel_new (void)
 {
         CRAttrSel *result = NULL;
 
-        result = g_malloc0 (sizeof (CRAttrSel));
+        result = cr_arena_node_try_alloc (sizeof (CRAttrSel));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRAttrSel));
 
         return result;
 }
@@ -228,7 +235,7 @@ cr_attr_sel_destroy (CRAttrSel * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_arena_node_free (sizeof (CRAttrSel), a_this);
                 a_this = NULL;
         }
 }
@@ -40,7 +40,7 @@ struct _CRCascadePriv {
 	 *of sheets[ORIGIN_UA] ;
 	 */
         CRStyleSheet *sheets[3];
-        guint ref_count;
+        gint ref_count;
 };
 
 /**
@@ -160,7 +160,7 @@ cr_cascade_ref (CRCascade * a_this)
 {
         g_return_if_fail (a_this && PRIVATE (a_this));
 
-        PRIVATE (a_this)->ref_count++;
+        g_atomic_int_inc (&PRIVATE (a_this)->ref_count);
 }
 
 /**
@@ -178,9 +178,8 @@ cr_cascade_unref (CRCascade * a_this)
 {
         g_return_if_fail (a_this && PRIVATE (a_this));
 
-        if (PRIVATE (a_this)->ref_count)
-                PRIVATE (a_this)->ref_count--;
-        if (!PRIVATE (a_this)->ref_count) {
+        if (g_atomic_int_get (&PRIVATE (a_this)->ref_count) == 0
+            || g_atomic_int_dec_and_test (&PRIVATE (a_this)->ref_count)) {
                 cr_cascade_destroy (a_this);
         }
 }
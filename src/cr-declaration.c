@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include "cr-declaration.h"
+#include "cr-arena.h"
 #include "cr-statement.h"
 #include "cr-parser.h"
 
@@ -86,7 +87,7 @@ cr_declaration_new (CRStatement * a_statement,
                                           || (a_statement->type
                                               == AT_PAGE_RULE_STMT)), NULL);
 
-        result = g_try_malloc (sizeof (CRDeclaration));
+        result = cr_arena_node_try_alloc (sizeof (CRDeclaration));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
@@ -730,7 +731,7 @@ cr_declaration_ref (CRDeclaration * a_this)
 {
         g_return_if_fail (a_this);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
 }
 
 /**
@@ -748,11 +749,8 @@ cr_declaration_unref (CRDeclaration * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count) {
-                a_this->ref_count--;
-        }
-
-        if (a_this->ref_count == 0) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_declaration_destroy (a_this);
                 return TRUE;
         }
@@ -783,7 +781,7 @@ cr_declaration_destroy (CRDeclaration * a_this)
          * Meanwhile, free each property/value pair contained in the list.
          */
         for (; cur; cur = cur->prev) {
-                g_free (cur->next);
+                cr_arena_node_free (sizeof (CRDeclaration), cur->next);
                 cur->next = NULL;
 
                 if (cur->property) {
@@ -797,5 +795,5 @@ cr_declaration_destroy (CRDeclaration * a_this)
                 }
         }
 
-        g_free (a_this);
+        cr_arena_node_free (sizeof (CRDeclaration), a_this);
 }
@@ -211,7 +211,7 @@ cr_doc_handler_ref (CRDocHandler * a_this)
 {
         g_return_if_fail (a_this);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
 }
 
 /**
@@ -228,11 +228,8 @@ cr_doc_handler_unref (CRDocHandler * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count > 0) {
-                a_this->ref_count--;
-        }
-
-        if (a_this->ref_count == 0) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_doc_handler_destroy (a_this);
                 return TRUE;
         }
@@ -36,6 +36,47 @@
  *Private type defs
  *******************/
 
+typedef struct _CRInputStream CRInputStream;
+
+/**
+ *The state of a streaming input.
+ *See cr_input_new_streaming().
+ */
+struct _CRInputStream {
+        /*
+         *The number of bytes fed so far.
+         *The bytes of in_buf located after the current window,
+         *that is in [nb_bytes, nb_bytes_fed), are pending.
+         */
+        gulong nb_bytes_fed;
+        gulong buf_capacity;
+
+        /*
+         *The offset of in_buf[0] in the whole stream.
+         */
+        gulong base_offset;
+
+        /*
+         *The location at the beginning of the current window.
+         */
+        gulong line;
+        gulong col;
+        gboolean end_of_line;
+
+        /*
+         *The state of the scanner that looks for
+         *the end of the top level statements.
+         */
+        gulong scan_index;
+        gulong last_boundary;
+        guint block_depth;
+        guint paren_depth;
+        guchar quote;
+        gboolean in_comment;
+        gboolean comment_star;
+        gboolean escaped;
+};
+
 /**
  *The private attributes of
  *the #CRInputPriv class.
@@ -74,10 +115,42 @@ struct _CRInputPriv {
          */
         guint ref_count;
         gboolean free_in_buf;
+
+        /*
+         *TRUE if in_buf is known to only hold ascii
+         *characters (see cr_utils_is_ascii()), so
+         *each byte is a whole character.
+         *Computed when the instance is built, and
+         *as chunks are appended to a streaming input.
+         */
+        gboolean is_ascii;
+
+        /*
+         *The file mapping in_buf points into,
+         *if the instance was built by cr_input_new_from_mmap().
+         */
+        GMappedFile *mapped_file;
+
+        /*
+         *Not NULL if the instance was built
+         *by cr_input_new_streaming().
+         */
+        CRInputStream *stream;
 };
 
 #define PRIVATE(object) (object)->priv
 
+/*
+ *TRUE if the next byte of the input is there and is an ascii
+ *character (see cr_utils_is_ascii()), that is, a byte
+ *cr_utils_read_char_from_utf8_buf() would decode as itself.
+ */
+#define CR_INPUT_NEXT_BYTE_IS_ASCII(a_this) \
+(PRIVATE (a_this)->next_byte_index < PRIVATE (a_this)->nb_bytes \
+ && (PRIVATE (a_this)->is_ascii \
+     || (guchar) (PRIVATE (a_this)->in_buf \
+                  [PRIVATE (a_this)->next_byte_index] - 1) < 0x7F))
+
 /***************************
  *private constants
  **************************/
@@ -85,6 +158,13 @@ struct _CRInputPriv {
 
 static CRInput *cr_input_new_real (void);
 
+static void cr_input_stream_advance_location (CRInputStream * a_stream,
+                                              guchar const * a_buf,
+                                              gulong a_len);
+
+static void cr_input_stream_scan (CRInputStream * a_stream,
+                                  guchar const * a_buf);
+
 static CRInput *
 cr_input_new_real (void)
 {
@@ -108,6 +188,117 @@ cr_input_new_real (void)
         return result;
 }
 
+/**
+ *Updates the location recorded in the stream state as
+ *cr_input_read_char() would if it read the characters of a_buf.
+ */
+static void
+cr_input_stream_advance_location (CRInputStream * a_stream,
+                                  guchar const * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_len; i++) {
+                /*only the first byte of an utf8 char counts*/
+                if ((a_buf[i] & 0xC0) == 0x80)
+                        continue;
+
+                if (a_stream->end_of_line == TRUE) {
+                        a_stream->col = 1;
+                        a_stream->line++;
+                        a_stream->end_of_line = FALSE;
+                } else if (a_buf[i] != '\n') {
+                        a_stream->col++;
+                }
+
+                if (a_buf[i] == '\n') {
+                        a_stream->end_of_line = TRUE;
+                }
+        }
+}
+
+/**
+ *Scans the bytes fed since the last scan and records the end
+ *of the last complete top level statement, that is the end of
+ *a ';' or of a '}' found at nesting level 0, outside of strings
+ *and comments.
+ */
+static void
+cr_input_stream_scan (CRInputStream * a_stream, guchar const * a_buf)
+{
+        gulong i = 0;
+        guchar c = 0;
+
+        for (i = a_stream->scan_index; i < a_stream->nb_bytes_fed; i++) {
+                c = a_buf[i];
+
+                if (a_stream->escaped == TRUE) {
+                        a_stream->escaped = FALSE;
+                        continue;
+                }
+                if (a_stream->in_comment == TRUE) {
+                        if (c == '/' && a_stream->comment_star == TRUE)
+                                a_stream->in_comment = FALSE;
+                        a_stream->comment_star = (c == '*');
+                        continue;
+                }
+                if (c == '\\') {
+                        a_stream->escaped = TRUE;
+                        continue;
+                }
+                if (a_stream->quote) {
+                        if (c == a_stream->quote || c == '\n')
+                                a_stream->quote = 0;
+                        continue;
+                }
+
+                switch (c) {
+                case '/':
+                        if (i + 1 == a_stream->nb_bytes_fed) {
+                                /*wait for the next byte*/
+                                a_stream->scan_index = i;
+                                return;
+                        }
+                        if (a_buf[i + 1] == '*') {
+                                a_stream->in_comment = TRUE;
+                                a_stream->comment_star = FALSE;
+                                i++;
+                        }
+                        break;
+                case '"':
+                case '\'':
+                        a_stream->quote = c;
+                        break;
+                case '(':
+                        a_stream->paren_depth++;
+                        break;
+                case ')':
+                        if (a_stream->paren_depth)
+                                a_stream->paren_depth--;
+                        break;
+                case '{':
+                        a_stream->block_depth++;
+                        break;
+                case '}':
+                        if (a_stream->block_depth)
+                                a_stream->block_depth--;
+                        if (!a_stream->block_depth) {
+                                a_stream->paren_depth = 0;
+                                a_stream->last_boundary = i + 1;
+                        }
+                        break;
+                case ';':
+                        if (!a_stream->block_depth
+                            && !a_stream->paren_depth)
+                                a_stream->last_boundary = i + 1;
+                        break;
+                default:
+                        break;
+                }
+        }
+        a_stream->scan_index = i;
+}
+
 /****************
  *Public methods
  ***************/
@@ -166,6 +357,8 @@ cr_input_new_from_buf (guchar * a_buf,
                 PRIVATE (result)->nb_bytes = a_len;
                 PRIVATE (result)->free_in_buf = a_free_buf;
         }
+        PRIVATE (result)->is_ascii = cr_utils_is_ascii
+                (PRIVATE (result)->in_buf, PRIVATE (result)->nb_bytes);
         PRIVATE (result)->line = 1;
         PRIVATE (result)->col =  0;
         return result;
@@ -273,6 +466,229 @@ cr_input_new_from_uri (const gchar * a_file_uri, enum CREncoding a_enc)
         return result;
 }
 
+/**
+ * cr_input_new_from_mmap:
+ *@a_file_path: the path of the file to create the input stream from.
+ *@a_enc: the encoding of the file.
+ *
+ *Creates a new input stream that reads a file through a read only
+ *memory mapping, without copying it into the heap.
+ *Only utf8 files, and ascii files that are really 7 bits clean, can
+ *be tokenized in place. For the other encodings, or if the file
+ *cannot be mapped, this falls back to cr_input_new_from_uri().
+ *
+ *Returns the newly created input stream, NULL if the file could
+ *not be read.
+ */
+CRInput *
+cr_input_new_from_mmap (const gchar * a_file_path, enum CREncoding a_enc)
+{
+        CRInput *result = NULL;
+        GMappedFile *mapped_file = NULL;
+        guchar *buf = NULL;
+        gsize len = 0;
+
+        g_return_val_if_fail (a_file_path, NULL);
+
+        if (a_enc != CR_UTF_8 && a_enc != CR_ASCII) {
+                return cr_input_new_from_uri (a_file_path, a_enc);
+        }
+
+        mapped_file = g_mapped_file_new (a_file_path, FALSE, NULL);
+        if (!mapped_file) {
+                return cr_input_new_from_uri (a_file_path, a_enc);
+        }
+
+        len = g_mapped_file_get_length (mapped_file);
+        buf = (guchar *) g_mapped_file_get_contents (mapped_file);
+        if (!len || !buf) {
+                goto fallback;
+        }
+
+        /*
+         *CR_ASCII is otherwise converted as latin1,
+         *so only map it if no byte needs a conversion.
+         */
+        if (a_enc == CR_ASCII && !cr_utils_is_ascii (buf, len)) {
+                goto fallback;
+        }
+
+        result = cr_input_new_from_buf (buf, len, CR_UTF_8, FALSE);
+        if (!result) {
+                g_mapped_file_unref (mapped_file);
+                return NULL;
+        }
+        PRIVATE (result)->mapped_file = mapped_file;
+
+        return result;
+
+ fallback:
+        g_mapped_file_unref (mapped_file);
+        return cr_input_new_from_uri (a_file_path, a_enc);
+}
+
+/**
+ * cr_input_new_streaming:
+ *
+ *Creates a new, empty, utf8 input stream the data of which is
+ *pushed by the caller, chunk by chunk, using cr_input_append_buf().
+ *
+ *Such an input only exposes a window made of the complete top level
+ *statements received so far, see cr_input_next_window(). Everything
+ *located before the current window is discarded, so the memory used
+ *is bounded by the size of the biggest statement, not by the size of
+ *the whole stylesheet. Positions (#CRInputPos) are relative to the
+ *current window; parsing locations are relative to the whole stream.
+ *
+ *This is the input cr_parser_feed() expects.
+ *
+ *Returns the newly built instance of #CRInput.
+ */
+CRInput *
+cr_input_new_streaming (void)
+{
+        CRInput *result = NULL;
+
+        result = cr_input_new_real ();
+        g_return_val_if_fail (result, NULL);
+
+        PRIVATE (result)->stream = g_try_malloc (sizeof (CRInputStream));
+        if (!PRIVATE (result)->stream) {
+                cr_utils_trace_info ("Out of memory");
+                cr_input_destroy (result);
+                return NULL;
+        }
+        memset (PRIVATE (result)->stream, 0, sizeof (CRInputStream));
+
+        PRIVATE (result)->line = 1;
+        PRIVATE (result)->col = 0;
+        PRIVATE (result)->is_ascii = TRUE;
+        PRIVATE (result)->stream->line = 1;
+        PRIVATE (result)->stream->col = 0;
+
+        return result;
+}
+
+/**
+ * cr_input_append_buf:
+ *@a_this: the current instance of #CRInput, built by
+ *cr_input_new_streaming().
+ *@a_buf: the utf8 encoded bytes to append. They are copied.
+ *@a_len: the number of bytes in a_buf.
+ *
+ *Appends a chunk of data to a streaming input.
+ *The appended bytes only become readable once they are part of the
+ *window exposed by cr_input_next_window().
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_input_append_buf (CRInput * a_this, const guchar * a_buf, gulong a_len)
+{
+        CRInputStream *stream = NULL;
+        gulong capacity = 0;
+        guchar *buf = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->stream
+                              && (a_buf || !a_len), CR_BAD_PARAM_ERROR);
+
+        stream = PRIVATE (a_this)->stream;
+        if (!a_len)
+                return CR_OK;
+
+        if (stream->nb_bytes_fed + a_len > stream->buf_capacity) {
+                capacity = stream->buf_capacity ?
+                        stream->buf_capacity : CR_INPUT_MEM_CHUNK_SIZE;
+                while (capacity < stream->nb_bytes_fed + a_len)
+                        capacity *= 2;
+                buf = g_try_realloc (PRIVATE (a_this)->in_buf, capacity);
+                if (!buf) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                PRIVATE (a_this)->in_buf = buf;
+                stream->buf_capacity = capacity;
+        }
+        memcpy (PRIVATE (a_this)->in_buf + stream->nb_bytes_fed,
+                a_buf, a_len);
+        stream->nb_bytes_fed += a_len;
+        if (PRIVATE (a_this)->is_ascii)
+                PRIVATE (a_this)->is_ascii = cr_utils_is_ascii (a_buf, a_len);
+
+        return CR_OK;
+}
+
+/**
+ * cr_input_next_window:
+ *@a_this: the current instance of #CRInput, built by
+ *cr_input_new_streaming().
+ *@a_end_of_stream: TRUE if no more data is going to be appended.
+ *In that case, the new window holds all the remaining bytes, even if
+ *they do not end with a complete statement.
+ *
+ *Discards the current window of a streaming input and makes the
+ *complete top level statements appended since then the new current
+ *window. The read position is set to the beginning of the
+ *new window. Statement boundaries are found by a scan that skips
+ *strings, comments and escaped characters, and keeps track of the
+ *nesting of blocks.
+ *
+ *Returns CR_OK if a new, non empty, window is available,
+ *CR_END_OF_INPUT_ERROR if more data is needed, an other error code
+ *otherwise.
+ */
+enum CRStatus
+cr_input_next_window (CRInput * a_this, gboolean a_end_of_stream)
+{
+        CRInputStream *stream = NULL;
+        gulong consumed = 0,
+                end = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->stream,
+                              CR_BAD_PARAM_ERROR);
+
+        stream = PRIVATE (a_this)->stream;
+
+        /*drop the current window*/
+        consumed = PRIVATE (a_this)->nb_bytes;
+        if (consumed) {
+                cr_input_stream_advance_location
+                        (stream, PRIVATE (a_this)->in_buf, consumed);
+                memmove (PRIVATE (a_this)->in_buf,
+                         PRIVATE (a_this)->in_buf + consumed,
+                         stream->nb_bytes_fed - consumed);
+                stream->nb_bytes_fed -= consumed;
+                stream->base_offset += consumed;
+                stream->scan_index -= consumed;
+                stream->last_boundary -= consumed;
+        }
+
+        cr_input_stream_scan (stream, PRIVATE (a_this)->in_buf);
+
+        if (a_end_of_stream == TRUE) {
+                end = stream->nb_bytes_fed;
+                stream->scan_index = end;
+                stream->last_boundary = end;
+        } else {
+                end = stream->last_boundary;
+        }
+
+        PRIVATE (a_this)->nb_bytes = end;
+        PRIVATE (a_this)->in_buf_size = end;
+        PRIVATE (a_this)->next_byte_index = 0;
+        PRIVATE (a_this)->end_of_input = FALSE;
+        PRIVATE (a_this)->line = stream->line;
+        PRIVATE (a_this)->col = stream->col;
+        PRIVATE (a_this)->end_of_line = stream->end_of_line;
+
+        if (!end)
+                return CR_END_OF_INPUT_ERROR;
+
+        return CR_OK;
+}
+
 /**
  * cr_input_destroy:
  *@a_this: the current instance of #CRInput.
@@ -291,6 +707,16 @@ cr_input_destroy (CRInput * a_this)
                         PRIVATE (a_this)->in_buf = NULL;
                 }
 
+                if (PRIVATE (a_this)->mapped_file) {
+                        g_mapped_file_unref (PRIVATE (a_this)->mapped_file);
+                        PRIVATE (a_this)->mapped_file = NULL;
+                }
+
+                if (PRIVATE (a_this)->stream) {
+                        g_free (PRIVATE (a_this)->stream);
+                        PRIVATE (a_this)->stream = NULL;
+                }
+
                 g_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
         }
@@ -457,17 +883,23 @@ cr_input_read_char (CRInput * a_this, guint32 * a_char)
         if (PRIVATE (a_this)->end_of_input == TRUE)
                 return CR_END_OF_INPUT_ERROR;
 
-        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        if (CR_INPUT_NEXT_BYTE_IS_ASCII (a_this)) {
+                *a_char = PRIVATE (a_this)->in_buf
+                        [PRIVATE (a_this)->next_byte_index];
+                consumed = 1;
+        } else {
+                nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
 
-        if (nb_bytes_left < 1) {
-                return CR_END_OF_INPUT_ERROR;
-        }
+                if (nb_bytes_left < 1) {
+                        return CR_END_OF_INPUT_ERROR;
+                }
 
-        status = cr_utils_read_char_from_utf8_buf
-                (PRIVATE (a_this)->in_buf
-                 +
-                 PRIVATE (a_this)->next_byte_index,
-                 nb_bytes_left, a_char, &consumed);
+                status = cr_utils_read_char_from_utf8_buf
+                        (PRIVATE (a_this)->in_buf
+                         +
+                         PRIVATE (a_this)->next_byte_index,
+                         nb_bytes_left, a_char, &consumed);
+        }
 
         if (status == CR_OK) {
                 /*update next byte index */
@@ -490,6 +922,73 @@ cr_input_read_char (CRInput * a_this, guint32 * a_char)
         return status;
 }
 
+/**
+ * cr_input_skip_ascii_chars:
+ *@a_this: the current instance of #CRInput.
+ *@a_nb_chars: the number of characters to skip.
+ *
+ *Skips the next a_nb_chars characters of the input, updating
+ *the line and column numbers just like a_nb_chars calls to
+ *cr_input_read_char() would. This is meant to move past a run
+ *of characters found by one of the cr_utils_span_*() scanners,
+ *without decoding it again: the next a_nb_chars bytes *MUST*
+ *all be ascii characters.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_input_skip_ascii_chars (CRInput * a_this, gulong a_nb_chars)
+{
+        const guchar *cur = NULL,
+                *end = NULL,
+                *nl = NULL;
+        glong nb_bytes_left = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        if (!a_nb_chars)
+                return CR_OK;
+        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        if (nb_bytes_left < 0)
+                return CR_ERROR;
+        if ((gulong) nb_bytes_left < a_nb_chars)
+                return CR_END_OF_INPUT_ERROR;
+
+        cur = PRIVATE (a_this)->in_buf + PRIVATE (a_this)->next_byte_index;
+        end = cur + a_nb_chars;
+        PRIVATE (a_this)->next_byte_index += a_nb_chars;
+
+        /*
+         *Handle the characters located between two newlines at once,
+         *and the newlines one by one, as cr_input_read_char() does.
+         */
+        while (cur < end) {
+                gulong run = 0;
+
+                nl = memchr (cur, '\n', end - cur);
+                run = (nl ? nl : end) - cur;
+                if (run) {
+                        if (PRIVATE (a_this)->end_of_line == TRUE) {
+                                PRIVATE (a_this)->col = 1;
+                                PRIVATE (a_this)->line++;
+                                PRIVATE (a_this)->end_of_line = FALSE;
+                                run--;
+                        }
+                        PRIVATE (a_this)->col += run;
+                }
+                if (!nl)
+                        break;
+                if (PRIVATE (a_this)->end_of_line == TRUE) {
+                        PRIVATE (a_this)->col = 1;
+                        PRIVATE (a_this)->line++;
+                }
+                PRIVATE (a_this)->end_of_line = TRUE;
+                cur = nl + 1;
+        }
+
+        return CR_OK;
+}
+
 /**
  * cr_input_set_line_num:
  *@a_this: the "this pointer" of the current instance of #CRInput.
@@ -704,13 +1203,30 @@ enum CRStatus
 cr_input_consume_white_spaces (CRInput * a_this, gulong * a_nb_chars)
 {
         enum CRStatus status = CR_OK;
-        guint32 cur_char = 0,
-                nb_consumed = 0;
+        guint32 cur_char = 0;
+        gulong nb_consumed = 0;
+        glong nb_bytes_left = 0;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this) && a_nb_chars,
                               CR_BAD_PARAM_ERROR);
 
-        for (nb_consumed = 0;
+        /*
+         *White spaces are ascii: skip the leading run of them
+         *without decoding it, then let the loop below stop
+         *on whatever follows.
+         */
+        nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
+        if (*a_nb_chars > 0 && nb_bytes_left > 0) {
+                gulong run = cr_utils_span_white_spaces
+                        (PRIVATE (a_this)->in_buf
+                         + PRIVATE (a_this)->next_byte_index,
+                         MIN (*a_nb_chars, (gulong) nb_bytes_left));
+
+                cr_input_skip_ascii_chars (a_this, run);
+                nb_consumed = run;
+        }
+
+        for (;
              ((*a_nb_chars > 0) && (nb_consumed < *a_nb_chars));
              nb_consumed++) {
                 status = cr_input_peek_char (a_this, &cur_char);
@@ -766,6 +1282,13 @@ cr_input_peek_char (CRInput const * a_this, guint32 * a_char)
                 return CR_END_OF_INPUT_ERROR;
         }
 
+        if (PRIVATE (a_this)->end_of_input == FALSE
+            && CR_INPUT_NEXT_BYTE_IS_ASCII (a_this)) {
+                *a_char = PRIVATE (a_this)->in_buf
+                        [PRIVATE (a_this)->next_byte_index];
+                return CR_OK;
+        }
+
         nb_bytes_left = cr_input_get_nb_bytes_left (a_this);
 
         if (nb_bytes_left < 1) {
@@ -1035,6 +1558,9 @@ cr_input_get_parsing_location (CRInput const *a_this,
         } else {
                 a_loc->byte_offset = PRIVATE (a_this)->next_byte_index  ;
         }
+        if (PRIVATE (a_this)->stream) {
+                a_loc->byte_offset += PRIVATE (a_this)->stream->base_offset ;
+        }
         return CR_OK ;
 }
 
@@ -1123,6 +1649,25 @@ cr_input_get_end_of_file (CRInput const * a_this, gboolean * a_eof)
         return CR_OK;
 }
 
+/**
+ * cr_input_is_ascii:
+ *@a_this: the current instance of #CRInput.
+ *
+ *Tells whether the whole input is known to be ascii. This is checked
+ *once, when the input is built (and as chunks are appended to a
+ *streaming input), so that reading characters does not need to
+ *decode utf8.
+ *
+ *Returns TRUE if each byte of the input is a character, FALSE otherwise.
+ */
+gboolean
+cr_input_is_ascii (CRInput const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), FALSE);
+
+        return PRIVATE (a_this)->is_ascii;
+}
+
 /**
  * cr_input_set_end_of_line:
  *@a_this: the current instance of #CRInput.
@@ -67,6 +67,20 @@ CRInput *
 cr_input_new_from_uri (const gchar *a_file_uri, 
                        enum CREncoding a_enc) ;
 
+CRInput *
+cr_input_new_from_mmap (const gchar *a_file_path,
+                        enum CREncoding a_enc) ;
+
+CRInput *
+cr_input_new_streaming (void) ;
+
+enum CRStatus
+cr_input_append_buf (CRInput *a_this, const guchar *a_buf,
+                     gulong a_len) ;
+
+enum CRStatus
+cr_input_next_window (CRInput *a_this, gboolean a_end_of_stream) ;
+
 void
 cr_input_destroy (CRInput *a_this) ;
 
@@ -82,6 +96,9 @@ cr_input_read_byte (CRInput *a_this, guchar *a_byte) ;
 enum CRStatus
 cr_input_read_char (CRInput *a_this, guint32 *a_char) ;
 
+enum CRStatus
+cr_input_skip_ascii_chars (CRInput *a_this, gulong a_nb_chars) ;
+
 enum CRStatus
 cr_input_consume_chars (CRInput *a_this, guint32 a_char, 
                         gulong *a_nb_char) ;
@@ -139,6 +156,9 @@ cr_input_set_end_of_line (CRInput *a_this, gboolean a_eol) ;
 enum CRStatus
 cr_input_get_end_of_file (CRInput const *a_this, gboolean *a_eof) ;
 
+gboolean
+cr_input_is_ascii (CRInput const *a_this) ;
+
 enum CRStatus
 cr_input_set_end_of_file (CRInput *a_this, gboolean a_eof) ;
 
@@ -0,0 +1,204 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+
+#include <string.h>
+#include "cr-libxml-node-iface.h"
+
+/**
+ *@CRLibxmlNodeIface:
+ *
+ *The #CRNodeIface of the libxml2 trees, the one the
+ *selection engine reads the nodes with by default.
+ */
+
+static gboolean
+is_element (CRXMLNodePtr a_node)
+{
+        return ((xmlNode *) a_node)->type == XML_ELEMENT_NODE;
+}
+
+static CRXMLNodePtr
+get_parent_element (CRXMLNodePtr a_node)
+{
+        xmlNode *cur_node = NULL;
+
+        g_return_val_if_fail (a_node, NULL);
+
+        cur_node = ((xmlNode *) a_node)->parent;
+        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
+                cur_node = cur_node->parent;
+        }
+        return cur_node;
+}
+
+static CRXMLNodePtr
+get_next_sibling_element (CRXMLNodePtr a_node)
+{
+        xmlNode *cur_node = NULL;
+
+        g_return_val_if_fail (a_node, NULL);
+
+        cur_node = ((xmlNode *) a_node)->next;
+        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
+                cur_node = cur_node->next;
+        }
+        return cur_node;
+}
+
+static CRXMLNodePtr
+get_first_child_element (CRXMLNodePtr a_node)
+{
+        xmlNode *cur_node = NULL;
+
+        g_return_val_if_fail (a_node, NULL);
+
+        cur_node = ((xmlNode *) a_node)->children;
+        if (!cur_node || cur_node->type == XML_ELEMENT_NODE)
+                return cur_node;
+        return get_next_sibling_element (cur_node);
+}
+
+static CRXMLNodePtr
+get_prev_sibling_element (CRXMLNodePtr a_node)
+{
+        xmlNode *cur_node = NULL;
+
+        g_return_val_if_fail (a_node, NULL);
+
+        cur_node = ((xmlNode *) a_node)->prev;
+        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
+                cur_node = cur_node->prev;
+        }
+        return cur_node;
+}
+
+static const gchar *
+get_local_name (CRXMLNodePtr a_node)
+{
+        return (const gchar *) ((xmlNode *) a_node)->name;
+}
+
+/**
+ *Reads an attribute of a node the way xmlGetProp() does, but
+ *without copying its value when the node (or its DTD) holds it
+ *as is, which is the common case.
+ *@param a_node the xml node to consider.
+ *@param a_name the name of the attribute.
+ *@param a_is_set out parameter. Set to TRUE if the node has the
+ *attribute, as xmlHasProp() says, FALSE otherwise.
+ *@param a_copy out parameter. Set to the value of the attribute
+ *if it had to be built, in which case the caller frees it with
+ *g_free(), to NULL otherwise.
+ *@return the value of the attribute, or NULL if xmlGetProp()
+ *would return NULL.
+ */
+static const gchar *
+get_attribute (CRXMLNodePtr a_node, const gchar * a_name,
+               gboolean * a_is_set, gchar ** a_copy)
+{
+        xmlAttr *prop = NULL;
+        xmlChar *value = NULL;
+
+        *a_is_set = FALSE;
+        *a_copy = NULL;
+        prop = xmlHasProp ((xmlNode *) a_node, (const xmlChar *) a_name);
+        if (!prop)
+                return NULL;
+        *a_is_set = TRUE;
+        if (prop->type == XML_ATTRIBUTE_DECL)
+                return (const gchar *)
+                        ((xmlAttribute *) prop)->defaultValue;
+        if (!prop->children)
+                return NULL;
+        if (!prop->children->next
+            && (prop->children->type == XML_TEXT_NODE
+                || prop->children->type == XML_CDATA_SECTION_NODE))
+                return (const gchar *) prop->children->content;
+        /*
+         *the value is made of several nodes (entity references),
+         *which is rare enough to copy it twice: the engine frees
+         *the copies with g_free().
+         */
+        value = xmlNodeListGetString (prop->doc, prop->children, 1);
+        if (!value)
+                return NULL;
+        *a_copy = g_strdup ((const gchar *) value);
+        xmlFree (value);
+        return *a_copy;
+}
+
+static const gchar *
+get_id (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return get_attribute (a_node, "id", &is_set, a_copy);
+}
+
+static const gchar *
+get_classes (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return get_attribute (a_node, "class", &is_set, a_copy);
+}
+
+static const gchar *
+get_lang (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return get_attribute (a_node, "lang", &is_set, a_copy);
+}
+
+static CRNodeIface const gv_libxml_node_iface = {
+        is_element,
+        get_parent_element,
+        get_first_child_element,
+        get_next_sibling_element,
+        get_prev_sibling_element,
+        get_local_name,
+        get_id,
+        get_classes,
+        get_attribute,
+        get_lang
+};
+
+/**
+ * cr_libxml_node_iface_get:
+ *
+ *The #CRNodeIface of the libxml2 trees: the nodes are xmlNode *,
+ *an element matches the type selectors of its local name, and its
+ *id, classes and language are its "id", "class" and "lang"
+ *attributes. This is the interface a #CRSelEng reads the nodes
+ *with, unless it is given another one with cr_sel_eng_set_node_iface().
+ *An xmlDoc * (cast to #CRXMLNodePtr) is not an element, but its
+ *first child element is its root element.
+ *
+ *Returns the interface, which is static and must not be freed.
+ */
+CRNodeIface const *
+cr_libxml_node_iface_get (void)
+{
+        return &gv_libxml_node_iface;
+}
@@ -0,0 +1,292 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#include <string.h>
+#include "cr-media-context.h"
+#include "cr-string.h"
+
+/**
+ *@CRMediaContext:
+ *
+ *The definition of the #CRMediaContext class.
+ */
+
+#define PRIVATE(a_this) (a_this)->priv
+
+/*
+ *the resolution of a media context that has not
+ *been given one: the css2 reference pixel.
+ */
+#define DEFAULT_RESOLUTION 96.0
+
+struct _CRMediaContextPriv {
+        /*the media type, lower cased*/
+        CRAtom media_type;
+        /*the size of the viewport in pixels, 0 if unknown*/
+        gdouble width;
+        gdouble height;
+        /*in dots per inch*/
+        gdouble resolution;
+        gint ref_count;
+};
+
+/**
+ * cr_media_context_new:
+ *@a_media_type: the media type to style for, like "screen"
+ *or "print". Media types are case insensitive.
+ *
+ *Constructor of the #CRMediaContext class.
+ *The viewport of the new context has an unknown size,
+ *and its resolution is 96 dots per inch.
+ *
+ *Returns the newly built instance of #CRMediaContext, or NULL
+ *if an error occurs.
+ */
+CRMediaContext *
+cr_media_context_new (const gchar * a_media_type)
+{
+        CRMediaContext *result = NULL;
+        gchar *type = NULL;
+
+        g_return_val_if_fail (a_media_type && *a_media_type, NULL);
+
+        result = g_try_malloc (sizeof (CRMediaContext));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRMediaContext));
+        PRIVATE (result) = g_try_malloc (sizeof (CRMediaContextPriv));
+        if (!PRIVATE (result)) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (result);
+                return NULL;
+        }
+        memset (PRIVATE (result), 0, sizeof (CRMediaContextPriv));
+
+        type = g_ascii_strdown (a_media_type, -1);
+        PRIVATE (result)->media_type = cr_atom_from_string (type);
+        g_free (type);
+        PRIVATE (result)->resolution = DEFAULT_RESOLUTION;
+        return result;
+}
+
+/**
+ * cr_media_context_get_media_type:
+ *@a_this: the current instance of #CRMediaContext.
+ *
+ *Returns the media type of the context, lower cased.
+ */
+CRAtom
+cr_media_context_get_media_type (CRMediaContext const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
+
+        return PRIVATE (a_this)->media_type;
+}
+
+/**
+ * cr_media_context_set_viewport:
+ *@a_this: the current instance of #CRMediaContext.
+ *@a_width: the width of the viewport, in pixels.
+ *@a_height: the height of the viewport, in pixels.
+ *
+ *Sets the size of the viewport. 0 means the size is unknown.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_media_context_set_viewport (CRMediaContext * a_this,
+                               gdouble a_width, gdouble a_height)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_width >= 0 && a_height >= 0,
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->width = a_width;
+        PRIVATE (a_this)->height = a_height;
+        return CR_OK;
+}
+
+/**
+ * cr_media_context_get_viewport:
+ *@a_this: the current instance of #CRMediaContext.
+ *@a_width: out parameter. The width of the viewport, in pixels.
+ *@a_height: out parameter. The height of the viewport, in pixels.
+ *
+ *Gets the size of the viewport.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_media_context_get_viewport (CRMediaContext const * a_this,
+                               gdouble * a_width, gdouble * a_height)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_width && a_height, CR_BAD_PARAM_ERROR);
+
+        *a_width = PRIVATE (a_this)->width;
+        *a_height = PRIVATE (a_this)->height;
+        return CR_OK;
+}
+
+/**
+ * cr_media_context_set_resolution:
+ *@a_this: the current instance of #CRMediaContext.
+ *@a_dpi: the resolution, in dots per inch.
+ *
+ *Sets the resolution of the medium.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_media_context_set_resolution (CRMediaContext * a_this, gdouble a_dpi)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_dpi > 0,
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->resolution = a_dpi;
+        return CR_OK;
+}
+
+/**
+ * cr_media_context_get_resolution:
+ *@a_this: the current instance of #CRMediaContext.
+ *
+ *Returns the resolution of the medium, in dots per inch.
+ */
+gdouble
+cr_media_context_get_resolution (CRMediaContext const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->resolution;
+}
+
+/**
+ * cr_media_context_matches_medium:
+ *@a_media_type: a lower cased media type, as returned by
+ *cr_media_context_get_media_type().
+ *@a_media_list: the media list of an \@media or an \@import
+ *rule, a list of #CRString.
+ *
+ *Returns TRUE if a rule with the media list @a_media_list applies
+ *to the media type @a_media_type, that is, if the list is empty,
+ *or holds the media type or "all", FALSE otherwise.
+ */
+gboolean
+cr_media_context_matches_medium (CRAtom a_media_type,
+                                 GList const * a_media_list)
+{
+        GList const *cur = NULL;
+
+        g_return_val_if_fail (a_media_type, FALSE);
+
+        if (!a_media_list)
+                return TRUE;
+        for (cur = a_media_list; cur; cur = cur->next) {
+                CRString *medium = cur->data;
+                const gchar *name = NULL;
+
+                if (!medium || !medium->stryng || !medium->stryng->str)
+                        continue;
+                name = medium->stryng->str;
+                if (!g_ascii_strcasecmp (name, "all")
+                    || !g_ascii_strcasecmp (name, a_media_type))
+                        return TRUE;
+        }
+        return FALSE;
+}
+
+/**
+ * cr_media_context_matches:
+ *@a_this: the current instance of #CRMediaContext.
+ *@a_media_list: the media list of an \@media or an \@import
+ *rule, a list of #CRString.
+ *
+ *Returns TRUE if a rule with the media list @a_media_list
+ *applies to the medium of the context, FALSE otherwise.
+ *See cr_media_context_matches_medium().
+ */
+gboolean
+cr_media_context_matches (CRMediaContext const * a_this,
+                          GList const * a_media_list)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), FALSE);
+
+        return cr_media_context_matches_medium
+                (PRIVATE (a_this)->media_type, a_media_list);
+}
+
+/**
+ * cr_media_context_ref:
+ *@a_this: the current instance of #CRMediaContext.
+ *
+ *Increases the reference count of the current instance.
+ */
+void
+cr_media_context_ref (CRMediaContext * a_this)
+{
+        g_return_if_fail (a_this && PRIVATE (a_this));
+
+        g_atomic_int_inc (&PRIVATE (a_this)->ref_count);
+}
+
+/**
+ * cr_media_context_unref:
+ *@a_this: the current instance of #CRMediaContext.
+ *
+ *Decreases the reference count of the current instance,
+ *and destroys it if the count reaches zero.
+ *
+ *Returns TRUE if the instance has been destroyed, FALSE otherwise.
+ */
+gboolean
+cr_media_context_unref (CRMediaContext * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), FALSE);
+
+        if (g_atomic_int_get (&PRIVATE (a_this)->ref_count) == 0
+            || g_atomic_int_dec_and_test (&PRIVATE (a_this)->ref_count)) {
+                cr_media_context_destroy (a_this);
+                return TRUE;
+        }
+        return FALSE;
+}
+
+/**
+ * cr_media_context_destroy:
+ *@a_this: the current instance of #CRMediaContext.
+ *
+ *The destructor of #CRMediaContext.
+ */
+void
+cr_media_context_destroy (CRMediaContext * a_this)
+{
+        g_return_if_fail (a_this);
+
+        if (PRIVATE (a_this)) {
+                g_free (PRIVATE (a_this));
+                PRIVATE (a_this) = NULL;
+        }
+        g_free (a_this);
+}
@@ -0,0 +1,85 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#ifndef __CR_MEDIA_CONTEXT_H__
+#define __CR_MEDIA_CONTEXT_H__
+
+#include "cr-utils.h"
+#include "cr-atom.h"
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRMediaContext class.
+ */
+
+typedef struct _CRMediaContext CRMediaContext ;
+typedef struct _CRMediaContextPriv CRMediaContextPriv ;
+
+/**
+ *The medium a document is styled for: its media type, the
+ *size of its viewport and its resolution.
+ *Set on a selection engine with cr_sel_eng_set_media_context(),
+ *it decides which \@media rules of the stylesheets apply.
+ *Only media types can be read from the \@media rules of a css2
+ *stylesheet, so the media type alone decides whether a rule
+ *applies; the viewport and the resolution are there for the
+ *pseudo class handlers and the applications that need them.
+ */
+struct _CRMediaContext
+{
+        CRMediaContextPriv *priv ;
+} ;
+
+CRMediaContext * cr_media_context_new (const gchar *a_media_type) ;
+
+CRAtom cr_media_context_get_media_type (CRMediaContext const *a_this) ;
+
+enum CRStatus cr_media_context_set_viewport (CRMediaContext *a_this,
+                                             gdouble a_width,
+                                             gdouble a_height) ;
+
+enum CRStatus cr_media_context_get_viewport (CRMediaContext const *a_this,
+                                             gdouble *a_width,
+                                             gdouble *a_height) ;
+
+enum CRStatus cr_media_context_set_resolution (CRMediaContext *a_this,
+                                               gdouble a_dpi) ;
+
+gdouble cr_media_context_get_resolution (CRMediaContext const *a_this) ;
+
+gboolean cr_media_context_matches_medium (CRAtom a_media_type,
+                                          GList const *a_media_list) ;
+
+gboolean cr_media_context_matches (CRMediaContext const *a_this,
+                                   GList const *a_media_list) ;
+
+void cr_media_context_ref (CRMediaContext *a_this) ;
+
+gboolean cr_media_context_unref (CRMediaContext *a_this) ;
+
+void cr_media_context_destroy (CRMediaContext *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_MEDIA_CONTEXT_H__*/
@@ -0,0 +1,117 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+
+#ifndef __CR_NODE_IFACE_H__
+#define __CR_NODE_IFACE_H__
+
+#include "cr-utils.h"
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRNodeIface interface.
+ */
+
+/**
+ *A node of the document the selection engine styles. The engine
+ *never looks into the node itself: it reads it through the
+ *#CRNodeIface it is given, see cr_sel_eng_set_node_iface().
+ *With the default interface, a node is an xmlNode *.
+ */
+typedef gpointer CRXMLNodePtr ;
+
+typedef struct _CRNodeIface CRNodeIface ;
+
+/**
+ *The functions the selection engine reads the nodes of a
+ *document with, so that documents held in another tree than
+ *a libxml2 one can be styled without being copied.
+ *All the members must be set. The strings returned are only read
+ *by the engine, during the selection; when one of them has to be
+ *built for the occasion, it is returned in the a_copy out parameter
+ *as well, for the engine to free it with g_free(); a_copy
+ *is set to NULL otherwise.
+ *The nodes must not be modified while the engine selects, and
+ *the functions must be thread safe if cr_sel_eng_style_document()
+ *is run in several threads.
+ *See cr_libxml_node_iface_get() for the default implementation.
+ */
+struct _CRNodeIface
+{
+        /**
+         *Returns TRUE if the node is an element. The other
+         *nodes are never matched by a selector.
+         */
+        gboolean (*is_element) (CRXMLNodePtr a_node) ;
+
+        /**Returns the parent element of the node, or NULL.*/
+        CRXMLNodePtr (*get_parent_element) (CRXMLNodePtr a_node) ;
+
+        /**Returns the first child element of the node, or NULL.*/
+        CRXMLNodePtr (*get_first_child_element) (CRXMLNodePtr a_node) ;
+
+        /**Returns the next sibling element of the node, or NULL.*/
+        CRXMLNodePtr (*get_next_sibling_element) (CRXMLNodePtr a_node) ;
+
+        /**Returns the previous sibling element of the node, or NULL.*/
+        CRXMLNodePtr (*get_prev_sibling_element) (CRXMLNodePtr a_node) ;
+
+        /**
+         *Returns the local name of an element, the one
+         *type selectors are compared to.
+         */
+        const gchar * (*get_local_name) (CRXMLNodePtr a_node) ;
+
+        /**Returns the id of an element, or NULL if it has none.*/
+        const gchar * (*get_id) (CRXMLNodePtr a_node, gchar **a_copy) ;
+
+        /**
+         *Returns the classes of an element, separated by
+         *white spaces, or NULL if it has none.
+         */
+        const gchar * (*get_classes) (CRXMLNodePtr a_node,
+                                      gchar **a_copy) ;
+
+        /**
+         *Returns the value of an attribute of an element. a_is_set
+         *is set to whether the element has the attribute at all, in
+         *which case the value may still be NULL when the attribute
+         *has none.
+         */
+        const gchar * (*get_attribute) (CRXMLNodePtr a_node,
+                                        const gchar *a_name,
+                                        gboolean *a_is_set,
+                                        gchar **a_copy) ;
+
+        /**
+         *Returns the language declared on the element itself,
+         *the one :lang() compares to, or NULL if it declares none.
+         *The engine looks the ancestors of the element up itself.
+         */
+        const gchar * (*get_lang) (CRXMLNodePtr a_node, gchar **a_copy) ;
+} ;
+
+G_END_DECLS
+
+#endif /*__CR_NODE_IFACE_H__*/
@@ -30,6 +30,7 @@
  */
 
 #include "cr-num.h"
+#include "cr-arena.h"
 #include "string.h"
 
 /**
@@ -45,7 +46,7 @@ cr_num_new (void)
 {
         CRNum *result = NULL;
 
-        result = g_try_malloc (sizeof (CRNum));
+        result = cr_arena_node_try_alloc (sizeof (CRNum));
 
         if (result == NULL) {
                 cr_utils_trace_info ("Out of memory");
@@ -309,5 +310,5 @@ cr_num_destroy (CRNum * a_this)
 {
         g_return_if_fail (a_this);
 
-        g_free (a_this);
+        cr_arena_node_free (sizeof (CRNum), a_this);
 }
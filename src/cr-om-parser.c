@@ -24,6 +24,11 @@
 #include <string.h>
 #include "cr-utils.h"
 #include "cr-om-parser.h"
+#include "cr-arena.h"
+#include "cr-enc-handler.h"
+#ifdef G_OS_UNIX
+#include <stdlib.h>
+#endif
 
 /**
  *@CROMParser:
@@ -35,10 +40,55 @@
 
 struct _CROMParserPriv {
         CRParser *parser;
+
+        /*
+         *if TRUE, each parsed stylesheet gets an arena
+         *its nodes are allocated in.
+         */
+        gboolean use_arena;
+
+        /*
+         *the number of threads a stylesheet is parsed with.
+         *See cr_om_parser_set_nb_threads().
+         */
+        guint nb_threads;
+
+        /*
+         *if TRUE, cr_om_parser_parse_file() parses the stylesheets
+         *imported by the ones it parses.
+         *See cr_om_parser_set_resolve_imports().
+         */
+        gboolean resolve_imports;
+
+        /*
+         *the stylesheets imported so far, keyed by canonical path.
+         *The table holds a reference on each of them, so a stylesheet
+         *imported by several others is parsed once per parser.
+         */
+        GHashTable *imported_sheets;
+
+        /*
+         *the canonical paths of the stylesheets whose imports
+         *are being resolved, innermost first. Used to detect
+         *circular imports.
+         */
+        GSList *import_stack;
 };
 
+/**
+ *The number of nested \@import rules followed by
+ *cr_om_parser_parse_file().
+ */
+#define MAX_IMPORT_DEPTH 32
+
 #define PRIVATE(a_this) ((a_this)->priv)
 
+/**
+ *The smallest number of bytes worth being parsed
+ *by a thread of its own, see cr_om_parser_set_nb_threads().
+ */
+#define PARALLEL_MIN_CHUNK_SIZE (64 * 1024)
+
 /*
  *Forward declaration of a type defined later
  *in this file.
@@ -46,6 +96,9 @@ struct _CROMParserPriv {
 struct _ParsingContext;
 typedef struct _ParsingContext ParsingContext;
 
+struct _ParsingChunk;
+typedef struct _ParsingChunk ParsingChunk;
+
 static ParsingContext *new_parsing_context (void);
 
 static void destroy_context (ParsingContext * a_ctxt);
@@ -98,12 +151,47 @@ static void import_style (CRDocHandler * a_this,
                           CRString * a_uri_default_ns,
                           CRParsingLocation *a_location);
 
+static void chunk_error (CRDocHandler * a_this);
+
+static void chunk_unrecoverable_error (CRDocHandler * a_this);
+
 struct _ParsingContext {
         CRStyleSheet *stylesheet;
         CRStatement *cur_stmt;
         CRStatement *cur_media_stmt;
 };
 
+/**
+ *A slice of a stylesheet parsed on its own, by one of
+ *the threads of a parallel parsing. See parse_buf_in_parallel().
+ */
+struct _ParsingChunk {
+        /*the whole utf8 encoded stylesheet*/
+        const guchar *buf;
+
+        /*
+         *The position of the first byte of the chunk in buf,
+         *with the line and column numbers the parsing
+         *of the whole stylesheet would have there.
+         */
+        CRInputPos start;
+
+        /*the index of the byte that follows the chunk*/
+        gulong end;
+
+        gboolean use_arena;
+
+        /*the result of the parsing of the chunk*/
+        enum CRStatus status;
+        CRStyleSheet *stylesheet;
+
+        /*
+         *the number of syntax errors reported while
+         *parsing the chunk, recovered from or not.
+         */
+        gulong nb_errors;
+};
+
 /********************************************
  *Private methods
  ********************************************/
@@ -778,6 +866,453 @@ unrecoverable_error (CRDocHandler * a_this)
         }
 }
 
+/**
+ *Makes a new arena the current one of the thread if
+ *the parser is in arena mode.
+ *@param a_this the current instance of #CROMParser.
+ *@param a_arena out parameter. The new arena, or NULL
+ *if the parser is not in arena mode.
+ *@return the previous current arena.
+ */
+static CRArena *
+begin_arena_parsing (CROMParser * a_this, CRArena ** a_arena)
+{
+        *a_arena = NULL;
+        if (!PRIVATE (a_this)->use_arena)
+                return cr_arena_get_current ();
+
+        *a_arena = cr_arena_new (0);
+        if (!*a_arena)
+                return cr_arena_get_current ();
+        return cr_arena_set_current (*a_arena);
+}
+
+/**
+ *Ends a parsing started by begin_arena_parsing().
+ *Whatever the parser still holds from the parsing is dropped
+ *while the arena is still current. The arena is then handed
+ *over to the resulting stylesheet, or destroyed if there is none.
+ *@param a_this the current instance of #CROMParser.
+ *@param a_arena the arena returned by begin_arena_parsing().
+ *@param a_prev_arena the arena to make current again.
+ *@param a_result the resulting stylesheet, if any.
+ */
+static void
+end_arena_parsing (CROMParser * a_this, CRArena * a_arena,
+                   CRArena * a_prev_arena, CRStyleSheet * a_result)
+{
+        CRDocHandler *sac_handler = NULL;
+        CRStyleSheet *leftover = NULL;
+        CRStyleSheet **leftoverptr = NULL;
+        ParsingContext *ctxt = NULL;
+        ParsingContext **ctxtptr = NULL;
+
+        if (!a_arena)
+                return;
+
+        cr_parser_set_tknzr (PRIVATE (a_this)->parser, NULL);
+        cr_parser_get_sac_handler (PRIVATE (a_this)->parser, &sac_handler);
+        if (sac_handler) {
+                leftoverptr = &leftover;
+                cr_doc_handler_get_result (sac_handler,
+                                           (gpointer *) leftoverptr);
+                if (leftover && leftover != a_result)
+                        cr_stylesheet_destroy (leftover);
+                cr_doc_handler_set_result (sac_handler, NULL);
+
+                ctxtptr = &ctxt;
+                cr_doc_handler_get_ctxt (sac_handler, (gpointer *) ctxtptr);
+                if (ctxt) {
+                        destroy_context (ctxt);
+                        cr_doc_handler_set_ctxt (sac_handler, NULL);
+                }
+        }
+        cr_arena_set_current (a_prev_arena);
+
+        if (a_result)
+                a_result->arena = a_arena;
+        else
+                cr_arena_destroy (a_arena);
+}
+
+static void
+chunk_error (CRDocHandler * a_this)
+{
+        ParsingChunk *chunk = NULL;
+
+        g_return_if_fail (a_this && a_this->app_data);
+
+        chunk = a_this->app_data;
+        chunk->nb_errors++;
+        error (a_this);
+}
+
+static void
+chunk_unrecoverable_error (CRDocHandler * a_this)
+{
+        ParsingChunk *chunk = NULL;
+
+        g_return_if_fail (a_this && a_this->app_data);
+
+        chunk = a_this->app_data;
+        chunk->nb_errors++;
+        unrecoverable_error (a_this);
+}
+
+/**
+ *Splits an utf8 stylesheet in chunks of about the same size
+ *that can be parsed independently. The chunks end with a '}'
+ *that closes a top level statement, found by a scan that skips
+ *strings, comments and escaped characters, like the one of the
+ *streaming inputs. A chunk only starts with a statement that
+ *may follow a ruleset (not with a @charset nor an @import), on
+ *a line of its own so that the columns are those of the parsing
+ *of the whole stylesheet.
+ *@param a_buf the stylesheet.
+ *@param a_len the length of a_buf.
+ *@param a_chunks out parameter. The chunks. Only their start
+ *and end fields are set.
+ *@param a_nb_chunks the number of chunks wanted.
+ *@return the number of chunks a_buf has been split in,
+ *between 1 and a_nb_chunks.
+ */
+static guint
+split_in_chunks (const guchar * a_buf, gulong a_len,
+                 ParsingChunk * a_chunks, guint a_nb_chunks)
+{
+        CRInputPos pos;
+        guint nb_chunks = 1,
+                block_depth = 0;
+        gulong i = 0,
+                j = 0,
+                target = 0;
+        guchar c = 0,
+                quote = 0;
+        gboolean in_comment = FALSE,
+                comment_star = FALSE,
+                escaped = FALSE,
+                new_line = FALSE;
+
+        memset (&pos, 0, sizeof (CRInputPos));
+        pos.line = 1;
+        a_chunks[0].start = pos;
+        target = a_len / a_nb_chunks;
+
+        for (i = 0; i < a_len && nb_chunks < a_nb_chunks; i++) {
+                c = a_buf[i];
+
+                /*
+                 *update the location as cr_input_read_char() does,
+                 *only the first byte of an utf8 char counts.
+                 */
+                if ((c & 0xC0) != 0x80) {
+                        if (pos.end_of_line == TRUE) {
+                                pos.col = 1;
+                                pos.line++;
+                                pos.end_of_line = FALSE;
+                        } else if (c != '\n') {
+                                pos.col++;
+                        }
+                        if (c == '\n')
+                                pos.end_of_line = TRUE;
+                }
+
+                if (escaped == TRUE) {
+                        escaped = FALSE;
+                        continue;
+                }
+                if (in_comment == TRUE) {
+                        if (c == '/' && comment_star == TRUE)
+                                in_comment = FALSE;
+                        comment_star = (c == '*');
+                        continue;
+                }
+                if (c == '\\') {
+                        escaped = TRUE;
+                        continue;
+                }
+                if (quote) {
+                        if (c == quote || c == '\n')
+                                quote = 0;
+                        continue;
+                }
+
+                switch (c) {
+                case '/':
+                        if (i + 1 < a_len && a_buf[i + 1] == '*') {
+                                /*the '*' of "/ *" does not end a comment*/
+                                in_comment = TRUE;
+                                comment_star = FALSE;
+                                pos.col++;
+                                i++;
+                        }
+                        break;
+                case '"':
+                case '\'':
+                        quote = c;
+                        break;
+                case '{':
+                        block_depth++;
+                        break;
+                case '}':
+                        if (block_depth)
+                                block_depth--;
+                        if (block_depth || i + 1 < target)
+                                break;
+
+                        new_line = FALSE;
+                        for (j = i + 1;
+                             j < a_len && cr_utils_is_white_space (a_buf[j]);
+                             j++) {
+                                if (a_buf[j] == '\n')
+                                        new_line = TRUE;
+                        }
+                        if (new_line == FALSE || j == a_len)
+                                break;
+                        if (a_buf[j] == '@' && j + 1 < a_len
+                            && (g_ascii_tolower (a_buf[j + 1]) == 'c'
+                                || g_ascii_tolower (a_buf[j + 1]) == 'i'))
+                                break;
+
+                        a_chunks[nb_chunks - 1].end = i + 1;
+                        a_chunks[nb_chunks].start = pos;
+                        a_chunks[nb_chunks].start.next_byte_index = i + 1;
+                        nb_chunks++;
+                        target = (a_len / a_nb_chunks) * nb_chunks;
+                        break;
+                default:
+                        break;
+                }
+        }
+        a_chunks[nb_chunks - 1].end = a_len;
+
+        return nb_chunks;
+}
+
+/**
+ *Parses a chunk of a stylesheet with an object model
+ *parser of its own. This is run by the threads of
+ *parse_buf_in_parallel().
+ *@param a_chunk the chunk to parse, a #ParsingChunk.
+ *@param a_user_data unused.
+ */
+static void
+parse_chunk (gpointer a_chunk, gpointer a_user_data)
+{
+        ParsingChunk *chunk = a_chunk;
+        CROMParser *om_parser = NULL;
+        CRInput *input = NULL;
+        CRDocHandler *sac_handler = NULL;
+        CRArena *arena = NULL,
+                *prev_arena = NULL;
+        CRStyleSheet *result = NULL;
+        CRStyleSheet **resultptr = NULL;
+
+        (void) a_user_data;
+
+        chunk->status = CR_ERROR;
+        chunk->stylesheet = NULL;
+        chunk->nb_errors = 0;
+
+        input = cr_input_new_from_buf ((guchar *) chunk->buf, chunk->end,
+                                       CR_UTF_8, FALSE);
+        g_return_if_fail (input);
+        cr_input_set_cur_pos (input, &chunk->start);
+
+        om_parser = cr_om_parser_new (input);
+        if (!om_parser) {
+                cr_input_destroy (input);
+                return;
+        }
+        PRIVATE (om_parser)->use_arena = chunk->use_arena;
+
+        cr_parser_get_sac_handler (PRIVATE (om_parser)->parser,
+                                   &sac_handler);
+        sac_handler->app_data = chunk;
+        sac_handler->error = chunk_error;
+        sac_handler->unrecoverable_error = chunk_unrecoverable_error;
+
+        prev_arena = begin_arena_parsing (om_parser, &arena);
+
+        chunk->status = cr_parser_parse (PRIVATE (om_parser)->parser);
+
+        resultptr = &result;
+        cr_doc_handler_get_result (sac_handler, (gpointer *) resultptr);
+        if (chunk->status != CR_OK && result && !arena) {
+                /*the stylesheet an unrecoverable error left behind*/
+                cr_stylesheet_destroy (result);
+        }
+        if (chunk->status == CR_OK)
+                chunk->stylesheet = result;
+
+        end_arena_parsing (om_parser, arena, prev_arena,
+                           chunk->stylesheet);
+        cr_om_parser_destroy (om_parser);
+}
+
+/**
+ *Parses an in memory buffer in several threads.
+ *The buffer is split in chunks of top level statements (see
+ *split_in_chunks()) that are parsed concurrently, each with an
+ *object model parser of its own. The statements of the chunks
+ *are then put back together, in order, in the resulting stylesheet.
+ *
+ *A chunk is only kept if its parsing did not report any syntax
+ *error: the error recovery of the parser might then have crossed
+ *the end of the chunk. The first chunk that has errors is parsed
+ *again with everything that follows it, in the calling thread,
+ *so the result is always the one of the parsing of the whole buffer.
+ *@param a_this the current instance of #CROMParser.
+ *@param a_buf the buffer to parse.
+ *@param a_len the length of a_buf.
+ *@param a_enc the encoding of a_buf.
+ *@param a_result out parameter. The resulting stylesheet.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+parse_buf_in_parallel (CROMParser * a_this,
+                       const guchar * a_buf,
+                       gulong a_len,
+                       enum CREncoding a_enc, CRStyleSheet ** a_result)
+{
+        enum CRStatus status = CR_OK;
+        CREncHandler *enc_handler = NULL;
+        guchar *utf8_buf = NULL;
+        gulong utf8_len = 0,
+                len = a_len;
+        ParsingChunk *chunks = NULL;
+        GThreadPool *pool = NULL;
+        CRStyleSheet *result = NULL,
+                *sheet = NULL;
+        CRStatement *tail = NULL,
+                *cur = NULL,
+                *rule = NULL;
+        guint nb_chunks = 0,
+                nb_kept = 0,
+                i = 0;
+
+        if (a_enc != CR_UTF_8) {
+                enc_handler = cr_enc_handler_get_instance (a_enc);
+                if (!enc_handler)
+                        return CR_ENCODING_NOT_FOUND_ERROR;
+                status = cr_enc_handler_convert_input
+                        (enc_handler, a_buf, &len, &utf8_buf, &utf8_len);
+                if (status != CR_OK)
+                        return status;
+                a_buf = utf8_buf;
+                a_len = utf8_len;
+        }
+
+        nb_chunks = MIN (PRIVATE (a_this)->nb_threads,
+                         MAX (a_len / PARALLEL_MIN_CHUNK_SIZE, 1));
+        chunks = g_try_malloc (nb_chunks * sizeof (ParsingChunk));
+        if (!chunks) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (utf8_buf);
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        memset (chunks, 0, nb_chunks * sizeof (ParsingChunk));
+
+        nb_chunks = split_in_chunks (a_buf, a_len, chunks, nb_chunks);
+        for (i = 0; i < nb_chunks; i++) {
+                chunks[i].buf = a_buf;
+                chunks[i].use_arena = PRIVATE (a_this)->use_arena;
+        }
+
+        /*
+         *the calling thread parses the first chunk,
+         *the pool the others.
+         */
+        if (nb_chunks > 1)
+                pool = g_thread_pool_new (parse_chunk, NULL, nb_chunks - 1,
+                                          FALSE, NULL);
+        for (i = 1; i < nb_chunks; i++) {
+                if (pool)
+                        g_thread_pool_push (pool, &chunks[i], NULL);
+                else
+                        parse_chunk (&chunks[i], NULL);
+        }
+        parse_chunk (&chunks[0], NULL);
+        if (pool)
+                g_thread_pool_free (pool, FALSE, TRUE);
+
+        /*
+         *the last chunk ends with the buffer, so
+         *it is kept whatever its errors are.
+         */
+        for (nb_kept = 0; nb_kept < nb_chunks - 1; nb_kept++) {
+                if (!chunks[nb_kept].stylesheet
+                    || chunks[nb_kept].nb_errors)
+                        break;
+        }
+        if (nb_kept < nb_chunks - 1) {
+                for (i = nb_kept; i < nb_chunks; i++) {
+                        if (chunks[i].stylesheet)
+                                cr_stylesheet_destroy (chunks[i].stylesheet);
+                }
+                chunks[nb_kept].end = a_len;
+                parse_chunk (&chunks[nb_kept], NULL);
+                nb_chunks = nb_kept + 1;
+        }
+        status = chunks[nb_chunks - 1].status;
+
+        /*
+         *splice the statements of the chunks
+         *into the stylesheet of the first one.
+         */
+        for (i = 0; i < nb_chunks; i++) {
+                sheet = chunks[i].stylesheet;
+                if (!sheet)
+                        continue;
+                if (!result) {
+                        result = sheet;
+                        for (tail = result->statements;
+                             tail && tail->next; tail = tail->next) ;
+                        continue;
+                }
+                for (cur = sheet->statements; cur; cur = cur->next) {
+                        cur->parent_sheet = result;
+                        if (cur->type != AT_MEDIA_RULE_STMT
+                            || !cur->kind.media_rule)
+                                continue;
+                        for (rule = cur->kind.media_rule->rulesets;
+                             rule; rule = rule->next)
+                                rule->parent_sheet = result;
+                }
+                if (sheet->statements) {
+                        if (tail) {
+                                tail->next = sheet->statements;
+                                sheet->statements->prev = tail;
+                        } else {
+                                result->statements = sheet->statements;
+                        }
+                        for (tail = sheet->statements;
+                             tail->next; tail = tail->next) ;
+                        sheet->statements = NULL;
+                }
+                if (sheet->arena) {
+                        if (result->arena)
+                                cr_arena_merge (result->arena, sheet->arena);
+                        else
+                                result->arena = sheet->arena;
+                        sheet->arena = NULL;
+                }
+                cr_stylesheet_destroy (sheet);
+        }
+
+        g_free (chunks);
+        g_free (utf8_buf);
+
+        if (status != CR_OK) {
+                if (result)
+                        cr_stylesheet_destroy (result);
+                return status;
+        }
+        if (result)
+                *a_result = result;
+        return CR_OK;
+}
+
 /********************************************
  *Public methods
  ********************************************/
@@ -856,33 +1391,47 @@ cr_om_parser_parse_buf (CROMParser * a_this,
 {
 
         enum CRStatus status = CR_OK;
+        CRStyleSheet *result = NULL;
+        CRArena *arena = NULL,
+                *prev_arena = NULL;
 
         g_return_val_if_fail (a_this && a_result, CR_BAD_PARAM_ERROR);
 
+        if (PRIVATE (a_this)->nb_threads > 1
+            && a_len >= 2 * PARALLEL_MIN_CHUNK_SIZE) {
+                return parse_buf_in_parallel (a_this, a_buf, a_len,
+                                              a_enc, a_result);
+        }
+
         if (!PRIVATE (a_this)->parser) {
                 PRIVATE (a_this)->parser = cr_parser_new (NULL);
         }
 
+        prev_arena = begin_arena_parsing (a_this, &arena);
+
         status = cr_parser_parse_buf (PRIVATE (a_this)->parser,
                                       a_buf, a_len, a_enc);
 
         if (status == CR_OK) {
-                CRStyleSheet *result = NULL;
                 CRStyleSheet **resultptr = NULL;
                 CRDocHandler *sac_handler = NULL;
 
                 cr_parser_get_sac_handler (PRIVATE (a_this)->parser,
                                            &sac_handler);
-                g_return_val_if_fail (sac_handler, CR_ERROR);
 		resultptr = &result;
-                status = cr_doc_handler_get_result (sac_handler,
-                                                    (gpointer *) resultptr);
-                g_return_val_if_fail (status == CR_OK, status);
-
-                if (result)
-                        *a_result = result;
+                if (sac_handler)
+                        status = cr_doc_handler_get_result
+                                (sac_handler, (gpointer *) resultptr);
+                else
+                        status = CR_ERROR;
         }
 
+        end_arena_parsing (a_this, arena, prev_arena,
+                           status == CR_OK ? result : NULL);
+
+        if (status == CR_OK && result)
+                *a_result = result;
+
         return status;
 }
 
@@ -925,56 +1474,324 @@ cr_om_parser_simply_parse_buf (const guchar * a_buf,
 }
 
 /**
- * cr_om_parser_parse_file:
- *@a_this: the current instance of the cssom parser.
- *@a_file_uri: the uri of the file. 
- *(only local file paths are suppported so far)
- *@a_enc: the encoding of the file.
- *@a_result: out parameter. A pointer 
- *the build css object model.
- *
- *Parses a css2 stylesheet contained
- *in a file.
- *
- * Returns CR_OK upon succesful completion, an error code otherwise.
+ *Parses a stylesheet contained in a file, leaving its
+ *\@import rules unresolved.
+ *See cr_om_parser_parse_file() for the parameters.
  */
-enum CRStatus
-cr_om_parser_parse_file (CROMParser * a_this,
-                         const guchar * a_file_uri,
-                         enum CREncoding a_enc, CRStyleSheet ** a_result)
+static enum CRStatus
+parse_file (CROMParser * a_this,
+            const guchar * a_file_uri,
+            enum CREncoding a_enc, CRStyleSheet ** a_result)
 {
         enum CRStatus status = CR_OK;
+        CRStyleSheet *result = NULL;
+        GMappedFile *mapped_file = NULL;
+        CRArena *arena = NULL,
+                *prev_arena = NULL;
 
         g_return_val_if_fail (a_this && a_file_uri && a_result,
                               CR_BAD_PARAM_ERROR);
 
+        if (PRIVATE (a_this)->nb_threads > 1) {
+                /*
+                 *the file is parsed in parallel as
+                 *an in memory buffer.
+                 */
+                mapped_file = g_mapped_file_new ((const gchar *) a_file_uri,
+                                                 FALSE, NULL);
+                if (mapped_file && g_mapped_file_get_length (mapped_file)) {
+                        status = cr_om_parser_parse_buf
+                                (a_this,
+                                 (const guchar *) g_mapped_file_get_contents
+                                 (mapped_file),
+                                 g_mapped_file_get_length (mapped_file),
+                                 a_enc, a_result);
+                        g_mapped_file_unref (mapped_file);
+                        return status;
+                }
+                if (mapped_file)
+                        g_mapped_file_unref (mapped_file);
+        }
+
         if (!PRIVATE (a_this)->parser) {
                 PRIVATE (a_this)->parser = cr_parser_new_from_file
                         (a_file_uri, a_enc);
         }
 
+        prev_arena = begin_arena_parsing (a_this, &arena);
+
         status = cr_parser_parse_file (PRIVATE (a_this)->parser,
                                        a_file_uri, a_enc);
 
         if (status == CR_OK) {
-                CRStyleSheet *result = NULL;
                 CRStyleSheet **resultptr = NULL;
                 CRDocHandler *sac_handler = NULL;
 
                 cr_parser_get_sac_handler (PRIVATE (a_this)->parser,
                                            &sac_handler);
-                g_return_val_if_fail (sac_handler, CR_ERROR);
 		resultptr = &result;
-                status = cr_doc_handler_get_result
-                        (sac_handler, (gpointer *) resultptr);
-                g_return_val_if_fail (status == CR_OK, status);
-                if (result)
-                        *a_result = result;
+                if (sac_handler)
+                        status = cr_doc_handler_get_result
+                                (sac_handler, (gpointer *) resultptr);
+                else
+                        status = CR_ERROR;
         }
 
+        end_arena_parsing (a_this, arena, prev_arena,
+                           status == CR_OK ? result : NULL);
+
+        if (status == CR_OK && result)
+                *a_result = result;
+
         return status;
 }
 
+/**
+ *Computes the canonical path of a stylesheet, so that the
+ *different urls a stylesheet is imported by all lead to the
+ *same entry of the cache of the parser.
+ *@param a_path the path of the stylesheet.
+ *@return the canonical path, to be freed with g_free(),
+ *or NULL if the file could not be found.
+ */
+static gchar *
+get_canonical_path (const gchar * a_path)
+{
+#ifdef G_OS_UNIX
+        char *real_path = NULL;
+        gchar *result = NULL;
+
+        real_path = realpath (a_path, NULL);
+        if (!real_path)
+                return NULL;
+        result = g_strdup (real_path);
+        free (real_path);
+        return result;
+#else
+        return g_strdup (a_path);
+#endif
+}
+
+/**
+ *Computes the canonical path of the stylesheet an \@import
+ *rule points to. Only local files are supported: the url is
+ *either a path, absolute or relative to the importing
+ *stylesheet, or a "file://" url.
+ *@param a_importer_path the canonical path of the
+ *importing stylesheet.
+ *@param a_url the url of the \@import rule.
+ *@return the canonical path, to be freed with g_free(),
+ *or NULL if the url can not be resolved.
+ */
+static gchar *
+get_import_path (const gchar * a_importer_path, const gchar * a_url)
+{
+        gchar *dir = NULL,
+                *path = NULL,
+                *result = NULL;
+
+        g_return_val_if_fail (a_importer_path && a_url, NULL);
+
+        if (g_str_has_prefix (a_url, "file://"))
+                a_url += strlen ("file://");
+        else if (strstr (a_url, "://"))
+                return NULL;
+        if (!*a_url)
+                return NULL;
+
+        if (g_path_is_absolute (a_url))
+                return get_canonical_path (a_url);
+        dir = g_path_get_dirname (a_importer_path);
+        path = g_build_filename (dir, a_url, NULL);
+        g_free (dir);
+        result = get_canonical_path (path);
+        g_free (path);
+        return result;
+}
+
+/**
+ *Tells whether a stylesheet is being imported already,
+ *that is, whether importing it again would make a cycle.
+ */
+static gboolean
+is_being_imported (CROMParser * a_this, const gchar * a_path)
+{
+        GSList *cur = NULL;
+
+        for (cur = PRIVATE (a_this)->import_stack; cur; cur = cur->next) {
+                if (!strcmp ((const gchar *) cur->data, a_path))
+                        return TRUE;
+        }
+        return FALSE;
+}
+
+/**
+ *Drops the reference the cache of the imported stylesheets
+ *holds on a stylesheet, as a #GDestroyNotify.
+ *@param a_sheet the #CRStyleSheet to unref.
+ */
+static void
+unref_stylesheet (gpointer a_sheet)
+{
+        cr_stylesheet_unref (a_sheet);
+}
+
+/**
+ *Parses the stylesheets the \@import rules of a stylesheet
+ *point to, and the ones they import in turn, and attaches them
+ *to the rules with cr_stylesheet_set_imported_sheet().
+ *A stylesheet is looked up in the cache of the parser before
+ *being parsed, so it is parsed once however many stylesheets
+ *import it. The \@import rules that can not be resolved, and
+ *the ones that would make a cycle, are left unresolved.
+ *@param a_this the current instance of #CROMParser.
+ *@param a_sheet the importing stylesheet.
+ *@param a_path the canonical path of @a_sheet.
+ *@param a_enc the encoding of the stylesheets.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+resolve_imports (CROMParser * a_this, CRStyleSheet * a_sheet,
+                 const gchar * a_path, enum CREncoding a_enc)
+{
+        enum CRStatus status = CR_OK;
+        CRStatement *cur = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_sheet && a_path, CR_BAD_PARAM_ERROR);
+
+        if (g_slist_length (PRIVATE (a_this)->import_stack)
+            >= MAX_IMPORT_DEPTH) {
+                cr_utils_trace_info ("@import rules nested too deep");
+                return CR_OK;
+        }
+        if (!PRIVATE (a_this)->imported_sheets) {
+                PRIVATE (a_this)->imported_sheets = g_hash_table_new_full
+                        (g_str_hash, g_str_equal, g_free,
+                         unref_stylesheet);
+                if (!PRIVATE (a_this)->imported_sheets) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_ERROR;
+                }
+        }
+        PRIVATE (a_this)->import_stack = g_slist_prepend
+                (PRIVATE (a_this)->import_stack, (gpointer) a_path);
+
+        for (cur = a_sheet->statements; cur; cur = cur->next) {
+                CRAtImportRule *rule = NULL;
+                CRStyleSheet *imported = NULL;
+                gchar *path = NULL;
+
+                if (cur->type != AT_IMPORT_RULE_STMT)
+                        continue;
+                rule = cur->kind.import_rule;
+                if (!rule || rule->sheet
+                    || !rule->url || !rule->url->stryng
+                    || !rule->url->stryng->str)
+                        continue;
+                path = get_import_path (a_path, rule->url->stryng->str);
+                if (!path) {
+                        cr_utils_trace_info ("Could not resolve "
+                                             "an @import rule");
+                        continue;
+                }
+                if (is_being_imported (a_this, path) == TRUE) {
+                        cr_utils_trace_info ("Circular @import rule "
+                                             "ignored");
+                        g_free (path);
+                        continue;
+                }
+                imported = g_hash_table_lookup
+                        (PRIVATE (a_this)->imported_sheets, path);
+                if (!imported) {
+                        status = parse_file (a_this, (const guchar *) path,
+                                             a_enc, &imported);
+                        if (status != CR_OK || !imported) {
+                                cr_utils_trace_info ("Could not parse "
+                                                     "an imported "
+                                                     "stylesheet");
+                                g_free (path);
+                                status = CR_OK;
+                                continue;
+                        }
+                        /*
+                         *the cache now owns the path and holds
+                         *a reference on the sheet.
+                         */
+                        cr_stylesheet_ref (imported);
+                        g_hash_table_insert
+                                (PRIVATE (a_this)->imported_sheets,
+                                 path, imported);
+                        status = resolve_imports (a_this, imported,
+                                                  path, a_enc);
+                        path = NULL;
+                        if (status != CR_OK)
+                                break;
+                } else {
+                        g_free (path);
+                        path = NULL;
+                }
+                status = cr_stylesheet_set_imported_sheet
+                        (a_sheet, cur, imported);
+                if (status != CR_OK)
+                        break;
+        }
+
+        PRIVATE (a_this)->import_stack = g_slist_delete_link
+                (PRIVATE (a_this)->import_stack,
+                 PRIVATE (a_this)->import_stack);
+        return status;
+}
+
+/**
+ * cr_om_parser_parse_file:
+ *@a_this: the current instance of the cssom parser.
+ *@a_file_uri: the uri of the file. 
+ *(only local file paths are suppported so far)
+ *@a_enc: the encoding of the file.
+ *@a_result: out parameter. A pointer 
+ *the build css object model.
+ *
+ *Parses a css2 stylesheet contained
+ *in a file. If the parser resolves imports, see
+ *cr_om_parser_set_resolve_imports(), the stylesheets
+ *the \@import rules point to are parsed too.
+ *
+ * Returns CR_OK upon succesful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_parse_file (CROMParser * a_this,
+                         const guchar * a_file_uri,
+                         enum CREncoding a_enc, CRStyleSheet ** a_result)
+{
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *result = NULL;
+        gchar *path = NULL;
+
+        g_return_val_if_fail (a_this && a_file_uri && a_result,
+                              CR_BAD_PARAM_ERROR);
+
+        status = parse_file (a_this, a_file_uri, a_enc, &result);
+        if (status != CR_OK || !result)
+                return status;
+
+        if (PRIVATE (a_this)->resolve_imports == TRUE) {
+                path = get_canonical_path ((const gchar *) a_file_uri);
+                if (path) {
+                        status = resolve_imports (a_this, result,
+                                                  path, a_enc);
+                        g_free (path);
+                        path = NULL;
+                }
+                if (status != CR_OK) {
+                        cr_stylesheet_unref (result);
+                        return status;
+                }
+        }
+        *a_result = result;
+        return CR_OK;
+}
+
 /**
  * cr_om_parser_simply_parse_file:
  *@a_file_path: the css2 local file path.
@@ -1114,6 +1931,85 @@ cr_om_parser_simply_parse_paths_to_cascade (const guchar * a_author_path,
         return status;
 }
 
+/**
+ * cr_om_parser_set_use_arena:
+ *@a_this: the current instance of #CROMParser.
+ *@a_use_arena: TRUE to parse in arena mode.
+ *
+ *In arena mode, each stylesheet built by the parser owns a
+ *#CRArena its statements, selectors, declarations, terms and
+ *strings are allocated in, so that cr_stylesheet_destroy()
+ *gives them back to the system a few large blocks at a time.
+ *The nodes of such a stylesheet must not be destroyed on their
+ *own, nor be kept after the stylesheet is destroyed.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_set_use_arena (CROMParser * a_this, gboolean a_use_arena)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->use_arena = a_use_arena;
+        return CR_OK;
+}
+
+/**
+ * cr_om_parser_set_nb_threads:
+ *@a_this: the current instance of #CROMParser.
+ *@a_nb_threads: the maximum number of threads a stylesheet
+ *is parsed with. 0 or 1, the default, means no parallel parsing.
+ *
+ *Makes cr_om_parser_parse_buf() and cr_om_parser_parse_file()
+ *parse big stylesheets in parallel: the stylesheet is split at the
+ *end of top level statements in up to @a_nb_threads chunks of
+ *at least 64KiB that are parsed concurrently, each by a parser of
+ *its own, and whose statements are put back together in order.
+ *The resulting stylesheet, parsing locations included, is the one
+ *a parsing in a single thread gives.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_set_nb_threads (CROMParser * a_this, guint a_nb_threads)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->nb_threads = a_nb_threads;
+        return CR_OK;
+}
+
+/**
+ * cr_om_parser_set_resolve_imports:
+ *@a_this: the current instance of #CROMParser.
+ *@a_resolve_imports: TRUE to resolve the \@import rules.
+ *
+ *Makes cr_om_parser_parse_file() parse the local stylesheets the
+ *\@import rules of the stylesheets it parses point to, and attach
+ *them to the rules with cr_stylesheet_set_imported_sheet(), so that
+ *their rulesets are selected, in cascade order, along with the ones
+ *of the importing stylesheet. The imported stylesheets are cached by
+ *canonical path for the lifetime of the parser: a stylesheet imported
+ *by several others, even through different urls, is parsed once.
+ *Circular imports are ignored. Stylesheets parsed from in memory
+ *buffers have no path the urls can be relative to, so their
+ *\@import rules are left unresolved.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_om_parser_set_resolve_imports (CROMParser * a_this,
+                                  gboolean a_resolve_imports)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->resolve_imports = a_resolve_imports;
+        return CR_OK;
+}
+
 /**
  * cr_om_parser_destroy:
  *@a_this: the current instance of #CROMParser.
@@ -1130,6 +2026,11 @@ cr_om_parser_destroy (CROMParser * a_this)
                 PRIVATE (a_this)->parser = NULL;
         }
 
+        if (PRIVATE (a_this)->imported_sheets) {
+                g_hash_table_destroy (PRIVATE (a_this)->imported_sheets);
+                PRIVATE (a_this)->imported_sheets = NULL;
+        }
+
         if (PRIVATE (a_this)) {
                 g_free (PRIVATE (a_this));
                 PRIVATE (a_this) = NULL;
@@ -91,6 +91,15 @@ enum CRStatus cr_om_parser_simply_parse_paths_to_cascade (const guchar *a_author
                                                           enum CREncoding a_encoding,
                                                           CRCascade ** a_result) ;
 
+enum CRStatus cr_om_parser_set_use_arena (CROMParser *a_this,
+                                          gboolean a_use_arena) ;
+
+enum CRStatus cr_om_parser_set_nb_threads (CROMParser *a_this,
+                                           guint a_nb_threads) ;
+
+enum CRStatus cr_om_parser_set_resolve_imports (CROMParser *a_this,
+                                                gboolean a_resolve_imports) ;
+
 void cr_om_parser_destroy (CROMParser *a_this) ;
 
 G_END_DECLS
@@ -130,6 +130,18 @@ struct _CRParserPriv {
         gboolean resolve_import;
         gboolean is_case_sensitive;
         gboolean use_core_grammar;
+
+        /*
+         *TRUE while a stylesheet is pushed to the parser
+         *using cr_parser_feed(). stream_state is the stylesheet
+         *production the next window of statements resumes at.
+         *stream_status is the error of the window that stopped
+         *the stream: like cr_parser_parse(), the parser stops at
+         *the first unrecoverable error, and ignores what is fed next.
+         */
+        gboolean streaming;
+        enum CRParserState stream_state;
+        enum CRStatus stream_status;
 };
 
 #define PRIVATE(obj) ((obj)->priv)
@@ -186,10 +198,13 @@ if ((a_status) != CR_OK) \
 }
 
 /**
- *Peeks the next char from the input stream of the current parser
- *by invoking cr_tknzr_input_peek_char().
+ *Peeks the char of the next token of the current parser
+ *by invoking cr_parser_peek_char_token(): the parser only
+ *ever looks at the chars of the single char tokens
+ *(delimiters, braces, semi colons...), and peeking tokens rather
+ *than chars keeps the tokens the tokenizer has read ahead.
  *invokes CHECK_PARSING_STATUS on the status returned by
- *cr_tknzr_peek_char().
+ *cr_parser_peek_char_token().
  *
  *@param a_this the current instance of #CRParser.
  *@param a_to_char a pointer to the char where to store the
@@ -198,12 +213,13 @@ if ((a_status) != CR_OK) \
 #define PEEK_NEXT_CHAR(a_this, a_to_char) \
 {\
 enum CRStatus pnc_status ; \
-pnc_status = cr_tknzr_peek_char  (PRIVATE (a_this)->tknzr, a_to_char) ; \
+pnc_status = cr_parser_peek_char_token (a_this, a_to_char) ; \
 CHECK_PARSING_STATUS (pnc_status, TRUE) \
 }
 
 /**
- *Reads the next char from the input stream of the current parser.
+ *Reads the next token of the current parser and gets its char,
+ *as PEEK_NEXT_CHAR does.
  *In case of error, jumps to the "error:" label located in the
  *function where this macro is called.
  *@param a_this the curent instance of #CRParser
@@ -211,7 +227,7 @@ CHECK_PARSING_STATUS (pnc_status, TRUE) \
  *the character read.
  */
 #define READ_NEXT_CHAR(a_this, a_to_char) \
-status = cr_tknzr_read_char (PRIVATE (a_this)->tknzr, a_to_char) ; \
+status = cr_parser_read_char_token (a_this, a_to_char) ; \
 CHECK_PARSING_STATUS (status, TRUE)
 
 /**
@@ -400,6 +416,12 @@ static enum CRStatus cr_parser_dump_err_stack (CRParser * a_this,
 static enum CRStatus
   cr_parser_clear_errors (CRParser * a_this);
 
+static enum CRStatus cr_parser_peek_char_token (CRParser * a_this,
+                                                guint32 * a_char);
+
+static enum CRStatus cr_parser_read_char_token (CRParser * a_this,
+                                                guint32 * a_char);
+
 /*****************************
  *error managemet methods
  *****************************/
@@ -627,7 +649,7 @@ cr_parser_try_to_skip_spaces_and_comments (CRParser * a_this)
                               && PRIVATE (a_this)->tknzr, CR_BAD_PARAM_ERROR);
         do {
                 if (token) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
                 }
 
@@ -646,13 +668,112 @@ cr_parser_try_to_skip_spaces_and_comments (CRParser * a_this)
       error:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
         return status;
 }
 
+/**
+ *Gets the char a token is made of, if it is made of a single
+ *char.
+ *@param a_token the token to consider.
+ *@return the char of the token, or 0 if the token is not made
+ *of a single char.
+ */
+static guint32
+cr_parser_get_token_char (CRToken const * a_token)
+{
+        switch (a_token->type) {
+        case SEMICOLON_TK:
+                return ';';
+        case CBO_TK:
+                return '{';
+        case CBC_TK:
+                return '}';
+        case PO_TK:
+                return '(';
+        case PC_TK:
+                return ')';
+        case BO_TK:
+                return '[';
+        case BC_TK:
+                return ']';
+        case DELIM_TK:
+                return a_token->u.unichar;
+        default:
+                return 0;
+        }
+}
+
+/**
+ *Peeks the next token and, if it is made of a single char,
+ *gets that char. Unlike cr_tknzr_peek_char(), keeps the tokens
+ *the tokenizer has read ahead, so they are not scanned again.
+ *@param a_this the current instance of #CRParser.
+ *@param a_char out parameter. The char of the next token, or 0
+ *if the next token is not made of a single char.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+static enum CRStatus
+cr_parser_peek_char_token (CRParser * a_this, guint32 * a_char)
+{
+        enum CRStatus status = CR_OK;
+        CRToken *token = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_char, CR_BAD_PARAM_ERROR);
+
+        status = cr_tknzr_peek_token (PRIVATE (a_this)->tknzr, 0, &token);
+        if (status == CR_END_OF_INPUT_ERROR) {
+                return status;
+        } else if (status != CR_OK) {
+                /*
+                 *the next token is malformed:
+                 *look at its first char only.
+                 */
+                return cr_tknzr_peek_char (PRIVATE (a_this)->tknzr, a_char);
+        }
+
+        *a_char = cr_parser_get_token_char (token);
+
+        return CR_OK;
+}
+
+/**
+ *Same as cr_parser_peek_char_token() but consumes the token.
+ *@param a_this the current instance of #CRParser.
+ *@param a_char out parameter. The char of the token read, or 0
+ *if the token is not made of a single char.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+static enum CRStatus
+cr_parser_read_char_token (CRParser * a_this, guint32 * a_char)
+{
+        enum CRStatus status = CR_OK;
+        CRToken *token = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_char, CR_BAD_PARAM_ERROR);
+
+        status = cr_tknzr_peek_token (PRIVATE (a_this)->tknzr, 0, &token);
+        if (status == CR_END_OF_INPUT_ERROR) {
+                return status;
+        } else if (status != CR_OK) {
+                return cr_tknzr_read_char (PRIVATE (a_this)->tknzr, a_char);
+        }
+
+        token = NULL;
+        status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
+        g_return_val_if_fail (status == CR_OK && token, CR_ERROR);
+
+        *a_char = cr_parser_get_token_char (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
+
+        return CR_OK;
+}
+
 /***************************************
  *End of Parser input handling routines
  ***************************************/
@@ -687,7 +808,7 @@ cr_parser_parse_stylesheet_core (CRParser * a_this)
  continue_parsing:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -724,7 +845,7 @@ cr_parser_parse_stylesheet_core (CRParser * a_this)
 
  done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -738,7 +859,7 @@ cr_parser_parse_stylesheet_core (CRParser * a_this)
         cr_parser_dump_err_stack (a_this, TRUE);
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -778,7 +899,7 @@ cr_parser_parse_atrule_core (CRParser * a_this)
                               || token->type == FONT_FACE_SYM_TK
                               || token->type == CHARSET_SYM_TK));
 
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -808,14 +929,14 @@ cr_parser_parse_atrule_core (CRParser * a_this)
 
  done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         return CR_OK;
 
  error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr,
@@ -849,7 +970,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
         ENSURE_PARSING_COND (status == CR_OK && token
                              && token->type == CBO_TK);
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -857,7 +978,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
 
       parse_declaration_list:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -870,7 +991,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
         ENSURE_PARSING_COND (status == CR_OK
                              && token && token->type == SEMICOLON_TK);
 
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
         cr_parser_try_to_skip_spaces_and_comments (a_this);
         status = cr_parser_parse_declaration_core (a_this);
@@ -879,7 +1000,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
         ENSURE_PARSING_COND (status == CR_OK && token);
         if (token->type == CBC_TK) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
                 cr_parser_try_to_skip_spaces_and_comments (a_this);
                 goto done;
@@ -892,7 +1013,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
 
       done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -902,7 +1023,7 @@ cr_parser_parse_ruleset_core (CRParser * a_this)
 
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -942,7 +1063,7 @@ cr_parser_parse_selector_core (CRParser * a_this)
 
  error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -976,7 +1097,7 @@ cr_parser_parse_block_core (CRParser * a_this)
       parse_block_content:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1009,7 +1130,7 @@ cr_parser_parse_block_core (CRParser * a_this)
 
       done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1018,7 +1139,7 @@ cr_parser_parse_block_core (CRParser * a_this)
 
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1051,7 +1172,7 @@ cr_parser_parse_declaration_core (CRParser * a_this)
                              && token
                              && token->type == DELIM_TK
                              && token->u.unichar == ':');
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
         cr_parser_try_to_skip_spaces_and_comments (a_this);
         status = cr_parser_parse_value_core (a_this);
@@ -1067,7 +1188,7 @@ cr_parser_parse_declaration_core (CRParser * a_this)
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1097,7 +1218,7 @@ cr_parser_parse_value_core (CRParser * a_this)
       continue_parsing:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1137,7 +1258,7 @@ cr_parser_parse_value_core (CRParser * a_this)
 
       done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1145,7 +1266,7 @@ cr_parser_parse_value_core (CRParser * a_this)
                 return CR_OK;
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1227,7 +1348,8 @@ cr_parser_parse_any_core (CRParser * a_this)
                 ENSURE_PARSING_COND (status == CR_OK && token2);
 
                 if (token2->type == PC_TK) {
-                        cr_token_destroy (token2);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr,
+                                                token2);
                         token2 = NULL;
                         goto done;
                 } else {
@@ -1255,7 +1377,8 @@ cr_parser_parse_any_core (CRParser * a_this)
                 ENSURE_PARSING_COND (status == CR_OK && token2);
 
                 if (token2->type == BC_TK) {
-                        cr_token_destroy (token2);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr,
+                                                token2);
                         token2 = NULL;
                         goto done;
                 } else {
@@ -1283,12 +1406,12 @@ cr_parser_parse_any_core (CRParser * a_this)
 
       done:
         if (token1) {
-                cr_token_destroy (token1);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token1);
                 token1 = NULL;
         }
 
         if (token2) {
-                cr_token_destroy (token2);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token2);
                 token2 = NULL;
         }
 
@@ -1297,12 +1420,12 @@ cr_parser_parse_any_core (CRParser * a_this)
       error:
 
         if (token1) {
-                cr_token_destroy (token1);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token1);
                 token1 = NULL;
         }
 
         if (token2) {
-                cr_token_destroy (token2);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token2);
                 token2 = NULL;
         }
 
@@ -1340,7 +1463,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
                              && token->type == BO_TK);
         cr_parsing_location_copy
                 (&location, &token->location) ;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -1359,7 +1482,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
 
         result->name = token->u.str;
         token->u.str = NULL;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -1384,7 +1507,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
  parse_right_part:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1405,7 +1528,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1417,7 +1540,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
                              && token->type == BC_TK);
  done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1439,7 +1562,7 @@ cr_parser_parse_attribute_selector (CRParser * a_this,
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1518,6 +1641,40 @@ cr_parser_parse_term (CRParser * a_this, CRTerm ** a_term)
 
         RECORD_INITIAL_POS (a_this, &init_pos);
 
+        /*
+         *Look at the next token before consuming it, so that when
+         *there is no term there, as at the end of an expression,
+         *the token is left to the caller instead of being
+         *tokenized again after a rewind.
+         */
+        status = cr_tknzr_peek_token (PRIVATE (a_this)->tknzr, 0, &token);
+        if (status != CR_OK || !token)
+                return status == CR_OK ? CR_PARSING_ERROR : status;
+        switch (token->type) {
+        case DELIM_TK:
+                if (token->u.unichar != '+' && token->u.unichar != '-')
+                        return CR_PARSING_ERROR;
+                break;
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case PERCENTAGE_TK:
+        case NUMBER_TK:
+        case FUNCTION_TK:
+        case STRING_TK:
+        case IDENT_TK:
+        case URI_TK:
+        case RGB_TK:
+        case HASH_TK:
+                break;
+        default:
+                return CR_PARSING_ERROR;
+        }
+        token = NULL;
+
         result = cr_term_new ();
 
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
@@ -1528,7 +1685,7 @@ cr_parser_parse_term (CRParser * a_this, CRTerm ** a_term)
         cr_parsing_location_copy (&location, &token->location) ;
         if (token->type == DELIM_TK && token->u.unichar == '+') {
                 result->unary_op = PLUS_UOP;
-                cr_token_destroy (token) ;
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL ;
                 cr_parser_try_to_skip_spaces_and_comments (a_this);
                 status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
@@ -1537,7 +1694,7 @@ cr_parser_parse_term (CRParser * a_this, CRTerm ** a_term)
                         goto error;
         } else if (token->type == DELIM_TK && token->u.unichar == '-') {
                 result->unary_op = MINUS_UOP;
-                cr_token_destroy (token) ;
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL ;
                 cr_parser_try_to_skip_spaces_and_comments (a_this);
                 status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
@@ -1611,7 +1768,7 @@ cr_parser_parse_term (CRParser * a_this, CRTerm ** a_term)
         cr_parser_try_to_skip_spaces_and_comments (a_this);
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1626,7 +1783,7 @@ cr_parser_parse_term (CRParser * a_this, CRTerm ** a_term)
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1702,7 +1859,7 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1710,13 +1867,18 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
 
         for (;;) {
                 if (token) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
                 }
 
-                status = cr_tknzr_get_next_token 
+                status = cr_tknzr_get_next_token
                         (PRIVATE (a_this)->tknzr,
                          &token);
+                if (status == CR_END_OF_INPUT_ERROR) {
+                        /*a selector parsed on its own may end the input*/
+                        status = CR_OK;
+                        break;
+                }
                 if (status != CR_OK)
                         goto error;
 
@@ -1739,7 +1901,7 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
                         found_sel = TRUE;
                 } else if (token && (token->type == DELIM_TK)
                            && (token->u.unichar == '.')) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
 
                         status = cr_tknzr_get_next_token
@@ -1803,7 +1965,8 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
                         /*try to parse a pseudo */
 
                         if (token) {
-                                cr_token_destroy (token);
+                                cr_tknzr_release_token (PRIVATE (a_this)->tknzr,
+                                                        token);
                                 token = NULL;
                         }
 
@@ -1878,7 +2041,7 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
                 sel = NULL;
 
                 if (token) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
                 }
 
@@ -1891,7 +2054,7 @@ cr_parser_parse_simple_selector (CRParser * a_this, CRSimpleSel ** a_sel)
  error:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -1952,7 +2115,10 @@ cr_parser_parse_simple_sels (CRParser * a_this,
 
                 sel = NULL;
 
-                PEEK_NEXT_CHAR (a_this, &next_char);
+                status = cr_parser_peek_char_token (a_this, &next_char);
+                if (status == CR_END_OF_INPUT_ERROR)
+                        break;
+                CHECK_PARSING_STATUS (status, TRUE);
 
                 if (next_char == '+') {
                         READ_NEXT_CHAR (a_this, &cur_char);
@@ -1967,8 +2133,17 @@ cr_parser_parse_simple_sels (CRParser * a_this,
                 }
 
                 status = cr_parser_parse_simple_selector (a_this, &sel);
-                if (status != CR_OK)
+                if (status != CR_OK) {
+                        /*
+                         *a '+' or a '>' must be followed by
+                         *a simple selector.
+                         */
+                        if (comb != COMB_WS) {
+                                status = CR_PARSING_ERROR;
+                                goto error;
+                        }
                         break;
+                }
 
                 if (comb && sel) {
                         sel->combinator = comb;
@@ -1995,12 +2170,14 @@ cr_parser_parse_simple_sels (CRParser * a_this,
  *@a_selector: the parsed list of comma separated
  *selectors.
  *
- *Parses a comma separated list of selectors.
+ *Parses a comma separated list of selectors, and appends
+ *it to *@a_selector. The caller owns the selectors, and
+ *frees them with cr_selector_unref().
  *
  *Returns CR_OK upon successful completion, an error
  *code otherwise.
  */
-static enum CRStatus
+enum CRStatus
 cr_parser_parse_selector (CRParser * a_this, 
                           CRSelector ** a_selector)
 {
@@ -2032,8 +2209,7 @@ cr_parser_parse_selector (CRParser * a_this,
                 goto error ;
         }
 
-        status = cr_tknzr_peek_char (PRIVATE (a_this)->tknzr,
-                                     &next_char);
+        status = cr_parser_peek_char_token (a_this, &next_char);
         if (status != CR_OK) {
                 if (status == CR_END_OF_INPUT_ERROR) {
                         status = CR_OK;
@@ -2047,8 +2223,8 @@ cr_parser_parse_selector (CRParser * a_this,
                 for (;;) {
                         simple_sels = NULL;
 
-                        status = cr_tknzr_peek_char (PRIVATE (a_this)->tknzr,
-                                                     &next_char);
+                        status = cr_parser_peek_char_token (a_this,
+                                                            &next_char);
                         if (status != CR_OK) {
                                 if (status == CR_END_OF_INPUT_ERROR) {
                                         status = CR_OK;
@@ -2150,7 +2326,7 @@ cr_parser_parse_function (CRParser * a_this,
                 status = CR_PARSING_ERROR;
                 goto error;
         }
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
         
         cr_parser_try_to_skip_spaces_and_comments (a_this) ;
@@ -2165,7 +2341,7 @@ cr_parser_parse_function (CRParser * a_this,
 
         ENSURE_PARSING_COND (token && token->type == PC_TK);
 
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         if (expr) {
@@ -2189,7 +2365,7 @@ cr_parser_parse_function (CRParser * a_this,
         }
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
 
         }
 
@@ -2315,8 +2491,20 @@ cr_parser_parse_stylesheet (CRParser * a_this)
 
         PRIVATE (a_this)->state = READY_STATE;
 
-        if (PRIVATE (a_this)->sac_handler
-            && PRIVATE (a_this)->sac_handler->start_document) {
+        if (PRIVATE (a_this)->streaming == TRUE) {
+                /*
+                 *cr_parser_feed() calls us once per window of
+                 *complete statements. Resume where the previous
+                 *window stopped.
+                 */
+                if (PRIVATE (a_this)->stream_state
+                    == TRY_PARSE_RULESET_STATE)
+                        goto parse_ruleset_and_others;
+                if (PRIVATE (a_this)->stream_state
+                    == TRY_PARSE_IMPORT_STATE)
+                        goto parse_imports;
+        } else if (PRIVATE (a_this)->sac_handler
+                   && PRIVATE (a_this)->sac_handler->start_document) {
                 PRIVATE (a_this)->sac_handler->start_document
                         (PRIVATE (a_this)->sac_handler);
         }
@@ -2372,10 +2560,11 @@ cr_parser_parse_stylesheet (CRParser * a_this)
                 CHECK_PARSING_STATUS (status, TRUE);
         }
 
-/* parse_imports:*/
+ parse_imports:
+        PRIVATE (a_this)->stream_state = TRY_PARSE_IMPORT_STATE;
         do {
                 if (token) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
                 }
                 cr_parser_try_to_skip_spaces_and_comments (a_this) ;
@@ -2487,7 +2676,8 @@ cr_parser_parse_stylesheet (CRParser * a_this)
 
                         do {
                                 if (token) {
-                                        cr_token_destroy (token);
+                                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr,
+                                                                token);
                                         token = NULL;
                                 }
 
@@ -2512,6 +2702,7 @@ cr_parser_parse_stylesheet (CRParser * a_this)
         }
 
  parse_ruleset_and_others:
+        PRIVATE (a_this)->stream_state = TRY_PARSE_RULESET_STATE;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
 
@@ -2531,7 +2722,8 @@ cr_parser_parse_stylesheet (CRParser * a_this)
 
                         do {
                                 if (token) {
-                                        cr_token_destroy (token);
+                                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr,
+                                                                token);
                                         token = NULL;
                                 }
 
@@ -2687,13 +2879,14 @@ cr_parser_parse_stylesheet (CRParser * a_this)
 
       done:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
         if (status == CR_END_OF_INPUT_ERROR || status == CR_OK) {
 
-                if (PRIVATE (a_this)->sac_handler
+                if (PRIVATE (a_this)->streaming == FALSE
+                    && PRIVATE (a_this)->sac_handler
                     && PRIVATE (a_this)->sac_handler->end_document) {
                         PRIVATE (a_this)->sac_handler->end_document
                                 (PRIVATE (a_this)->sac_handler);
@@ -2718,7 +2911,7 @@ cr_parser_parse_stylesheet (CRParser * a_this)
       error:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -2831,6 +3024,9 @@ cr_parser_new_from_input (CRInput * a_input)
  * @a_file_uri: the uri of the file to parse.
  * @a_enc: the file encoding to use.
  *
+ * The file is memory mapped when its encoding allows it,
+ * see cr_input_new_from_mmap().
+ *
  * Returns the newly built parser.
  */
 CRParser *
@@ -3014,7 +3210,7 @@ cr_parser_parse_expr (CRParser * a_this, CRTerm ** a_expr)
         CRInputPos init_pos;
         CRTerm *expr = NULL,
                 *expr2 = NULL;
-        guchar next_byte = 0;
+        guint32 next_char = 0;
         gulong nb_terms = 0;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this)
@@ -3027,10 +3223,9 @@ cr_parser_parse_expr (CRParser * a_this, CRTerm ** a_expr)
         CHECK_PARSING_STATUS (status, FALSE);
 
         for (;;) {
-                guchar operator = 0;
+                guint32 operator = 0;
 
-                status = cr_tknzr_peek_byte (PRIVATE (a_this)->tknzr,
-                                             1, &next_byte);
+                status = cr_parser_peek_char_token (a_this, &next_char);
                 if (status != CR_OK) {
                         if (status == CR_END_OF_INPUT_ERROR) {
                                 /*
@@ -3046,8 +3241,8 @@ cr_parser_parse_expr (CRParser * a_this, CRTerm ** a_expr)
                         }
                 }
 
-                if (next_byte == '/' || next_byte == ',') {
-                        READ_NEXT_BYTE (a_this, &operator);
+                if (next_char == '/' || next_char == ',') {
+                        READ_NEXT_CHAR (a_this, &operator);
                 }
 
                 cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -3127,22 +3322,31 @@ cr_parser_parse_prio (CRParser * a_this, CRString ** a_prio)
 
         RECORD_INITIAL_POS (a_this, &init_pos);
 
+        /*
+         *peek the token first: most declarations have
+         *no priority, and the token that follows them must
+         *not be tokenized twice.
+         */
+        status = cr_tknzr_peek_token (PRIVATE (a_this)->tknzr, 0, &token);
+        if (status == CR_END_OF_INPUT_ERROR)
+                return status;
+        if (status != CR_OK || !token
+            || token->type != IMPORTANT_SYM_TK)
+                return CR_PARSING_ERROR;
+        token = NULL;
+
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
-        if (status == CR_END_OF_INPUT_ERROR) {
-                goto error;
-        }
-        ENSURE_PARSING_COND (status == CR_OK
-                             && token && token->type == IMPORTANT_SYM_TK);
+        ENSURE_PARSING_COND (status == CR_OK && token);
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
         *a_prio = cr_string_new_from_string ("!important");
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
         return CR_OK;
 
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         cr_tknzr_set_cur_pos (PRIVATE (a_this)->tknzr, &init_pos);
@@ -3299,7 +3503,7 @@ cr_parser_parse_statement_core (CRParser * a_this)
 
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -3405,7 +3609,7 @@ cr_parser_parse_ruleset (CRParser * a_this)
                  *would mean that we are parsing an empty ruleset (eg. x{ })
                  *In that case, goto end_of_ruleset.
                  */
-                status = cr_tknzr_peek_char (PRIVATE (a_this)->tknzr, &c) ;
+                status = cr_parser_peek_char_token (a_this, &c) ;
                 if (status == CR_OK && c == '}') {
                         status = CR_OK ;
                         goto end_of_ruleset ;
@@ -3550,6 +3754,8 @@ cr_parser_parse_import (CRParser * a_this,
         guint32 cur_char = 0,
                 next_char = 0;
         CRString *medium = NULL;
+        CRToken *token = NULL;
+        gboolean is_string = FALSE;
 
         g_return_val_if_fail (a_this
                               && a_import_string
@@ -3558,20 +3764,14 @@ cr_parser_parse_import (CRParser * a_this,
 
         RECORD_INITIAL_POS (a_this, &init_pos);
 
-        if (BYTE (a_this, 1, NULL) == '@'
-            && BYTE (a_this, 2, NULL) == 'i'
-            && BYTE (a_this, 3, NULL) == 'm'
-            && BYTE (a_this, 4, NULL) == 'p'
-            && BYTE (a_this, 5, NULL) == 'o'
-            && BYTE (a_this, 6, NULL) == 'r'
-            && BYTE (a_this, 7, NULL) == 't') {
-                SKIP_CHARS (a_this, 1);
+        status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, &token);
+        if (status == CR_OK && token && token->type == IMPORT_SYM_TK) {
                 if (a_location) {
-                        cr_parser_get_parsing_location 
-                                (a_this, a_location) ;
+                        cr_parsing_location_copy (a_location,
+                                                  &token->location) ;
                 }
-                SKIP_CHARS (a_this, 6);
-                status = CR_OK;
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
+                token = NULL;
         } else {
                 status = CR_PARSING_ERROR;
                 goto error;
@@ -3581,9 +3781,15 @@ cr_parser_parse_import (CRParser * a_this,
 
         PRIVATE (a_this)->state = TRY_PARSE_IMPORT_STATE;
 
-        PEEK_NEXT_CHAR (a_this, &next_char);
+        /*the token peeked still belongs to the tokenizer*/
+        status = cr_tknzr_peek_token (PRIVATE (a_this)->tknzr, 0, &token);
+        if (status == CR_END_OF_INPUT_ERROR)
+                goto error;
+        is_string = (status == CR_OK && token->type == STRING_TK)
+                ? TRUE : FALSE;
+        token = NULL;
 
-        if (next_char == '"' || next_char == '\'') {
+        if (is_string == TRUE) {
                 status = cr_parser_parse_string (a_this, a_import_string);
 
                 CHECK_PARSING_STATUS (status, FALSE);
@@ -3605,8 +3811,8 @@ cr_parser_parse_import (CRParser * a_this,
         cr_parser_try_to_skip_spaces_and_comments (a_this);
 
         for (; status == CR_OK;) {
-                if ((status = cr_tknzr_peek_char (PRIVATE (a_this)->tknzr,
-                                                  &next_char)) != CR_OK) {
+                if ((status = cr_parser_peek_char_token
+                     (a_this, &next_char)) != CR_OK) {
                         if (status == CR_END_OF_INPUT_ERROR) {
                                 status = CR_OK;
                                 goto okay;
@@ -3675,6 +3881,11 @@ cr_parser_parse_import (CRParser * a_this,
                 *a_import_string = NULL;
         }
 
+        if (token) {
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
+                token = NULL;
+        }
+
         if (medium) {
                 cr_string_destroy (medium);
                 medium = NULL;
@@ -3724,7 +3935,7 @@ cr_parser_parse_media (CRParser * a_this)
                              && token 
                              && token->type == MEDIA_SYM_TK);
         cr_parsing_location_copy (&location, &token->location) ;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -3735,7 +3946,7 @@ cr_parser_parse_media (CRParser * a_this)
 
         medium = token->u.str;
         token->u.str = NULL;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         if (medium) {
@@ -3831,7 +4042,7 @@ cr_parser_parse_media (CRParser * a_this)
       error:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -3894,7 +4105,7 @@ cr_parser_parse_page (CRParser * a_this)
                              && token->type == PAGE_SYM_TK);
 
         cr_parsing_location_copy (&location, &token->location) ;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -3905,7 +4116,7 @@ cr_parser_parse_page (CRParser * a_this)
         if (token->type == IDENT_TK) {
                 page_selector = token->u.str;
                 token->u.str = NULL;
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         } else {
                 cr_tknzr_unget_token (PRIVATE (a_this)->tknzr, token);
@@ -3920,7 +4131,7 @@ cr_parser_parse_page (CRParser * a_this)
         ENSURE_PARSING_COND (status == CR_OK && token);
 
         if (token->type == DELIM_TK && token->u.unichar == ':') {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
                 status = cr_parser_parse_ident (a_this, &page_pseudo_class);
                 CHECK_PARSING_STATUS (status, FALSE);
@@ -3940,7 +4151,7 @@ cr_parser_parse_page (CRParser * a_this)
         ENSURE_PARSING_COND (status == CR_OK && token
                              && token->type == CBO_TK);
 
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         /*
@@ -3990,7 +4201,7 @@ cr_parser_parse_page (CRParser * a_this)
         for (;;) {
                 /*parse the other ';' separated declarations */
                 if (token) {
-                        cr_token_destroy (token);
+                        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                         token = NULL;
                 }
                 status = cr_tknzr_get_next_token
@@ -4006,7 +4217,7 @@ cr_parser_parse_page (CRParser * a_this)
                         break;
                 }
 
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
                 cr_parser_try_to_skip_spaces_and_comments (a_this);
 
@@ -4042,7 +4253,7 @@ cr_parser_parse_page (CRParser * a_this)
         cr_parser_try_to_skip_spaces_and_comments 
                 (a_this) ;
         if (token) {
-                cr_token_destroy (token) ;
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL ;
         }
 
@@ -4051,7 +4262,7 @@ cr_parser_parse_page (CRParser * a_this)
         ENSURE_PARSING_COND (status == CR_OK 
                              && token 
                              && token->type == CBC_TK) ;
-        cr_token_destroy (token) ;
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL ;
         /*
          *call the relevant SAC handler here.
@@ -4084,7 +4295,7 @@ cr_parser_parse_page (CRParser * a_this)
 
  error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         if (page_selector) {
@@ -4144,7 +4355,7 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
                 cr_parsing_location_copy (a_charset_sym_location, 
                                           &token->location) ;
         }
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         PRIVATE (a_this)->state = TRY_PARSE_CHARSET_STATE;
@@ -4156,7 +4367,7 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
                              && token && token->type == STRING_TK);
         charset_str = token->u.str;
         token->u.str = NULL;
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         cr_parser_try_to_skip_spaces_and_comments (a_this);
@@ -4165,7 +4376,7 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
 
         ENSURE_PARSING_COND (status == CR_OK
                              && token && token->type == SEMICOLON_TK);
-        cr_token_destroy (token);
+        cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
         token = NULL;
 
         if (charset_str) {
@@ -4179,7 +4390,7 @@ cr_parser_parse_charset (CRParser * a_this, CRString ** a_value,
  error:
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
 
@@ -4238,7 +4449,7 @@ cr_parser_parse_font_face (CRParser * a_this)
         if (token) {
                 cr_parsing_location_copy (&location, 
                                           &token->location) ;
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         status = cr_tknzr_get_next_token (PRIVATE (a_this)->tknzr, 
@@ -4246,7 +4457,7 @@ cr_parser_parse_font_face (CRParser * a_this)
         ENSURE_PARSING_COND (status == CR_OK && token
                              && token->type == CBO_TK);
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         /*
@@ -4335,7 +4546,7 @@ cr_parser_parse_font_face (CRParser * a_this)
         cr_parser_try_to_skip_spaces_and_comments (a_this);
 
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         cr_parser_clear_errors (a_this);
@@ -4344,7 +4555,7 @@ cr_parser_parse_font_face (CRParser * a_this)
 
       error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (PRIVATE (a_this)->tknzr, token);
                 token = NULL;
         }
         if (property) {
@@ -4486,6 +4697,132 @@ cr_parser_parse_buf (CRParser * a_this,
         return status;
 }
 
+/**
+ *Parses the windows of complete statements available
+ *in the streaming input of the parser.
+ *@param a_this the current instance of #CRParser.
+ *@param a_end_of_stream TRUE if no more data will be fed.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+cr_parser_parse_stream (CRParser * a_this, gboolean a_end_of_stream)
+{
+        enum CRStatus status = CR_OK;
+        CRInput *input = NULL;
+
+        cr_tknzr_get_input (PRIVATE (a_this)->tknzr, &input);
+        g_return_val_if_fail (input, CR_BAD_PARAM_ERROR);
+
+        if (PRIVATE (a_this)->streaming == FALSE) {
+                PRIVATE (a_this)->streaming = TRUE;
+                PRIVATE (a_this)->stream_state = READY_STATE;
+                PRIVATE (a_this)->stream_status = CR_OK;
+                if (PRIVATE (a_this)->sac_handler
+                    && PRIVATE (a_this)->sac_handler->start_document) {
+                        PRIVATE (a_this)->sac_handler->start_document
+                                (PRIVATE (a_this)->sac_handler);
+                }
+        }
+
+        while (PRIVATE (a_this)->stream_status == CR_OK) {
+                /*
+                 *drop the tokens the tokenizer may have
+                 *read ahead from the window we are about to drop.
+                 */
+                cr_tknzr_flush_lookahead (PRIVATE (a_this)->tknzr);
+
+                status = cr_input_next_window (input, a_end_of_stream);
+                if (status == CR_END_OF_INPUT_ERROR)
+                        break;
+                g_return_val_if_fail (status == CR_OK, status);
+
+                if (PRIVATE (a_this)->use_core_grammar == FALSE) {
+                        status = cr_parser_parse_stylesheet (a_this);
+                } else {
+                        status = cr_parser_parse_stylesheet_core (a_this);
+                }
+                PRIVATE (a_this)->stream_status = status;
+        }
+
+        return PRIVATE (a_this)->stream_status;
+}
+
+/**
+ * cr_parser_feed:
+ *@a_this: the current instance of #CRParser. Its input must have
+ *been built by cr_input_new_streaming().
+ *@a_buf: the next chunk of the utf8 encoded stylesheet.
+ *@a_len: the length of a_buf.
+ *
+ *Pushes the next chunk of a stylesheet to the parser.
+ *The statements completed by this chunk are parsed right away,
+ *and the SAC handler is notified accordingly, so the stylesheet
+ *does not have to be fully buffered before being parsed.
+ *Once all the chunks have been fed, call cr_parser_finish().
+ *Like cr_parser_parse(), the parser stops at the first unrecoverable
+ *error: the chunks fed after it are ignored, and cr_parser_feed()
+ *and cr_parser_finish() return that error; the end of the document
+ *is then not notified.
+ *A well formed stylesheet gives the same SAC events as with
+ *cr_parser_parse(). The chunks are parsed a window of complete
+ *statements at a time though, so a statement broken by an unbalanced
+ *quote or brace may not be recovered from at the same place.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_feed (CRParser * a_this, const guchar * a_buf, gulong a_len)
+{
+        enum CRStatus status = CR_OK;
+        CRInput *input = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->tknzr,
+                              CR_BAD_PARAM_ERROR);
+
+        if (PRIVATE (a_this)->streaming == TRUE
+            && PRIVATE (a_this)->stream_status != CR_OK)
+                return PRIVATE (a_this)->stream_status;
+
+        cr_tknzr_get_input (PRIVATE (a_this)->tknzr, &input);
+        status = cr_input_append_buf (input, a_buf, a_len);
+        if (status != CR_OK)
+                return status;
+
+        return cr_parser_parse_stream (a_this, FALSE);
+}
+
+/**
+ * cr_parser_finish:
+ *@a_this: the current instance of #CRParser.
+ *
+ *Parses what remains of a stylesheet pushed using cr_parser_feed()
+ *and notifies the end of the document to the SAC handler.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_parser_finish (CRParser * a_this)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->tknzr,
+                              CR_BAD_PARAM_ERROR);
+
+        status = cr_parser_parse_stream (a_this, TRUE);
+
+        PRIVATE (a_this)->streaming = FALSE;
+        if (status == CR_OK
+            && PRIVATE (a_this)->sac_handler
+            && PRIVATE (a_this)->sac_handler->end_document) {
+                PRIVATE (a_this)->sac_handler->end_document
+                        (PRIVATE (a_this)->sac_handler);
+        }
+
+        return status;
+}
+
 /**
  * cr_parser_destroy:
  *@a_this: the current instance of #CRParser to
@@ -93,6 +93,11 @@ enum CRStatus cr_parser_parse_file (CRParser *a_this,
 enum CRStatus cr_parser_parse_buf (CRParser *a_this, const guchar *a_buf, 
                                    gulong a_len, enum CREncoding a_enc) ;
 
+enum CRStatus cr_parser_feed (CRParser *a_this, const guchar *a_buf,
+                              gulong a_len) ;
+
+enum CRStatus cr_parser_finish (CRParser *a_this) ;
+
 enum CRStatus cr_parser_set_default_sac_handler (CRParser *a_this) ;
 
 enum CRStatus cr_parser_parse_term (CRParser *a_this, CRTerm **a_term) ;
@@ -108,6 +113,9 @@ enum CRStatus cr_parser_parse_statement_core (CRParser *a_this) ;
 
 enum CRStatus cr_parser_parse_ruleset (CRParser *a_this) ;
 
+enum CRStatus cr_parser_parse_selector (CRParser *a_this,
+                                        CRSelector **a_selector) ;
+
 enum CRStatus cr_parser_parse_import (CRParser *a_this, GList ** a_media_list,
                                       CRString **a_import_string,
                                       CRParsingLocation *a_location) ;
@@ -24,15 +24,176 @@
 
 #define PRIVATE(a_obj) (a_obj)->priv
 
+/*
+ *The index of a list of prop/decl pairs.
+ *It is shared by all the pairs of a list, and lets
+ *appends and unlinks run in constant time. The table of
+ *the properties, that lets lookups run in constant time,
+ *is only built by the first lookup: most lists, like the
+ *ones the cascade builds, are never looked up.
+ */
+typedef struct _CRPropListIndex CRPropListIndex;
+
+struct _CRPropListIndex {
+        CRPropList *head;
+        CRPropList *tail;
+        /*
+         *property name atom -> CRPropListIndexEntry.
+         *NULL until the first lookup.
+         */
+        GHashTable *props;
+};
+
+typedef struct {
+        /*the first pair of the list that holds the property*/
+        CRPropList *first;
+        /*the number of pairs of the list that hold the property*/
+        guint count;
+} CRPropListIndexEntry;
+
 struct _CRPropListPriv {
         CRString *prop;
         CRDeclaration *decl;
         CRPropList *next;
         CRPropList *prev;
+        /*
+         *the index of the list the pair belongs to.
+         *NULL as long as the pair is alone.
+         */
+        CRPropListIndex *index;
 };
 
 static CRPropList *cr_prop_list_allocate (void);
 
+static CRAtom
+get_prop_atom (CRPropList * a_pair)
+{
+        if (PRIVATE (a_pair)->prop)
+                return cr_string_get_atom (PRIVATE (a_pair)->prop);
+        return NULL;
+}
+
+/**
+ *Registers a pair in the index of its list.
+ *@param a_index the index of the list.
+ *@param a_pair the pair to register.
+ *@param a_at_start TRUE if a_pair comes before all the pairs
+ *already registered, FALSE if it comes after them.
+ */
+static void
+index_add_pair (CRPropListIndex * a_index, CRPropList * a_pair,
+                gboolean a_at_start)
+{
+        CRPropListIndexEntry *entry = NULL;
+        CRAtom name = get_prop_atom (a_pair);
+
+        PRIVATE (a_pair)->index = a_index;
+        if (!name || !a_index->props)
+                return;
+        entry = g_hash_table_lookup (a_index->props, name);
+        if (!entry) {
+                entry = g_try_malloc (sizeof (CRPropListIndexEntry));
+                if (!entry) {
+                        cr_utils_trace_info ("Out of memory");
+                        return;
+                }
+                entry->first = a_pair;
+                entry->count = 1;
+                g_hash_table_insert (a_index->props, (gpointer) name, entry);
+                return;
+        }
+        entry->count++;
+        if (a_at_start == TRUE)
+                entry->first = a_pair;
+}
+
+/**
+ *Unregisters a pair from the index of its list.
+ *Must be called while a_pair is still linked.
+ */
+static void
+index_remove_pair (CRPropListIndex * a_index, CRPropList * a_pair)
+{
+        CRPropListIndexEntry *entry = NULL;
+        CRPropList *cur = NULL;
+        CRAtom name = get_prop_atom (a_pair);
+
+        PRIVATE (a_pair)->index = NULL;
+        if (!name || !a_index->props)
+                return;
+        entry = g_hash_table_lookup (a_index->props, name);
+        if (!entry)
+                return;
+        if (!--entry->count) {
+                g_hash_table_remove (a_index->props, name);
+                return;
+        }
+        if (entry->first != a_pair)
+                return;
+        /*another pair holds the property further on*/
+        for (cur = PRIVATE (a_pair)->next; cur; cur = PRIVATE (cur)->next) {
+                if (get_prop_atom (cur) == name) {
+                        entry->first = cur;
+                        return;
+                }
+        }
+}
+
+/**
+ *Returns the index of the list a_pair belongs to,
+ *creating it if a_pair is alone.
+ */
+static CRPropListIndex *
+index_ensure (CRPropList * a_pair)
+{
+        CRPropListIndex *index = NULL;
+
+        if (PRIVATE (a_pair)->index)
+                return PRIVATE (a_pair)->index;
+
+        index = g_try_malloc (sizeof (CRPropListIndex));
+        if (!index) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (index, 0, sizeof (CRPropListIndex));
+        index->head = index->tail = a_pair;
+        index_add_pair (index, a_pair, FALSE);
+        return index;
+}
+
+/**
+ *Builds the table of the properties of an index,
+ *if it is not built yet.
+ *@return TRUE if the table is built, FALSE otherwise.
+ */
+static gboolean
+index_ensure_props (CRPropListIndex * a_index)
+{
+        CRPropList *cur = NULL;
+
+        if (a_index->props)
+                return TRUE;
+        a_index->props = g_hash_table_new_full (g_direct_hash,
+                                                g_direct_equal,
+                                                NULL, g_free);
+        if (!a_index->props) {
+                cr_utils_trace_info ("Out of memory");
+                return FALSE;
+        }
+        for (cur = a_index->head; cur; cur = PRIVATE (cur)->next)
+                index_add_pair (a_index, cur, FALSE);
+        return TRUE;
+}
+
+static void
+index_destroy (CRPropListIndex * a_index)
+{
+        if (a_index->props)
+                g_hash_table_destroy (a_index->props);
+        g_free (a_index);
+}
+
 /**
  *Default allocator of CRPropList
  *@return the newly allocated CRPropList or NULL
@@ -77,19 +238,27 @@ CRPropList *
 cr_prop_list_append (CRPropList * a_this, CRPropList * a_to_append)
 {
         CRPropList *cur = NULL;
+        CRPropListIndex *index = NULL;
 
         g_return_val_if_fail (a_to_append, NULL);
 
         if (!a_this)
                 return a_to_append;
 
-        /*go fetch the last element of the list */
-        for (cur = a_this;
-             cur && PRIVATE (cur) && PRIVATE (cur)->next;
-             cur = PRIVATE (cur)->next) ;
+        index = index_ensure (a_this);
+        g_return_val_if_fail (index, NULL);
+
+        /*the last element of the list */
+        cur = index->tail;
         g_return_val_if_fail (cur, NULL);
+        if (PRIVATE (a_to_append)->index)
+                index_destroy (PRIVATE (a_to_append)->index);
         PRIVATE (cur)->next = a_to_append;
         PRIVATE (a_to_append)->prev = cur;
+        for (cur = a_to_append; cur; cur = PRIVATE (cur)->next) {
+                index_add_pair (index, cur, FALSE);
+                index->tail = cur;
+        }
         return a_this;
 }
 
@@ -135,18 +304,32 @@ cr_prop_list_append2 (CRPropList * a_this,
 CRPropList *
 cr_prop_list_prepend (CRPropList * a_this, CRPropList * a_to_prepend)
 {
-        CRPropList *cur = NULL;
+        CRPropList *cur = NULL,
+                *tail = NULL;
+        CRPropListIndex *index = NULL;
 
         g_return_val_if_fail (a_to_prepend, NULL);
 
         if (!a_this)
                 return a_to_prepend;
 
-        for (cur = a_to_prepend; cur && PRIVATE (cur)->next;
-             cur = PRIVATE (cur)->next) ;
-        g_return_val_if_fail (cur, NULL);
-        PRIVATE (cur)->next = a_this;
-        PRIVATE (a_this)->prev = cur;
+        index = index_ensure (a_this);
+        g_return_val_if_fail (index, NULL);
+
+        for (tail = a_to_prepend; tail && PRIVATE (tail)->next;
+             tail = PRIVATE (tail)->next) ;
+        g_return_val_if_fail (tail, NULL);
+        if (PRIVATE (a_to_prepend)->index)
+                index_destroy (PRIVATE (a_to_prepend)->index);
+        /*
+         *register the new pairs from the last one backward, so that
+         *each of them comes before the ones registered already.
+         */
+        for (cur = tail; cur; cur = PRIVATE (cur)->prev)
+                index_add_pair (index, cur, TRUE);
+        index->head = a_to_prepend;
+        PRIVATE (tail)->next = a_this;
+        PRIVATE (a_this)->prev = tail;
         return a_to_prepend;
 }
 
@@ -188,10 +371,36 @@ cr_prop_list_prepend2 (CRPropList * a_this,
 enum CRStatus
 cr_prop_list_set_prop (CRPropList * a_this, CRString * a_prop)
 {
+        CRPropListIndex *index = NULL;
+        CRPropListIndexEntry *entry = NULL;
+        CRPropList *cur = NULL;
+        CRAtom name = NULL;
+
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && a_prop, CR_BAD_PARAM_ERROR);
 
+        index = PRIVATE (a_this)->index;
+        if (!index || !index->props) {
+                PRIVATE (a_this)->prop = a_prop;
+                return CR_OK;
+        }
+        index_remove_pair (index, a_this);
         PRIVATE (a_this)->prop = a_prop;
+        index_add_pair (index, a_this, FALSE);
+
+        /*the pair may now be the first one holding the property*/
+        name = get_prop_atom (a_this);
+        if (!name)
+                return CR_OK;
+        entry = g_hash_table_lookup (index->props, name);
+        if (!entry || entry->count == 1)
+                return CR_OK;
+        for (cur = index->head; cur; cur = PRIVATE (cur)->next) {
+                if (get_prop_atom (cur) == name) {
+                        entry->first = cur;
+                        break;
+                }
+        }
         return CR_OK;
 }
 
@@ -276,6 +485,21 @@ cr_prop_list_lookup_prop (CRPropList * a_this,
 
         g_return_val_if_fail (PRIVATE (a_this), CR_BAD_PARAM_ERROR);
 
+        if (PRIVATE (a_this)->index
+            && PRIVATE (a_this)->index->head == a_this
+            && index_ensure_props (PRIVATE (a_this)->index) == TRUE) {
+                CRPropListIndexEntry *entry = NULL;
+
+                if (!cr_string_get_atom (a_prop))
+                        return CR_VALUE_NOT_FOUND_ERROR;
+                entry = g_hash_table_lookup (PRIVATE (a_this)->index->props,
+                                             cr_string_get_atom (a_prop));
+                if (!entry)
+                        return CR_VALUE_NOT_FOUND_ERROR;
+                *a_pair = entry->first;
+                return CR_OK;
+        }
+
         for (cur = a_this; cur; cur = PRIVATE (cur)->next) {
                 if (PRIVATE (cur)->prop
 		    && PRIVATE (cur)->prop->stryng
@@ -357,6 +581,17 @@ cr_prop_list_unlink (CRPropList * a_this, CRPropList * a_pair)
                 g_return_val_if_fail (PRIVATE (prev), NULL);
                 g_return_val_if_fail (PRIVATE (prev)->next == a_pair, NULL);
         }
+        if (PRIVATE (a_pair)->index) {
+                CRPropListIndex *index = PRIVATE (a_pair)->index;
+
+                index_remove_pair (index, a_pair);
+                if (index->head == a_pair)
+                        index->head = next;
+                if (index->tail == a_pair)
+                        index->tail = prev;
+                if (!index->head)
+                        index_destroy (index);
+        }
         if (prev) {
                 PRIVATE (prev)->next = next;
         }
@@ -384,6 +619,9 @@ cr_prop_list_destroy (CRPropList * a_this)
 
         g_return_if_fail (a_this && PRIVATE (a_this));
 
+        if (PRIVATE (a_this)->index) {
+                index_destroy (PRIVATE (a_this)->index);
+        }
         for (tail = a_this;
              tail && PRIVATE (tail) && PRIVATE (tail)->next;
              tail = cr_prop_list_get_next (tail)) ;
@@ -21,7 +21,9 @@
  * See COPYRIGHTS file for copyright information.
  */
 
+#include <string.h>
 #include "cr-pseudo.h"
+#include "cr-arena.h"
 
 /**
  *@CRPseudo:
@@ -39,7 +41,12 @@ cr_pseudo_new (void)
 {
         CRPseudo *result = NULL;
 
-        result = g_malloc0 (sizeof (CRPseudo));
+        result = cr_arena_node_try_alloc (sizeof (CRPseudo));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRPseudo));
 
         return result;
 }
@@ -163,5 +170,5 @@ cr_pseudo_destroy (CRPseudo * a_this)
                 a_this->extra = NULL;
         }
 
-        g_free (a_this);
+        cr_arena_node_free (sizeof (CRPseudo), a_this);
 }
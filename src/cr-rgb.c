@@ -27,6 +27,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "cr-rgb.h"
+#include "cr-arena.h"
 #include "cr-term.h"
 #include "cr-parser.h"
 
@@ -193,7 +194,7 @@ cr_rgb_new (void)
 {
         CRRgb *result = NULL;
 
-        result = g_try_malloc (sizeof (CRRgb));
+        result = cr_arena_node_try_alloc (sizeof (CRRgb));
 
         if (result == NULL) {
                 cr_utils_trace_info ("No more memory");
@@ -632,7 +633,7 @@ void
 cr_rgb_destroy (CRRgb * a_this)
 {
         g_return_if_fail (a_this);
-        g_free (a_this);
+        cr_arena_node_free (sizeof (CRRgb), a_this);
 }
 
 /**
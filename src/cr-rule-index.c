@@ -0,0 +1,661 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#include <string.h>
+#include "cr-rule-index.h"
+#include "cr-media-context.h"
+
+/**
+ *@CRRuleIndex:
+ *
+ *The definition of the #CRRuleIndex class.
+ *The index lets the selection engine only evaluate the
+ *selectors that have a chance to match a given node, instead
+ *of every selector of the stylesheet.
+ */
+
+#define PRIVATE(a_this) (a_this)->priv
+
+/*
+ *the number of nested \@import rules the index follows,
+ *so that a cycle of imports cannot make it loop.
+ */
+#define MAX_IMPORT_DEPTH 32
+
+struct _CRRuleIndexPriv {
+        /*all the entries, in source order*/
+        CRRuleIndexEntry *entries;
+        gulong nr_entries;
+
+        /*
+         *buckets. The keys are the atoms of the ids, classes
+         *and names, the values are GPtrArray of CRRuleIndexEntry*.
+         */
+        GHashTable *id_buckets;
+        GHashTable *class_buckets;
+        GHashTable *element_buckets;
+        GPtrArray *universal;
+
+        /*
+         *the medium the index has been built for, NULL if
+         *it has been built for all media.
+         */
+        CRAtom medium;
+
+        /*see cr_rule_index_get_sibling_reach()*/
+        guint sibling_reach;
+};
+
+static void
+bucket_destroy (gpointer a_bucket)
+{
+        g_ptr_array_free (a_bucket, TRUE);
+}
+
+/**
+ *Records in @a_entry whether its statement holds
+ *normal declarations, !important ones, or both.
+ *Only rulesets hold declarations the cascade uses.
+ */
+static void
+compute_decl_kinds (CRRuleIndexEntry * a_entry)
+{
+        CRDeclaration const *cur = NULL;
+
+        a_entry->has_normal_decls = FALSE;
+        a_entry->has_important_decls = FALSE;
+        if (a_entry->stmt->type != RULESET_STMT
+            || !a_entry->stmt->kind.ruleset)
+                return;
+        for (cur = a_entry->stmt->kind.ruleset->decl_list; cur;
+             cur = cur->next) {
+                if (cur->important == TRUE)
+                        a_entry->has_important_decls = TRUE;
+                else
+                        a_entry->has_normal_decls = TRUE;
+        }
+}
+
+static void
+add_to_bucket (GHashTable * a_buckets, CRAtom a_key,
+               CRRuleIndexEntry * a_entry)
+{
+        GPtrArray *bucket = NULL;
+
+        bucket = g_hash_table_lookup (a_buckets, a_key);
+        if (!bucket) {
+                bucket = g_ptr_array_new ();
+                g_hash_table_insert (a_buckets, (gpointer) a_key, bucket);
+        }
+        g_ptr_array_add (bucket, a_entry);
+}
+
+/**
+ *Puts an entry in the bucket of the most selective key
+ *its rightmost simple selector requires: an id, then a class,
+ *then an element name.
+ *Additional selectors are considered from the last one backward,
+ *up to the first pseudo class, because that is how far the
+ *selection engine evaluates them.
+ */
+static void
+index_entry (CRRuleIndex * a_this, CRRuleIndexEntry * a_entry)
+{
+        CRSimpleSel *sel = NULL;
+        CRAdditionalSel *add_sel = NULL;
+        CRAtom id = NULL,
+                klass = NULL;
+
+        for (sel = a_entry->sel->simple_sel; sel && sel->next;
+             sel = sel->next) ;
+
+        if (sel && sel->add_sel) {
+                for (add_sel = sel->add_sel; add_sel->next;
+                     add_sel = add_sel->next) ;
+                for (; add_sel; add_sel = add_sel->prev) {
+                        if (add_sel->type == PSEUDO_CLASS_ADD_SELECTOR)
+                                break;
+                        if (add_sel->type == ID_ADD_SELECTOR
+                            && add_sel->content.id_name
+                            && add_sel->content.id_name->stryng
+                            && add_sel->content.id_name->stryng->str) {
+                                id = cr_string_get_atom
+                                        (add_sel->content.id_name);
+                        } else if (add_sel->type == CLASS_ADD_SELECTOR
+                                   && add_sel->content.class_name
+                                   && add_sel->content.class_name->stryng
+                                   && add_sel->content.class_name->stryng->str) {
+                                klass = cr_string_get_atom
+                                        (add_sel->content.class_name);
+                        }
+                }
+        }
+
+        if (id) {
+                add_to_bucket (PRIVATE (a_this)->id_buckets, id, a_entry);
+        } else if (klass) {
+                add_to_bucket (PRIVATE (a_this)->class_buckets,
+                               klass, a_entry);
+        } else if (sel
+                   && (sel->type_mask & TYPE_SELECTOR)
+                   && !(sel->type_mask & UNIVERSAL_SELECTOR)
+                   && sel->name && sel->name->stryng
+                   && sel->name->stryng->str) {
+                add_to_bucket (PRIVATE (a_this)->element_buckets,
+                               cr_string_get_atom (sel->name), a_entry);
+        } else {
+                g_ptr_array_add (PRIVATE (a_this)->universal, a_entry);
+        }
+}
+
+static void
+add_ancestor_hash (CRRuleIndexEntry * a_entry,
+                   enum CRRuleIndexKeyType a_type, const gchar * a_str)
+{
+        if (a_entry->nr_ancestor_hashes >= CR_RULE_INDEX_MAX_ANCESTOR_HASHES)
+                return;
+        a_entry->ancestor_hashes[a_entry->nr_ancestor_hashes++] =
+                cr_rule_index_hash_key (a_type, a_str, strlen (a_str));
+}
+
+/**
+ *Records the keys a_sel requires from the node it is
+ *matched against, using the same rules as index_entry().
+ */
+static void
+add_simple_sel_ancestor_hashes (CRRuleIndexEntry * a_entry,
+                                CRSimpleSel * a_sel)
+{
+        CRAdditionalSel *add_sel = NULL;
+
+        if ((a_sel->type_mask & TYPE_SELECTOR)
+            && !(a_sel->type_mask & UNIVERSAL_SELECTOR)
+            && a_sel->name && a_sel->name->stryng
+            && a_sel->name->stryng->str) {
+                add_ancestor_hash (a_entry, CR_RULE_INDEX_KEY_ELEMENT,
+                                   a_sel->name->stryng->str);
+        }
+        if (!a_sel->add_sel)
+                return;
+        for (add_sel = a_sel->add_sel; add_sel->next;
+             add_sel = add_sel->next) ;
+        for (; add_sel; add_sel = add_sel->prev) {
+                if (add_sel->type == PSEUDO_CLASS_ADD_SELECTOR)
+                        break;
+                if (add_sel->type == ID_ADD_SELECTOR
+                    && add_sel->content.id_name
+                    && add_sel->content.id_name->stryng
+                    && add_sel->content.id_name->stryng->str) {
+                        add_ancestor_hash (a_entry, CR_RULE_INDEX_KEY_ID,
+                                           add_sel->content.id_name->
+                                           stryng->str);
+                } else if (add_sel->type == CLASS_ADD_SELECTOR
+                           && add_sel->content.class_name
+                           && add_sel->content.class_name->stryng
+                           && add_sel->content.class_name->stryng->str) {
+                        add_ancestor_hash (a_entry, CR_RULE_INDEX_KEY_CLASS,
+                                           add_sel->content.class_name->
+                                           stryng->str);
+                }
+        }
+}
+
+/**
+ *Walks the simple selectors of the entry from right to left
+ *and records the keys of the ones that must match an ancestor
+ *of the node, that is, the ones found on the left of a
+ *descendant or child combinator. The ones found on the left
+ *of a '+' combinator only have to match a sibling, unless they
+ *are themselves on the left of a descendant or child combinator.
+ */
+static void
+compute_ancestor_hashes (CRRuleIndexEntry * a_entry)
+{
+        CRSimpleSel *sel = NULL;
+        gboolean is_ancestor = FALSE;
+
+        for (sel = a_entry->sel->simple_sel; sel && sel->next;
+             sel = sel->next) ;
+        for (; sel && sel->prev; sel = sel->prev) {
+                switch (sel->combinator) {
+                case COMB_WS:
+                case COMB_GT:
+                        is_ancestor = TRUE;
+                        break;
+                case COMB_PLUS:
+                        /*
+                         *the sibling of an ancestor is not
+                         *an ancestor, but the ancestors
+                         *of a sibling are.
+                         */
+                        is_ancestor = FALSE;
+                        break;
+                case NO_COMBINATOR:
+                        break;
+                default:
+                        return;
+                }
+                if (is_ancestor == TRUE)
+                        add_simple_sel_ancestor_hashes (a_entry, sel->prev);
+        }
+}
+
+static CRRuleIndexEntry **
+lookup_bucket (GHashTable * a_buckets, const gchar * a_key, guint * a_len)
+{
+        GPtrArray *bucket = NULL;
+        CRAtom key = NULL;
+
+        /*a string that has no atom is not used by any selector*/
+        key = cr_atom_lookup (a_key);
+        if (key)
+                bucket = g_hash_table_lookup (a_buckets, key);
+        if (!bucket || !bucket->len) {
+                *a_len = 0;
+                return NULL;
+        }
+        *a_len = bucket->len;
+        return (CRRuleIndexEntry **) bucket->pdata;
+}
+
+/**
+ *Counts the selectors of a ruleset and, once the entries
+ *of the index are allocated, fills an entry for each of them.
+ *@param a_this the index being built.
+ *@param a_stmt the ruleset.
+ *@param a_nr_entries in/out parameter. The number of entries
+ *counted or filled so far.
+ */
+static void
+index_ruleset (CRRuleIndex * a_this, CRStatement * a_stmt,
+               gulong * a_nr_entries)
+{
+        CRSelector *cur_sel = NULL;
+
+        for (cur_sel = a_stmt->kind.ruleset->sel_list; cur_sel;
+             cur_sel = cur_sel->next) {
+                CRRuleIndexEntry *entry = NULL;
+
+                if (!cur_sel->simple_sel)
+                        continue;
+                if (!PRIVATE (a_this)->entries) {
+                        (*a_nr_entries)++;
+                        continue;
+                }
+                entry = &PRIVATE (a_this)->entries[*a_nr_entries];
+                entry->stmt = a_stmt;
+                entry->sel = cur_sel;
+                entry->order = (*a_nr_entries)++;
+                entry->nr_ancestor_hashes = 0;
+                entry->specificity = cur_sel->simple_sel->specificity;
+                compute_decl_kinds (entry);
+                entry->prog = cr_sel_prog_new (cur_sel->simple_sel);
+                entry->only_tests_names = entry->prog
+                        && cr_sel_prog_only_tests_names (entry->prog);
+                if (entry->prog
+                    && cr_sel_prog_get_sibling_reach (entry->prog)
+                    > PRIVATE (a_this)->sibling_reach)
+                        PRIVATE (a_this)->sibling_reach =
+                                cr_sel_prog_get_sibling_reach (entry->prog);
+                compute_ancestor_hashes (entry);
+                index_entry (a_this, entry);
+        }
+}
+
+/**
+ *Walks a list of statements and indexes the selectors of its
+ *rulesets, see index_ruleset(). The rulesets of the \@media
+ *rules, and of the stylesheets of the \@import rules, that apply
+ *to the medium of the index are indexed in place of the rules,
+ *in cascade order; the other ones are skipped.
+ *This must stay in sync with what the selection engine reports.
+ *@param a_depth the number of \@import rules followed to
+ *get to @a_stmts.
+ */
+static void
+index_statements (CRRuleIndex * a_this, CRStatement * a_stmts,
+                  guint a_depth, gulong * a_nr_entries)
+{
+        CRStatement *cur = NULL;
+        CRAtom medium = PRIVATE (a_this)->medium;
+
+        for (cur = a_stmts; cur; cur = cur->next) {
+                switch (cur->type) {
+                case RULESET_STMT:
+                        if (cur->kind.ruleset)
+                                index_ruleset (a_this, cur, a_nr_entries);
+                        break;
+                case AT_MEDIA_RULE_STMT:
+                        if (!cur->kind.media_rule)
+                                break;
+                        if (medium
+                            && !cr_media_context_matches_medium
+                            (medium, cur->kind.media_rule->media_list))
+                                break;
+                        index_statements (a_this,
+                                          cur->kind.media_rule->rulesets,
+                                          a_depth, a_nr_entries);
+                        break;
+                case AT_IMPORT_RULE_STMT:
+                        if (!cur->kind.import_rule
+                            || !cur->kind.import_rule->sheet)
+                                break;
+                        if (medium
+                            && !cr_media_context_matches_medium
+                            (medium, cur->kind.import_rule->media_list))
+                                break;
+                        if (a_depth >= MAX_IMPORT_DEPTH) {
+                                cr_utils_trace_info ("@import rules "
+                                                     "nested too deep");
+                                break;
+                        }
+                        index_statements
+                                (a_this,
+                                 cur->kind.import_rule->sheet->statements,
+                                 a_depth + 1, a_nr_entries);
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+/**
+ * cr_rule_index_new_for_medium:
+ *@a_sheet: the stylesheet to index.
+ *@a_medium: the lower cased media type to index the stylesheet
+ *for, as returned by cr_media_context_get_media_type(), or NULL.
+ *
+ *Builds the index of the selectors of @a_sheet, as seen when
+ *styling for the medium @a_medium: the rulesets of the \@media
+ *rules that apply to @a_medium are indexed like the top level
+ *ones, and the other \@media rules are left out, so their media
+ *lists are evaluated once, here. If @a_medium is NULL, the
+ *rulesets of all the \@media rules are indexed.
+ *The same goes for the \@import rules resolved with
+ *cr_stylesheet_set_imported_sheet(): the rulesets of the stylesheets
+ *they import are indexed at the place of the rules, before the
+ *rulesets of @a_sheet.
+ *The index borrows the selectors and statements of the
+ *stylesheet, so it must not outlive it, and must be rebuilt
+ *if the statements of the stylesheet are changed.
+ *
+ *Returns the newly built instance of #CRRuleIndex, or NULL
+ *if an error occurs.
+ */
+CRRuleIndex *
+cr_rule_index_new_for_medium (CRStyleSheet * a_sheet, CRAtom a_medium)
+{
+        CRRuleIndex *result = NULL;
+        gulong nr_entries = 0;
+
+        g_return_val_if_fail (a_sheet, NULL);
+
+        result = g_try_malloc (sizeof (CRRuleIndex));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRRuleIndex));
+        PRIVATE (result) = g_try_malloc (sizeof (CRRuleIndexPriv));
+        if (!PRIVATE (result)) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (result);
+                return NULL;
+        }
+        memset (PRIVATE (result), 0, sizeof (CRRuleIndexPriv));
+        PRIVATE (result)->medium = a_medium;
+
+        PRIVATE (result)->id_buckets = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, bucket_destroy);
+        PRIVATE (result)->class_buckets = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, bucket_destroy);
+        PRIVATE (result)->element_buckets = g_hash_table_new_full
+                (g_direct_hash, g_direct_equal, NULL, bucket_destroy);
+        PRIVATE (result)->universal = g_ptr_array_new ();
+
+        /*count the entries first, then fill them*/
+        index_statements (result, a_sheet->statements, 0, &nr_entries);
+        if (!nr_entries)
+                return result;
+
+        PRIVATE (result)->entries = g_try_malloc
+                (nr_entries * sizeof (CRRuleIndexEntry));
+        if (!PRIVATE (result)->entries) {
+                cr_utils_trace_info ("Out of memory");
+                cr_rule_index_destroy (result);
+                return NULL;
+        }
+        PRIVATE (result)->nr_entries = nr_entries;
+        nr_entries = 0;
+        index_statements (result, a_sheet->statements, 0, &nr_entries);
+        return result;
+}
+
+/**
+ * cr_rule_index_new:
+ *@a_sheet: the stylesheet to index.
+ *
+ *Builds the index of the selectors of @a_sheet, for all
+ *media. See cr_rule_index_new_for_medium().
+ *
+ *Returns the newly built instance of #CRRuleIndex, or NULL
+ *if an error occurs.
+ */
+CRRuleIndex *
+cr_rule_index_new (CRStyleSheet * a_sheet)
+{
+        return cr_rule_index_new_for_medium (a_sheet, NULL);
+}
+
+/**
+ * cr_rule_index_get_medium:
+ *@a_this: the current instance of #CRRuleIndex.
+ *
+ *Returns the medium the index has been built for,
+ *or NULL if it has been built for all media.
+ */
+CRAtom
+cr_rule_index_get_medium (CRRuleIndex const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
+
+        return PRIVATE (a_this)->medium;
+}
+
+/**
+ * cr_rule_index_get_nr_entries:
+ *@a_this: the current instance of #CRRuleIndex.
+ *
+ *Returns the number of selectors held by the index.
+ */
+gulong
+cr_rule_index_get_nr_entries (CRRuleIndex const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->nr_entries;
+}
+
+/**
+ * cr_rule_index_get_sibling_reach:
+ *@a_this: the current instance of #CRRuleIndex.
+ *
+ *Returns the number of previous siblings of an element the
+ *selectors of the index may look at, as computed by
+ *cr_sel_prog_get_sibling_reach(): the selection only needs that
+ *many previous siblings of the element and of its ancestors.
+ */
+guint
+cr_rule_index_get_sibling_reach (CRRuleIndex const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->sibling_reach;
+}
+
+/**
+ * cr_rule_index_get_by_id:
+ *@a_this: the current instance of #CRRuleIndex.
+ *@a_id: the id to look up.
+ *@a_len: out parameter. The number of entries returned.
+ *
+ *Returns the entries of the selectors that require the id @a_id,
+ *in source order, or NULL if there is none. The returned array
+ *belongs to the index.
+ */
+CRRuleIndexEntry **
+cr_rule_index_get_by_id (CRRuleIndex const * a_this,
+                         const gchar * a_id, guint * a_len)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_id && a_len, NULL);
+
+        return lookup_bucket (PRIVATE (a_this)->id_buckets, a_id, a_len);
+}
+
+/**
+ * cr_rule_index_get_by_class:
+ *@a_this: the current instance of #CRRuleIndex.
+ *@a_class: the class name to look up.
+ *@a_len: out parameter. The number of entries returned.
+ *
+ *Returns the entries of the selectors that require the class
+ *@a_class and no id, in source order, or NULL if there is none.
+ *The returned array belongs to the index.
+ */
+CRRuleIndexEntry **
+cr_rule_index_get_by_class (CRRuleIndex const * a_this,
+                            const gchar * a_class, guint * a_len)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_class && a_len, NULL);
+
+        return lookup_bucket (PRIVATE (a_this)->class_buckets,
+                              a_class, a_len);
+}
+
+/**
+ * cr_rule_index_get_by_element:
+ *@a_this: the current instance of #CRRuleIndex.
+ *@a_name: the element name to look up.
+ *@a_len: out parameter. The number of entries returned.
+ *
+ *Returns the entries of the selectors that require the element
+ *name @a_name and neither an id nor a class, in source order,
+ *or NULL if there is none. The returned array belongs to the index.
+ */
+CRRuleIndexEntry **
+cr_rule_index_get_by_element (CRRuleIndex const * a_this,
+                              const gchar * a_name, guint * a_len)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_name && a_len, NULL);
+
+        return lookup_bucket (PRIVATE (a_this)->element_buckets,
+                              a_name, a_len);
+}
+
+/**
+ * cr_rule_index_get_universal:
+ *@a_this: the current instance of #CRRuleIndex.
+ *@a_len: out parameter. The number of entries returned.
+ *
+ *Returns the entries of the selectors that must be tried
+ *on every node, in source order, or NULL if there is none.
+ *The returned array belongs to the index.
+ */
+CRRuleIndexEntry **
+cr_rule_index_get_universal (CRRuleIndex const * a_this, guint * a_len)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_len, NULL);
+
+        *a_len = PRIVATE (a_this)->universal->len;
+        if (!*a_len)
+                return NULL;
+        return (CRRuleIndexEntry **) PRIVATE (a_this)->universal->pdata;
+}
+
+/**
+ * cr_rule_index_hash_key:
+ *@a_type: the kind of key to hash.
+ *@a_str: the id, class or element name to hash.
+ *@a_len: the length of @a_str, in bytes.
+ *
+ *Hashes an id, a class or an element name the way
+ *the ancestor hashes of #CRRuleIndexEntry are computed.
+ *Keys of different kinds hash differently.
+ *
+ *Returns the hash of the key.
+ */
+guint32
+cr_rule_index_hash_key (enum CRRuleIndexKeyType a_type,
+                        const gchar * a_str, gsize a_len)
+{
+        guint32 hash = 2166136261u;
+        gsize i = 0;
+
+        /*FNV-1a, seeded by the key type*/
+        hash = (hash ^ (a_type + 1)) * 16777619u;
+        for (i = 0; i < a_len; i++)
+                hash = (hash ^ (guchar) a_str[i]) * 16777619u;
+        return hash;
+}
+
+/**
+ * cr_rule_index_destroy:
+ *@a_this: the current instance of #CRRuleIndex.
+ *
+ *The destructor of #CRRuleIndex.
+ */
+void
+cr_rule_index_destroy (CRRuleIndex * a_this)
+{
+        gulong i = 0;
+
+        g_return_if_fail (a_this);
+
+        if (PRIVATE (a_this)) {
+                if (PRIVATE (a_this)->id_buckets)
+                        g_hash_table_destroy (PRIVATE (a_this)->id_buckets);
+                if (PRIVATE (a_this)->class_buckets)
+                        g_hash_table_destroy
+                                (PRIVATE (a_this)->class_buckets);
+                if (PRIVATE (a_this)->element_buckets)
+                        g_hash_table_destroy
+                                (PRIVATE (a_this)->element_buckets);
+                if (PRIVATE (a_this)->universal)
+                        g_ptr_array_free (PRIVATE (a_this)->universal, TRUE);
+                if (PRIVATE (a_this)->entries) {
+                        for (i = 0; i < PRIVATE (a_this)->nr_entries; i++) {
+                                if (PRIVATE (a_this)->entries[i].prog)
+                                        cr_sel_prog_destroy
+                                                (PRIVATE (a_this)->
+                                                 entries[i].prog);
+                        }
+                        g_free (PRIVATE (a_this)->entries);
+                }
+                g_free (PRIVATE (a_this));
+                PRIVATE (a_this) = NULL;
+        }
+        g_free (a_this);
+}
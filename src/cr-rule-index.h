@@ -0,0 +1,165 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#ifndef __CR_RULE_INDEX_H__
+#define __CR_RULE_INDEX_H__
+
+#include "cr-utils.h"
+#include "cr-atom.h"
+#include "cr-stylesheet.h"
+#include "cr-sel-prog.h"
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRRuleIndex class.
+ */
+
+/**
+ *The maximum number of ancestor keys recorded per
+ *#CRRuleIndexEntry. Selectors that require more ancestor
+ *ids, classes or element names only have the first ones recorded.
+ */
+#define CR_RULE_INDEX_MAX_ANCESTOR_HASHES 4
+
+/**
+ *The kinds of keys hashed by cr_rule_index_hash_key().
+ */
+enum CRRuleIndexKeyType
+{
+        CR_RULE_INDEX_KEY_ID,
+        CR_RULE_INDEX_KEY_CLASS,
+        CR_RULE_INDEX_KEY_ELEMENT
+} ;
+
+typedef struct _CRRuleIndex CRRuleIndex ;
+typedef struct _CRRuleIndexPriv CRRuleIndexPriv ;
+typedef struct _CRRuleIndexEntry CRRuleIndexEntry ;
+
+/**
+ *One selector of the stylesheet, as seen by the index.
+ */
+struct _CRRuleIndexEntry
+{
+        /**
+         *The ruleset the selector belongs to, at the top level
+         *of the stylesheet or in an \@media rule. This is
+         *the statement the selection engine reports when
+         *the selector matches.
+         */
+        CRStatement *stmt ;
+
+        /**The selector, an item of the statement's selector list.*/
+        CRSelector *sel ;
+
+        /**
+         *The rank of the selector in the stylesheet, in
+         *source order. Used to merge buckets back in order.
+         */
+        gulong order ;
+
+        /**
+         *The specificity of the selector, computed
+         *when the selector was built, see cr_selector_new().
+         */
+        gulong specificity ;
+
+        /**
+         *Whether the statement holds declarations that are
+         *not marked !important, and ones that are. The cascade
+         *only visits the statement at the levels it has
+         *declarations for.
+         */
+        gboolean has_normal_decls ;
+        gboolean has_important_decls ;
+
+        /**
+         *The selector compiled by cr_sel_prog_new(), that the
+         *selection engine runs on the candidate nodes. NULL
+         *if the compilation failed.
+         */
+        CRSelInstr *prog ;
+
+        /**
+         *Whether the selector only tests the names, the ids and
+         *the classes of the node and of its ancestors, as said
+         *by cr_sel_prog_only_tests_names().
+         */
+        gboolean only_tests_names ;
+
+        /**
+         *The hashes of the ids, classes and element names
+         *the selector requires from the ancestors of the node,
+         *as computed by cr_rule_index_hash_key().
+         *A node can only match the selector if each of these
+         *keys is carried by one of its ancestors.
+         */
+        guint32 ancestor_hashes[CR_RULE_INDEX_MAX_ANCESTOR_HASHES] ;
+        guint nr_ancestor_hashes ;
+} ;
+
+/**
+ *An index of the selectors of a #CRStyleSheet.
+ *Each selector is put in exactly one bucket, keyed by the id, the
+ *class or the element name required by its rightmost simple selector.
+ *Selectors that require none of these go in the universal bucket.
+ */
+struct _CRRuleIndex
+{
+        CRRuleIndexPriv *priv ;
+} ;
+
+CRRuleIndex * cr_rule_index_new (CRStyleSheet *a_sheet) ;
+
+CRRuleIndex * cr_rule_index_new_for_medium (CRStyleSheet *a_sheet,
+                                            CRAtom a_medium) ;
+
+CRAtom cr_rule_index_get_medium (CRRuleIndex const *a_this) ;
+
+gulong cr_rule_index_get_nr_entries (CRRuleIndex const *a_this) ;
+
+guint cr_rule_index_get_sibling_reach (CRRuleIndex const *a_this) ;
+
+CRRuleIndexEntry ** cr_rule_index_get_by_id (CRRuleIndex const *a_this,
+                                             const gchar *a_id,
+                                             guint *a_len) ;
+
+CRRuleIndexEntry ** cr_rule_index_get_by_class (CRRuleIndex const *a_this,
+                                                const gchar *a_class,
+                                                guint *a_len) ;
+
+CRRuleIndexEntry ** cr_rule_index_get_by_element (CRRuleIndex const *a_this,
+                                                  const gchar *a_name,
+                                                  guint *a_len) ;
+
+CRRuleIndexEntry ** cr_rule_index_get_universal (CRRuleIndex const *a_this,
+                                                 guint *a_len) ;
+
+guint32 cr_rule_index_hash_key (enum CRRuleIndexKeyType a_type,
+                                const gchar *a_str, gsize a_len) ;
+
+void cr_rule_index_destroy (CRRuleIndex *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_RULE_INDEX_H__*/
@@ -23,6 +23,8 @@
 
 #include <string.h>
 #include "cr-sel-eng.h"
+#include "cr-rule-index.h"
+#include "cr-libxml-node-iface.h"
 
 /**
  *@CRSelEng:
@@ -37,73 +39,182 @@
 
 struct CRPseudoClassSelHandlerEntry {
         guchar *name;
+        /*the atom of name, see lookup_pseudo_class_handler()*/
+        CRAtom atom;
         enum CRPseudoType type;
+        /*only one of the two handlers is set*/
         CRPseudoClassSelectorHandler handler;
+        CRNodePseudoClassSelectorHandler node_handler;
+};
+
+/*
+ *The size, in counters, of the ancestor filter.
+ *Must be a power of two. Each key sets two counters,
+ *indexed by two slices of its hash.
+ */
+#define ANCESTOR_FILTER_BITS 12
+#define ANCESTOR_FILTER_SIZE (1 << ANCESTOR_FILTER_BITS)
+#define ANCESTOR_FILTER_MASK (ANCESTOR_FILTER_SIZE - 1)
+
+struct CRAncestorEntry {
+        CRXMLNodePtr node;
+        /*index of the first key of the node in ancestor_hashes*/
+        guint first_hash;
+};
+
+/*
+ *A class of a node, as split by node_snapshot_take().
+ */
+struct CRNodeClass {
+        const gchar *name;
+        guint len;
+        /*see cr_rule_index_hash_key()*/
+        guint32 hash;
+};
+
+/*
+ *An attribute looked up on a node, see node_snapshot_get_attr().
+ */
+struct CRNodeAttr {
+        const gchar *name;
+        const gchar *value;
+        gboolean is_set;
+};
+
+/*
+ *What the selectors test on a node, read from the node once
+ *per selection: its id, its classes, split and hashed, and the
+ *attributes looked up so far. Testing a selector against a node
+ *that has its snapshot allocates nothing.
+ *The snapshot points to the attributes of the node, so the
+ *node must not be modified during the selection.
+ */
+struct CRNodeSnapshot {
+        CRXMLNodePtr node;
+        /*the interface the node is read with*/
+        CRNodeIface const *iface;
+        const gchar *id;
+        guint id_len;
+        /*the class attribute of the node, split in place*/
+        GString *classes_str;
+        GArray *classes;
+        GArray *attrs;
+        /*the strings the node interface had to build*/
+        GPtrArray *copies;
+};
+
+/**
+ *The scratch state of a selection, that lasts from one
+ *method call to another. The selection engine itself is
+ *only read while selecting.
+ */
+struct _CRSelMatchContext {
+        CRStyleSheet *sheet;
+        CRXMLNodePtr node;
+        /**
+         *the entries of the rule index that may match
+         *the node, and where to resume their evaluation
+         *so that we can remember it from one method call to another.
+         */
+        GPtrArray *candidates;
+        guint cur_candidate;
+        /*
+         *the rule index entry of the most specific selector
+         *that matched each of the statements found for the node
+         *in the stylesheet being walked, keyed by statement.
+         */
+        GHashTable *matched_entries;
+        /*
+         *the scratch state of the cascade, see cascade_properties():
+         *the matched rulesets sorted by precedence, the properties
+         *cascaded so far and the declarations that won.
+         */
+        GArray *cascade_items;
+        GHashTable *cascaded_props;
+        GPtrArray *winners;
+        /*
+         *the traversal context: a counting bloom filter of
+         *the ids, classes and names of the elements pushed with
+         *cr_sel_eng_push_element(), the stack of these elements
+         *and the keys each of them added to the filter.
+         */
+        guchar *ancestor_filter;
+        GArray *ancestors;
+        GArray *ancestor_hashes;
+        /*
+         *the snapshots of the nodes tested by the current
+         *selection, keyed by node, the pool they are taken from,
+         *and the last one looked up.
+         */
+        GHashTable *snapshots;
+        GPtrArray *snapshot_pool;
+        guint nb_snapshots;
+        struct CRNodeSnapshot *last_snapshot;
+        /*
+         *whether all the rules that may match the node of the
+         *last selection only test names, ids and classes, see
+         *cr_sel_prog_only_tests_names().
+         */
+        gboolean only_tests_names;
 };
 
 struct _CRSelEngPriv {
         /*not used yet */
         gboolean case_sensitive;
 
-        CRStyleSheet *sheet;
-        /**
-         *where to store the next statement
-         *to be visited so that we can remember
-         *it from one method call to another.
+        /*
+         *the context of the selections made without
+         *a context of their own.
          */
-        CRStatement *cur_stmt;
+        CRSelMatchContext *ctxt;
         GList *pcs_handlers;
         gint pcs_handlers_size;
+        /*see cr_sel_eng_set_style_sharing()*/
+        gboolean share_styles;
+        /*
+         *see cr_sel_eng_set_media_context(), and
+         *the media type of the context.
+         */
+        CRMediaContext *media;
+        CRAtom medium;
+        /*see cr_sel_eng_set_node_iface()*/
+        CRNodeIface const *node_iface;
 } ;
 
-static gboolean class_add_sel_matches_node (CRAdditionalSel * a_add_sel,
-                                            xmlNode * a_node);
-
-static gboolean id_add_sel_matches_node (CRAdditionalSel * a_add_sel,
-                                         xmlNode * a_node);
-
-static gboolean attr_add_sel_matches_node (CRAdditionalSel * a_add_sel,
-                                           xmlNode * a_node);
-
-static enum CRStatus sel_matches_node_real (CRSelEng * a_this,
-                                            CRSimpleSel * a_sel,
-                                            xmlNode * a_node,
-                                            gboolean * a_result,
-                                            gboolean a_eval_sel_list_from_end,
-                                            gboolean a_recurse);
+static gboolean sel_prog_matches_node (CRSelEng * a_this,
+                                       CRSelMatchContext * a_ctxt,
+                                       CRSelInstr const * a_prog,
+                                       CRXMLNodePtr a_node);
 
 static enum CRStatus cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
+                                                           CRSelMatchContext *
+                                                           a_ctxt,
                                                            CRStyleSheet *
                                                            a_stylesheet,
-                                                           xmlNode * a_node,
+                                                           CRXMLNodePtr a_node,
                                                            CRStatement **
                                                            a_rulesets,
                                                            gulong * a_len);
 
-static enum CRStatus put_css_properties_in_props_list (CRPropList ** a_props,
-                                                       CRStatement *
-                                                       a_ruleset);
-
-static gboolean pseudo_class_add_sel_matches_node (CRSelEng * a_this,
-                                                   CRAdditionalSel *
-                                                   a_add_sel,
-                                                   xmlNode * a_node);
+static enum CRStatus cascade_properties (CRSelMatchContext * a_ctxt,
+                                         CRPropList ** a_props);
 
 static gboolean lang_pseudo_class_handler (CRSelEng * a_this,
                                            CRAdditionalSel * a_sel,
-                                           xmlNode * a_node);
+                                           CRXMLNodePtr a_node);
 
 static gboolean first_child_pseudo_class_handler (CRSelEng * a_this,
                                                   CRAdditionalSel * a_sel,
-                                                  xmlNode * a_node);
+                                                  CRXMLNodePtr a_node);
 
-static xmlNode *get_next_element_node (xmlNode * a_node);
+struct _StylingTask;
+typedef struct _StylingTask StylingTask;
 
-static xmlNode *get_next_child_element_node (xmlNode * a_node);
+struct _StylingWorker;
+typedef struct _StylingWorker StylingWorker;
 
-static xmlNode *get_prev_element_node (xmlNode * a_node);
-
-static xmlNode *get_next_parent_element_node (xmlNode * a_node);
+struct _StylingJob;
+typedef struct _StylingJob StylingJob;
 
 /* Quick strcmp.  Test only for == 0 or != 0, not < 0 or > 0.  */
 #define strqcmp(str,lit,lit_len) \
@@ -111,10 +222,12 @@ static xmlNode *get_next_parent_element_node (xmlNode * a_node);
 
 static gboolean
 lang_pseudo_class_handler (CRSelEng * a_this,
-                           CRAdditionalSel * a_sel, xmlNode * a_node)
+                           CRAdditionalSel * a_sel, CRXMLNodePtr a_node)
 {
-        xmlNode *node = a_node;
-        xmlChar *val = NULL;
+        CRNodeIface const *iface = NULL;
+        CRXMLNodePtr node = a_node;
+        const gchar *val = NULL;
+        gchar *copy = NULL;
         gboolean result = FALSE;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this)
@@ -135,17 +248,18 @@ lang_pseudo_class_handler (CRSelEng * a_this,
             || !a_sel->content.pseudo->extra->stryng
             || a_sel->content.pseudo->extra->stryng->len < 2)
                 return FALSE;
-        for (; node; node = get_next_parent_element_node (node)) {
-                val = xmlGetProp (node, (const xmlChar *) "lang");
+        iface = PRIVATE (a_this)->node_iface;
+        for (; node; node = iface->get_parent_element (node)) {
+                val = iface->get_lang (node, &copy);
                 if (val
-                    && !strqcmp ((const char *) val,
+                    && !strqcmp (val,
                                  a_sel->content.pseudo->extra->stryng->str,
                                  a_sel->content.pseudo->extra->stryng->len)) {
                         result = TRUE;
                 }
-                if (val) {
-                        xmlFree (val);
-                        val = NULL;
+                if (copy) {
+                        g_free (copy);
+                        copy = NULL;
                 }
         }
 
@@ -154,10 +268,8 @@ lang_pseudo_class_handler (CRSelEng * a_this,
 
 static gboolean
 first_child_pseudo_class_handler (CRSelEng * a_this,
-                                  CRAdditionalSel * a_sel, xmlNode * a_node)
+                                  CRAdditionalSel * a_sel, CRXMLNodePtr a_node)
 {
-        xmlNode *node = NULL;
-
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && a_sel && a_sel->content.pseudo
                               && a_sel->content.pseudo
@@ -171,627 +283,991 @@ first_child_pseudo_class_handler (CRSelEng * a_this,
                 cr_utils_trace_info ("This handler is for :first-child only");
                 return CR_BAD_PSEUDO_CLASS_SEL_HANDLER_ERROR;
         }
-        if (!a_node->parent)
+        if (PRIVATE (a_this)->node_iface->get_prev_sibling_element (a_node))
                 return FALSE;
-        node = get_next_child_element_node (a_node->parent);
-        if (node == a_node)
-                return TRUE;
-        return FALSE;
+        return TRUE;
 }
 
-static gboolean
-pseudo_class_add_sel_matches_node (CRSelEng * a_this,
-                                   CRAdditionalSel * a_add_sel,
-                                   xmlNode * a_node)
+/**
+ *Looks up the handler of a pseudo class by the atom of its
+ *name, which spares the string compares of
+ *cr_sel_eng_get_pseudo_class_selector_handler().
+ *@return the entry of the handler, or NULL if there is none.
+ */
+static struct CRPseudoClassSelHandlerEntry *
+lookup_pseudo_class_handler (CRSelEng * a_this, CRAtom a_name,
+                             enum CRPseudoType a_type)
 {
-        enum CRStatus status = CR_OK;
-        CRPseudoClassSelectorHandler handler = NULL;
+        GList *elem = NULL;
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
 
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_add_sel
-                              && a_add_sel->content.pseudo
-                              && a_add_sel->content.pseudo->name
-                              && a_add_sel->content.pseudo->name->stryng
-                              && a_add_sel->content.pseudo->name->stryng->str
-                              && a_node, CR_BAD_PARAM_ERROR);
+        for (elem = PRIVATE (a_this)->pcs_handlers;
+             elem; elem = g_list_next (elem)) {
+                entry = elem->data;
+                if (entry->atom == a_name && entry->type == a_type)
+                        return entry;
+        }
+        return NULL;
+}
+
+/**
+ *Runs the handler of a pseudo class on a node. A handler
+ *registered with cr_sel_eng_register_pseudo_class_sel_handler()
+ *is given the node as an xmlNode.
+ *@param a_this the selection engine.
+ *@param a_name the atom of the name of the pseudo class.
+ *@param a_type the type of the pseudo class.
+ *@param a_add_sel the additional selector of the pseudo class.
+ *@param a_node the xml node, an element.
+ *@return the result of the handler, FALSE if there is none.
+ */
+static gboolean
+pseudo_class_matches_node (CRSelEng * a_this, CRAtom a_name,
+                           enum CRPseudoType a_type,
+                           CRAdditionalSel * a_add_sel, CRXMLNodePtr a_node)
+{
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
 
-        status = cr_sel_eng_get_pseudo_class_selector_handler
-                (a_this, (guchar *) a_add_sel->content.pseudo->name->stryng->str,
-                 a_add_sel->content.pseudo->type, &handler);
-        if (status != CR_OK || !handler)
+        entry = lookup_pseudo_class_handler (a_this, a_name, a_type);
+        if (!entry)
                 return FALSE;
+        if (entry->node_handler)
+                return entry->node_handler (a_this, a_add_sel,
+                                            a_node) == TRUE;
+        return entry->handler (a_this, a_add_sel,
+                               (xmlNode *) a_node) == TRUE;
+}
 
-        return handler (a_this, a_add_sel, a_node);
+static struct CRNodeSnapshot *
+node_snapshot_new (void)
+{
+        struct CRNodeSnapshot *result = NULL;
+
+        result = g_try_malloc (sizeof (struct CRNodeSnapshot));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (struct CRNodeSnapshot));
+        result->classes_str = g_string_new (NULL);
+        result->classes = g_array_new (FALSE, FALSE,
+                                       sizeof (struct CRNodeClass));
+        result->attrs = g_array_new (FALSE, FALSE,
+                                     sizeof (struct CRNodeAttr));
+        result->copies = g_ptr_array_new ();
+        return result;
 }
 
 /**
- *@param a_add_sel the class additional selector to consider.
- *@param a_node the xml node to consider.
- *@return TRUE if the class additional selector matches
- *the xml node given in argument, FALSE otherwise.
+ *Forgets the node a snapshot has been taken of,
+ *but keeps the buffers of the snapshot for the next node.
  */
-static gboolean
-class_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+static void
+node_snapshot_clear (struct CRNodeSnapshot *a_this)
 {
-        gboolean result = FALSE;
-        xmlChar *klass = NULL,
-                *cur = NULL;
+        guint i = 0;
+
+        for (i = 0; i < a_this->copies->len; i++)
+                g_free (g_ptr_array_index (a_this->copies, i));
+        g_ptr_array_set_size (a_this->copies, 0);
+        g_array_set_size (a_this->classes, 0);
+        g_array_set_size (a_this->attrs, 0);
+        a_this->node = NULL;
+        a_this->iface = NULL;
+        a_this->id = NULL;
+        a_this->id_len = 0;
+}
 
-        g_return_val_if_fail (a_add_sel
-                              && a_add_sel->type == CLASS_ADD_SELECTOR
-                              && a_add_sel->content.class_name
-                              && a_add_sel->content.class_name->stryng
-                              && a_add_sel->content.class_name->stryng->str
-                              && a_node, FALSE);
-
-        if (xmlHasProp (a_node, (const xmlChar *) "class")) {
-                klass = xmlGetProp (a_node, (const xmlChar *) "class");
-                for (cur = klass; cur && *cur; cur++) {
-                        while (cur && *cur
-                               && cr_utils_is_white_space (*cur) 
-                               == TRUE)
-                                cur++;
+static void
+node_snapshot_destroy (gpointer a_this)
+{
+        struct CRNodeSnapshot *snapshot = a_this;
+
+        node_snapshot_clear (snapshot);
+        g_string_free (snapshot->classes_str, TRUE);
+        g_array_free (snapshot->classes, TRUE);
+        g_array_free (snapshot->attrs, TRUE);
+        g_ptr_array_free (snapshot->copies, TRUE);
+        g_free (snapshot);
+}
 
-                        if (!strncmp ((const char *) cur, 
-                                      a_add_sel->content.class_name->stryng->str,
-                                      a_add_sel->content.class_name->stryng->len)) {
-                                cur += a_add_sel->content.class_name->stryng->len;
-                                if ((cur && !*cur)
-                                    || cr_utils_is_white_space (*cur) == TRUE)
-                                        result = TRUE;
-                        } else {  /* if it doesn't match,  */
-                                /*   then skip to next whitespace character to try again */
-                                while (cur && *cur && !(cr_utils_is_white_space(*cur) == TRUE)) 
-                                        cur++;
-                        }
-                        if (cur && !*cur)
-                                break ;
+/**
+ *Takes the snapshot of a node: reads its id, and
+ *splits and hashes its classes.
+ */
+static void
+node_snapshot_take (struct CRNodeSnapshot *a_this,
+                    CRNodeIface const * a_iface, CRXMLNodePtr a_node)
+{
+        struct CRNodeClass klass;
+        const gchar *value = NULL;
+        gchar *copy = NULL,
+                *cur = NULL,
+                *end = NULL;
+
+        node_snapshot_clear (a_this);
+        a_this->node = a_node;
+        a_this->iface = a_iface;
+
+        a_this->id = a_iface->get_id (a_node, &copy);
+        if (copy)
+                g_ptr_array_add (a_this->copies, copy);
+        if (a_this->id)
+                a_this->id_len = strlen (a_this->id);
+
+        value = a_iface->get_classes (a_node, &copy);
+        if (!value)
+                return;
+        g_string_assign (a_this->classes_str, value);
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
+        for (cur = a_this->classes_str->str; *cur; cur = end) {
+                while (*cur && cr_utils_is_white_space (*cur) == TRUE)
+                        cur++;
+                if (!*cur)
+                        break;
+                for (end = cur;
+                     *end && cr_utils_is_white_space (*end) == FALSE;
+                     end++) ;
+                klass.name = cur;
+                klass.len = end - cur;
+                klass.hash = cr_rule_index_hash_key
+                        (CR_RULE_INDEX_KEY_CLASS, cur, end - cur);
+                g_array_append_val (a_this->classes, klass);
+                if (*end)
+                        *end++ = 0;
+        }
+}
+
+/**
+ *Looks an attribute up in the snapshot of a node, reading it
+ *from the node the first time only.
+ *@param a_this the snapshot.
+ *@param a_name the name of the attribute.
+ *@param a_is_set out parameter. Whether the node has the attribute.
+ *@return the value of the attribute, see the get_attribute
+ *member of #CRNodeIface.
+ */
+static const gchar *
+node_snapshot_get_attr (struct CRNodeSnapshot *a_this,
+                        const gchar * a_name, gboolean * a_is_set)
+{
+        struct CRNodeAttr attr;
+        gchar *copy = NULL;
+        guint i = 0;
+
+        for (i = 0; i < a_this->attrs->len; i++) {
+                struct CRNodeAttr *cur = &g_array_index
+                        (a_this->attrs, struct CRNodeAttr, i);
+
+                if (!strcmp (cur->name, a_name)) {
+                        *a_is_set = cur->is_set;
+                        return cur->value;
                 }
         }
-        if (klass) {
-                xmlFree (klass);
-                klass = NULL;
+        attr.name = a_name;
+        attr.value = a_this->iface->get_attribute
+                (a_this->node, a_name, &attr.is_set, &copy);
+        if (copy)
+                g_ptr_array_add (a_this->copies, copy);
+        g_array_append_val (a_this->attrs, attr);
+        *a_is_set = attr.is_set;
+        return attr.value;
+}
+
+/**
+ *Drops the snapshots of the nodes tested by the previous
+ *selection made in a match context.
+ */
+static void
+node_snapshots_reset (CRSelMatchContext * a_ctxt)
+{
+        guint i = 0;
+
+        for (i = 0; i < a_ctxt->nb_snapshots; i++)
+                node_snapshot_clear (g_ptr_array_index
+                                     (a_ctxt->snapshot_pool, i));
+        a_ctxt->nb_snapshots = 0;
+        a_ctxt->last_snapshot = NULL;
+        g_hash_table_remove_all (a_ctxt->snapshots);
+}
+
+/**
+ *Gets the snapshot of a node for the current selection,
+ *taking it if the node has none yet.
+ *@param a_ctxt the match context of the selection, or NULL.
+ *@param a_iface the interface to read the node with.
+ *@param a_node the xml node to consider.
+ *@return the snapshot, or NULL if there is no match
+ *context or if an error occurs.
+ */
+static struct CRNodeSnapshot *
+get_node_snapshot (CRSelMatchContext * a_ctxt, CRNodeIface const * a_iface,
+                   CRXMLNodePtr a_node)
+{
+        struct CRNodeSnapshot *result = NULL;
+
+        if (!a_ctxt)
+                return NULL;
+        if (a_ctxt->last_snapshot && a_ctxt->last_snapshot->node == a_node)
+                return a_ctxt->last_snapshot;
+
+        result = g_hash_table_lookup (a_ctxt->snapshots, a_node);
+        if (!result) {
+                if (a_ctxt->nb_snapshots < a_ctxt->snapshot_pool->len) {
+                        result = g_ptr_array_index (a_ctxt->snapshot_pool,
+                                                    a_ctxt->nb_snapshots);
+                } else {
+                        result = node_snapshot_new ();
+                        if (!result)
+                                return NULL;
+                        g_ptr_array_add (a_ctxt->snapshot_pool, result);
+                }
+                a_ctxt->nb_snapshots++;
+                node_snapshot_take (result, a_iface, a_node);
+                g_hash_table_insert (a_ctxt->snapshots, a_node, result);
         }
+        a_ctxt->last_snapshot = result;
         return result;
-
 }
 
 /**
- *@return TRUE if the additional attribute selector matches
- *the current xml node given in argument, FALSE otherwise.
- *@param a_add_sel the additional attribute selector to consider.
+ *@param a_ctxt the match context of the selection, or NULL.
+ *@param a_iface the interface to read the node with.
  *@param a_node the xml node to consider.
+ *@param a_instr the CR_SEL_OP_CLASS instruction to run.
+ *@return TRUE if the class of a_instr is one of the classes
+ *of the xml node given in argument, FALSE otherwise.
  */
 static gboolean
-id_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+class_matches_node (CRSelMatchContext * a_ctxt, CRNodeIface const * a_iface,
+                    CRXMLNodePtr a_node, CRSelInstr const * a_instr)
 {
+        struct CRNodeSnapshot *snapshot = NULL;
+        struct CRNodeClass *klass = NULL;
+        const gchar *value = NULL,
+                *cur = NULL,
+                *end = NULL;
+        gchar *copy = NULL;
         gboolean result = FALSE;
-        xmlChar *id = NULL;
-
-        g_return_val_if_fail (a_add_sel
-                              && a_add_sel->type == ID_ADD_SELECTOR
-                              && a_add_sel->content.id_name
-                              && a_add_sel->content.id_name->stryng
-                              && a_add_sel->content.id_name->stryng->str
-                              && a_node, FALSE);
-        g_return_val_if_fail (a_add_sel
-                              && a_add_sel->type == ID_ADD_SELECTOR
-                              && a_node, FALSE);
-
-        if (xmlHasProp (a_node, (const xmlChar *) "id")) {
-                id = xmlGetProp (a_node, (const xmlChar *) "id");
-                if (!strqcmp ((const char *) id, a_add_sel->content.id_name->stryng->str,
-                              a_add_sel->content.id_name->stryng->len)) {
+        guint i = 0;
+
+        snapshot = get_node_snapshot (a_ctxt, a_iface, a_node);
+        if (snapshot) {
+                for (i = 0; i < snapshot->classes->len; i++) {
+                        klass = &g_array_index (snapshot->classes,
+                                                struct CRNodeClass, i);
+                        if (klass->hash == a_instr->hash
+                            && klass->len == a_instr->len
+                            && !memcmp (klass->name, a_instr->str,
+                                        a_instr->len))
+                                return TRUE;
+                }
+                return FALSE;
+        }
+
+        value = a_iface->get_classes (a_node, &copy);
+        for (cur = value; cur && *cur; cur = end) {
+                while (*cur && cr_utils_is_white_space (*cur) == TRUE)
+                        cur++;
+                for (end = cur;
+                     *end && cr_utils_is_white_space (*end) == FALSE;
+                     end++) ;
+                if (end - cur == a_instr->len
+                    && !memcmp (cur, a_instr->str, end - cur)) {
                         result = TRUE;
+                        break;
                 }
         }
-        if (id) {
-                xmlFree (id);
-                id = NULL;
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
+        return result;
+}
+
+/**
+ *@param a_ctxt the match context of the selection, or NULL.
+ *@param a_iface the interface to read the node with.
+ *@param a_node the xml node to consider.
+ *@param a_instr the CR_SEL_OP_ID instruction to run.
+ *@return TRUE if the id of the xml node
+ *given in argument is the one of a_instr, FALSE otherwise.
+ */
+static gboolean
+id_matches_node (CRSelMatchContext * a_ctxt, CRNodeIface const * a_iface,
+                 CRXMLNodePtr a_node, CRSelInstr const * a_instr)
+{
+        struct CRNodeSnapshot *snapshot = NULL;
+        const gchar *id = NULL;
+        gchar *copy = NULL;
+        gboolean result = FALSE;
+
+        snapshot = get_node_snapshot (a_ctxt, a_iface, a_node);
+        if (snapshot)
+                return snapshot->id
+                        && snapshot->id_len == a_instr->len
+                        && !memcmp (snapshot->id, a_instr->str,
+                                    a_instr->len);
+
+        id = a_iface->get_id (a_node, &copy);
+        if (id && !strqcmp (id, a_instr->str, a_instr->len))
+                result = TRUE;
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
         }
         return result;
 }
 
 /**
- *Returns TRUE if the instance of #CRAdditional selector matches
- *the node given in parameter, FALSE otherwise.
- *@param a_add_sel the additional selector to evaluate.
+ *Returns TRUE if an attribute selector matches the
+ *node given in parameter, FALSE otherwise.
+ *@param a_ctxt the match context of the selection, or NULL.
+ *@param a_iface the interface to read the node with.
+ *@param a_attr_sel the attribute selector to evaluate. Its
+ *name, and its value unless its match way is SET, are set, as
+ *checked by cr_sel_prog_new().
  *@param a_node the xml node against whitch the selector is to
  *be evaluated
- *return TRUE if the additional selector matches the current xml node
+ *return TRUE if the attribute selector matches the xml node,
  *FALSE otherwise.
  */
 static gboolean
-attr_add_sel_matches_node (CRAdditionalSel * a_add_sel, xmlNode * a_node)
+attr_sel_matches_node (CRSelMatchContext * a_ctxt,
+                       CRNodeIface const * a_iface,
+                       CRAttrSel * a_attr_sel, CRXMLNodePtr a_node)
 {
-        CRAttrSel *cur_sel = NULL;
+        struct CRNodeSnapshot *snapshot = NULL;
+        const gchar *value = NULL,
+                *ptr1 = NULL,
+                *ptr2 = NULL,
+                *cur = NULL;
+        gchar *copy = NULL;
+        gboolean found = FALSE,
+                is_set = FALSE;
+
+        snapshot = get_node_snapshot (a_ctxt, a_iface, a_node);
+        if (snapshot)
+                value = node_snapshot_get_attr
+                        (snapshot, a_attr_sel->name->stryng->str, &is_set);
+        else
+                value = a_iface->get_attribute
+                        (a_node, a_attr_sel->name->stryng->str,
+                         &is_set, &copy);
+        if (!is_set)
+                return FALSE;
 
-        g_return_val_if_fail (a_add_sel
-                              && a_add_sel->type == ATTRIBUTE_ADD_SELECTOR
-                              && a_node, FALSE);
+        switch (a_attr_sel->match_way) {
+        case SET:
+                found = TRUE;
+                break;
 
-        for (cur_sel = a_add_sel->content.attr_sel;
-             cur_sel; cur_sel = cur_sel->next) {
-                switch (cur_sel->match_way) {
-                case SET:
-                        if (!cur_sel->name 
-                            || !cur_sel->name->stryng
-                            || !cur_sel->name->stryng->str)
-                                return FALSE;
+        case EQUALS:
+                found = !value
+                        || !strcmp (value, a_attr_sel->value->stryng->str);
+                break;
 
-                        if (!xmlHasProp (a_node,
-                                         (const xmlChar *) cur_sel->name->stryng->str))
-                                return FALSE;
+        case INCLUDES:
+                if (!value)
                         break;
 
-                case EQUALS:
-                        {
-                                xmlChar *value = NULL;
+                /*
+                 *here, make sure value is a space
+                 *separated list of "words", where one
+                 *value is exactly a_attr_sel->value->str
+                 */
+                for (cur = value; *cur; cur++) {
+                        /*
+                         *set ptr1 to the first non white space
+                         *char addr.
+                         */
+                        while (cr_utils_is_white_space (*cur) == TRUE && *cur)
+                                cur++;
+                        if (!*cur)
+                                break;
+                        ptr1 = cur;
 
-                                if (!cur_sel->name 
-                                    || !cur_sel->name->stryng
-                                    || !cur_sel->name->stryng->str
-                                    || !cur_sel->value
-                                    || !cur_sel->value->stryng
-                                    || !cur_sel->value->stryng->str)
-                                        return FALSE;
+                        /*
+                         *set ptr2 to the end the word.
+                         */
+                        while (cr_utils_is_white_space (*cur) == FALSE && *cur)
+                                cur++;
+                        cur--;
+                        ptr2 = cur;
+
+                        if (!strncmp (ptr1,
+                                      a_attr_sel->value->stryng->str,
+                                      ptr2 - ptr1 + 1)) {
+                                found = TRUE;
+                                break;
+                        }
+                        ptr1 = ptr2 = NULL;
+                }
+                break;
 
-                                if (!xmlHasProp 
-                                    (a_node, 
-                                     (const xmlChar *) cur_sel->name->stryng->str))
-                                        return FALSE;
+        case DASHMATCH:
+                if (!value)
+                        break;
 
-                                value = xmlGetProp 
-                                        (a_node,
-                                         (const xmlChar *) cur_sel->name->stryng->str);
+                /*
+                 *here, make sure value is an hyphen
+                 *separated list of "words", each of which
+                 *starting with "a_attr_sel->value->str"
+                 */
+                for (cur = value; *cur; cur++) {
+                        if (*cur == '-')
+                                cur++;
+                        ptr1 = cur;
 
-                                if (value
-                                    && strcmp 
-                                    ((const char *) value, 
-                                     cur_sel->value->stryng->str)) {
-                                        xmlFree (value);
-                                        return FALSE;
-                                }
-                                xmlFree (value);
+                        while (*cur != '-' && *cur)
+                                cur++;
+                        cur--;
+                        ptr2 = cur;
+
+                        if (g_strstr_len (ptr1, ptr2 - ptr1 + 1,
+                                          a_attr_sel->value->stryng->str)
+                            == ptr1) {
+                                found = TRUE;
+                                break;
                         }
-                        break;
+                }
+                break;
 
-                case INCLUDES:
-                        {
-                                xmlChar *value = NULL,
-                                        *ptr1 = NULL,
-                                        *ptr2 = NULL,
-                                        *cur = NULL;
-                                gboolean found = FALSE;
-
-                                if (!xmlHasProp 
-                                    (a_node, 
-                                     (const xmlChar *) cur_sel->name->stryng->str))
-                                        return FALSE;
-                                value = xmlGetProp 
-                                        (a_node,
-                                         (const xmlChar *) cur_sel->name->stryng->str);
+        default:
+                break;
+        }
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
+        return found;
+}
 
-                                if (!value)
-                                        return FALSE;
+/**
+ *Runs the instructions of a selector program that test a node
+ *itself, those of one compound selector, up to the next combinator.
+ *@param a_this the selection engine.
+ *@param a_ctxt the match context of the selection, or NULL.
+ *@param a_prog the first instruction to run.
+ *@param a_node the xml node, an element.
+ *@return the first instruction that was not run, a combinator
+ *or CR_SEL_OP_MATCH, if the node passed the tests, NULL otherwise.
+ */
+static CRSelInstr const *
+compound_matches_node (CRSelEng * a_this, CRSelMatchContext * a_ctxt,
+                       CRSelInstr const * a_prog, CRXMLNodePtr a_node)
+{
+        CRNodeIface const *iface = PRIVATE (a_this)->node_iface;
+        CRSelInstr const *pc = NULL;
+
+        for (pc = a_prog;; pc++) {
+                switch (pc->op) {
+                case CR_SEL_OP_MATCH:
+                case CR_SEL_OP_PARENT:
+                case CR_SEL_OP_PREV_SIBLING:
+                case CR_SEL_OP_ANCESTOR:
+                        return pc;
+
+                case CR_SEL_OP_ELEMENT:
+                        if (strcmp (pc->str, iface->get_local_name (a_node)))
+                                return NULL;
+                        break;
 
-                                /*
-                                 *here, make sure value is a space
-                                 *separated list of "words", where one
-                                 *value is exactly cur_sel->value->str
-                                 */
-                                for (cur = value; *cur; cur++) {
-                                        /*
-                                         *set ptr1 to the first non white space
-                                         *char addr.
-                                         */
-                                        while (cr_utils_is_white_space
-                                               (*cur) == TRUE && *cur)
-                                                cur++;
-                                        if (!*cur)
-                                                break;
-                                        ptr1 = cur;
-
-                                        /*
-                                         *set ptr2 to the end the word.
-                                         */
-                                        while (cr_utils_is_white_space
-                                               (*cur) == FALSE && *cur)
-                                                cur++;
-                                        cur--;
-                                        ptr2 = cur;
-
-                                        if (!strncmp
-                                            ((const char *) ptr1, 
-                                             cur_sel->value->stryng->str,
-                                             ptr2 - ptr1 + 1)) {
-                                                found = TRUE;
-                                                break;
-                                        }
-                                        ptr1 = ptr2 = NULL;
-                                }
-
-                                if (found == FALSE) {
-                                        xmlFree (value);
-                                        return FALSE;
-                                }
-                                xmlFree (value);
-                        }
+                case CR_SEL_OP_ID:
+                        if (id_matches_node (a_ctxt, iface, a_node, pc)
+                            == FALSE)
+                                return NULL;
                         break;
 
-                case DASHMATCH:
-                        {
-                                xmlChar *value = NULL,
-                                        *ptr1 = NULL,
-                                        *ptr2 = NULL,
-                                        *cur = NULL;
-                                gboolean found = FALSE;
-
-                                if (!xmlHasProp 
-                                    (a_node, 
-                                     (const xmlChar *) cur_sel->name->stryng->str))
-                                        return FALSE;
-                                value = xmlGetProp 
-                                        (a_node,
-                                         (const xmlChar *) cur_sel->name->stryng->str);
+                case CR_SEL_OP_CLASS:
+                        if (class_matches_node (a_ctxt, iface, a_node, pc)
+                            == FALSE)
+                                return NULL;
+                        break;
 
-                                /*
-                                 *here, make sure value is an hyphen
-                                 *separated list of "words", each of which
-                                 *starting with "cur_sel->value->str"
-                                 */
-                                for (cur = value; *cur; cur++) {
-                                        if (*cur == '-')
-                                                cur++;
-                                        ptr1 = cur;
-
-                                        while (*cur != '-' && *cur)
-                                                cur++;
-                                        cur--;
-                                        ptr2 = cur;
-
-                                        if (g_strstr_len
-                                            ((const gchar *) ptr1, ptr2 - ptr1 + 1,
-                                             cur_sel->value->stryng->str)
-                                            == (gchar *) ptr1) {
-                                                found = TRUE;
-                                                break;
-                                        }
-                                }
-
-                                if (found == FALSE) {
-                                        xmlFree (value);
-                                        return FALSE;
-                                }
-                                xmlFree (value);
-                        }
+                case CR_SEL_OP_ATTR:
+                        if (attr_sel_matches_node (a_ctxt, iface,
+                                                   pc->data, a_node)
+                            == FALSE)
+                                return NULL;
+                        break;
+
+                case CR_SEL_OP_PSEUDO_CLASS:
+                        if (pseudo_class_matches_node
+                            (a_this, pc->str, pc->len, pc->data, a_node)
+                            == FALSE)
+                                return NULL;
                         break;
+
+                case CR_SEL_OP_FAIL:
                 default:
-                        return FALSE;
+                        return NULL;
                 }
         }
-
-        return TRUE;
 }
 
 /**
- *Evaluates if a given additional selector matches an xml node.
- *@param a_add_sel the additional selector to consider.
- *@param a_node the xml node to consider.
- *@return TRUE is a_add_sel matches a_node, FALSE otherwise.
+ *Runs a selector program (see cr_sel_prog_new()) on an xml
+ *node, which says if the selector it is compiled from matches
+ *the node.
+ *A descendant combinator runs the rest of the program
+ *on each ancestor of the node until it matches, so that
+ *the program backtracks to the next ancestor when the simple
+ *selectors on the left of the combinator fail.
+ *
+ *@param a_this the selection engine.
+ *@param a_ctxt the match context of the selection, whose node
+ *snapshots the program reads. If NULL, the nodes are read
+ *directly.
+ *@param a_prog the instructions to run.
+ *@param a_node the xml node, an element.
+ *@return TRUE if the selector matches the node, FALSE otherwise.
  */
 static gboolean
-additional_selector_matches_node (CRSelEng * a_this,
-                                  CRAdditionalSel * a_add_sel,
-                                  xmlNode * a_node)
+sel_prog_matches_node (CRSelEng * a_this, CRSelMatchContext * a_ctxt,
+                       CRSelInstr const * a_prog, CRXMLNodePtr a_node)
 {
-        CRAdditionalSel *cur_add_sel = NULL, *tail = NULL ;
-        gboolean evaluated = FALSE ;
+        CRNodeIface const *iface = PRIVATE (a_this)->node_iface;
+        CRSelInstr const *pc = NULL;
+        CRXMLNodePtr node = a_node,
+                n = NULL;
+
+        for (pc = a_prog;; pc++) {
+                pc = compound_matches_node (a_this, a_ctxt, pc, node);
+                if (!pc)
+                        return FALSE;
 
-        for (tail = a_add_sel ; 
-             tail && tail->next; 
-             tail = tail->next) ;
+                switch (pc->op) {
+                case CR_SEL_OP_MATCH:
+                        return TRUE;
 
-        g_return_val_if_fail (tail, FALSE) ;
+                case CR_SEL_OP_PARENT:
+                        node = iface->get_parent_element (node);
+                        if (!node)
+                                return FALSE;
+                        break;
 
-        for (cur_add_sel = tail ;
-             cur_add_sel ;
-             cur_add_sel = cur_add_sel->prev) {
+                case CR_SEL_OP_PREV_SIBLING:
+                        node = iface->get_prev_sibling_element (node);
+                        if (!node)
+                                return FALSE;
+                        break;
 
-                evaluated = TRUE ;
-                if (cur_add_sel->type == NO_ADD_SELECTOR) {
+                case CR_SEL_OP_ANCESTOR:
+                        for (n = iface->get_parent_element (node); n;
+                             n = iface->get_parent_element (n)) {
+                                if (sel_prog_matches_node
+                                    (a_this, a_ctxt, pc + 1, n) == TRUE)
+                                        return TRUE;
+                        }
                         return FALSE;
-                }
 
-                if (cur_add_sel->type == CLASS_ADD_SELECTOR
-                    && cur_add_sel->content.class_name
-                    && cur_add_sel->content.class_name->stryng
-                    && cur_add_sel->content.class_name->stryng->str) {
-                        if (class_add_sel_matches_node (cur_add_sel,
-                                                        a_node) == FALSE) {
-                                return FALSE;
-                        }
-                        continue ;
-                } else if (cur_add_sel->type == ID_ADD_SELECTOR
-                           && cur_add_sel->content.id_name
-                           && cur_add_sel->content.id_name->stryng
-                           && cur_add_sel->content.id_name->stryng->str) {
-                        if (id_add_sel_matches_node (cur_add_sel, a_node) == FALSE) {
-                                return FALSE;
-                        }
-                        continue ;
-                } else if (cur_add_sel->type == ATTRIBUTE_ADD_SELECTOR
-                           && cur_add_sel->content.attr_sel) {
-                        /*
-                         *here, call a function that does the match
-                         *against an attribute additionnal selector
-                         *and an xml node.
-                         */
-                        if (attr_add_sel_matches_node (cur_add_sel, a_node)
-                            == FALSE) {
-                                return FALSE;
-                        }
-                        continue ;
-                } else if (cur_add_sel->type == PSEUDO_CLASS_ADD_SELECTOR
-                           && cur_add_sel->content.pseudo) {
-                        if (pseudo_class_add_sel_matches_node
-                            (a_this, cur_add_sel, a_node) == TRUE) {
-                                return TRUE;
-                        }
+                default:
                         return FALSE;
                 }
         }
-        if (evaluated == TRUE)
-                return TRUE;
-        return FALSE ;
-}
-
-static xmlNode *
-get_next_element_node (xmlNode * a_node)
-{
-        xmlNode *cur_node = NULL;
-
-        g_return_val_if_fail (a_node, NULL);
-
-        cur_node = a_node->next;
-        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
-                cur_node = cur_node->next;
-        }
-        return cur_node;
 }
 
-static xmlNode *
-get_next_child_element_node (xmlNode * a_node)
+static gboolean
+string_is_set (CRString const * a_str)
 {
-        xmlNode *cur_node = NULL;
-
-        g_return_val_if_fail (a_node, NULL);
-
-        cur_node = a_node->children;
-        if (!cur_node)
-                return cur_node;
-        if (a_node->children->type == XML_ELEMENT_NODE)
-                return a_node->children;
-        return get_next_element_node (a_node->children);
+        return a_str && a_str->stryng && a_str->stryng->str;
 }
 
-static xmlNode *
-get_prev_element_node (xmlNode * a_node)
+/**
+ *Checks one simple selector on a node, without compiling it.
+ *The checks are those cr_sel_prog_new() would compile, made in
+ *the same order: the additional selectors are checked from the
+ *last one backward, up to the first pseudo class, whose result
+ *is the result of the whole simple selector.
+ *@param a_this the selection engine.
+ *@param a_sel the simple selector.
+ *@param a_node the xml node, an element.
+ *@return TRUE if the simple selector matches the node,
+ *FALSE otherwise.
+ */
+static gboolean
+simple_sel_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
+                         CRXMLNodePtr a_node)
 {
-        xmlNode *cur_node = NULL;
-
-        g_return_val_if_fail (a_node, NULL);
-
-        cur_node = a_node->prev;
-        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
-                cur_node = cur_node->prev;
+        CRNodeIface const *iface = PRIVATE (a_this)->node_iface;
+        CRAdditionalSel *add_sel = NULL;
+        CRAttrSel *attr_sel = NULL;
+        CRPseudo *pseudo = NULL;
+        CRSelInstr instr;
+
+        if (!(a_sel->type_mask & UNIVERSAL_SELECTOR)) {
+                if (a_sel->type_mask & TYPE_SELECTOR) {
+                        if (!string_is_set (a_sel->name)
+                            || strcmp (a_sel->name->stryng->str,
+                                       iface->get_local_name (a_node)))
+                                return FALSE;
+                } else if (!a_sel->add_sel) {
+                        return FALSE;
+                }
         }
-        return cur_node;
-}
-
-static xmlNode *
-get_next_parent_element_node (xmlNode * a_node)
-{
-        xmlNode *cur_node = NULL;
-
-        g_return_val_if_fail (a_node, NULL);
+        if (!a_sel->add_sel)
+                return TRUE;
 
-        cur_node = a_node->parent;
-        while (cur_node && cur_node->type != XML_ELEMENT_NODE) {
-                cur_node = cur_node->parent;
+        memset (&instr, 0, sizeof (CRSelInstr));
+        for (add_sel = a_sel->add_sel; add_sel->next;
+             add_sel = add_sel->next) ;
+        for (; add_sel; add_sel = add_sel->prev) {
+                switch (add_sel->type) {
+                case NO_ADD_SELECTOR:
+                        return FALSE;
+                case CLASS_ADD_SELECTOR:
+                        if (!string_is_set (add_sel->content.class_name))
+                                break;
+                        /*
+                         *no snapshot is read without a match context,
+                         *so the hash of the class is not needed.
+                         */
+                        instr.str = add_sel->content.class_name->stryng->str;
+                        instr.len = add_sel->content.class_name->stryng->len;
+                        if (class_matches_node (NULL, iface, a_node, &instr)
+                            == FALSE)
+                                return FALSE;
+                        break;
+                case ID_ADD_SELECTOR:
+                        if (!string_is_set (add_sel->content.id_name))
+                                break;
+                        instr.str = add_sel->content.id_name->stryng->str;
+                        instr.len = add_sel->content.id_name->stryng->len;
+                        if (id_matches_node (NULL, iface, a_node, &instr)
+                            == FALSE)
+                                return FALSE;
+                        break;
+                case ATTRIBUTE_ADD_SELECTOR:
+                        for (attr_sel = add_sel->content.attr_sel;
+                             attr_sel; attr_sel = attr_sel->next) {
+                                if (!string_is_set (attr_sel->name)
+                                    || (attr_sel->match_way != SET
+                                        && !string_is_set
+                                        (attr_sel->value)))
+                                        return FALSE;
+                                if (attr_sel_matches_node
+                                    (NULL, iface, attr_sel, a_node)
+                                    == FALSE)
+                                        return FALSE;
+                        }
+                        break;
+                case PSEUDO_CLASS_ADD_SELECTOR:
+                        pseudo = add_sel->content.pseudo;
+                        if (!pseudo)
+                                break;
+                        if (!string_is_set (pseudo->name))
+                                return FALSE;
+                        return pseudo_class_matches_node
+                                (a_this,
+                                 cr_atom_from_string
+                                 (pseudo->name->stryng->str),
+                                 pseudo->type, add_sel, a_node);
+                default:
+                        break;
+                }
         }
-        return cur_node;
+        return TRUE;
 }
 
 /**
- *Evaluate a selector (a simple selectors list) and says
- *if it matches the xml node given in parameter.
- *The algorithm used here is the following:
- *Walk the combinator separated list of simple selectors backward, starting
- *from the end of the list. For each simple selector, looks if
- *if matches the current node.
- *
+ *Walks a list of simple selectors backward from a_sel and says
+ *if they match a_node and the nodes their combinators lead to.
+ *This is sel_prog_matches_node() for a selector that is not
+ *compiled: a descendant combinator backtracks the same way.
  *@param a_this the selection engine.
- *@param a_sel the simple selection list.
- *@param a_node the xml node.
- *@param a_result out parameter. Set to true if the
- *selector matches the xml node, FALSE otherwise.
- *@param a_recurse if set to TRUE, the function will walk to
- *the next simple selector (after the evaluation of the current one) 
- *and recursively evaluate it. Must be usually set to TRUE unless you
- *know what you are doing.
+ *@param a_sel the simple selector a_node is checked against,
+ *the last of the list the first time.
+ *@param a_node the xml node, an element.
+ *@return TRUE if the selector matches the node, FALSE otherwise.
  */
-static enum CRStatus
-sel_matches_node_real (CRSelEng * a_this, CRSimpleSel * a_sel,
-                       xmlNode * a_node, gboolean * a_result,
-                       gboolean a_eval_sel_list_from_end,
-                       gboolean a_recurse)
+static gboolean
+simple_sels_match_node (CRSelEng * a_this, CRSimpleSel * a_sel,
+                        CRXMLNodePtr a_node)
 {
-        CRSimpleSel *cur_sel = NULL;
-        xmlNode *cur_node = NULL;
+        CRNodeIface const *iface = PRIVATE (a_this)->node_iface;
+        CRSimpleSel *cur = NULL;
+        CRXMLNodePtr node = a_node,
+                n = NULL;
 
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_this && a_node
-                              && a_result, CR_BAD_PARAM_ERROR);
+        for (cur = a_sel; cur; cur = cur->prev) {
+                if (simple_sel_matches_node (a_this, cur, node) == FALSE)
+                        return FALSE;
+                if (!cur->prev)
+                        return TRUE;
 
-        *a_result = FALSE;
+                switch (cur->combinator) {
+                case NO_COMBINATOR:
+                        break;
 
-        if (a_node->type != XML_ELEMENT_NODE)
-                return CR_OK;
+                case COMB_WS:
+                        for (n = iface->get_parent_element (node); n;
+                             n = iface->get_parent_element (n)) {
+                                if (simple_sels_match_node
+                                    (a_this, cur->prev, n) == TRUE)
+                                        return TRUE;
+                        }
+                        return FALSE;
 
-        if (a_eval_sel_list_from_end == TRUE) {
-                /*go and get the last simple selector of the list */
-                for (cur_sel = a_sel;
-                     cur_sel && cur_sel->next; cur_sel = cur_sel->next) ;
-        } else {
-                cur_sel = a_sel;
-        }
+                case COMB_PLUS:
+                        node = iface->get_prev_sibling_element (node);
+                        if (!node)
+                                return FALSE;
+                        break;
 
-        for (cur_node = a_node; cur_sel; cur_sel = cur_sel->prev) {
-                if (((cur_sel->type_mask & TYPE_SELECTOR)
-                     && (cur_sel->name 
-                         && cur_sel->name->stryng
-                         && cur_sel->name->stryng->str)
-                     && (!strcmp (cur_sel->name->stryng->str,
-                                  (const char *) cur_node->name)))
-                    || (cur_sel->type_mask & UNIVERSAL_SELECTOR)) {
-                        /*
-                         *this simple selector
-                         *matches the current xml node
-                         *Let's see if the preceding
-                         *simple selectors also match
-                         *their xml node counterpart.
-                         */
-                        if (cur_sel->add_sel) {
-                                if (additional_selector_matches_node (a_this, cur_sel->add_sel, 
-                                                                      cur_node) == TRUE) {
-                                        goto walk_a_step_in_expr;
-                                } else {
-                                        goto done;
-                                }
-                        } else {
-                                goto walk_a_step_in_expr;
-                        }                                
-                } 
-                if (!(cur_sel->type_mask & TYPE_SELECTOR)
-                    && !(cur_sel->type_mask & UNIVERSAL_SELECTOR)) {
-                        if (!cur_sel->add_sel) {
-                                goto done;
-                        }
-                        if (additional_selector_matches_node
-                            (a_this, cur_sel->add_sel, cur_node)
-                            == TRUE) {
-                                goto walk_a_step_in_expr;
-                        } else {
-                                goto done;
-                        }
-                } else {
-                        goto done ;
-                }
+                case COMB_GT:
+                        node = iface->get_parent_element (node);
+                        if (!node)
+                                return FALSE;
+                        break;
 
-        walk_a_step_in_expr:
-                if (a_recurse == FALSE) {
-                        *a_result = TRUE;
-                        goto done;
+                default:
+                        return FALSE;
                 }
+        }
+        return TRUE;
+}
 
-                /*
-                 *here, depending on the combinator of cur_sel
-                 *choose the axis of the xml tree traversal
-                 *and walk one step in the xml tree.
-                 */
-                if (!cur_sel->prev)
-                        break;
+static void
+ancestor_filter_add (CRSelMatchContext * a_ctxt, guint32 a_hash)
+{
+        guchar *counter = NULL;
+
+        g_array_append_val (a_ctxt->ancestor_hashes, a_hash);
+        /*a saturated counter is never decremented again*/
+        counter = &a_ctxt->ancestor_filter
+                [a_hash & ANCESTOR_FILTER_MASK];
+        if (*counter < G_MAXUINT8)
+                (*counter)++;
+        counter = &a_ctxt->ancestor_filter
+                [(a_hash >> ANCESTOR_FILTER_BITS) & ANCESTOR_FILTER_MASK];
+        if (*counter < G_MAXUINT8)
+                (*counter)++;
+}
 
-                switch (cur_sel->combinator) {
-                case NO_COMBINATOR:
-                        break;
+static void
+ancestor_filter_remove (CRSelMatchContext * a_ctxt, guint32 a_hash)
+{
+        guchar *counter = NULL;
+
+        counter = &a_ctxt->ancestor_filter
+                [a_hash & ANCESTOR_FILTER_MASK];
+        if (*counter && *counter < G_MAXUINT8)
+                (*counter)--;
+        counter = &a_ctxt->ancestor_filter
+                [(a_hash >> ANCESTOR_FILTER_BITS) & ANCESTOR_FILTER_MASK];
+        if (*counter && *counter < G_MAXUINT8)
+                (*counter)--;
+}
 
-                case COMB_WS:  /*descendant selector */
-                {
-                        xmlNode *n = NULL;
-                        enum CRStatus status = CR_OK;
-                        gboolean matches = FALSE;
+static gboolean
+ancestor_filter_may_contain (CRSelMatchContext * a_ctxt, guint32 a_hash)
+{
+        return a_ctxt->ancestor_filter
+                [a_hash & ANCESTOR_FILTER_MASK]
+                && a_ctxt->ancestor_filter
+                [(a_hash >> ANCESTOR_FILTER_BITS) & ANCESTOR_FILTER_MASK];
+}
 
-                        /*
-                         *walk the xml tree upward looking for a parent
-                         *node that matches the preceding selector.
-                         */
-                        for (n = cur_node->parent; n; n = n->parent) {
-                                status = sel_matches_node_real
-                                        (a_this, cur_sel->prev,
-                                         n, &matches, FALSE, TRUE);
-
-                                if (status != CR_OK)
-                                        goto done;
-
-                                if (matches == TRUE) {
-                                        cur_node = n ;
-                                        break;
-                                }
-                        }
+/**
+ *Adds the name, the id and the classes of a_node
+ *to the ancestor filter.
+ */
+static void
+ancestor_filter_add_node (CRSelMatchContext * a_ctxt,
+                          CRNodeIface const * a_iface, CRXMLNodePtr a_node)
+{
+        const gchar *name = NULL,
+                *id = NULL,
+                *klass = NULL,
+                *cur = NULL,
+                *end = NULL;
+        gchar *copy = NULL;
+
+        name = a_iface->get_local_name (a_node);
+        ancestor_filter_add
+                (a_ctxt, cr_rule_index_hash_key
+                 (CR_RULE_INDEX_KEY_ELEMENT, name, strlen (name)));
+
+        id = a_iface->get_id (a_node, &copy);
+        if (id) {
+                ancestor_filter_add
+                        (a_ctxt, cr_rule_index_hash_key
+                         (CR_RULE_INDEX_KEY_ID, id, strlen (id)));
+        }
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
 
-                        if (!n) {
-                                /*
-                                 *didn't find any ancestor that matches
-                                 *the previous simple selector.
-                                 */
-                                goto done;
-                        }
-                        /*
-                         *in this case, the preceding simple sel
-                         *will have been interpreted twice, which
-                         *is a cpu and mem waste ... I need to find
-                         *another way to do this. Anyway, this is
-                         *my first attempt to write this function and
-                         *I am a bit clueless.
-                         */
+        klass = a_iface->get_classes (a_node, &copy);
+        for (cur = klass; cur && *cur; cur = end) {
+                while (*cur && cr_utils_is_white_space (*cur) == TRUE)
+                        cur++;
+                if (!*cur)
                         break;
-                }
+                for (end = cur;
+                     *end && cr_utils_is_white_space (*end) == FALSE;
+                     end++) ;
+                ancestor_filter_add
+                        (a_ctxt, cr_rule_index_hash_key
+                         (CR_RULE_INDEX_KEY_CLASS, cur, end - cur));
+        }
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
+}
 
-                case COMB_PLUS:
-                        cur_node = get_prev_element_node (cur_node);
-                        if (!cur_node)
-                                goto done;
-                        break;
+/**
+ *Says if the ancestor filter holds the ancestors of a_node,
+ *that is, if the last element pushed is the parent of a_node.
+ */
+static gboolean
+ancestor_filter_is_usable (CRSelMatchContext * a_ctxt,
+                          CRNodeIface const * a_iface, CRXMLNodePtr a_node)
+{
+        GArray *ancestors = a_ctxt->ancestors;
 
-                case COMB_GT:
-                        cur_node = get_next_parent_element_node (cur_node);
-                        if (!cur_node)
-                                goto done;
-                        break;
+        if (!ancestors || !ancestors->len)
+                return FALSE;
+        return g_array_index (ancestors, struct CRAncestorEntry,
+                              ancestors->len - 1).node
+                == a_iface->get_parent_element (a_node);
+}
 
-                default:
-                        goto done;
-                }
-                continue;
+/**
+ *Says if the ancestor filter proves that one of the
+ *ancestors a_entry requires is missing, in which case
+ *the selector of the entry can't match.
+ */
+static gboolean
+ancestor_filter_rejects (CRSelMatchContext * a_ctxt,
+                         CRRuleIndexEntry * a_entry)
+{
+        guint i = 0;
+
+        for (i = 0; i < a_entry->nr_ancestor_hashes; i++) {
+                if (ancestor_filter_may_contain
+                    (a_ctxt, a_entry->ancestor_hashes[i]) == FALSE)
+                        return TRUE;
+        }
+        return FALSE;
+}
+
+static void
+add_candidate_rules (GPtrArray * a_candidates,
+                     CRRuleIndexEntry ** a_entries, guint a_len)
+{
+        guint i = 0;
+
+        for (i = 0; i < a_len; i++)
+                g_ptr_array_add (a_candidates, a_entries[i]);
+}
+
+static gint
+compare_rule_index_entries (gconstpointer a_a, gconstpointer a_b)
+{
+        CRRuleIndexEntry const *a = *(CRRuleIndexEntry * const *) a_a,
+                *b = *(CRRuleIndexEntry * const *) a_b;
+
+        if (a->order < b->order)
+                return -1;
+        return a->order > b->order;
+}
+
+/**
+ *Fills a_candidates with the entries of the rule index
+ *that may match a node, that is, the ones keyed by the id,
+ *the classes or the name of the node, plus the universal ones.
+ *The entries are sorted back in stylesheet order, so that
+ *the rulesets are reported in the same order as the ones
+ *of a full walk of the stylesheet.
+ *@param a_index the rule index of the stylesheet.
+ *@param a_snapshot the snapshot of the xml node to consider.
+ *@param a_candidates the array to fill. Its previous content
+ *is dropped.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+collect_candidate_rules (CRRuleIndex * a_index,
+                         struct CRNodeSnapshot *a_snapshot,
+                         GPtrArray * a_candidates)
+{
+        CRRuleIndexEntry **entries = NULL;
+        CRXMLNodePtr node = NULL;
+        guint len = 0,
+                i = 0,
+                j = 0;
+
+        g_return_val_if_fail (a_index && a_snapshot && a_candidates,
+                              CR_BAD_PARAM_ERROR);
+
+        node = a_snapshot->node;
+        g_ptr_array_set_size (a_candidates, 0);
+        if (!a_snapshot->iface->is_element (node))
+                return CR_OK;
+
+        entries = cr_rule_index_get_universal (a_index, &len);
+        add_candidate_rules (a_candidates, entries, len);
+
+        entries = cr_rule_index_get_by_element
+                (a_index, a_snapshot->iface->get_local_name (node), &len);
+        add_candidate_rules (a_candidates, entries, len);
+
+        if (a_snapshot->id) {
+                entries = cr_rule_index_get_by_id
+                        (a_index, a_snapshot->id, &len);
+                add_candidate_rules (a_candidates, entries, len);
+        }
+
+        for (i = 0; i < a_snapshot->classes->len; i++) {
+                entries = cr_rule_index_get_by_class
+                        (a_index, g_array_index (a_snapshot->classes,
+                                                 struct CRNodeClass,
+                                                 i).name, &len);
+                add_candidate_rules (a_candidates, entries, len);
         }
 
         /*
-         *if we reached this point, it means the selector matches
-         *the xml node.
+         *put the candidates back in stylesheet order. A bucket
+         *may have been added twice if the node has the same class
+         *more than once, so drop duplicates as well.
          */
-        *a_result = TRUE;
-
- done:
+        if (a_candidates->len > 1) {
+                g_ptr_array_sort (a_candidates, compare_rule_index_entries);
+                for (i = 1, j = 1; i < a_candidates->len; i++) {
+                        if (g_ptr_array_index (a_candidates, i)
+                            == g_ptr_array_index (a_candidates, j - 1))
+                                continue;
+                        g_ptr_array_index (a_candidates, j++) =
+                                g_ptr_array_index (a_candidates, i);
+                }
+                g_ptr_array_set_size (a_candidates, j);
+        }
         return CR_OK;
 }
 
-
 /**
  *Returns  array of the ruleset statements that matches the
  *given xml node.
- *The engine keeps in memory the last statement he
+ *Only the selectors the rule index of the stylesheet
+ *reports as candidates for the node are evaluated.
+ *The match context keeps in memory the last selector
  *visited during the match. So, the next call
  *to this function will eventually return a rulesets list starting
  *from the last ruleset statement visited during the previous call.
  *The enable users to get matching rulesets in an incremental way.
- *Note that for each statement returned, 
- *the engine calculates the specificity of the selector
- *that matched the xml node and stores it in the "specifity" field
- *of the statement structure.
+ *Note that each statement is returned once, and that the index
+ *entry of the most specific of its selectors that matched the
+ *xml node is recorded in the matched_entries table of the match
+ *context. Nothing but the context is modified.
  *
  *@param a_sel_eng the current selection engine
+ *@param a_ctxt the match context.
  *@param a_node the xml node for which the request
  *is being made.
  *@param a_sel_list the list of selectors to perform the search in.
@@ -817,19 +1293,22 @@ sel_matches_node_real (CRSelEng * a_this, CRSimpleSel * a_sel,
  */
 static enum CRStatus
 cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
+                                      CRSelMatchContext * a_ctxt,
                                       CRStyleSheet * a_stylesheet,
-                                      xmlNode * a_node,
+                                      CRXMLNodePtr a_node,
                                       CRStatement ** a_rulesets,
                                       gulong * a_len)
 {
-        CRStatement *cur_stmt = NULL;
-        CRSelector *sel_list = NULL,
-                *cur_sel = NULL;
-        gboolean matches = FALSE;
+        CRRuleIndex *index = NULL;
+        CRRuleIndexEntry *entry = NULL;
+        struct CRNodeSnapshot *snapshot = NULL;
+        GPtrArray *candidates = NULL;
+        gboolean matches = FALSE,
+                use_ancestor_filter = FALSE;
         enum CRStatus status = CR_OK;
         gulong i = 0;
 
-        g_return_val_if_fail (a_this
+        g_return_val_if_fail (a_this && a_ctxt
                               && a_stylesheet
                               && a_node && a_rulesets, CR_BAD_PARAM_ERROR);
 
@@ -840,272 +1319,963 @@ cr_sel_eng_get_matched_rulesets_real (CRSelEng * a_this,
         }
 
         /*
-         *if this stylesheet is "new one"
-         *let's remember it for subsequent calls.
+         *if this stylesheet/node pair is a "new one"
+         *let's look up the selectors that may match the node,
+         *and remember them for subsequent calls.
          */
-        if (PRIVATE (a_this)->sheet != a_stylesheet) {
-                PRIVATE (a_this)->sheet = a_stylesheet;
-                PRIVATE (a_this)->cur_stmt = a_stylesheet->statements;
+        if (a_ctxt->sheet != a_stylesheet || a_ctxt->node != a_node) {
+                index = cr_stylesheet_get_rule_index_for_medium
+                        (a_stylesheet, PRIVATE (a_this)->medium);
+                if (!index) {
+                        cr_utils_trace_info ("Could not index stylesheet");
+                        return CR_ERROR;
+                }
+                snapshot = get_node_snapshot
+                        (a_ctxt, PRIVATE (a_this)->node_iface, a_node);
+                if (!snapshot) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_ERROR;
+                }
+                status = collect_candidate_rules
+                        (index, snapshot, a_ctxt->candidates);
+                if (status != CR_OK)
+                        return status;
+                for (i = 0; i < a_ctxt->candidates->len; i++) {
+                        entry = g_ptr_array_index (a_ctxt->candidates, i);
+                        if (!entry->only_tests_names)
+                                a_ctxt->only_tests_names = FALSE;
+                }
+                a_ctxt->sheet = a_stylesheet;
+                a_ctxt->node = a_node;
+                a_ctxt->cur_candidate = 0;
+        }
+        candidates = a_ctxt->candidates;
+        use_ancestor_filter = ancestor_filter_is_usable
+                (a_ctxt, PRIVATE (a_this)->node_iface, a_node);
+
+        /*
+         *walk through the candidate selectors, in the order
+         *they appear in the stylesheet, and try to match
+         *our xml node against them.
+         */
+        for (i = 0;
+             a_ctxt->cur_candidate < candidates->len;
+             a_ctxt->cur_candidate++) {
+                entry = g_ptr_array_index (candidates,
+                                           a_ctxt->cur_candidate);
+                if (use_ancestor_filter == TRUE
+                    && ancestor_filter_rejects (a_ctxt, entry) == TRUE)
+                        continue;
+
+                if (entry->prog) {
+                        matches = sel_prog_matches_node
+                                (a_this, a_ctxt, entry->prog, a_node);
+                        status = CR_OK;
+                } else {
+                        status = cr_sel_eng_matches_node
+                                (a_this, entry->sel->simple_sel,
+                                 a_node, &matches);
+                }
+
+                if (status == CR_OK && matches == TRUE) {
+                        CRRuleIndexEntry *matched = NULL;
+
+                        /*
+                         *if another selector of the statement matched
+                         *the node already, the statement is in the
+                         *out array already. Only the most specific
+                         *of the selectors counts for the cascade.
+                         */
+                        matched = g_hash_table_lookup
+                                (a_ctxt->matched_entries, entry->stmt);
+                        if (matched) {
+                                if (entry->specificity
+                                    >= matched->specificity)
+                                        g_hash_table_insert
+                                                (a_ctxt->matched_entries,
+                                                 entry->stmt, entry);
+                                continue;
+                        }
+
+                        /*
+                         *bingo!!! we found one ruleset that
+                         *matches that fucking node.
+                         *lets put it in the out array.
+                         */
+
+                        if (i < *a_len) {
+                                a_rulesets[i] = entry->stmt;
+                                i++;
+
+                                /*
+                                 *For the cascade computing algorithm
+                                 *(which is gonna take place later)
+                                 *we must remember the specificity
+                                 *(css2 spec chap 6.4.1) and the source
+                                 *order of the selector that matched the
+                                 *current xml node. The index entry
+                                 *holds both.
+                                 */
+                                g_hash_table_insert
+                                        (a_ctxt->matched_entries,
+                                         entry->stmt, entry);
+                        } else {
+                                *a_len = i;
+                                return CR_OUTPUT_TOO_SHORT_ERROR;
+                        }
+                }
         }
 
         /*
-         *walk through the list of statements and,
-         *get the selectors list inside the statements that
-         *contain some, and try to match our xml node in these
-         *selectors lists.
+         *if we reached this point, it means
+         *we reached the end of the candidates.
+         *no need to store any info about the stylesheet
+         *anymore.
          */
-        for (cur_stmt = PRIVATE (a_this)->cur_stmt, i = 0;
-             (PRIVATE (a_this)->cur_stmt = cur_stmt);
-             cur_stmt = cur_stmt->next) {
+        a_ctxt->sheet = NULL;
+        a_ctxt->node = NULL;
+        *a_len = i;
+        return CR_OK;
+}
+
+/**
+ *@return the specificity of the most specific selector that
+ *matched the node a ruleset has been found for, as recorded by
+ *cr_sel_eng_get_matched_rulesets_real().
+ */
+static gulong
+get_matched_specificity (GHashTable * a_matched_entries,
+                         CRStatement * a_stmt)
+{
+        CRRuleIndexEntry *entry = NULL;
+
+        entry = g_hash_table_lookup (a_matched_entries, a_stmt);
+        return entry ? entry->specificity : 0;
+}
+
+/*
+ *A ruleset matched by the node, seen from one level of the cascade:
+ *either its normal declarations or its !important ones.
+ */
+struct CRCascadeItem {
+        CRStatement *stmt;
+        gboolean important;
+        guint level;
+        gulong specificity;
+        gulong order;
+};
+
+/**
+ *Computes the rank of the declarations of a given origin and
+ *importance in the cascade, as defined in chapter 6.4.1 of the
+ *css2 spec: the user agent declarations, then the user normal
+ *declarations, the author normal declarations, the author
+ *!important declarations and the user !important declarations.
+ *The !important declarations of the user agent come right after
+ *its normal ones.
+ *@return the level of the declarations. The higher level wins.
+ */
+static guint
+get_cascade_level (enum CRStyleOrigin a_origin, gboolean a_important)
+{
+        switch (a_origin) {
+        case ORIGIN_UA:
+                return a_important == TRUE ? 1 : 0;
+        case ORIGIN_USER:
+                return a_important == TRUE ? 5 : 2;
+        case ORIGIN_AUTHOR:
+        default:
+                return a_important == TRUE ? 4 : 3;
+        }
+}
+
+static gint
+compare_cascade_items (gconstpointer a_item1, gconstpointer a_item2)
+{
+        struct CRCascadeItem const *item1 = a_item1,
+                *item2 = a_item2;
+
+        if (item1->level != item2->level)
+                return item1->level < item2->level ? -1 : 1;
+        if (item1->specificity != item2->specificity)
+                return item1->specificity < item2->specificity ? -1 : 1;
+        if (item1->order != item2->order)
+                return item1->order < item2->order ? -1 : 1;
+        return 0;
+}
+
+static void
+add_cascade_item (CRSelMatchContext * a_ctxt, CRRuleIndexEntry * a_entry,
+                  enum CRStyleOrigin a_origin, gboolean a_important)
+{
+        struct CRCascadeItem item;
+
+        item.stmt = a_entry->stmt;
+        item.important = a_important;
+        item.level = get_cascade_level (a_origin, a_important);
+        item.specificity = a_entry->specificity;
+        item.order = a_entry->order;
+        g_array_append_val (a_ctxt->cascade_items, item);
+}
+
+/**
+ *Adds the rulesets found for a node in the stylesheet of
+ *an origin of the cascade to the ones cascade_properties()
+ *sorts out.
+ *@param a_ctxt the match context the rulesets have been found in.
+ *Its matched_entries table must be the one of the stylesheet.
+ *@param a_stmts the statements found for the node.
+ *@param a_nr_stmts the number of statements of @a_stmts.
+ *@param a_origin the origin of the stylesheet. The rulesets
+ *of the stylesheets it imports have the same.
+ */
+static void
+add_cascade_items (CRSelMatchContext * a_ctxt, CRStatement ** a_stmts,
+                   gulong a_nr_stmts, enum CRStyleOrigin a_origin)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_nr_stmts; i++) {
+                CRRuleIndexEntry *entry = NULL;
+
+                if (!a_stmts[i]
+                    || a_stmts[i]->type != RULESET_STMT
+                    || !a_stmts[i]->kind.ruleset)
+                        continue;
+                entry = g_hash_table_lookup (a_ctxt->matched_entries,
+                                             a_stmts[i]);
+                if (!entry)
+                        continue;
+                if (entry->has_normal_decls == TRUE)
+                        add_cascade_item (a_ctxt, entry, a_origin, FALSE);
+                if (entry->has_important_decls == TRUE)
+                        add_cascade_item (a_ctxt, entry, a_origin, TRUE);
+        }
+}
+
+/**
+ *Appends to a list the declarations of a set of matched rulesets
+ *that win the cascade, as defined in chapter 6.4.1 of the css2 spec.
+ *The rulesets, added by add_cascade_items(), are sorted once by
+ *level, specificity and source order, then walked from the one
+ *that takes precedence down: the first declaration found for a
+ *property is the one that applies, and the ones found afterwards
+ *are not even looked at.
+ *@param a_ctxt the match context the rulesets have been found in.
+ *@param a_props in/out parameter. The list to append the winning
+ *declarations to, in ascending order of precedence.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+cascade_properties (CRSelMatchContext * a_ctxt, CRPropList ** a_props)
+{
+        CRPropList *props = NULL;
+        guint j = 0;
+
+        g_return_val_if_fail (a_ctxt && a_props, CR_BAD_PARAM_ERROR);
+
+        if (!a_ctxt->cascade_items->len)
+                return CR_OK;
+        g_array_sort (a_ctxt->cascade_items, compare_cascade_items);
+
+        g_hash_table_remove_all (a_ctxt->cascaded_props);
+        g_ptr_array_set_size (a_ctxt->winners, 0);
+        for (j = a_ctxt->cascade_items->len; j > 0; j--) {
+                struct CRCascadeItem *item = NULL;
+                CRDeclaration *cur_decl = NULL;
+
+                item = &g_array_index (a_ctxt->cascade_items,
+                                       struct CRCascadeItem, j - 1);
+                cur_decl = item->stmt->kind.ruleset->decl_list;
+                if (!cur_decl)
+                        continue;
                 /*
-                 *initialyze the selector list in which we will
-                 *really perform the search.
+                 *within a ruleset, the later declaration wins:
+                 *walk them backward.
                  */
-                sel_list = NULL;
+                while (cur_decl->next)
+                        cur_decl = cur_decl->next;
+                for (; cur_decl; cur_decl = cur_decl->prev) {
+                        const gchar *name = NULL;
+
+                        if (cur_decl->important != item->important
+                            || !cur_decl->property
+                            || !cur_decl->property->stryng
+                            || !cur_decl->property->stryng->str)
+                                continue;
+                        name = cur_decl->property->stryng->str;
+                        if (g_hash_table_lookup (a_ctxt->cascaded_props,
+                                                 name))
+                                continue;
+                        g_hash_table_insert (a_ctxt->cascaded_props,
+                                             (gpointer) name, cur_decl);
+                        g_ptr_array_add (a_ctxt->winners, cur_decl);
+                }
+        }
 
+        props = *a_props;
+        for (j = a_ctxt->winners->len; j > 0; j--) {
+                CRDeclaration *decl = g_ptr_array_index
+                        (a_ctxt->winners, j - 1);
+                CRPropList *tmp_props = NULL;
+
+                tmp_props = cr_prop_list_append2
+                        (props, decl->property, decl);
+                if (!tmp_props) {
+                        cr_utils_trace_info ("Out of memory");
+                        *a_props = props;
+                        return CR_ERROR;
+                }
+                props = tmp_props;
+        }
+        *a_props = props;
+        return CR_OK;
+}
+
+static void
+set_style_from_props (CRStyle * a_style, CRPropList * a_props)
+{
+        CRPropList *cur = NULL;
+        CRDeclaration *decl = NULL;
+
+        for (cur = a_props; cur; cur = cr_prop_list_get_next (cur)) {
+                cr_prop_list_get_decl (cur, &decl);
+                cr_style_set_style_from_decl (a_style, decl);
+                decl = NULL;
+        }
+}
+
+/*
+ *The number of subtrees a worker of cr_sel_eng_style_document()
+ *keeps queued for the others to steal. Beyond that, it styles
+ *the children of an element itself, depth first.
+ */
+#define STYLING_QUEUE_LENGTH 4
+
+/*
+ *The number of elements a worker of cr_sel_eng_style_document()
+ *remembers for the next ones to share their styles, see
+ *find_shared_style().
+ */
+#define STYLE_SHARING_CACHE_SIZE 8
+
+/**
+ *A subtree to style: an element, and the
+ *style its inherited properties come from.
+ */
+struct _StylingTask {
+        CRXMLNodePtr node;
+        CRStyle *parent_style;
+};
+
+/**
+ *A thread of cr_sel_eng_style_document(). It takes its
+ *subtrees from the tail of its queue, the idle workers
+ *steal them from its head.
+ */
+struct _StylingWorker {
+        StylingJob *job;
+        GMutex lock;
+        GQueue *tasks;
+        CRSelMatchContext *ctxt;
+        /*the elements styled by the worker and their styles, in pairs*/
+        GPtrArray *styled;
+        /*
+         *the last elements styled whose style can be shared,
+         *and their styles, the oldest one at next_shared.
+         */
+        CRXMLNodePtr shared_nodes[STYLE_SHARING_CACHE_SIZE];
+        CRStyle *shared_styles[STYLE_SHARING_CACHE_SIZE];
+        guint next_shared;
+};
+
+/**
+ *The state cr_sel_eng_style_document() shares with its workers.
+ */
+struct _StylingJob {
+        CRSelEng *sel_eng;
+        /*the node interface of the engine*/
+        CRNodeIface const *iface;
+        CRCascade *cascade;
+        StylingWorker *workers;
+        guint nb_workers;
+        /*the number of subtrees queued or being styled*/
+        gint nb_pending;
+        /*the number of subtrees queued*/
+        gint nb_queued;
+        /*
+         *the idle workers wait on cond, under lock, for a subtree
+         *to be queued or for the last one to be styled.
+         */
+        GMutex lock;
+        GCond cond;
+        gint nb_idle;
+        /*the first error met by a worker*/
+        gint status;
+};
+
+/**
+ *Queues a subtree for the workers, if the queue of
+ *a_worker is not full already.
+ *@return TRUE if the subtree has been queued, FALSE if
+ *a_worker must style it itself.
+ */
+static gboolean
+styling_worker_offer (StylingWorker * a_worker, CRXMLNodePtr a_node,
+                      CRStyle * a_parent_style)
+{
+        StylingTask *task = NULL;
+
+        if (a_worker->job->nb_workers < 2)
+                return FALSE;
+
+        g_mutex_lock (&a_worker->lock);
+        if (a_worker->tasks->length < STYLING_QUEUE_LENGTH)
+                task = g_try_malloc (sizeof (StylingTask));
+        if (task) {
+                task->node = a_node;
+                task->parent_style = a_parent_style;
+                g_atomic_int_inc (&a_worker->job->nb_pending);
+                g_atomic_int_inc (&a_worker->job->nb_queued);
+                g_queue_push_tail (a_worker->tasks, task);
+        }
+        g_mutex_unlock (&a_worker->lock);
+        if (task && g_atomic_int_get (&a_worker->job->nb_idle) > 0) {
+                g_mutex_lock (&a_worker->job->lock);
+                g_cond_signal (&a_worker->job->cond);
+                g_mutex_unlock (&a_worker->job->lock);
+        }
+        return task ? TRUE : FALSE;
+}
+
+/**
+ *Gets the next subtree a worker has to style: the last one
+ *it queued, or else the first one queued by another worker.
+ *@return the subtree, or NULL if all the queues are empty.
+ */
+static StylingTask *
+styling_worker_take (StylingWorker * a_worker)
+{
+        StylingJob *job = a_worker->job;
+        StylingWorker *victim = NULL;
+        StylingTask *result = NULL;
+        guint i = 0;
+
+        g_mutex_lock (&a_worker->lock);
+        result = g_queue_pop_tail (a_worker->tasks);
+        g_mutex_unlock (&a_worker->lock);
+
+        for (i = 1; !result && i < job->nb_workers; i++) {
+                victim = &job->workers[(a_worker - job->workers + i)
+                                       % job->nb_workers];
+                g_mutex_lock (&victim->lock);
+                result = g_queue_pop_head (victim->tasks);
+                g_mutex_unlock (&victim->lock);
+        }
+        if (result)
+                g_atomic_int_add (&job->nb_queued, -1);
+        return result;
+}
+
+static gboolean
+element_has_id (CRNodeIface const * a_iface, CRXMLNodePtr a_node)
+{
+        const gchar *id = NULL;
+        gchar *copy = NULL;
+
+        id = a_iface->get_id (a_node, &copy);
+        if (copy)
+                g_free (copy);
+        return id ? TRUE : FALSE;
+}
+
+/**
+ *Looks for a recently styled element whose style a_node can
+ *share, that is, an element that has the same name and class
+ *attribute as a_node, no id, and the same parent style. Such an
+ *element is a sibling of a_node, or a cousin whose parent shares
+ *the style of the parent of a_node, and so on up. It was only
+ *remembered if the rules that may match it only test names, ids
+ *and classes (see remember_shared_style()), so the same rules
+ *match a_node.
+ *@return the style to share, or NULL if there is none.
+ */
+static CRStyle *
+find_shared_style (StylingWorker * a_worker, CRXMLNodePtr a_node,
+                   CRStyle * a_parent_style)
+{
+        CRNodeIface const *iface = a_worker->job->iface;
+        const gchar *klass = NULL,
+                *cur_klass = NULL;
+        gchar *copy = NULL,
+                *cur_copy = NULL;
+        CRXMLNodePtr cur = NULL;
+        CRStyle *result = NULL;
+        guint i = 0;
+
+        if (!PRIVATE (a_worker->job->sel_eng)->share_styles
+            || element_has_id (iface, a_node) == TRUE)
+                return NULL;
+
+        klass = iface->get_classes (a_node, &copy);
+        for (i = 0; !result && i < STYLE_SHARING_CACHE_SIZE; i++) {
+                cur = a_worker->shared_nodes[i];
+                if (!cur
+                    || a_worker->shared_styles[i]->parent_style
+                    != a_parent_style
+                    || strcmp (iface->get_local_name (cur),
+                               iface->get_local_name (a_node)))
+                        continue;
+                cur_klass = iface->get_classes (cur, &cur_copy);
+                if ((!klass && !cur_klass)
+                    || (klass && cur_klass && !strcmp (klass, cur_klass)))
+                        result = a_worker->shared_styles[i];
+                if (cur_copy) {
+                        g_free (cur_copy);
+                        cur_copy = NULL;
+                }
+        }
+        if (copy) {
+                g_free (copy);
+                copy = NULL;
+        }
+        return result;
+}
+
+/**
+ *Remembers the style of an element just styled for the next
+ *elements to share, if the rules that may match the element
+ *only test names, ids and classes, and the element has no id.
+ */
+static void
+remember_shared_style (StylingWorker * a_worker, CRXMLNodePtr a_node,
+                       CRStyle * a_style)
+{
+        if (!PRIVATE (a_worker->job->sel_eng)->share_styles
+            || !a_worker->ctxt->only_tests_names
+            || element_has_id (a_worker->job->iface, a_node) == TRUE)
+                return;
+
+        a_worker->shared_nodes[a_worker->next_shared] = a_node;
+        a_worker->shared_styles[a_worker->next_shared] = a_style;
+        a_worker->next_shared =
+                (a_worker->next_shared + 1) % STYLE_SHARING_CACHE_SIZE;
+}
+
+/**
+ *Styles an element and its descendants, queueing the
+ *subtrees of its children for the idle workers while
+ *the queue of a_worker has room for them.
+ *The parent of a_node must be the last element pushed
+ *in the match context of a_worker.
+ */
+static enum CRStatus
+style_subtree (StylingWorker * a_worker, CRXMLNodePtr a_node,
+               CRStyle * a_parent_style)
+{
+        StylingJob *job = a_worker->job;
+        CRStyle *style = NULL;
+        CRXMLNodePtr cur = NULL;
+        enum CRStatus status = CR_OK;
+
+        /*each element of the table of the styles holds a reference*/
+        style = find_shared_style (a_worker, a_node, a_parent_style);
+        if (style) {
+                cr_style_ref (style);
+                g_ptr_array_add (a_worker->styled, a_node);
+                g_ptr_array_add (a_worker->styled, style);
+        } else {
                 /*
-                 *get the the damn selector list in 
-                 *which we have to look
+                 *the root of the styled subtree has no parent
+                 *style to inherit from, so it gets the initial values.
                  */
-                switch (cur_stmt->type) {
-                case RULESET_STMT:
-                        if (cur_stmt->kind.ruleset
-                            && cur_stmt->kind.ruleset->sel_list) {
-                                sel_list = cur_stmt->kind.ruleset->sel_list;
-                        }
-                        break;
+                style = cr_style_new (a_parent_style ? FALSE : TRUE);
+                if (!style)
+                        return CR_OUT_OF_MEMORY_ERROR;
+                cr_style_ref (style);
+                g_ptr_array_add (a_worker->styled, a_node);
+                g_ptr_array_add (a_worker->styled, style);
+
+                status = cr_sel_eng_get_matched_style_in_context
+                        (job->sel_eng, a_worker->ctxt, job->cascade, a_node,
+                         a_parent_style, &style,
+                         a_parent_style ? FALSE : TRUE);
+                if (status != CR_OK)
+                        return status;
+                if (a_parent_style) {
+                        style->parent_style = a_parent_style;
+                        status = cr_style_resolve_inherited_properties
+                                (style);
+                        if (status != CR_OK)
+                                return status;
+                }
+                remember_shared_style (a_worker, a_node, style);
+        }
 
-                case AT_MEDIA_RULE_STMT:
-                        if (cur_stmt->kind.media_rule
-                            && cur_stmt->kind.media_rule->rulesets
-                            && cur_stmt->kind.media_rule->rulesets->
-                            kind.ruleset
-                            && cur_stmt->kind.media_rule->rulesets->
-                            kind.ruleset->sel_list) {
-                                sel_list =
-                                        cur_stmt->kind.media_rule->
-                                        rulesets->kind.ruleset->sel_list;
-                        }
-                        break;
+        status = cr_sel_eng_push_element_in_context
+                (job->sel_eng, a_worker->ctxt, a_node);
+        if (status != CR_OK)
+                return status;
+        for (cur = job->iface->get_first_child_element (a_node);
+             cur && status == CR_OK
+             && g_atomic_int_get (&job->status) == CR_OK;
+             cur = job->iface->get_next_sibling_element (cur)) {
+                if (job->iface->get_first_child_element (cur)
+                    && styling_worker_offer (a_worker, cur, style) == TRUE)
+                        continue;
+                status = style_subtree (a_worker, cur, style);
+        }
+        cr_sel_eng_pop_element_in_context (job->sel_eng, a_worker->ctxt,
+                                           a_node);
+        return status;
+}
 
-                case AT_IMPORT_RULE_STMT:
-                        /*
-                         *some recursivity may be needed here.
-                         *I don't like this :(
-                         */
-                        break;
-                default:
-                        break;
+/**
+ *Styles a subtree taken from a queue. The match context of
+ *a_worker has no element pushed, so the parent of the subtree
+ *is pushed first to give the selection its ancestors.
+ */
+static void
+run_styling_task (StylingWorker * a_worker, StylingTask * a_task)
+{
+        StylingJob *job = a_worker->job;
+        CRXMLNodePtr parent = job->iface->get_parent_element (a_task->node);
+        enum CRStatus status = CR_OK;
+
+        if (g_atomic_int_get (&job->status) == CR_OK) {
+                if (parent)
+                        status = cr_sel_eng_push_element_in_context
+                                (job->sel_eng, a_worker->ctxt, parent);
+                if (status == CR_OK) {
+                        status = style_subtree (a_worker, a_task->node,
+                                                a_task->parent_style);
+                        if (parent)
+                                cr_sel_eng_pop_element_in_context
+                                        (job->sel_eng, a_worker->ctxt,
+                                         parent);
                 }
+                if (status != CR_OK)
+                        g_atomic_int_compare_and_exchange
+                                (&job->status, CR_OK, status);
+        }
+        g_free (a_task);
+        if (g_atomic_int_dec_and_test (&job->nb_pending)) {
+                /*the last subtree: wake the idle workers up to leave*/
+                g_mutex_lock (&job->lock);
+                g_cond_broadcast (&job->cond);
+                g_mutex_unlock (&job->lock);
+        }
+}
+
+/**
+ *The body of a worker of cr_sel_eng_style_document():
+ *styles subtrees until there are no more to style.
+ *@param a_worker the #StylingWorker.
+ *@param a_user_data unused.
+ */
+static void
+run_styling_worker (gpointer a_worker, gpointer a_user_data)
+{
+        StylingWorker *worker = a_worker;
+        StylingJob *job = worker->job;
+        StylingTask *task = NULL;
+        gboolean is_done = FALSE;
 
-                if (!sel_list)
-                        continue;
+        (void) a_user_data;
 
+        while (is_done == FALSE) {
+                task = styling_worker_take (worker);
+                if (task) {
+                        run_styling_task (worker, task);
+                        continue;
+                }
                 /*
-                 *now, we have a comma separated selector list to look in.
-                 *let's walk it and try to match the xml_node
-                 *on each item of the list.
+                 *the other workers are busy with the last subtrees:
+                 *wait for them to queue more, or to be done.
+                 *nb_idle is raised before nb_queued is tested,
+                 *and styling_worker_offer() raises nb_queued before
+                 *it tests nb_idle, so a subtree can't be queued
+                 *without waking up a worker.
                  */
-                for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next) {
-                        if (!cur_sel->simple_sel)
-                                continue;
+                g_mutex_lock (&job->lock);
+                g_atomic_int_inc (&job->nb_idle);
+                while (g_atomic_int_get (&job->nb_pending) > 0
+                       && g_atomic_int_get (&job->nb_queued) <= 0)
+                        g_cond_wait (&job->cond, &job->lock);
+                g_atomic_int_add (&job->nb_idle, -1);
+                if (g_atomic_int_get (&job->nb_pending) <= 0)
+                        is_done = TRUE;
+                g_mutex_unlock (&job->lock);
+        }
+}
 
-                        status = cr_sel_eng_matches_node
-                                (a_this, cur_sel->simple_sel,
-                                 a_node, &matches);
+static void
+unref_style (gpointer a_style)
+{
+        cr_style_unref (a_style);
+}
 
-                        if (status == CR_OK && matches == TRUE) {
-                                /*
-                                 *bingo!!! we found one ruleset that
-                                 *matches that fucking node.
-                                 *lets put it in the out array.
-                                 */
+/*
+ *The most compound selectors (the parts of a selector between two
+ *combinators) cr_sel_eng_query_all() matches incrementally, one
+ *bit of a mask per compound. Longer selectors are matched as a
+ *whole on each element.
+ */
+#define QUERY_MAX_COMPOUNDS 32
 
-                                if (i < *a_len) {
-                                        a_rulesets[i] = cur_stmt;
-                                        i++;
-
-                                        /*
-                                         *For the cascade computing algorithm
-                                         *(which is gonna take place later)
-                                         *we must compute the specificity
-                                         *(css2 spec chap 6.4.1) of the selector
-                                         *that matched the current xml node
-                                         *and store it in the css2 statement
-                                         *(statement == ruleset here).
-                                         */
-                                        status = cr_simple_sel_compute_specificity (cur_sel->simple_sel);
-
-                                        g_return_val_if_fail (status == CR_OK,
-                                                              CR_ERROR);
-                                        cur_stmt->specificity =
-                                                cur_sel->simple_sel->
-                                                specificity;
-                                } else
-                                {
-                                        *a_len = i;
-                                        return CR_OUTPUT_TOO_SHORT_ERROR;
-                                }
-                        }
-                }
-        }
+/**
+ *A selector of the list cr_sel_eng_query_all() looks for.
+ *The mask of an element for the selector has its bit k set when
+ *the element matches the selector made of the compounds 0 to k:
+ *then the compound k + 1 matches the elements that have the
+ *element as ancestor, parent or previous sibling, depending on
+ *the combinator between the two.
+ */
+struct CRQuerySel {
+        CRSelInstr *prog;
+        /*
+         *the compounds, from left to right: their first
+         *instruction in prog, and the combinator on their left.
+         *0 compounds if the selector is matched as a whole.
+         */
+        CRSelInstr const *compounds[QUERY_MAX_COMPOUNDS];
+        enum CRSelOpcode combinators[QUERY_MAX_COMPOUNDS];
+        guint nr_compounds;
+};
 
+/**
+ *The state of a walk of cr_sel_eng_query_all().
+ */
+struct CRQuery {
+        CRSelEng *sel_eng;
+        CRSelMatchContext *ctxt;
+        struct CRQuerySel *sels;
+        guint nr_sels;
         /*
-         *if we reached this point, it means
-         *we reached the end of stylesheet.
-         *no need to store any info about the stylesheet
-         *anymore.
+         *the masks of the elements, for each selector, per
+         *depth of the walk: see query_children().
          */
-        g_return_val_if_fail (!PRIVATE (a_this)->cur_stmt, CR_ERROR);
-        PRIVATE (a_this)->sheet = NULL;
-        *a_len = i;
-        return CR_OK;
-}
+        GPtrArray *levels;
+        CRSelQueryHandler handler;
+        gpointer user_data;
+        gboolean stopped;
+};
 
+/**
+ *Compiles a selector for cr_sel_eng_query_all(), and
+ *splits it in compounds.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
 static enum CRStatus
-put_css_properties_in_props_list (CRPropList ** a_props, CRStatement * a_stmt)
+query_sel_init (struct CRQuerySel *a_this, CRSimpleSel const * a_sel)
 {
-        CRPropList *props = NULL,
-                *pair = NULL,
-                *tmp_props = NULL;
-        CRDeclaration *cur_decl = NULL;
-
-        g_return_val_if_fail (a_props && a_stmt
-                              && a_stmt->type == RULESET_STMT
-                              && a_stmt->kind.ruleset, CR_BAD_PARAM_ERROR);
-
-        props = *a_props;
+        CRSelInstr const *pc = NULL,
+                *start = NULL;
+        CRSelInstr const *compounds[QUERY_MAX_COMPOUNDS];
+        enum CRSelOpcode combinators[QUERY_MAX_COMPOUNDS];
+        guint nr = 0,
+                i = 0;
+
+        a_this->prog = cr_sel_prog_new (a_sel);
+        if (!a_this->prog)
+                return CR_ERROR;
+        a_this->nr_compounds = 0;
+
+        /*the program runs from the rightmost compound to the leftmost*/
+        for (pc = start = a_this->prog;; pc++) {
+                if (pc->op == CR_SEL_OP_FAIL)
+                        return CR_OK;
+                if (pc->op != CR_SEL_OP_MATCH
+                    && pc->op != CR_SEL_OP_PARENT
+                    && pc->op != CR_SEL_OP_PREV_SIBLING
+                    && pc->op != CR_SEL_OP_ANCESTOR)
+                        continue;
+                if (nr == QUERY_MAX_COMPOUNDS)
+                        return CR_OK;
+                compounds[nr] = start;
+                combinators[nr++] = pc->op;
+                if (pc->op == CR_SEL_OP_MATCH)
+                        break;
+                start = pc + 1;
+        }
+        for (i = 0; i < nr; i++) {
+                a_this->compounds[i] = compounds[nr - 1 - i];
+                /*CR_SEL_OP_MATCH for the leftmost compound*/
+                a_this->combinators[i] = combinators[nr - 1 - i];
+        }
+        a_this->nr_compounds = nr;
+        return CR_OK;
+}
 
-        for (cur_decl = a_stmt->kind.ruleset->decl_list;
-             cur_decl; cur_decl = cur_decl->next) {
-                CRDeclaration *decl;
+/**
+ *@return TRUE if no element can match the selector: if it
+ *failed to compile, or uses a pseudo class the engine has no
+ *handler for.
+ */
+static gboolean
+query_sel_never_matches (CRSelEng * a_sel_eng, struct CRQuerySel *a_this)
+{
+        CRSelInstr const *pc = NULL;
+
+        for (pc = a_this->prog; pc->op != CR_SEL_OP_MATCH; pc++) {
+                if (pc->op == CR_SEL_OP_FAIL)
+                        return TRUE;
+                if (pc->op == CR_SEL_OP_PSEUDO_CLASS
+                    && !lookup_pseudo_class_handler (a_sel_eng, pc->str,
+                                                     pc->len))
+                        return TRUE;
+        }
+        return FALSE;
+}
 
-                decl = NULL;
-                pair = NULL;
+/**
+ *Computes the mask of an element out of the walked subtree
+ *(an ancestor of its root) the slow way, by running the
+ *program of each of the selectors made of the compounds 0 to k.
+ */
+static guint32
+query_sel_get_context_mask (struct CRQuery *a_query,
+                            struct CRQuerySel *a_sel, CRXMLNodePtr a_node)
+{
+        guint32 result = 0;
+        guint k = 0;
+
+        for (k = 0; k < a_sel->nr_compounds; k++) {
+                if (sel_prog_matches_node (a_query->sel_eng, a_query->ctxt,
+                                           a_sel->compounds[k], a_node)
+                    == TRUE)
+                        result |= (guint32) 1 << k;
+        }
+        return result;
+}
 
-                if (!cur_decl->property 
-                    || !cur_decl->property->stryng
-                    || !cur_decl->property->stryng->str)
-                        continue;
-                /*
-                 *First, test if the property is not
-                 *already present in our properties list
-                 *If yes, apply the cascading rules to
-                 *compute the precedence. If not, insert
-                 *the property into the list
-                 */
-                cr_prop_list_lookup_prop (props,
-                                          cur_decl->property, 
-                                          &pair);
-
-                if (!pair) {
-                        tmp_props = cr_prop_list_append2
-                                (props, cur_decl->property, cur_decl);
-                        if (tmp_props) {
-                                props = tmp_props;
-                                tmp_props = NULL;
+/**
+ *Computes the mask of an element of the walked subtree
+ *from the ones of its parent, of its ancestors and of its
+ *previous sibling, so that only the compounds that
+ *may extend a match are tested on the element.
+ */
+static guint32
+query_sel_get_mask (struct CRQuery *a_query, struct CRQuerySel *a_sel,
+                    CRXMLNodePtr a_node, guint32 a_parent_mask,
+                    guint32 a_ancestors_mask, guint32 a_prev_mask)
+{
+        guint32 result = 0,
+                required = 0;
+        guint k = 0;
+
+        for (k = 0; k < a_sel->nr_compounds; k++) {
+                if (k) {
+                        switch (a_sel->combinators[k]) {
+                        case CR_SEL_OP_PARENT:
+                                required = a_parent_mask;
+                                break;
+                        case CR_SEL_OP_PREV_SIBLING:
+                                required = a_prev_mask;
+                                break;
+                        default:
+                                required = a_ancestors_mask;
+                                break;
                         }
-                        continue;
+                        if (!(required & ((guint32) 1 << (k - 1))))
+                                continue;
                 }
+                if (compound_matches_node (a_query->sel_eng, a_query->ctxt,
+                                           a_sel->compounds[k], a_node))
+                        result |= (guint32) 1 << k;
+        }
+        return result;
+}
 
-                /*
-                 *A property with the same name already exists.
-                 *We must apply here 
-                 *some cascading rules
-                 *to compute the precedence.
-                 */
-                cr_prop_list_get_decl (pair, &decl);
-                g_return_val_if_fail (decl, CR_ERROR);
+/**
+ *Walks the children of an element, and their descendants, and
+ *gives the ones that match one of the selectors to the handler.
+ *@param a_query the query.
+ *@param a_parent the element.
+ *@param a_depth the depth of the children in the walk.
+ *@param a_parent_masks the masks of a_parent, one per selector.
+ *@param a_ancestors_masks the masks of a_parent and of all its
+ *ancestors, or'ed, one per selector.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+query_children (struct CRQuery *a_query, CRXMLNodePtr a_parent,
+                guint a_depth, guint32 const * a_parent_masks,
+                guint32 const * a_ancestors_masks)
+{
+        CRNodeIface const *iface = PRIVATE (a_query->sel_eng)->node_iface;
+        CRXMLNodePtr cur = NULL;
+        struct CRQuerySel *sel = NULL;
+        guint32 *masks = NULL,
+                *prev_masks = NULL,
+                *descendants_masks = NULL;
+        enum CRSelQueryAction action = CR_SEL_QUERY_CONTINUE;
+        gboolean matches = FALSE;
+        enum CRStatus status = CR_OK;
+        guint i = 0;
 
-                /*
-                 *first, look at the origin.
-                 *6.4.1 says: 
-                 *"for normal declarations, 
-                 *author style sheets override user 
-                 *style sheets which override 
-                 *the default style sheet."
-                 */
-                if (decl->parent_statement
-                    && decl->parent_statement->parent_sheet
-                    && (decl->parent_statement->parent_sheet->origin
-                        < a_stmt->parent_sheet->origin)) {
-                        /*
-                         *if the already selected declaration
-                         *is marked as being !important the current
-                         *declaration must not overide it 
-                         *(unless the already selected declaration 
-                         *has an UA origin)
-                         */
-                        if (decl->important == TRUE
-                            && decl->parent_statement->parent_sheet->origin
-                            != ORIGIN_UA) {
+        /*the masks of each depth are allocated once per query*/
+        if (a_depth >= a_query->levels->len) {
+                masks = g_try_malloc (3 * a_query->nr_sels
+                                      * sizeof (guint32));
+                if (!masks) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                g_ptr_array_add (a_query->levels, masks);
+        }
+        masks = g_ptr_array_index (a_query->levels, a_depth);
+        prev_masks = masks + a_query->nr_sels;
+        descendants_masks = prev_masks + a_query->nr_sels;
+        memset (prev_masks, 0, a_query->nr_sels * sizeof (guint32));
+
+        for (cur = iface->get_first_child_element (a_parent); cur;
+             cur = iface->get_next_sibling_element (cur)) {
+                node_snapshots_reset (a_query->ctxt);
+                matches = FALSE;
+                for (i = 0; i < a_query->nr_sels; i++) {
+                        sel = &a_query->sels[i];
+                        if (!sel->nr_compounds) {
+                                masks[i] = 0;
+                                if (matches == FALSE)
+                                        matches = sel_prog_matches_node
+                                                (a_query->sel_eng,
+                                                 a_query->ctxt, sel->prog,
+                                                 cur);
                                 continue;
                         }
-                        tmp_props = cr_prop_list_unlink (props, pair);
-                        if (props) {
-                                cr_prop_list_destroy (pair);
-                        }
-                        props = tmp_props;
-                        tmp_props = NULL;
-                        props = cr_prop_list_append2
-                                (props, cur_decl->property, cur_decl);
-
-                        continue;
-                } else if (decl->parent_statement
-                           && decl->parent_statement->parent_sheet
-                           && (decl->parent_statement->
-                               parent_sheet->origin
-                               > a_stmt->parent_sheet->origin)) {
-                        cr_utils_trace_info
-                                ("We should not reach this line\n");
-                        continue;
+                        masks[i] = query_sel_get_mask
+                                (a_query, sel, cur, a_parent_masks[i],
+                                 a_ancestors_masks[i], prev_masks[i]);
+                        if (masks[i] & ((guint32) 1 << (sel->nr_compounds - 1)))
+                                matches = TRUE;
                 }
 
-                /*
-                 *A property with the same
-                 *name and the same origin already exists.
-                 *shit. This is lasting longer than expected ...
-                 *Luckily, the spec says in 6.4.1:
-                 *"more specific selectors will override 
-                 *more general ones"
-                 *and
-                 *"if two rules have the same weight, 
-                 *origin and specificity, 
-                 *the later specified wins"
-                 */
-                if (a_stmt->specificity
-                    >= decl->parent_statement->specificity) {
-                        if (decl->important == TRUE)
-                                continue;
-                        props = cr_prop_list_unlink (props, pair);
-                        if (pair) {
-                                cr_prop_list_destroy (pair);
-                                pair = NULL;
-                        }
-                        props = cr_prop_list_append2 (props,
-                                                      cur_decl->property,
-                                                      cur_decl);
+                action = CR_SEL_QUERY_CONTINUE;
+                if (matches == TRUE)
+                        action = a_query->handler (a_query->sel_eng, cur,
+                                                   a_query->user_data);
+                if (action == CR_SEL_QUERY_STOP) {
+                        a_query->stopped = TRUE;
+                        return CR_OK;
                 }
+                if (action == CR_SEL_QUERY_CONTINUE
+                    && iface->get_first_child_element (cur)) {
+                        for (i = 0; i < a_query->nr_sels; i++)
+                                descendants_masks[i] =
+                                        a_ancestors_masks[i] | masks[i];
+                        status = query_children (a_query, cur,
+                                                 a_depth + 1, masks,
+                                                 descendants_masks);
+                        if (status != CR_OK || a_query->stopped == TRUE)
+                                return status;
+                }
+                memcpy (prev_masks, masks,
+                        a_query->nr_sels * sizeof (guint32));
         }
-        /*TODO: this may leak. Check this out */
-        *a_props = props;
-
         return CR_OK;
 }
 
-static void
-set_style_from_props (CRStyle * a_style, CRPropList * a_props)
-{
-        CRPropList *cur = NULL;
-        CRDeclaration *decl = NULL;
-
-        for (cur = a_props; cur; cur = cr_prop_list_get_next (cur)) {
-                cr_prop_list_get_decl (cur, &decl);
-                cr_style_set_style_from_decl (a_style, decl);
-                decl = NULL;
-        }
-}
-
 /****************************************
  *PUBLIC METHODS
  ****************************************/
@@ -1113,6 +2283,10 @@ set_style_from_props (CRStyle * a_style, CRPropList * a_props)
 /**
  * cr_sel_eng_new:
  *Creates a new instance of #CRSelEng.
+ *Once its pseudo class selector handlers are registered, the
+ *engine is only read by the *_in_context() selection methods,
+ *so it can be shared by threads that each select in their own
+ *#CRSelMatchContext.
  *
  *Returns the newly built instance of #CRSelEng of
  *NULL if an error occurs.
@@ -1136,43 +2310,44 @@ cr_sel_eng_new (void)
                 return NULL;
         }
         memset (PRIVATE (result), 0, sizeof (CRSelEngPriv));
-        cr_sel_eng_register_pseudo_class_sel_handler
+        PRIVATE (result)->ctxt = cr_sel_match_context_new ();
+        if (!PRIVATE (result)->ctxt) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (PRIVATE (result));
+                g_free (result);
+                return NULL;
+        }
+        PRIVATE (result)->node_iface = cr_libxml_node_iface_get ();
+        cr_sel_eng_register_node_pseudo_class_sel_handler
                 (result, (guchar *) "first-child",
-                 IDENT_PSEUDO, (CRPseudoClassSelectorHandler)
-                 first_child_pseudo_class_handler);
-        cr_sel_eng_register_pseudo_class_sel_handler
+                 IDENT_PSEUDO, first_child_pseudo_class_handler);
+        cr_sel_eng_register_node_pseudo_class_sel_handler
                 (result, (guchar *) "lang",
-                 FUNCTION_PSEUDO, (CRPseudoClassSelectorHandler)
-                 lang_pseudo_class_handler);
+                 FUNCTION_PSEUDO, lang_pseudo_class_handler);
 
         return result;
 }
 
 /**
- * cr_sel_eng_register_pseudo_class_sel_handler:
- *@a_this: the current instance of #CRSelEng
- *@a_pseudo_class_sel_name: the name of the pseudo class selector.
- *@a_pseudo_class_type: the type of the pseudo class selector.
- *@a_handler: the actual handler or callback to be called during
- *the selector evaluation process.
- *
  *Adds a new handler entry in the handlers entry table.
- *
- *Returns CR_OK, upon successful completion, an error code otherwise.
+ *@param a_this the current instance of #CRSelEng
+ *@param a_name the name of the pseudo class selector.
+ *@param a_type the type of the pseudo class selector.
+ *@param a_handler the handler given xmlNode, or NULL.
+ *@param a_node_handler the handler given the nodes of any
+ *#CRNodeIface, or NULL.
+ *@return CR_OK, upon successful completion, an error code otherwise.
  */
-enum CRStatus
-cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
-                                              guchar * a_name,
-                                              enum CRPseudoType a_type,
-                                              CRPseudoClassSelectorHandler
-                                              a_handler)
+static enum CRStatus
+add_pseudo_class_handler_entry (CRSelEng * a_this, guchar * a_name,
+                                enum CRPseudoType a_type,
+                                CRPseudoClassSelectorHandler a_handler,
+                                CRNodePseudoClassSelectorHandler
+                                a_node_handler)
 {
         struct CRPseudoClassSelHandlerEntry *handler_entry = NULL;
         GList *list = NULL;
 
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_handler && a_name, CR_BAD_PARAM_ERROR);
-
         handler_entry = g_try_malloc
                 (sizeof (struct CRPseudoClassSelHandlerEntry));
         if (!handler_entry) {
@@ -1181,8 +2356,10 @@ cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
         memset (handler_entry, 0,
                 sizeof (struct CRPseudoClassSelHandlerEntry));
         handler_entry->name = (guchar *) g_strdup ((const gchar *) a_name);
+        handler_entry->atom = cr_atom_from_string ((const gchar *) a_name);
         handler_entry->type = a_type;
         handler_entry->handler = a_handler;
+        handler_entry->node_handler = a_node_handler;
         list = g_list_append (PRIVATE (a_this)->pcs_handlers, handler_entry);
         if (!list) {
                 return CR_OUT_OF_MEMORY_ERROR;
@@ -1191,6 +2368,63 @@ cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
         return CR_OK;
 }
 
+/**
+ * cr_sel_eng_register_pseudo_class_sel_handler:
+ *@a_this: the current instance of #CRSelEng
+ *@a_pseudo_class_sel_name: the name of the pseudo class selector.
+ *@a_pseudo_class_type: the type of the pseudo class selector.
+ *@a_handler: the actual handler or callback to be called during
+ *the selector evaluation process.
+ *
+ *Adds a new handler entry in the handlers entry table.
+ *The handler is given the nodes as xmlNode, so it must only be
+ *used with the default, libxml2, #CRNodeIface; see
+ *cr_sel_eng_register_node_pseudo_class_sel_handler() otherwise.
+ *
+ *Returns CR_OK, upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng * a_this,
+                                              guchar * a_name,
+                                              enum CRPseudoType a_type,
+                                              CRPseudoClassSelectorHandler
+                                              a_handler)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_handler && a_name, CR_BAD_PARAM_ERROR);
+
+        return add_pseudo_class_handler_entry (a_this, a_name, a_type,
+                                               a_handler, NULL);
+}
+
+/**
+ * cr_sel_eng_register_node_pseudo_class_sel_handler:
+ *@a_this: the current instance of #CRSelEng
+ *@a_pseudo_class_sel_name: the name of the pseudo class selector.
+ *@a_pseudo_class_type: the type of the pseudo class selector.
+ *@a_handler: the actual handler or callback to be called during
+ *the selector evaluation process.
+ *
+ *Like cr_sel_eng_register_pseudo_class_sel_handler(), but the
+ *handler is given the nodes of whatever #CRNodeIface the engine
+ *reads, see cr_sel_eng_set_node_iface().
+ *
+ *Returns CR_OK, upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_register_node_pseudo_class_sel_handler (CRSelEng * a_this,
+                                                   guchar * a_name,
+                                                   enum CRPseudoType a_type,
+                                                   CRNodePseudoClassSelectorHandler
+                                                   a_handler)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_handler && a_name, CR_BAD_PARAM_ERROR);
+
+        return add_pseudo_class_handler_entry (a_this, a_name, a_type,
+                                               NULL, a_handler);
+}
+
 enum CRStatus
 cr_sel_eng_unregister_pseudo_class_sel_handler (CRSelEng * a_this,
                                                 guchar * a_name,
@@ -1262,6 +2496,23 @@ cr_sel_eng_unregister_all_pseudo_class_sel_handlers (CRSelEng * a_this)
         return CR_OK;
 }
 
+static struct CRPseudoClassSelHandlerEntry *
+get_pseudo_class_handler_entry (CRSelEng * a_this, guchar * a_name,
+                                enum CRPseudoType a_type)
+{
+        GList *elem = NULL;
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
+
+        for (elem = PRIVATE (a_this)->pcs_handlers;
+             elem; elem = g_list_next (elem)) {
+                entry = elem->data;
+                if (!strcmp ((const char *) a_name, (const char *) entry->name)
+                    && entry->type == a_type)
+                        return entry;
+        }
+        return NULL;
+}
+
 enum CRStatus
 cr_sel_eng_get_pseudo_class_selector_handler (CRSelEng * a_this,
                                               guchar * a_name,
@@ -1269,26 +2520,57 @@ cr_sel_eng_get_pseudo_class_selector_handler (CRSelEng * a_this,
                                               CRPseudoClassSelectorHandler *
                                               a_handler)
 {
-        GList *elem = NULL;
         struct CRPseudoClassSelHandlerEntry *entry = NULL;
-        gboolean found = FALSE;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_name, CR_BAD_PARAM_ERROR);
+                              && a_name && a_handler, CR_BAD_PARAM_ERROR);
 
-        for (elem = PRIVATE (a_this)->pcs_handlers;
-             elem; elem = g_list_next (elem)) {
-                entry = elem->data;
-                if (!strcmp ((const char *) a_name, (const char *) entry->name)
-                    && entry->type == a_type) {
-                        found = TRUE;
-                        break;
-                }
-        }
+        entry = get_pseudo_class_handler_entry (a_this, a_name, a_type);
+        if (!entry)
+                return CR_PSEUDO_CLASS_SEL_HANDLER_NOT_FOUND_ERROR;
+        /*
+         *a node handler, like the built in ones, takes
+         *the xmlNode of the default #CRNodeIface as well.
+         */
+        if (entry->handler)
+                *a_handler = entry->handler;
+        else
+                *a_handler = (CRPseudoClassSelectorHandler)
+                        entry->node_handler;
+        return CR_OK;
+}
 
-        if (found == FALSE)
+/**
+ * cr_sel_eng_get_node_pseudo_class_selector_handler:
+ *@a_this: the current instance of #CRSelEng
+ *@a_pseudo_class_sel_name: the name of the pseudo class selector.
+ *@a_pseudo_class_type: the type of the pseudo class selector.
+ *@a_handler: out parameter. The handler.
+ *
+ *Gets a handler registered with
+ *cr_sel_eng_register_node_pseudo_class_sel_handler(), or
+ *one of the built in handlers.
+ *
+ *Returns CR_OK upon successful completion,
+ *CR_PSEUDO_CLASS_SEL_HANDLER_NOT_FOUND_ERROR if there is no
+ *such handler, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_node_pseudo_class_selector_handler (CRSelEng * a_this,
+                                                   guchar * a_name,
+                                                   enum CRPseudoType a_type,
+                                                   CRNodePseudoClassSelectorHandler *
+                                                   a_handler)
+{
+        struct CRPseudoClassSelHandlerEntry *entry = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_name && a_handler, CR_BAD_PARAM_ERROR);
+
+        entry = get_pseudo_class_handler_entry (a_this, a_name, a_type);
+        if (!entry || !entry->node_handler)
                 return CR_PSEUDO_CLASS_SEL_HANDLER_NOT_FOUND_ERROR;
-        *a_handler = entry->handler;
+        *a_handler = entry->node_handler;
         return CR_OK;
 }
 
@@ -1304,31 +2586,173 @@ cr_sel_eng_get_pseudo_class_selector_handler (CRSelEng * a_this,
  *
  *Evaluates a chained list of simple selectors (known as a css2 selector).
  *Says wheter if this selector matches the xml node given in parameter or
- *not.
+ *not. The selector is matched as it is, without being compiled
+ *(see cr_sel_prog_new()), so that this function allocates nothing;
+ *the selectors of a stylesheet are compiled once, when it is indexed.
+ *
+ *Returns the CR_OK if the selection ran correctly, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
+                         CRXMLNodePtr a_node, gboolean * a_result)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_this && a_sel && a_node
+                              && a_result, CR_BAD_PARAM_ERROR);
+
+        *a_result = FALSE;
+        if (!PRIVATE (a_this)->node_iface->is_element (a_node))
+                return CR_OK;
+
+        for (; a_sel->next; a_sel = a_sel->next) ;
+        *a_result = simple_sels_match_node (a_this, a_sel, a_node);
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_query_all_in_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context the query is made in.
+ *@a_root: the node whose descendants are looked at.
+ *@a_sel: the list of comma separated selectors to look for.
+ *@a_handler: the function the matching elements are given to.
+ *@a_user_data: the data to give to @a_handler.
+ *
+ *Like cr_sel_eng_query_all(), for the queries made with a match
+ *context of their own, so that several threads can query with the
+ *same engine at once.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_query_all_in_context (CRSelEng * a_this,
+                                 CRSelMatchContext * a_ctxt,
+                                 CRXMLNodePtr a_root, CRSelector * a_sel,
+                                 CRSelQueryHandler a_handler,
+                                 gpointer a_user_data)
+{
+        struct CRQuery query;
+        CRNodeIface const *iface = NULL;
+        CRSelector *cur = NULL;
+        CRXMLNodePtr node = NULL;
+        guint32 *root_masks = NULL,
+                mask = 0;
+        gboolean can_match = FALSE;
+        guint nr_sels = 0,
+                i = 0;
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_ctxt
+                              && a_root && a_handler, CR_BAD_PARAM_ERROR);
+
+        iface = PRIVATE (a_this)->node_iface;
+        for (cur = a_sel; cur; cur = cur->next) {
+                if (cur->simple_sel)
+                        nr_sels++;
+        }
+        if (!nr_sels)
+                return CR_OK;
+
+        memset (&query, 0, sizeof (query));
+        query.sel_eng = a_this;
+        query.ctxt = a_ctxt;
+        query.handler = a_handler;
+        query.user_data = a_user_data;
+        query.levels = g_ptr_array_new ();
+        query.sels = g_try_malloc0 (nr_sels * sizeof (struct CRQuerySel));
+        root_masks = g_try_malloc0 (2 * nr_sels * sizeof (guint32));
+        if (!query.sels || !root_masks) {
+                cr_utils_trace_info ("Out of memory");
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto cleanup;
+        }
+        for (cur = a_sel; cur; cur = cur->next) {
+                if (!cur->simple_sel)
+                        continue;
+                status = query_sel_init (&query.sels[query.nr_sels],
+                                         cur->simple_sel);
+                if (status != CR_OK)
+                        goto cleanup;
+                if (query_sel_never_matches
+                    (a_this, &query.sels[query.nr_sels]) == FALSE)
+                        can_match = TRUE;
+                query.nr_sels++;
+        }
+        if (can_match == FALSE)
+                goto cleanup;
+
+        /*what the root and its ancestors match of the selectors*/
+        if (iface->is_element (a_root)) {
+                for (node = a_root; node;
+                     node = iface->get_parent_element (node)) {
+                        node_snapshots_reset (query.ctxt);
+                        for (i = 0; i < nr_sels; i++) {
+                                mask = query_sel_get_context_mask
+                                        (&query, &query.sels[i], node);
+                                if (node == a_root)
+                                        root_masks[i] = mask;
+                                root_masks[nr_sels + i] |= mask;
+                        }
+                }
+        }
+        status = query_children (&query, a_root, 0, root_masks,
+                                 root_masks + nr_sels);
+
+ cleanup:
+        node_snapshots_reset (query.ctxt);
+        for (i = 0; i < query.nr_sels; i++)
+                cr_sel_prog_destroy (query.sels[i].prog);
+        for (i = 0; i < query.levels->len; i++)
+                g_free (g_ptr_array_index (query.levels, i));
+        g_ptr_array_free (query.levels, TRUE);
+        g_free (query.sels);
+        g_free (root_masks);
+        return status;
+}
+
+/**
+ * cr_sel_eng_query_all:
+ *@a_this: the current instance of the selection engine.
+ *@a_root: the node whose descendants are looked at: an element
+ *or, with the default #CRNodeIface, an xml document.
+ *@a_sel: the list of comma separated selectors to look for, as
+ *built by cr_selector_parse_from_buf().
+ *@a_handler: the function the matching elements are given to.
+ *@a_user_data: the data to give to @a_handler.
  *
- *Returns the CR_OK if the selection ran correctly, an error code otherwise.
+ *Gives the descendant elements of @a_root that match one of the
+ *selectors of @a_sel to @a_handler, in document order. The
+ *ancestors of @a_root count for the combinators, but @a_root
+ *itself is never given.
+ *The subtree is walked once. Each selector is compiled once, and
+ *each element carries what it, its ancestors and its previous
+ *sibling match of the selectors, so only the compound selectors
+ *that may extend a match are tested on the next elements, and the
+ *descendant combinators never walk up the tree. @a_handler can have
+ *the walk skip the descendants of an element, or stop it; a list of
+ *selectors that can't match any element isn't walked at all.
+ *Like the other methods that take no match context, the query
+ *uses the one of the engine.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
  */
 enum CRStatus
-cr_sel_eng_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
-                         xmlNode * a_node, gboolean * a_result)
+cr_sel_eng_query_all (CRSelEng * a_this, CRXMLNodePtr a_root,
+                      CRSelector * a_sel, CRSelQueryHandler a_handler,
+                      gpointer a_user_data)
 {
-        g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && a_this && a_node
-                              && a_result, CR_BAD_PARAM_ERROR);
-
-        if (a_node->type != XML_ELEMENT_NODE) {
-                *a_result = FALSE;
-                return CR_OK;
-        }
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
-        return sel_matches_node_real (a_this, a_sel, 
-                                      a_node, a_result, 
-                                      TRUE, TRUE);
+        return cr_sel_eng_query_all_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_root, a_sel,
+                 a_handler, a_user_data);
 }
 
 /**
- * cr_sel_eng_get_matched_rulesets:
+ * cr_sel_eng_get_matched_rulesets_in_context:
  *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context to select in.
  *@a_sheet: the stylesheet that holds the selectors.
  *@a_node: the xml node to consider during the walk thru
  *the stylesheet.
@@ -1339,16 +2763,21 @@ cr_sel_eng_matches_node (CRSelEng * a_this, CRSimpleSel * a_sel,
  *point to statements that are still in the css stylesheet.
  *@a_len: the length of *a_ruleset.
  *
- *Returns an array of pointers to selectors that matches
- *the xml node given in parameter.
+ *Like cr_sel_eng_get_matched_rulesets(), but all the state
+ *of the selection lives in @a_ctxt, and neither the engine nor
+ *the stylesheet are modified. So several threads can select
+ *with the same engine and the same stylesheet at once, as long
+ *as each of them has its own match context.
  *
  *Returns CR_OK upon sucessfull completion, an error code otherwise.
  */
 enum CRStatus
-cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
-                                 CRStyleSheet * a_sheet,
-                                 xmlNode * a_node,
-                                 CRStatement *** a_rulesets, gulong * a_len)
+cr_sel_eng_get_matched_rulesets_in_context (CRSelEng * a_this,
+                                            CRSelMatchContext * a_ctxt,
+                                            CRStyleSheet * a_sheet,
+                                            CRXMLNodePtr a_node,
+                                            CRStatement *** a_rulesets,
+                                            gulong * a_len)
 {
         CRStatement **stmts_tab = NULL;
         enum CRStatus status = CR_OK;
@@ -1358,6 +2787,7 @@ cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
         gushort stmts_chunck_size = 8;
 
         g_return_val_if_fail (a_this
+                              && a_ctxt
                               && a_sheet
                               && a_node
                               && a_rulesets && *a_rulesets == NULL
@@ -1375,8 +2805,12 @@ cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
         tab_size = stmts_chunck_size;
         tab_len = tab_size;
 
+        g_hash_table_remove_all (a_ctxt->matched_entries);
+        node_snapshots_reset (a_ctxt);
+        a_ctxt->only_tests_names = TRUE;
         while ((status = cr_sel_eng_get_matched_rulesets_real
-                (a_this, a_sheet, a_node, stmts_tab + index, &tab_len))
+                (a_this, a_ctxt, a_sheet, a_node, stmts_tab + index,
+                 &tab_len))
                == CR_OUTPUT_TOO_SHORT_ERROR) {
                 stmts_tab = g_try_realloc (stmts_tab,
                                            (tab_size + stmts_chunck_size)
@@ -1409,31 +2843,115 @@ cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
         return status;
 }
 
+/**
+ * cr_sel_eng_get_matched_rulesets:
+ *@a_this: the current instance of the selection engine.
+ *@a_sheet: the stylesheet that holds the selectors.
+ *@a_node: the xml node to consider during the walk thru
+ *the stylesheet.
+ *@a_rulesets: out parameter. A pointer to an array of
+ *rulesets statement pointers. *a_rulesets is allocated by
+ *this function and must be freed by the caller. However, the caller
+ *must not alter the rulesets statements pointer because they
+ *point to statements that are still in the css stylesheet.
+ *@a_len: the length of *a_ruleset.
+ *
+ *Returns an array of pointers to selectors that matches
+ *the xml node given in parameter.
+ *Each ruleset is returned once, even if several of its
+ *selectors match the node. The specificity of the most specific
+ *of them is stored in the "specificity" field of the ruleset.
+ *This function uses the match context of the engine, see
+ *cr_sel_eng_get_matched_rulesets_in_context() for one that
+ *can be used from several threads at once.
+ *
+ *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_matched_rulesets (CRSelEng * a_this,
+                                 CRStyleSheet * a_sheet,
+                                 CRXMLNodePtr a_node,
+                                 CRStatement *** a_rulesets, gulong * a_len)
+{
+        enum CRStatus status = CR_OK;
+        gulong i = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
 
+        status = cr_sel_eng_get_matched_rulesets_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_sheet, a_node,
+                 a_rulesets, a_len);
+        if (status != CR_OK)
+                return status;
+
+        for (i = 0; i < *a_len; i++) {
+                (*a_rulesets)[i]->specificity = get_matched_specificity
+                        (PRIVATE (a_this)->ctxt->matched_entries,
+                         (*a_rulesets)[i]);
+        }
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_get_matched_properties_from_cascade_in_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context to select in.
+ *@a_cascade: the cascade to get the properties from.
+ *@a_node: the xml node to consider.
+ *@a_props: in/out parameter. The declarations that win the
+ *cascade for @a_node are appended to *@a_props, one per property,
+ *in ascending order of precedence.
+ *
+ *Like cr_sel_eng_get_matched_properties_from_cascade(), but
+ *all the state of the selection lives in @a_ctxt, so several
+ *threads can select against the same cascade at once.
+ *The rulesets that match @a_node are sorted once by origin,
+ *importance, specificity and source order; the declarations are
+ *then taken from the one that takes precedence down, so each
+ *property is resolved without being compared to the declarations
+ *it overrides.
+ *
+ *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ */
 enum CRStatus
-cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
-                                                CRCascade * a_cascade,
-                                                xmlNode * a_node,
-                                                CRPropList ** a_props)
+cr_sel_eng_get_matched_properties_from_cascade_in_context (CRSelEng * a_this,
+                                                           CRSelMatchContext *
+                                                           a_ctxt,
+                                                           CRCascade *
+                                                           a_cascade,
+                                                           CRXMLNodePtr a_node,
+                                                           CRPropList **
+                                                           a_props)
 {
         CRStatement **stmts_tab = NULL;
         enum CRStatus status = CR_OK;
         gulong tab_size = 0,
                 tab_len = 0,
-                i = 0,
-                index = 0;
+                index = 0,
+                first = 0;
         enum CRStyleOrigin origin = 0;
         gushort stmts_chunck_size = 8;
         CRStyleSheet *sheet = NULL;
 
         g_return_val_if_fail (a_this
+                              && a_ctxt
                               && a_cascade
                               && a_node && a_props, CR_BAD_PARAM_ERROR);
 
+        node_snapshots_reset (a_ctxt);
+        a_ctxt->only_tests_names = TRUE;
+        g_array_set_size (a_ctxt->cascade_items, 0);
         for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
                 sheet = cr_cascade_get_sheet (a_cascade, origin);
                 if (!sheet)
                         continue;
+                /*
+                 *a stylesheet imported by the sheets of two origins
+                 *has its rulesets found, and cascaded, for both.
+                 */
+                g_hash_table_remove_all (a_ctxt->matched_entries);
+                first = index;
                 if (tab_size - index < 1) {
                         stmts_tab = g_try_realloc
                                 (stmts_tab, (tab_size + stmts_chunck_size)
@@ -1451,7 +2969,8 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
                         tab_len = tab_size - index;
                 }
                 while ((status = cr_sel_eng_get_matched_rulesets_real
-                        (a_this, sheet, a_node, stmts_tab + index, &tab_len))
+                        (a_this, a_ctxt, sheet, a_node, stmts_tab + index,
+                         &tab_len))
                        == CR_OUTPUT_TOO_SHORT_ERROR) {
                         stmts_tab = g_try_realloc
                                 (stmts_tab, (tab_size + stmts_chunck_size)
@@ -1476,32 +2995,11 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
                 }
                 index += tab_len;
                 tab_len = tab_size - index;
+                add_cascade_items (a_ctxt, stmts_tab + first,
+                                   index - first, origin);
         }
 
-        /*
-         *TODO, walk down the stmts_tab and build the
-         *property_name/declaration hashtable.
-         *Make sure one can walk from the declaration to
-         *the stylesheet.
-         */
-        for (i = 0; i < index; i++) {
-                CRStatement *stmt = stmts_tab[i];
-
-                if (!stmt)
-                        continue;
-                switch (stmt->type) {
-                case RULESET_STMT:
-                        if (!stmt->parent_sheet)
-                                continue;
-                        status = put_css_properties_in_props_list
-                                (a_props, stmt);
-                        break;
-                default:
-                        break;
-                }
-
-        }
-        status = CR_OK ;
+        status = cascade_properties (a_ctxt, a_props);
  cleanup:
         if (stmts_tab) {
                 g_free (stmts_tab);
@@ -1512,22 +3010,56 @@ cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
 }
 
 enum CRStatus
-cr_sel_eng_get_matched_style (CRSelEng * a_this,
-                              CRCascade * a_cascade,
-                              xmlNode * a_node,
-                              CRStyle * a_parent_style, 
-                              CRStyle ** a_style,
-                              gboolean a_set_props_to_initial_values)
+cr_sel_eng_get_matched_properties_from_cascade (CRSelEng * a_this,
+                                                CRCascade * a_cascade,
+                                                CRXMLNodePtr a_node,
+                                                CRPropList ** a_props)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        return cr_sel_eng_get_matched_properties_from_cascade_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_cascade, a_node, a_props);
+}
+
+/**
+ * cr_sel_eng_get_matched_style_in_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context to select in.
+ *@a_cascade: the cascade to get the style from.
+ *@a_node: the xml node to consider.
+ *@a_parent_style: the style of the parent of @a_node.
+ *@a_style: in/out parameter. The style of @a_node. It is
+ *allocated if *a_style is NULL and a property applies to @a_node.
+ *@a_set_props_to_initial_values: whether the properties of the
+ *style that are not set by the cascade are set to their initial
+ *values (rather than their default values).
+ *
+ *Like cr_sel_eng_get_matched_style(), but all the state of the
+ *selection lives in @a_ctxt, so several threads can style nodes
+ *against the same cascade at once.
+ *
+ *Returns CR_OK upon sucessfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_get_matched_style_in_context (CRSelEng * a_this,
+                                         CRSelMatchContext * a_ctxt,
+                                         CRCascade * a_cascade,
+                                         CRXMLNodePtr a_node,
+                                         CRStyle * a_parent_style,
+                                         CRStyle ** a_style,
+                                         gboolean
+                                         a_set_props_to_initial_values)
 {
         enum CRStatus status = CR_OK;
 
         CRPropList *props = NULL;
 
-        g_return_val_if_fail (a_this && a_cascade
+        g_return_val_if_fail (a_this && a_ctxt && a_cascade
                               && a_node && a_style, CR_BAD_PARAM_ERROR);
 
-        status = cr_sel_eng_get_matched_properties_from_cascade
-                (a_this, a_cascade, a_node, &props);
+        status = cr_sel_eng_get_matched_properties_from_cascade_in_context
+                (a_this, a_ctxt, a_cascade, a_node, &props);
 
         g_return_val_if_fail (status == CR_OK, status);
         if (props) {
@@ -1552,6 +3084,445 @@ cr_sel_eng_get_matched_style (CRSelEng * a_this,
         return CR_OK;
 }
 
+enum CRStatus
+cr_sel_eng_get_matched_style (CRSelEng * a_this,
+                              CRCascade * a_cascade,
+                              CRXMLNodePtr a_node,
+                              CRStyle * a_parent_style, 
+                              CRStyle ** a_style,
+                              gboolean a_set_props_to_initial_values)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        return cr_sel_eng_get_matched_style_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_cascade, a_node,
+                 a_parent_style, a_style, a_set_props_to_initial_values);
+}
+
+/**
+ * cr_sel_eng_push_element_in_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context the walk is made in.
+ *@a_node: the element the caller is descending into.
+ *
+ *Like cr_sel_eng_push_element(), for the walks made
+ *with a match context of their own.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_push_element_in_context (CRSelEng * a_this,
+                                    CRSelMatchContext * a_ctxt,
+                                    CRXMLNodePtr a_node)
+{
+        struct CRAncestorEntry entry = { NULL, 0 };
+        CRNodeIface const *iface = NULL;
+        GArray *ancestors = NULL;
+        CRXMLNodePtr parent = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_ctxt && a_node,
+                              CR_BAD_PARAM_ERROR);
+
+        iface = PRIVATE (a_this)->node_iface;
+        g_return_val_if_fail (iface->is_element (a_node),
+                              CR_BAD_PARAM_ERROR);
+
+        if (!a_ctxt->ancestor_filter) {
+                a_ctxt->ancestor_filter =
+                        g_try_malloc (ANCESTOR_FILTER_SIZE);
+                if (!a_ctxt->ancestor_filter) {
+                        cr_utils_trace_info ("Out of memory");
+                        return CR_OUT_OF_MEMORY_ERROR;
+                }
+                memset (a_ctxt->ancestor_filter, 0, ANCESTOR_FILTER_SIZE);
+                a_ctxt->ancestors = g_array_new
+                        (FALSE, FALSE, sizeof (struct CRAncestorEntry));
+                a_ctxt->ancestor_hashes = g_array_new
+                        (FALSE, FALSE, sizeof (guint32));
+        }
+        ancestors = a_ctxt->ancestors;
+        parent = iface->get_parent_element (a_node);
+
+        entry.node = a_node;
+        entry.first_hash = a_ctxt->ancestor_hashes->len;
+        if (ancestors->len) {
+                if (g_array_index (ancestors, struct CRAncestorEntry,
+                                   ancestors->len - 1).node != parent) {
+                        cr_utils_trace_info ("Node is not a child of "
+                                             "the last element pushed");
+                        return CR_BAD_PARAM_ERROR;
+                }
+        } else {
+                for (; parent; parent = iface->get_parent_element (parent))
+                        ancestor_filter_add_node (a_ctxt, iface, parent);
+        }
+        ancestor_filter_add_node (a_ctxt, iface, a_node);
+        g_array_append_val (ancestors, entry);
+
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_push_element:
+ *@a_this: the current instance of the selection engine.
+ *@a_node: the element the caller is descending into.
+ *
+ *Tells the selection engine that the caller is about to
+ *look up the styles of the children of @a_node.
+ *Callers that walk the document from the top down should push
+ *each element before walking its children, and pop it with
+ *cr_sel_eng_pop_element() afterwards. As long as they do so, the
+ *engine knows the ids, classes and names of the ancestors of the
+ *nodes they ask about, and rejects the descendant and child
+ *selectors that require an ancestor none of them matches without
+ *walking up the tree.
+ *If @a_node is the first element pushed, its own ancestors are
+ *taken into account as well, so the walk may start anywhere in
+ *the document.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ *In particular, CR_BAD_PARAM_ERROR is returned if @a_node is not
+ *a child of the last element pushed.
+ */
+enum CRStatus
+cr_sel_eng_push_element (CRSelEng * a_this, CRXMLNodePtr a_node)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        return cr_sel_eng_push_element_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_node);
+}
+
+/**
+ * cr_sel_eng_pop_element_in_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_ctxt: the match context the walk is made in.
+ *@a_node: the element the caller is done with. It must be the
+ *last element pushed with cr_sel_eng_push_element_in_context().
+ *
+ *Like cr_sel_eng_pop_element(), for the walks made
+ *with a match context of their own.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_pop_element_in_context (CRSelEng * a_this,
+                                   CRSelMatchContext * a_ctxt,
+                                   CRXMLNodePtr a_node)
+{
+        GArray *ancestors = NULL,
+                *hashes = NULL;
+        struct CRAncestorEntry *top = NULL;
+        guint i = 0;
+
+        g_return_val_if_fail (a_this && a_ctxt && a_node,
+                              CR_BAD_PARAM_ERROR);
+
+        ancestors = a_ctxt->ancestors;
+        hashes = a_ctxt->ancestor_hashes;
+        if (!ancestors || !ancestors->len)
+                return CR_BAD_PARAM_ERROR;
+        top = &g_array_index (ancestors, struct CRAncestorEntry,
+                              ancestors->len - 1);
+        if (top->node != a_node)
+                return CR_BAD_PARAM_ERROR;
+
+        for (i = top->first_hash; i < hashes->len; i++)
+                ancestor_filter_remove
+                        (a_ctxt, g_array_index (hashes, guint32, i));
+        g_array_set_size (hashes, top->first_hash);
+        g_array_set_size (ancestors, ancestors->len - 1);
+
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_pop_element:
+ *@a_this: the current instance of the selection engine.
+ *@a_node: the element the caller is done with. It must be the
+ *last element pushed with cr_sel_eng_push_element().
+ *
+ *Tells the selection engine that the caller is done with the
+ *children of @a_node.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_pop_element (CRSelEng * a_this, CRXMLNodePtr a_node)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        return cr_sel_eng_pop_element_in_context
+                (a_this, PRIVATE (a_this)->ctxt, a_node);
+}
+
+/**
+ * cr_sel_eng_set_style_sharing:
+ *@a_this: the current instance of the selection engine.
+ *@a_share_styles: whether cr_sel_eng_style_document() shares
+ *styles between elements.
+ *
+ *Lets cr_sel_eng_style_document() give an element the style of
+ *a recently styled sibling or cousin instead of computing it,
+ *when both elements have the same name, the same class attribute,
+ *no id, and the same parent style, so that the same rulesets
+ *match them. The elements that a ruleset testing attributes,
+ *pseudo classes or siblings may match never share their style.
+ *The styles of the table returned by cr_sel_eng_style_document()
+ *are then shared by reference, which saves the time and memory
+ *of styling long runs of similar elements. Styles are not
+ *shared by default.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_style_sharing (CRSelEng * a_this, gboolean a_share_styles)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->share_styles = a_share_styles;
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_set_media_context:
+ *@a_this: the current instance of the selection engine.
+ *@a_media: the medium to select for, or NULL.
+ *
+ *Sets the medium the engine selects for. Only the rulesets of
+ *the \@media rules that apply to @a_media are then found for the
+ *nodes, with all the rulesets of the stylesheets. The media lists
+ *of the \@media rules are evaluated once per stylesheet and media
+ *type, not once per node: see cr_stylesheet_get_rule_index_for_medium().
+ *Without a media context, which is the default, the rulesets of
+ *all the \@media rules are found.
+ *The refcount of @a_media is increased, and decreased when the
+ *engine is destroyed or given another media context, like the
+ *stylesheets of a #CRCascade: the caller must not destroy it.
+ *The media context must not be changed while the engine is selecting.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_media_context (CRSelEng * a_this, CRMediaContext * a_media)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this),
+                              CR_BAD_PARAM_ERROR);
+
+        if (a_media)
+                cr_media_context_ref (a_media);
+        if (PRIVATE (a_this)->media)
+                cr_media_context_unref (PRIVATE (a_this)->media);
+        PRIVATE (a_this)->media = a_media;
+        PRIVATE (a_this)->medium = a_media
+                ? cr_media_context_get_media_type (a_media) : NULL;
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_get_media_context:
+ *@a_this: the current instance of the selection engine.
+ *
+ *Returns the medium the engine selects for, as set by
+ *cr_sel_eng_set_media_context(), or NULL.
+ */
+CRMediaContext *
+cr_sel_eng_get_media_context (CRSelEng * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
+
+        return PRIVATE (a_this)->media;
+}
+
+/**
+ * cr_sel_eng_set_node_iface:
+ *@a_this: the current instance of the selection engine.
+ *@a_node_iface: the interface to read the nodes with.
+ *
+ *Sets the interface the engine reads the nodes of the documents
+ *it styles with, so that documents that are not libxml2 trees can be
+ *styled as they are: the nodes given to the engine, and to its
+ *pseudo class selector handlers, are then the ones of that document.
+ *The engine reads libxml2 nodes, see cr_libxml_node_iface_get(),
+ *until it is given another interface. The interface is not copied
+ *and must outlive the engine. It must not be changed while the
+ *engine is selecting.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_set_node_iface (CRSelEng * a_this,
+                           CRNodeIface const * a_node_iface)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_node_iface,
+                              CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->node_iface = a_node_iface;
+        return CR_OK;
+}
+
+/**
+ * cr_sel_eng_get_node_iface:
+ *@a_this: the current instance of the selection engine.
+ *
+ *Returns the interface the engine reads the nodes with,
+ *as set by cr_sel_eng_set_node_iface().
+ */
+CRNodeIface const *
+cr_sel_eng_get_node_iface (CRSelEng * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), NULL);
+
+        return PRIVATE (a_this)->node_iface;
+}
+
+/**
+ * cr_sel_eng_style_document:
+ *@a_this: the current instance of the selection engine.
+ *@a_cascade: the cascade to get the styles from.
+ *@a_root: the element whose subtree is styled, or a node
+ *that is not an element, like the document, whose first
+ *child element is styled.
+ *@a_parent_style: the style the properties of @a_root
+ *inherit from, or NULL if @a_root gets the initial values.
+ *@a_nb_threads: the number of threads to style the subtree
+ *with, the calling thread included.
+ *@a_styles: out parameter. A hash table of the styles of
+ *the elements of the subtree, keyed by element. Each style
+ *has its inherited properties resolved and points to the one
+ *of the parent element. Elements may share a style, see
+ *cr_sel_eng_set_style_sharing(). The table holds a reference
+ *to the styles and must be destroyed with g_hash_table_destroy().
+ *
+ *Computes the style of each element of a subtree. The subtrees of
+ *the elements are spread over @a_nb_threads workers, each with a
+ *#CRSelMatchContext of its own. A worker queues a few subtrees
+ *while it styles the others itself, and steals the queued subtrees
+ *of the others when it runs out of work. So the pseudo class
+ *selector handlers registered in @a_this must be thread safe if
+ *@a_nb_threads is greater than one.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_sel_eng_style_document (CRSelEng * a_this,
+                           CRCascade * a_cascade,
+                           CRXMLNodePtr a_root,
+                           CRStyle * a_parent_style,
+                           guint a_nb_threads,
+                           GHashTable ** a_styles)
+{
+        StylingJob job;
+        StylingTask *task = NULL;
+        GThreadPool *pool = NULL;
+        GHashTable *result = NULL;
+        GPtrArray *styled = NULL;
+        enum CRStatus status = CR_OK;
+        guint i = 0,
+                j = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && a_cascade && a_root && a_styles,
+                              CR_BAD_PARAM_ERROR);
+
+        if (!PRIVATE (a_this)->node_iface->is_element (a_root))
+                a_root = PRIVATE (a_this)->node_iface->get_first_child_element
+                        (a_root);
+        g_return_val_if_fail (a_root, CR_BAD_PARAM_ERROR);
+
+        memset (&job, 0, sizeof (StylingJob));
+        job.sel_eng = a_this;
+        job.iface = PRIVATE (a_this)->node_iface;
+        job.cascade = a_cascade;
+        job.nb_workers = MAX (a_nb_threads, 1);
+        job.status = CR_OK;
+        g_mutex_init (&job.lock);
+        g_cond_init (&job.cond);
+        job.workers = g_try_malloc (job.nb_workers * sizeof (StylingWorker));
+        task = g_try_malloc (sizeof (StylingTask));
+        if (!job.workers || !task) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (job.workers);
+                g_free (task);
+                g_cond_clear (&job.cond);
+                g_mutex_clear (&job.lock);
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        memset (job.workers, 0, job.nb_workers * sizeof (StylingWorker));
+        for (i = 0; i < job.nb_workers; i++) {
+                job.workers[i].job = &job;
+                g_mutex_init (&job.workers[i].lock);
+                job.workers[i].tasks = g_queue_new ();
+                job.workers[i].styled = g_ptr_array_new ();
+                job.workers[i].ctxt = cr_sel_match_context_new ();
+                if (!job.workers[i].ctxt)
+                        status = CR_OUT_OF_MEMORY_ERROR;
+        }
+        if (status != CR_OK) {
+                g_free (task);
+                goto cleanup;
+        }
+
+        task->node = a_root;
+        task->parent_style = a_parent_style;
+        job.nb_pending = 1;
+        job.nb_queued = 1;
+        g_queue_push_tail (job.workers[0].tasks, task);
+        task = NULL;
+
+        /*
+         *the calling thread is the first worker,
+         *the pool runs the others.
+         */
+        if (job.nb_workers > 1)
+                pool = g_thread_pool_new (run_styling_worker, NULL,
+                                          job.nb_workers - 1, FALSE, NULL);
+        for (i = 1; pool && i < job.nb_workers; i++)
+                g_thread_pool_push (pool, &job.workers[i], NULL);
+        run_styling_worker (&job.workers[0], NULL);
+        if (pool)
+                g_thread_pool_free (pool, FALSE, TRUE);
+        status = job.status;
+
+        if (status == CR_OK) {
+                result = g_hash_table_new_full (g_direct_hash,
+                                                g_direct_equal,
+                                                NULL, unref_style);
+                for (i = 0; i < job.nb_workers; i++) {
+                        styled = job.workers[i].styled;
+                        for (j = 0; j + 1 < styled->len; j += 2)
+                                g_hash_table_insert
+                                        (result,
+                                         g_ptr_array_index (styled, j),
+                                         g_ptr_array_index (styled, j + 1));
+                        g_ptr_array_set_size (styled, 0);
+                }
+                *a_styles = result;
+        }
+
+ cleanup:
+        for (i = 0; i < job.nb_workers; i++) {
+                styled = job.workers[i].styled;
+                for (j = 0; j + 1 < styled->len; j += 2)
+                        cr_style_unref (g_ptr_array_index (styled, j + 1));
+                g_ptr_array_free (styled, TRUE);
+                while ((task = g_queue_pop_head (job.workers[i].tasks)))
+                        g_free (task);
+                g_queue_free (job.workers[i].tasks);
+                g_mutex_clear (&job.workers[i].lock);
+                if (job.workers[i].ctxt)
+                        cr_sel_match_context_destroy (job.workers[i].ctxt);
+        }
+        g_free (job.workers);
+        g_cond_clear (&job.cond);
+        g_mutex_clear (&job.lock);
+        return status;
+}
+
 /**
  * cr_sel_eng_destroy:
  *@a_this: the current instance of the selection engine.
@@ -1570,6 +3541,14 @@ cr_sel_eng_destroy (CRSelEng * a_this)
                         (a_this) ;
                 PRIVATE (a_this)->pcs_handlers = NULL ;
         }
+        if (PRIVATE (a_this)->ctxt) {
+                cr_sel_match_context_destroy (PRIVATE (a_this)->ctxt);
+                PRIVATE (a_this)->ctxt = NULL;
+        }
+        if (PRIVATE (a_this)->media) {
+                cr_media_context_unref (PRIVATE (a_this)->media);
+                PRIVATE (a_this)->media = NULL;
+        }
         g_free (PRIVATE (a_this));
         PRIVATE (a_this) = NULL;
  end:
@@ -1577,3 +3556,94 @@ cr_sel_eng_destroy (CRSelEng * a_this)
                 g_free (a_this);
         }
 }
+
+/**
+ * cr_sel_match_context_new:
+ *
+ *Creates a new match context, the scratch state of the
+ *selections made by a #CRSelEng. A match context can be used
+ *with any selection engine, but by one thread at a time: threads
+ *that share a selection engine each need a context of their own.
+ *
+ *Returns the newly built instance of #CRSelMatchContext, or
+ *NULL if an error occurs.
+ */
+CRSelMatchContext *
+cr_sel_match_context_new (void)
+{
+        CRSelMatchContext *result = NULL;
+
+        result = g_try_malloc (sizeof (CRSelMatchContext));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRSelMatchContext));
+        result->candidates = g_ptr_array_new ();
+        result->matched_entries = g_hash_table_new (g_direct_hash,
+                                                    g_direct_equal);
+        result->cascade_items = g_array_new
+                (FALSE, FALSE, sizeof (struct CRCascadeItem));
+        result->cascaded_props = g_hash_table_new (g_str_hash,
+                                                   g_str_equal);
+        result->winners = g_ptr_array_new ();
+        result->snapshots = g_hash_table_new (g_direct_hash,
+                                              g_direct_equal);
+        result->snapshot_pool = g_ptr_array_new_with_free_func
+                (node_snapshot_destroy);
+        return result;
+}
+
+/**
+ * cr_sel_match_context_destroy:
+ *@a_this: the current instance of #CRSelMatchContext.
+ *
+ *The destructor of #CRSelMatchContext.
+ */
+void
+cr_sel_match_context_destroy (CRSelMatchContext * a_this)
+{
+        g_return_if_fail (a_this);
+
+        if (a_this->candidates) {
+                g_ptr_array_free (a_this->candidates, TRUE);
+                a_this->candidates = NULL;
+        }
+        if (a_this->matched_entries) {
+                g_hash_table_destroy (a_this->matched_entries);
+                a_this->matched_entries = NULL;
+        }
+        if (a_this->cascade_items) {
+                g_array_free (a_this->cascade_items, TRUE);
+                a_this->cascade_items = NULL;
+        }
+        if (a_this->cascaded_props) {
+                g_hash_table_destroy (a_this->cascaded_props);
+                a_this->cascaded_props = NULL;
+        }
+        if (a_this->winners) {
+                g_ptr_array_free (a_this->winners, TRUE);
+                a_this->winners = NULL;
+        }
+        if (a_this->ancestor_filter) {
+                g_free (a_this->ancestor_filter);
+                a_this->ancestor_filter = NULL;
+        }
+        if (a_this->ancestors) {
+                g_array_free (a_this->ancestors, TRUE);
+                a_this->ancestors = NULL;
+        }
+        if (a_this->ancestor_hashes) {
+                g_array_free (a_this->ancestor_hashes, TRUE);
+                a_this->ancestor_hashes = NULL;
+        }
+        if (a_this->snapshots) {
+                g_hash_table_destroy (a_this->snapshots);
+                a_this->snapshots = NULL;
+        }
+        if (a_this->snapshot_pool) {
+                g_ptr_array_free (a_this->snapshot_pool, TRUE);
+                a_this->snapshot_pool = NULL;
+        }
+        g_free (a_this);
+}
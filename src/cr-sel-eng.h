@@ -29,6 +29,9 @@
 #include "cr-cascade.h"
 #include "cr-style.h"
 #include "cr-prop-list.h"
+#include "cr-media-context.h"
+#include "cr-node-iface.h"
+#include "cr-libxml-node-iface.h"
 
 #include <libxml/tree.h>
 
@@ -44,12 +47,22 @@ G_BEGIN_DECLS
 typedef struct _CRSelEng CRSelEng ;
 typedef struct _CRSelEngPriv CRSelEngPriv ;
 
+/**
+ *The scratch state of the selections made by a #CRSelEng:
+ *where an incremental lookup of rulesets stands, and the
+ *ancestors of the elements pushed during a walk of the document.
+ *A match context is used by one thread at a time.
+ */
+typedef struct _CRSelMatchContext CRSelMatchContext ;
+
 /**
  *The Selection engine class.
  *The main service provided by this class, is
  *the ability to interpret a libcroco implementation
  *of css2 selectors, and given an xml node, say if
  *the selector matches the node or not.
+ *The nodes are read through a #CRNodeIface, libxml2 ones
+ *by default, see cr_sel_eng_set_node_iface().
  */
 struct _CRSelEng
 {
@@ -60,6 +73,36 @@ struct _CRSelEng
 typedef gboolean (*CRPseudoClassSelectorHandler) (CRSelEng* a_this,
                                                   CRAdditionalSel *a_add_sel,
                                                   xmlNode *a_node) ;
+
+/**
+ *A pseudo class handler that is given the nodes of any
+ *#CRNodeIface, see cr_sel_eng_register_node_pseudo_class_sel_handler().
+ */
+typedef gboolean (*CRNodePseudoClassSelectorHandler) (CRSelEng* a_this,
+                                                      CRAdditionalSel *a_add_sel,
+                                                      CRXMLNodePtr a_node) ;
+
+/**
+ *What cr_sel_eng_query_all() does once its handler
+ *has been given an element.
+ */
+enum CRSelQueryAction {
+        /**Goes on with the descendants of the element.*/
+        CR_SEL_QUERY_CONTINUE,
+        /**Goes on, skipping the descendants of the element.*/
+        CR_SEL_QUERY_SKIP_CHILDREN,
+        /**Stops the query.*/
+        CR_SEL_QUERY_STOP
+} ;
+
+/**
+ *The function cr_sel_eng_query_all() gives the
+ *elements that match its selector to.
+ */
+typedef enum CRSelQueryAction (*CRSelQueryHandler) (CRSelEng *a_this,
+                                                    CRXMLNodePtr a_node,
+                                                    gpointer a_user_data) ;
+
 CRSelEng * cr_sel_eng_new (void) ;
 
 enum CRStatus cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng *a_this,
@@ -67,6 +110,11 @@ enum CRStatus cr_sel_eng_register_pseudo_class_sel_handler (CRSelEng *a_this,
                                                             enum CRPseudoType a_pseudo_class_type,
                                                             CRPseudoClassSelectorHandler a_handler) ;
 
+enum CRStatus cr_sel_eng_register_node_pseudo_class_sel_handler (CRSelEng *a_this,
+                                                                 guchar *a_pseudo_class_sel_name,
+                                                                 enum CRPseudoType a_pseudo_class_type,
+                                                                 CRNodePseudoClassSelectorHandler a_handler) ;
+
 enum CRStatus cr_sel_eng_unregister_pseudo_class_sel_handler (CRSelEng *a_this,
                                                               guchar *a_pseudo_class_sel_name,
                                                               enum CRPseudoType a_pseudo_class_type) ;
@@ -78,32 +126,112 @@ enum CRStatus cr_sel_eng_get_pseudo_class_selector_handler (CRSelEng *a_this,
                                                             enum CRPseudoType a_pseudo_class_type,
                                                             CRPseudoClassSelectorHandler *a_handler) ;
 
+enum CRStatus cr_sel_eng_get_node_pseudo_class_selector_handler (CRSelEng *a_this,
+                                                                 guchar *a_pseudo_class_sel_name,
+                                                                 enum CRPseudoType a_pseudo_class_type,
+                                                                 CRNodePseudoClassSelectorHandler *a_handler) ;
+
 enum CRStatus cr_sel_eng_matches_node (CRSelEng *a_this, 
                                        CRSimpleSel *a_sel,
-                                       xmlNode *a_node, 
+                                       CRXMLNodePtr a_node, 
                                        gboolean *a_result) ;
 
+enum CRStatus cr_sel_eng_query_all (CRSelEng *a_this,
+                                    CRXMLNodePtr a_root,
+                                    CRSelector *a_sel,
+                                    CRSelQueryHandler a_handler,
+                                    gpointer a_user_data) ;
+
+enum CRStatus cr_sel_eng_query_all_in_context (CRSelEng *a_this,
+                                               CRSelMatchContext *a_ctxt,
+                                               CRXMLNodePtr a_root,
+                                               CRSelector *a_sel,
+                                               CRSelQueryHandler a_handler,
+                                               gpointer a_user_data) ;
+
 enum CRStatus cr_sel_eng_get_matched_rulesets (CRSelEng *a_this,
                                                CRStyleSheet *a_sheet,
-                                               xmlNode *a_node,
+                                               CRXMLNodePtr a_node,
                                                CRStatement ***a_rulesets,
                                                gulong *a_len) ;
 
 enum CRStatus
 cr_sel_eng_get_matched_properties_from_cascade  (CRSelEng *a_this,
                                                  CRCascade *a_cascade,
-                                                 xmlNode *a_node,
+                                                 CRXMLNodePtr a_node,
                                                  CRPropList **a_props) ;
 
 enum CRStatus cr_sel_eng_get_matched_style (CRSelEng *a_this,
                                             CRCascade *a_cascade,
-                                            xmlNode *a_node,
+                                            CRXMLNodePtr a_node,
                                             CRStyle *a_parent_style,
                                             CRStyle **a_style,
                                             gboolean a_set_props_to_initial_values) ;
 
+enum CRStatus cr_sel_eng_push_element (CRSelEng *a_this,
+                                       CRXMLNodePtr a_node) ;
+
+enum CRStatus cr_sel_eng_pop_element (CRSelEng *a_this,
+                                      CRXMLNodePtr a_node) ;
+
+enum CRStatus
+cr_sel_eng_get_matched_rulesets_in_context (CRSelEng *a_this,
+                                            CRSelMatchContext *a_ctxt,
+                                            CRStyleSheet *a_sheet,
+                                            CRXMLNodePtr a_node,
+                                            CRStatement ***a_rulesets,
+                                            gulong *a_len) ;
+
+enum CRStatus
+cr_sel_eng_get_matched_properties_from_cascade_in_context (CRSelEng *a_this,
+                                                           CRSelMatchContext *a_ctxt,
+                                                           CRCascade *a_cascade,
+                                                           CRXMLNodePtr a_node,
+                                                           CRPropList **a_props) ;
+
+enum CRStatus
+cr_sel_eng_get_matched_style_in_context (CRSelEng *a_this,
+                                         CRSelMatchContext *a_ctxt,
+                                         CRCascade *a_cascade,
+                                         CRXMLNodePtr a_node,
+                                         CRStyle *a_parent_style,
+                                         CRStyle **a_style,
+                                         gboolean a_set_props_to_initial_values) ;
+
+enum CRStatus cr_sel_eng_push_element_in_context (CRSelEng *a_this,
+                                                  CRSelMatchContext *a_ctxt,
+                                                  CRXMLNodePtr a_node) ;
+
+enum CRStatus cr_sel_eng_pop_element_in_context (CRSelEng *a_this,
+                                                 CRSelMatchContext *a_ctxt,
+                                                 CRXMLNodePtr a_node) ;
+
+enum CRStatus cr_sel_eng_set_style_sharing (CRSelEng *a_this,
+                                            gboolean a_share_styles) ;
+
+enum CRStatus cr_sel_eng_set_media_context (CRSelEng *a_this,
+                                            CRMediaContext *a_media) ;
+
+CRMediaContext * cr_sel_eng_get_media_context (CRSelEng *a_this) ;
+
+enum CRStatus cr_sel_eng_set_node_iface (CRSelEng *a_this,
+                                         CRNodeIface const *a_node_iface) ;
+
+CRNodeIface const * cr_sel_eng_get_node_iface (CRSelEng *a_this) ;
+
+enum CRStatus cr_sel_eng_style_document (CRSelEng *a_this,
+                                         CRCascade *a_cascade,
+                                         CRXMLNodePtr a_root,
+                                         CRStyle *a_parent_style,
+                                         guint a_nb_threads,
+                                         GHashTable **a_styles) ;
+
 void cr_sel_eng_destroy (CRSelEng *a_this) ;
 
+CRSelMatchContext * cr_sel_match_context_new (void) ;
+
+void cr_sel_match_context_destroy (CRSelMatchContext *a_this) ;
+
 G_END_DECLS
 
 
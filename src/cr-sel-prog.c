@@ -0,0 +1,366 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#include <string.h>
+#include "cr-sel-prog.h"
+#include "cr-rule-index.h"
+
+/**
+ *@CRSelInstr:
+ *
+ *The compilation of selectors into selector programs.
+ *A program is a flat array of instructions, so matching a
+ *selector doesn't have to walk its simple and additional
+ *selector lists, nor to look its strings up, every time.
+ */
+
+static void
+emit (GArray * a_prog, enum CRSelOpcode a_op, const gchar * a_str,
+      guint a_len, gpointer a_data)
+{
+        CRSelInstr instr;
+
+        instr.op = a_op;
+        instr.str = a_str;
+        instr.len = a_len;
+        instr.hash = 0;
+        instr.data = a_data;
+        g_array_append_val (a_prog, instr);
+}
+
+static gboolean
+string_is_set (CRString const * a_str)
+{
+        return a_str && a_str->stryng && a_str->stryng->str;
+}
+
+/**
+ *Compiles the checks of one simple selector on a node.
+ *The additional selectors are checked from the last one
+ *backward, up to the first pseudo class: the result of the
+ *pseudo class is the result of the whole simple selector.
+ *@return FALSE if the simple selector can't match any node.
+ */
+static gboolean
+compile_simple_sel (GArray * a_prog, CRSimpleSel const * a_sel)
+{
+        CRAdditionalSel *add_sel = NULL;
+        CRAttrSel *attr_sel = NULL;
+        CRPseudo *pseudo = NULL;
+
+        if (!(a_sel->type_mask & UNIVERSAL_SELECTOR)) {
+                if (a_sel->type_mask & TYPE_SELECTOR) {
+                        if (!string_is_set (a_sel->name))
+                                return FALSE;
+                        emit (a_prog, CR_SEL_OP_ELEMENT,
+                              a_sel->name->stryng->str,
+                              a_sel->name->stryng->len, NULL);
+                } else if (!a_sel->add_sel) {
+                        return FALSE;
+                }
+        }
+        if (!a_sel->add_sel)
+                return TRUE;
+
+        for (add_sel = a_sel->add_sel; add_sel->next;
+             add_sel = add_sel->next) ;
+        for (; add_sel; add_sel = add_sel->prev) {
+                switch (add_sel->type) {
+                case NO_ADD_SELECTOR:
+                        return FALSE;
+                case CLASS_ADD_SELECTOR:
+                        if (!string_is_set (add_sel->content.class_name))
+                                break;
+                        emit (a_prog, CR_SEL_OP_CLASS,
+                              add_sel->content.class_name->stryng->str,
+                              add_sel->content.class_name->stryng->len,
+                              NULL);
+                        g_array_index (a_prog, CRSelInstr,
+                                       a_prog->len - 1).hash =
+                                cr_rule_index_hash_key
+                                (CR_RULE_INDEX_KEY_CLASS,
+                                 add_sel->content.class_name->stryng->str,
+                                 add_sel->content.class_name->stryng->len);
+                        break;
+                case ID_ADD_SELECTOR:
+                        if (string_is_set (add_sel->content.id_name))
+                                emit (a_prog, CR_SEL_OP_ID,
+                                      add_sel->content.id_name->stryng->str,
+                                      add_sel->content.id_name->stryng->len,
+                                      NULL);
+                        break;
+                case ATTRIBUTE_ADD_SELECTOR:
+                        for (attr_sel = add_sel->content.attr_sel;
+                             attr_sel; attr_sel = attr_sel->next) {
+                                if (!string_is_set (attr_sel->name)
+                                    || (attr_sel->match_way != SET
+                                        && !string_is_set
+                                        (attr_sel->value)))
+                                        return FALSE;
+                                emit (a_prog, CR_SEL_OP_ATTR,
+                                      attr_sel->name->stryng->str,
+                                      attr_sel->name->stryng->len,
+                                      attr_sel);
+                        }
+                        break;
+                case PSEUDO_CLASS_ADD_SELECTOR:
+                        pseudo = add_sel->content.pseudo;
+                        if (!pseudo)
+                                break;
+                        if (!string_is_set (pseudo->name))
+                                return FALSE;
+                        emit (a_prog, CR_SEL_OP_PSEUDO_CLASS,
+                              cr_atom_from_string (pseudo->name->stryng->str),
+                              pseudo->type, add_sel);
+                        return TRUE;
+                default:
+                        break;
+                }
+        }
+        return TRUE;
+}
+
+/**
+ * cr_sel_prog_new:
+ *@a_sel: the selector to compile, a list of simple selectors.
+ *
+ *Compiles a selector into a selector program, that the
+ *selection engine runs to match the selector against a node.
+ *Compiling doesn't modify the selector. The program borrows
+ *parts of the selector, so it must not outlive it.
+ *
+ *Returns the program, to be freed with cr_sel_prog_destroy(),
+ *or NULL if an error occurs.
+ */
+CRSelInstr *
+cr_sel_prog_new (CRSimpleSel const * a_sel)
+{
+        GArray *prog = NULL;
+        CRSimpleSel const *cur = NULL;
+        gboolean can_match = TRUE;
+
+        g_return_val_if_fail (a_sel, NULL);
+
+        prog = g_array_sized_new (FALSE, FALSE, sizeof (CRSelInstr), 8);
+        if (!prog) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+
+        for (cur = a_sel; cur->next; cur = cur->next) ;
+        for (; cur && can_match == TRUE; cur = cur->prev) {
+                can_match = compile_simple_sel (prog, cur);
+                if (can_match == FALSE || !cur->prev)
+                        break;
+                switch (cur->combinator) {
+                case NO_COMBINATOR:
+                        break;
+                case COMB_WS:
+                        emit (prog, CR_SEL_OP_ANCESTOR, NULL, 0, NULL);
+                        break;
+                case COMB_PLUS:
+                        emit (prog, CR_SEL_OP_PREV_SIBLING, NULL, 0, NULL);
+                        break;
+                case COMB_GT:
+                        emit (prog, CR_SEL_OP_PARENT, NULL, 0, NULL);
+                        break;
+                default:
+                        can_match = FALSE;
+                        break;
+                }
+        }
+        if (can_match == TRUE)
+                emit (prog, CR_SEL_OP_MATCH, NULL, 0, NULL);
+        else
+                emit (prog, CR_SEL_OP_FAIL, NULL, 0, NULL);
+
+        return (CRSelInstr *) g_array_free (prog, FALSE);
+}
+
+/**
+ * cr_sel_prog_only_tests_names:
+ *@a_this: the selector program.
+ *
+ *Says if a selector program only tests the element names, the
+ *ids and the classes of the node it is run on and of the ancestors
+ *of the node. Such a program gives the same result on two nodes
+ *that are alike in these respects, and whose ancestors are too.
+ *
+ *Returns TRUE if the program tests no attribute, no pseudo
+ *class and no sibling, FALSE otherwise.
+ */
+gboolean
+cr_sel_prog_only_tests_names (CRSelInstr const * a_this)
+{
+        CRSelInstr const *cur = NULL;
+
+        g_return_val_if_fail (a_this, FALSE);
+
+        for (cur = a_this;; cur++) {
+                switch (cur->op) {
+                case CR_SEL_OP_MATCH:
+                case CR_SEL_OP_FAIL:
+                        return TRUE;
+                case CR_SEL_OP_ELEMENT:
+                case CR_SEL_OP_ID:
+                case CR_SEL_OP_CLASS:
+                case CR_SEL_OP_PARENT:
+                case CR_SEL_OP_ANCESTOR:
+                        break;
+                default:
+                        return FALSE;
+                }
+        }
+}
+
+/**
+ * cr_sel_prog_get_sibling_reach:
+ *@a_this: the selector program.
+ *
+ *Says how far back among the previous siblings of an element
+ *a selector program may look: the length of its longest run of
+ *'+' combinators. The walks up to the parent or the ancestors
+ *start the count again, from the siblings of these elements.
+ *
+ *Returns the number of previous siblings the program may
+ *need, 0 if it tests no sibling.
+ */
+guint
+cr_sel_prog_get_sibling_reach (CRSelInstr const * a_this)
+{
+        CRSelInstr const *cur = NULL;
+        guint run = 0,
+                result = 0;
+
+        g_return_val_if_fail (a_this, 0);
+
+        for (cur = a_this;; cur++) {
+                switch (cur->op) {
+                case CR_SEL_OP_MATCH:
+                case CR_SEL_OP_FAIL:
+                        return result;
+                case CR_SEL_OP_PREV_SIBLING:
+                        if (++run > result)
+                                result = run;
+                        break;
+                case CR_SEL_OP_PARENT:
+                case CR_SEL_OP_ANCESTOR:
+                        run = 0;
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+/**
+ * cr_sel_prog_to_string:
+ *@a_this: the selector program.
+ *
+ *Serializes a selector program, one instruction
+ *after the other, for debugging purposes.
+ *
+ *Returns the serialized program, to be freed with g_free().
+ */
+gchar *
+cr_sel_prog_to_string (CRSelInstr const * a_this)
+{
+        GString *str = NULL;
+        CRSelInstr const *cur = NULL;
+        CRAttrSel *attr_sel = NULL;
+        const gchar *op = NULL;
+
+        g_return_val_if_fail (a_this, NULL);
+
+        str = g_string_new (NULL);
+        for (cur = a_this;; cur++) {
+                if (cur != a_this)
+                        g_string_append (str, "; ");
+                switch (cur->op) {
+                case CR_SEL_OP_MATCH:
+                        g_string_append (str, "match");
+                        return g_string_free (str, FALSE);
+                case CR_SEL_OP_FAIL:
+                        g_string_append (str, "fail");
+                        return g_string_free (str, FALSE);
+                case CR_SEL_OP_ELEMENT:
+                        g_string_append_printf (str, "element %s", cur->str);
+                        break;
+                case CR_SEL_OP_ID:
+                        g_string_append_printf (str, "id %s", cur->str);
+                        break;
+                case CR_SEL_OP_CLASS:
+                        g_string_append_printf (str, "class %s", cur->str);
+                        break;
+                case CR_SEL_OP_ATTR:
+                        attr_sel = cur->data;
+                        g_string_append_printf (str, "attr %s", cur->str);
+                        switch (attr_sel->match_way) {
+                        case EQUALS:
+                                op = "=";
+                                break;
+                        case INCLUDES:
+                                op = "~=";
+                                break;
+                        case DASHMATCH:
+                                op = "|=";
+                                break;
+                        default:
+                                op = NULL;
+                                break;
+                        }
+                        if (op && string_is_set (attr_sel->value))
+                                g_string_append_printf
+                                        (str, " %s \"%s\"", op,
+                                         attr_sel->value->stryng->str);
+                        break;
+                case CR_SEL_OP_PSEUDO_CLASS:
+                        g_string_append_printf (str, "pseudo-class %s",
+                                                cur->str);
+                        break;
+                case CR_SEL_OP_PARENT:
+                        g_string_append (str, "parent");
+                        break;
+                case CR_SEL_OP_PREV_SIBLING:
+                        g_string_append (str, "prev-sibling");
+                        break;
+                case CR_SEL_OP_ANCESTOR:
+                        g_string_append (str, "ancestor");
+                        break;
+                default:
+                        g_string_append (str, "?");
+                        return g_string_free (str, FALSE);
+                }
+        }
+}
+
+/**
+ * cr_sel_prog_destroy:
+ *@a_this: the selector program to destroy.
+ *
+ *Frees a selector program built by cr_sel_prog_new().
+ */
+void
+cr_sel_prog_destroy (CRSelInstr * a_this)
+{
+        g_free (a_this);
+}
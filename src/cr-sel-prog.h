@@ -0,0 +1,108 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+#ifndef __CR_SEL_PROG_H__
+#define __CR_SEL_PROG_H__
+
+#include "cr-utils.h"
+#include "cr-atom.h"
+#include "cr-simple-sel.h"
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the selector programs, the compiled
+ *form of the selectors the selection engine runs.
+ */
+
+/**
+ *The operations of a selector program.
+ *A program checks the node it is run on from the rightmost
+ *simple selector of the selector to the leftmost one, the
+ *combinator operations moving it to the node the next simple
+ *selector is checked on.
+ */
+enum CRSelOpcode
+{
+        /**The selector matches.*/
+        CR_SEL_OP_MATCH,
+        /**The selector can't match.*/
+        CR_SEL_OP_FAIL,
+        /**The name of the node must be str.*/
+        CR_SEL_OP_ELEMENT,
+        /**The id of the node must be str, of len bytes.*/
+        CR_SEL_OP_ID,
+        /**
+         *One of the classes of the node must be str, of len bytes.
+         *hash is the hash of str, see cr_rule_index_hash_key().
+         */
+        CR_SEL_OP_CLASS,
+        /**The node must match the #CRAttrSel data.*/
+        CR_SEL_OP_ATTR,
+        /**
+         *The handler of the pseudo class named str (an atom) must
+         *accept the node. data is the #CRAdditionalSel of the
+         *pseudo class, and len its #CRPseudoType.
+         */
+        CR_SEL_OP_PSEUDO_CLASS,
+        /**Moves to the parent element ('>' combinator).*/
+        CR_SEL_OP_PARENT,
+        /**Moves to the previous sibling element ('+' combinator).*/
+        CR_SEL_OP_PREV_SIBLING,
+        /**
+         *Runs the rest of the program on each ancestor element,
+         *from the parent up, until it matches (' ' combinator).
+         */
+        CR_SEL_OP_ANCESTOR
+} ;
+
+typedef struct _CRSelInstr CRSelInstr ;
+
+/**
+ *An instruction of a selector program. A program is an array
+ *of instructions that ends with CR_SEL_OP_MATCH or
+ *CR_SEL_OP_FAIL. It borrows the strings, attribute selectors and
+ *additional selectors of the selector it is compiled from.
+ */
+struct _CRSelInstr
+{
+        enum CRSelOpcode op ;
+        guint len ;
+        guint32 hash ;
+        const gchar *str ;
+        gpointer data ;
+} ;
+
+CRSelInstr * cr_sel_prog_new (CRSimpleSel const *a_sel) ;
+
+gboolean cr_sel_prog_only_tests_names (CRSelInstr const *a_this) ;
+
+guint cr_sel_prog_get_sibling_reach (CRSelInstr const *a_this) ;
+
+gchar * cr_sel_prog_to_string (CRSelInstr const *a_this) ;
+
+void cr_sel_prog_destroy (CRSelInstr *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_SEL_PROG_H__*/
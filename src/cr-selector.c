@@ -22,6 +22,7 @@
 
 #include <string.h>
 #include "cr-selector.h"
+#include "cr-arena.h"
 #include "cr-parser.h"
 
 /**
@@ -31,6 +32,9 @@
  *of the current instance of #CRSelector.
  *
  *Creates a new instance of #CRSelector.
+ *The specificity of @a_simple_sel is computed here, once
+ *and for all, so callers that modify the simple selector
+ *afterwards must call cr_simple_sel_compute_specificity() again.
  *
  *Returns the newly built instance of #CRSelector, or
  *NULL in case of failure.
@@ -40,28 +44,75 @@ cr_selector_new (CRSimpleSel * a_simple_sel)
 {
         CRSelector *result = NULL;
 
-        result = g_try_malloc (sizeof (CRSelector));
+        result = cr_arena_node_try_alloc (sizeof (CRSelector));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
         memset (result, 0, sizeof (CRSelector));
         result->simple_sel = a_simple_sel;
+        if (a_simple_sel)
+                cr_simple_sel_compute_specificity (a_simple_sel);
         return result;
 }
 
+/**
+ * cr_selector_parse_from_buf:
+ *@a_char_buf: the buffer to parse, a comma separated list of
+ *selectors, like "p.note > em, h1 + p".
+ *@a_enc: the encoding of @a_char_buf.
+ *
+ *Parses a list of selectors, with the specificity of each of them
+ *computed, so that it can be matched, many times, with
+ *cr_sel_eng_matches_node() or cr_sel_eng_query_all().
+ *
+ *Returns the parsed selector list, to be freed with
+ *cr_selector_unref(), or NULL if @a_char_buf is not a list of
+ *selectors (anything but white spaces and comments after
+ *the list is an error).
+ */
 CRSelector *
 cr_selector_parse_from_buf (const guchar * a_char_buf, enum CREncoding a_enc)
 {
+        enum CRStatus status = CR_OK;
         CRParser *parser = NULL;
+        CRTknzr *tknzr = NULL;
+        CRSelector *result = NULL;
+        guint32 next_char = 0;
+        gulong len = 0;
 
         g_return_val_if_fail (a_char_buf, NULL);
 
-        parser = cr_parser_new_from_buf ((guchar*)a_char_buf, strlen ((const char *) a_char_buf),
+        len = strlen ((const char *) a_char_buf);
+        if (!len)
+                return NULL;
+
+        parser = cr_parser_new_from_buf ((guchar*)a_char_buf, len,
                                          a_enc, FALSE);
         g_return_val_if_fail (parser, NULL);
 
-        return NULL;
+        status = cr_parser_try_to_skip_spaces_and_comments (parser);
+        if (status != CR_OK)
+                goto cleanup;
+        status = cr_parser_parse_selector (parser, &result);
+        if (status != CR_OK || !result)
+                goto cleanup;
+        status = cr_parser_get_tknzr (parser, &tknzr);
+        if (status != CR_OK || !tknzr
+            || cr_tknzr_peek_char (tknzr, &next_char)
+            != CR_END_OF_INPUT_ERROR)
+                status = CR_PARSING_ERROR;
+
+      cleanup:
+        if (parser) {
+                cr_parser_destroy (parser);
+                parser = NULL;
+        }
+        if (status != CR_OK && result) {
+                cr_selector_unref (result);
+                result = NULL;
+        }
+        return result;
 }
 
 /**
@@ -215,7 +266,7 @@ cr_selector_ref (CRSelector * a_this)
 {
         g_return_if_fail (a_this);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
 }
 
 /**
@@ -236,11 +287,8 @@ cr_selector_unref (CRSelector * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count) {
-                a_this->ref_count--;
-        }
-
-        if (a_this->ref_count == 0) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_selector_destroy (a_this);
                 return TRUE;
         }
@@ -282,14 +330,14 @@ cr_selector_destroy (CRSelector * a_this)
 
         /*in case the list has only one element */
         if (cur && !cur->prev) {
-                g_free (cur);
+                cr_arena_node_free (sizeof (CRSelector), cur);
                 return;
         }
 
         /*walk backward the list and free each "next element" */
         for (cur = cur->prev; cur && cur->prev; cur = cur->prev) {
                 if (cur->next) {
-                        g_free (cur->next);
+                        cr_arena_node_free (sizeof (CRSelector), cur->next);
                         cur->next = NULL;
                 }
         }
@@ -298,9 +346,9 @@ cr_selector_destroy (CRSelector * a_this)
                 return;
 
         if (cur->next) {
-                g_free (cur->next);
+                cr_arena_node_free (sizeof (CRSelector), cur->next);
                 cur->next = NULL;
         }
 
-        g_free (cur);
+        cr_arena_node_free (sizeof (CRSelector), cur);
 }
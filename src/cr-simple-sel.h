@@ -95,7 +95,9 @@ struct _CRSimpleSel
 
         /*
          *the specificity as specified by
-         *chapter 6.4.3 of the spec.
+         *chapter 6.4.3 of the spec. Only set on the
+         *first simple selector of the list, by
+         *cr_selector_new().
          */
         gulong specificity ;
 
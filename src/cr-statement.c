@@ -23,6 +23,8 @@
 
 #include <string.h>
 #include "cr-statement.h"
+#include "cr-stylesheet.h"
+#include "cr-arena.h"
 #include "cr-parser.h"
 
 /**
@@ -478,7 +480,8 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.ruleset->decl_list);
                         a_this->kind.ruleset->decl_list = NULL;
                 }
-                g_free (a_this->kind.ruleset);
+                cr_arena_node_free (sizeof (CRRuleSet),
+                                    a_this->kind.ruleset);
                 a_this->kind.ruleset = NULL;
                 break;
 
@@ -490,7 +493,8 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.import_rule->url) ;
                         a_this->kind.import_rule->url = NULL;
                 }
-                g_free (a_this->kind.import_rule);
+                cr_arena_node_free (sizeof (CRAtImportRule),
+                                    a_this->kind.import_rule);
                 a_this->kind.import_rule = NULL;
                 break;
 
@@ -516,7 +520,8 @@ cr_statement_clear (CRStatement * a_this)
                         g_list_free (a_this->kind.media_rule->media_list);
                         a_this->kind.media_rule->media_list = NULL;
                 }
-                g_free (a_this->kind.media_rule);
+                cr_arena_node_free (sizeof (CRAtMediaRule),
+                                    a_this->kind.media_rule);
                 a_this->kind.media_rule = NULL;
                 break;
 
@@ -539,7 +544,8 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.page_rule->pseudo);
                         a_this->kind.page_rule->pseudo = NULL;
                 }
-                g_free (a_this->kind.page_rule);
+                cr_arena_node_free (sizeof (CRAtPageRule),
+                                    a_this->kind.page_rule);
                 a_this->kind.page_rule = NULL;
                 break;
 
@@ -552,7 +558,8 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.charset_rule->charset);
                         a_this->kind.charset_rule->charset = NULL;
                 }
-                g_free (a_this->kind.charset_rule);
+                cr_arena_node_free (sizeof (CRAtCharsetRule),
+                                    a_this->kind.charset_rule);
                 a_this->kind.charset_rule = NULL;
                 break;
 
@@ -565,7 +572,8 @@ cr_statement_clear (CRStatement * a_this)
                                 (a_this->kind.font_face_rule->decl_list);
                         a_this->kind.font_face_rule->decl_list = NULL;
                 }
-                g_free (a_this->kind.font_face_rule);
+                cr_arena_node_free (sizeof (CRAtFontFaceRule),
+                                    a_this->kind.font_face_rule);
                 a_this->kind.font_face_rule = NULL;
                 break;
 
@@ -1133,7 +1141,7 @@ cr_statement_new_ruleset (CRStyleSheet * a_sheet,
                                       NULL);
         }
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1142,12 +1150,12 @@ cr_statement_new_ruleset (CRStyleSheet * a_sheet,
 
         memset (result, 0, sizeof (CRStatement));
         result->type = RULESET_STMT;
-        result->kind.ruleset = g_try_malloc (sizeof (CRRuleSet));
+        result->kind.ruleset = cr_arena_node_try_alloc (sizeof (CRRuleSet));
 
         if (!result->kind.ruleset) {
                 cr_utils_trace_info ("Out of memory");
                 if (result)
-                        g_free (result);
+                        cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
 
@@ -1268,7 +1276,7 @@ cr_statement_new_at_media_rule (CRStyleSheet * a_sheet,
         if (a_rulesets)
                 g_return_val_if_fail (a_rulesets->type == RULESET_STMT, NULL);
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1278,10 +1286,11 @@ cr_statement_new_at_media_rule (CRStyleSheet * a_sheet,
         memset (result, 0, sizeof (CRStatement));
         result->type = AT_MEDIA_RULE_STMT;
 
-        result->kind.media_rule = g_try_malloc (sizeof (CRAtMediaRule));
+        result->kind.media_rule =
+                 cr_arena_node_try_alloc (sizeof (CRAtMediaRule));
         if (!result->kind.media_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
         memset (result->kind.media_rule, 0, sizeof (CRAtMediaRule));
@@ -1327,7 +1336,7 @@ cr_statement_new_at_import_rule (CRStyleSheet * a_container_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1337,11 +1346,12 @@ cr_statement_new_at_import_rule (CRStyleSheet * a_container_sheet,
         memset (result, 0, sizeof (CRStatement));
         result->type = AT_IMPORT_RULE_STMT;
 
-        result->kind.import_rule = g_try_malloc (sizeof (CRAtImportRule));
+        result->kind.import_rule =
+                 cr_arena_node_try_alloc (sizeof (CRAtImportRule));
 
         if (!result->kind.import_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
 
@@ -1450,7 +1460,7 @@ cr_statement_new_at_page_rule (CRStyleSheet * a_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1460,11 +1470,12 @@ cr_statement_new_at_page_rule (CRStyleSheet * a_sheet,
         memset (result, 0, sizeof (CRStatement));
         result->type = AT_PAGE_RULE_STMT;
 
-        result->kind.page_rule = g_try_malloc (sizeof (CRAtPageRule));
+        result->kind.page_rule =
+                 cr_arena_node_try_alloc (sizeof (CRAtPageRule));
 
         if (!result->kind.page_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
 
@@ -1575,7 +1586,7 @@ cr_statement_new_at_charset_rule (CRStyleSheet * a_sheet,
 
         g_return_val_if_fail (a_charset, NULL);
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1585,11 +1596,12 @@ cr_statement_new_at_charset_rule (CRStyleSheet * a_sheet,
         memset (result, 0, sizeof (CRStatement));
         result->type = AT_CHARSET_RULE_STMT;
 
-        result->kind.charset_rule = g_try_malloc (sizeof (CRAtCharsetRule));
+        result->kind.charset_rule =
+                 cr_arena_node_try_alloc (sizeof (CRAtCharsetRule));
 
         if (!result->kind.charset_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
         memset (result->kind.charset_rule, 0, sizeof (CRAtCharsetRule));
@@ -1669,7 +1681,7 @@ cr_statement_new_at_font_face_rule (CRStyleSheet * a_sheet,
 {
         CRStatement *result = NULL;
 
-        result = g_try_malloc (sizeof (CRStatement));
+        result = cr_arena_node_try_alloc (sizeof (CRStatement));
 
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
@@ -1678,12 +1690,12 @@ cr_statement_new_at_font_face_rule (CRStyleSheet * a_sheet,
         memset (result, 0, sizeof (CRStatement));
         result->type = AT_FONT_FACE_RULE_STMT;
 
-        result->kind.font_face_rule = g_try_malloc
+        result->kind.font_face_rule = cr_arena_node_try_alloc
                 (sizeof (CRAtFontFaceRule));
 
         if (!result->kind.font_face_rule) {
                 cr_utils_trace_info ("Out of memory");
-                g_free (result);
+                cr_arena_node_free (sizeof (CRStatement), result);
                 return NULL;
         }
         memset (result->kind.font_face_rule, 0, sizeof (CRAtFontFaceRule));
@@ -1807,6 +1819,18 @@ cr_statement_get_parent_sheet (CRStatement * a_this, CRStyleSheet ** a_sheet)
         return CR_OK;
 }
 
+/**
+ *Drops the selector indexes of the stylesheet a statement
+ *belongs to, as the statements of the stylesheet are changed.
+ *@param a_stmt the statement, or NULL.
+ */
+static void
+invalidate_parent_sheet_rule_index (CRStatement const * a_stmt)
+{
+        if (a_stmt && a_stmt->parent_sheet)
+                cr_stylesheet_invalidate_rule_index (a_stmt->parent_sheet);
+}
+
 /**
  * cr_statement_append:
  *
@@ -1824,9 +1848,12 @@ cr_statement_append (CRStatement * a_this, CRStatement * a_new)
 
         g_return_val_if_fail (a_new, NULL);
 
+        invalidate_parent_sheet_rule_index (a_new);
         if (!a_this) {
                 return a_new;
         }
+        if (a_this->parent_sheet != a_new->parent_sheet)
+                invalidate_parent_sheet_rule_index (a_this);
 
         /*walk forward in the current list to find the tail list element */
         for (cur = a_this; cur && cur->next; cur = cur->next) ;
@@ -1856,8 +1883,11 @@ cr_statement_prepend (CRStatement * a_this, CRStatement * a_new)
 
         g_return_val_if_fail (a_new, NULL);
 
+        invalidate_parent_sheet_rule_index (a_new);
         if (!a_this)
                 return a_new;
+        if (a_this->parent_sheet != a_new->parent_sheet)
+                invalidate_parent_sheet_rule_index (a_this);
 
         a_new->next = a_this;
         a_this->prev = a_new;
@@ -1896,6 +1926,8 @@ cr_statement_unlink (CRStatement * a_stmt)
                 g_return_val_if_fail (a_stmt->prev->next == a_stmt, NULL);
         }
 
+        invalidate_parent_sheet_rule_index (a_stmt);
+
         /**
          *Now, the real unlinking job.
          */
@@ -1986,6 +2018,7 @@ cr_statement_ruleset_set_sel_list (CRStatement * a_this,
         g_return_val_if_fail (a_this && a_this->type == RULESET_STMT,
                               CR_BAD_PARAM_ERROR);
 
+        invalidate_parent_sheet_rule_index (a_this);
         if (a_this->kind.ruleset->sel_list)
                 cr_selector_unref (a_this->kind.ruleset->sel_list);
 
@@ -2157,6 +2190,7 @@ cr_statement_at_import_rule_set_imported_sheet (CRStatement * a_this,
                               && a_this->kind.import_rule,
                               CR_BAD_PARAM_ERROR);
 
+        invalidate_parent_sheet_rule_index (a_this);
         a_this->kind.import_rule->sheet = a_sheet;
 
         return CR_OK;
@@ -2768,14 +2802,14 @@ cr_statement_destroy (CRStatement * a_this)
                 cr_statement_clear (cur);
 
         if (cur->prev == NULL) {
-                g_free (a_this);
+                cr_arena_node_free (sizeof (CRStatement), a_this);
                 return;
         }
 
         /*walk backward and free next element */
         for (cur = cur->prev; cur && cur->prev; cur = cur->prev) {
                 if (cur->next) {
-                        g_free (cur->next);
+                        cr_arena_node_free (sizeof (CRStatement), cur->next);
                         cur->next = NULL;
                 }
         }
@@ -2785,10 +2819,10 @@ cr_statement_destroy (CRStatement * a_this)
 
         /*free the one remaining list */
         if (cur->next) {
-                g_free (cur->next);
+                cr_arena_node_free (sizeof (CRStatement), cur->next);
                 cur->next = NULL;
         }
 
-        g_free (cur);
+        cr_arena_node_free (sizeof (CRStatement), cur);
         cur = NULL;
 }
@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include "cr-string.h"
+#include "cr-arena.h"
 
 /**
  *Instanciates a #CRString
@@ -34,7 +35,7 @@ cr_string_new (void)
 {
 	CRString *result = NULL ;
 
-	result = g_try_malloc (sizeof (CRString)) ;
+	result = cr_arena_node_try_alloc (sizeof (CRString)) ;
 	if (!result) {
 		cr_utils_trace_info ("Out of memory") ;
 		return NULL ;
@@ -103,6 +104,7 @@ cr_string_dup (CRString const *a_this)
 	}
 	cr_parsing_location_copy (&result->location,
                                   &a_this->location) ;
+        result->atom = a_this->atom ;
         return result ;
 }
 
@@ -152,6 +154,24 @@ cr_string_peek_raw_str_len (CRString const *a_this)
         return a_this->stryng->len ;
 }
 
+/**
+ *Returns the atom of the current instance of #CRString,
+ *interning the string if that hasn't been done yet.
+ *Two strings with the same content have the same atom, so
+ *comparing the atoms of two strings is comparing the strings.
+ *@param a_this the current instance of #CRString.
+ *@return the atom of the string, or NULL if it has no content.
+ */
+CRAtom
+cr_string_get_atom (CRString *a_this)
+{
+        g_return_val_if_fail (a_this, NULL) ;
+
+        if (!a_this->atom && a_this->stryng && a_this->stryng->str)
+                a_this->atom = cr_atom_from_string (a_this->stryng->str) ;
+        return a_this->atom ;
+}
+
 /**
  *@param a_this the #CRString to destroy.
  */
@@ -164,5 +184,5 @@ cr_string_destroy (CRString *a_this)
 		g_string_free (a_this->stryng, TRUE) ;
 		a_this->stryng = NULL ;
 	}
-	g_free (a_this) ;
+	cr_arena_node_free (sizeof (CRString), a_this) ;
 }
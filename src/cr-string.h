@@ -31,6 +31,7 @@
 #include <glib.h>
 #include "cr-utils.h"
 #include "cr-parsing-location.h"
+#include "cr-atom.h"
 
 G_BEGIN_DECLS
 
@@ -59,6 +60,14 @@ struct _CRString {
 	 *The parsing location storage area.
 	 */
 	CRParsingLocation location ;
+        /**
+         *The atom of the string, or NULL if it
+         *hasn't been computed yet. The tokenizer sets it
+         *on the idents and names it parses.
+         *Use cr_string_get_atom() to read it, and reset it
+         *to NULL if you modify the content of the string.
+         */
+        CRAtom atom ;
 } ;
 
 CRString * cr_string_new (void) ;
@@ -69,6 +78,7 @@ CRString *cr_string_dup (CRString const *a_this) ;
 gchar *cr_string_dup2 (CRString const *a_this) ;
 const gchar *cr_string_peek_raw_str (CRString const *a_this) ;
 gint cr_string_peek_raw_str_len (CRString const *a_this) ;
+CRAtom cr_string_get_atom (CRString *a_this) ;
 void cr_string_destroy (CRString *a_this) ;
 
 G_END_DECLS
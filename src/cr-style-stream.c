@@ -0,0 +1,680 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+
+#include <string.h>
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include "cr-style-stream.h"
+#include "cr-rule-index.h"
+
+/**
+ *@CRStyleStream:
+ *
+ *The definition of the #CRStyleStream class.
+ */
+
+#define PRIVATE(a_this) (a_this)->priv
+
+typedef struct _CRStreamNode CRStreamNode;
+
+/**
+ *An element seen by the stream: an open one, or one of the
+ *previous siblings of an open one.
+ */
+struct _CRStreamNode {
+        gchar *name;
+        /*the attributes, as NULL terminated name and value pairs*/
+        gchar **attrs;
+        CRStreamNode *parent;
+        /*
+         *the previous sibling. A node owns its previous
+         *siblings, up to the number the stream keeps.
+         */
+        CRStreamNode *prev;
+        /*
+         *the last child that ended, which becomes the
+         *previous sibling of the next child.
+         */
+        CRStreamNode *last_child;
+        /*the style of the element, as long as it is open*/
+        CRStyle *style;
+};
+
+struct _CRStyleStreamPriv {
+        CRSelEng *sel_eng;
+        /*the interface of sel_eng before the stream set its own*/
+        CRNodeIface const *saved_iface;
+        CRCascade *cascade;
+        CRSelMatchContext *ctxt;
+        CRStyleStreamHandler handler;
+        gpointer user_data;
+        /*the innermost open element*/
+        CRStreamNode *cur;
+        /*the last top level element that ended*/
+        CRStreamNode *last_root;
+        guint depth;
+        /*
+         *the number of previous siblings kept for each open
+         *element, see compute_nr_kept_siblings().
+         */
+        guint nr_kept_siblings;
+        /*the status of the parsing in progress*/
+        enum CRStatus status;
+};
+
+static gboolean
+stream_node_is_element (CRXMLNodePtr a_node)
+{
+        (void) a_node;
+        return TRUE;
+}
+
+static CRXMLNodePtr
+stream_node_get_parent (CRXMLNodePtr a_node)
+{
+        return ((CRStreamNode *) a_node)->parent;
+}
+
+/**
+ *The children and the next siblings of an element
+ *are not read yet when the element is styled.
+ */
+static CRXMLNodePtr
+stream_node_get_nothing (CRXMLNodePtr a_node)
+{
+        (void) a_node;
+        return NULL;
+}
+
+static CRXMLNodePtr
+stream_node_get_prev (CRXMLNodePtr a_node)
+{
+        return ((CRStreamNode *) a_node)->prev;
+}
+
+static const gchar *
+stream_node_get_local_name (CRXMLNodePtr a_node)
+{
+        return ((CRStreamNode *) a_node)->name;
+}
+
+static const gchar *
+stream_node_get_attribute (CRXMLNodePtr a_node, const gchar * a_name,
+                           gboolean * a_is_set, gchar ** a_copy)
+{
+        gchar **cur = NULL;
+
+        *a_copy = NULL;
+        for (cur = ((CRStreamNode *) a_node)->attrs; cur && *cur;
+             cur += 2) {
+                if (!strcmp (*cur, a_name)) {
+                        *a_is_set = TRUE;
+                        return cur[1];
+                }
+        }
+        *a_is_set = FALSE;
+        return NULL;
+}
+
+static const gchar *
+stream_node_get_id (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return stream_node_get_attribute (a_node, "id", &is_set, a_copy);
+}
+
+static const gchar *
+stream_node_get_classes (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return stream_node_get_attribute (a_node, "class", &is_set,
+                                          a_copy);
+}
+
+static const gchar *
+stream_node_get_lang (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        gboolean is_set = FALSE;
+
+        return stream_node_get_attribute (a_node, "lang", &is_set,
+                                          a_copy);
+}
+
+static CRNodeIface const gv_stream_node_iface = {
+        stream_node_is_element,
+        stream_node_get_parent,
+        stream_node_get_nothing,
+        stream_node_get_nothing,
+        stream_node_get_prev,
+        stream_node_get_local_name,
+        stream_node_get_id,
+        stream_node_get_classes,
+        stream_node_get_attribute,
+        stream_node_get_lang
+};
+
+/**
+ *Frees a node, the previous siblings it owns
+ *and the last children of all of them.
+ *@param a_node the node to free, or NULL.
+ */
+static void
+stream_node_destroy (CRStreamNode * a_node)
+{
+        CRStreamNode *cur = NULL,
+                *prev = NULL;
+
+        for (cur = a_node; cur; cur = prev) {
+                prev = cur->prev;
+                stream_node_destroy (cur->last_child);
+                if (cur->style) {
+                        cur->style->parent_style = NULL;
+                        cr_style_unref (cur->style);
+                }
+                g_free (cur->name);
+                g_strfreev (cur->attrs);
+                g_free (cur);
+        }
+}
+
+/**
+ *Computes how many previous siblings of an element the
+ *selection may look at: as many as the longest run of '+'
+ *combinators of the cascade, plus one, so that :first-child
+ *can tell whether the farthest of them is a first child.
+ */
+static guint
+compute_nr_kept_siblings (CRCascade * a_cascade)
+{
+        CRStyleSheet *sheet = NULL;
+        CRRuleIndex *index = NULL;
+        enum CRStyleOrigin origin = 0;
+        guint result = 0;
+
+        for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+                sheet = cr_cascade_get_sheet (a_cascade, origin);
+                if (!sheet)
+                        continue;
+                index = cr_stylesheet_get_rule_index (sheet);
+                if (index && cr_rule_index_get_sibling_reach (index)
+                    > result)
+                        result = cr_rule_index_get_sibling_reach (index);
+        }
+        return result + 1;
+}
+
+/**
+ *Opens an element, styles it and gives its style to the handler.
+ *@param a_this the current instance of #CRStyleStream.
+ *@param a_name the name of the element, which the stream takes.
+ *@param a_attrs the attributes of the element, as NULL terminated
+ *name and value pairs, which the stream takes. May be NULL.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+start_element_real (CRStyleStream * a_this, gchar * a_name,
+                    gchar ** a_attrs)
+{
+        CRStreamNode *node = NULL,
+                *cur = NULL,
+                *parent = PRIVATE (a_this)->cur;
+        CRStyle *parent_style = parent ? parent->style : NULL;
+        guint i = 0;
+        enum CRStatus status = CR_OK;
+
+        node = g_try_malloc0 (sizeof (CRStreamNode));
+        if (!node) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (a_name);
+                g_strfreev (a_attrs);
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        node->name = a_name;
+        node->attrs = a_attrs;
+        node->parent = parent;
+        if (parent) {
+                node->prev = parent->last_child;
+                parent->last_child = NULL;
+        } else {
+                node->prev = PRIVATE (a_this)->last_root;
+                PRIVATE (a_this)->last_root = NULL;
+        }
+        PRIVATE (a_this)->cur = node;
+        PRIVATE (a_this)->depth++;
+
+        /*forget the siblings the selectors can't reach*/
+        for (cur = node, i = 0;
+             cur->prev && i < PRIVATE (a_this)->nr_kept_siblings;
+             cur = cur->prev, i++) ;
+        stream_node_destroy (cur->prev);
+        cur->prev = NULL;
+
+        /*
+         *the first element has no parent style to inherit
+         *from, so it gets the initial values.
+         */
+        node->style = cr_style_new (parent_style ? FALSE : TRUE);
+        if (!node->style) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        cr_style_ref (node->style);
+        status = cr_sel_eng_get_matched_style_in_context
+                (PRIVATE (a_this)->sel_eng, PRIVATE (a_this)->ctxt,
+                 PRIVATE (a_this)->cascade, node, parent_style,
+                 &node->style, parent_style ? FALSE : TRUE);
+        if (status != CR_OK)
+                return status;
+        if (parent_style) {
+                node->style->parent_style = parent_style;
+                status = cr_style_resolve_inherited_properties
+                        (node->style);
+                if (status != CR_OK)
+                        return status;
+        }
+
+        status = cr_sel_eng_push_element_in_context
+                (PRIVATE (a_this)->sel_eng, PRIVATE (a_this)->ctxt, node);
+        if (status != CR_OK)
+                return status;
+
+        if (PRIVATE (a_this)->handler)
+                PRIVATE (a_this)->handler (a_this, node, node->style,
+                                           PRIVATE (a_this)->user_data);
+        return CR_OK;
+}
+
+/**
+ *The startElementNs SAX handler of the parsings
+ *made by the stream.
+ */
+static void
+sax_start_element (void *a_ctx, const xmlChar * a_localname,
+                   const xmlChar * a_prefix, const xmlChar * a_uri,
+                   int a_nb_namespaces, const xmlChar ** a_namespaces,
+                   int a_nb_attributes, int a_nb_defaulted,
+                   const xmlChar ** a_attributes)
+{
+        xmlParserCtxt *ctxt = a_ctx;
+        CRStyleStream *stream = ctxt->_private;
+        const xmlChar *value = NULL;
+        xmlChar *decoded = NULL;
+        gchar **attrs = NULL;
+        gint i = 0,
+                len = 0;
+        enum CRStatus status = CR_OK;
+
+        (void) a_prefix;
+        (void) a_uri;
+        (void) a_nb_namespaces;
+        (void) a_namespaces;
+        (void) a_nb_defaulted;
+
+        if (PRIVATE (stream)->status != CR_OK)
+                return;
+
+        attrs = g_try_malloc0 ((2 * a_nb_attributes + 1)
+                               * sizeof (gchar *));
+        if (!attrs) {
+                cr_utils_trace_info ("Out of memory");
+                status = CR_OUT_OF_MEMORY_ERROR;
+                goto error;
+        }
+        for (i = 0; i < a_nb_attributes; i++) {
+                value = a_attributes[5 * i + 3];
+                len = a_attributes[5 * i + 4] - value;
+                attrs[2 * i] = g_strdup ((const gchar *) a_attributes[5 * i]);
+                if (!memchr (value, '&', len)) {
+                        attrs[2 * i + 1] = g_strndup ((const gchar *) value,
+                                                      len);
+                        continue;
+                }
+                /*
+                 *the parser leaves the references of the value
+                 *alone, the way libxml2 substitutes them when it
+                 *builds a tree.
+                 */
+                decoded = xmlStringLenDecodeEntities
+                        (ctxt, value, len, XML_SUBSTITUTE_REF, 0, 0, 0);
+                attrs[2 * i + 1] = g_strdup (decoded ?
+                                             (const gchar *) decoded : "");
+                if (decoded)
+                        xmlFree (decoded);
+        }
+        status = start_element_real
+                (stream, g_strdup ((const gchar *) a_localname), attrs);
+        if (status == CR_OK)
+                return;
+ error:
+        PRIVATE (stream)->status = status;
+        xmlStopParser (ctxt);
+}
+
+/**
+ *The endElementNs SAX handler of the parsings
+ *made by the stream.
+ */
+static void
+sax_end_element (void *a_ctx, const xmlChar * a_localname,
+                 const xmlChar * a_prefix, const xmlChar * a_uri)
+{
+        xmlParserCtxt *ctxt = a_ctx;
+        CRStyleStream *stream = ctxt->_private;
+        enum CRStatus status = CR_OK;
+
+        (void) a_localname;
+        (void) a_prefix;
+        (void) a_uri;
+
+        if (PRIVATE (stream)->status != CR_OK)
+                return;
+        status = cr_style_stream_end_element (stream);
+        if (status != CR_OK) {
+                PRIVATE (stream)->status = status;
+                xmlStopParser (ctxt);
+        }
+}
+
+/**
+ *Parses a document with a parser context made for it, and
+ *styles its elements as they are read. The context is freed.
+ *@param a_this the current instance of #CRStyleStream.
+ *@param a_ctxt the libxml2 parser context.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+parse_document (CRStyleStream * a_this, xmlParserCtxt * a_ctxt)
+{
+        xmlSAXHandler *sax = a_ctxt->sax;
+        enum CRStatus status = CR_OK;
+
+        /*
+         *the SAX2 handlers of the context still record the
+         *declarations of the DTD, for the default values of the
+         *attributes and the entities, but build no tree.
+         */
+        sax->startElementNs = sax_start_element;
+        sax->endElementNs = sax_end_element;
+        sax->startElement = NULL;
+        sax->endElement = NULL;
+        sax->characters = NULL;
+        sax->ignorableWhitespace = NULL;
+        sax->cdataBlock = NULL;
+        sax->comment = NULL;
+        sax->processingInstruction = NULL;
+        sax->reference = NULL;
+        a_ctxt->_private = a_this;
+
+        PRIVATE (a_this)->status = CR_OK;
+        xmlParseDocument (a_ctxt);
+        status = PRIVATE (a_this)->status;
+        if (status == CR_OK && !a_ctxt->wellFormed)
+                status = CR_PARSING_ERROR;
+        if (a_ctxt->myDoc) {
+                xmlFreeDoc (a_ctxt->myDoc);
+                a_ctxt->myDoc = NULL;
+        }
+        xmlFreeParserCtxt (a_ctxt);
+
+        /*a parsing stopped halfway leaves elements open*/
+        while (PRIVATE (a_this)->cur)
+                cr_style_stream_end_element (a_this);
+        return status;
+}
+
+/****************************************
+ *PUBLIC METHODS
+ ****************************************/
+
+/**
+ * cr_style_stream_new:
+ *@a_sel_eng: the selection engine to style the elements with.
+ *The stream sets the #CRNodeIface of the engine to its own, see
+ *cr_sel_eng_set_node_iface(), until it is destroyed. The pseudo
+ *class handlers of the engine can read the parent elements and
+ *the previous sibling elements of the nodes they are given, as far
+ *as the selectors of @a_cascade look, but never their children nor
+ *their next siblings.
+ *@a_cascade: the cascade to style the elements with. It must not
+ *be modified during the life of the stream, nor destroyed before it.
+ *@a_handler: the function the styles are given to, or NULL.
+ *@a_user_data: the data to give to @a_handler.
+ *
+ *Constructor of the #CRStyleStream class.
+ *
+ *Returns the newly built instance of #CRStyleStream, or NULL
+ *if an error occurs.
+ */
+CRStyleStream *
+cr_style_stream_new (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+                     CRStyleStreamHandler a_handler,
+                     gpointer a_user_data)
+{
+        CRStyleStream *result = NULL;
+
+        g_return_val_if_fail (a_sel_eng && a_cascade, NULL);
+
+        result = g_try_malloc (sizeof (CRStyleStream));
+        if (!result) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        memset (result, 0, sizeof (CRStyleStream));
+        PRIVATE (result) = g_try_malloc (sizeof (CRStyleStreamPriv));
+        if (!PRIVATE (result)) {
+                cr_utils_trace_info ("Out of memory");
+                g_free (result);
+                return NULL;
+        }
+        memset (PRIVATE (result), 0, sizeof (CRStyleStreamPriv));
+        PRIVATE (result)->ctxt = cr_sel_match_context_new ();
+        if (!PRIVATE (result)->ctxt) {
+                cr_utils_trace_info ("Out of memory");
+                cr_style_stream_destroy (result);
+                return NULL;
+        }
+        PRIVATE (result)->sel_eng = a_sel_eng;
+        PRIVATE (result)->saved_iface = cr_sel_eng_get_node_iface (a_sel_eng);
+        cr_sel_eng_set_node_iface (a_sel_eng, &gv_stream_node_iface);
+        PRIVATE (result)->cascade = a_cascade;
+        PRIVATE (result)->handler = a_handler;
+        PRIVATE (result)->user_data = a_user_data;
+        PRIVATE (result)->nr_kept_siblings =
+                compute_nr_kept_siblings (a_cascade);
+        return result;
+}
+
+/**
+ * cr_style_stream_start_element:
+ *@a_this: the current instance of #CRStyleStream.
+ *@a_name: the local name of the element.
+ *@a_attrs: the attributes of the element, as NULL terminated
+ *name and value pairs (the attributes of the libxml2 SAX1 startElement
+ *handler), or NULL. The stream copies them.
+ *
+ *Opens an element, a child of the innermost open one, styles it
+ *and gives its style to the handler of the stream.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ *After an error, the stream can only be destroyed.
+ */
+enum CRStatus
+cr_style_stream_start_element (CRStyleStream * a_this,
+                               const gchar * a_name,
+                               const gchar ** a_attrs)
+{
+        gchar **attrs = NULL;
+        guint i = 0,
+                len = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_name,
+                              CR_BAD_PARAM_ERROR);
+
+        for (len = 0; a_attrs && a_attrs[len]; len += 2) ;
+        attrs = g_try_malloc0 ((len + 1) * sizeof (gchar *));
+        if (!attrs) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+        for (i = 0; i < len; i++)
+                attrs[i] = g_strdup (a_attrs[i] ? a_attrs[i] : "");
+        return start_element_real (a_this, g_strdup (a_name), attrs);
+}
+
+/**
+ * cr_style_stream_end_element:
+ *@a_this: the current instance of #CRStyleStream.
+ *
+ *Closes the innermost open element. Its style is released, and it
+ *is kept as a previous sibling of the next elements, if the selectors
+ *may look that far.
+ *
+ *Returns CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_style_stream_end_element (CRStyleStream * a_this)
+{
+        CRStreamNode *node = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->cur, CR_BAD_PARAM_ERROR);
+
+        node = PRIVATE (a_this)->cur;
+        cr_sel_eng_pop_element_in_context (PRIVATE (a_this)->sel_eng,
+                                           PRIVATE (a_this)->ctxt, node);
+        stream_node_destroy (node->last_child);
+        node->last_child = NULL;
+        if (node->style) {
+                node->style->parent_style = NULL;
+                cr_style_unref (node->style);
+                node->style = NULL;
+        }
+
+        PRIVATE (a_this)->cur = node->parent;
+        if (node->parent)
+                node->parent->last_child = node;
+        else
+                PRIVATE (a_this)->last_root = node;
+        PRIVATE (a_this)->depth--;
+        return CR_OK;
+}
+
+/**
+ * cr_style_stream_get_depth:
+ *@a_this: the current instance of #CRStyleStream.
+ *
+ *Returns the number of open elements, 1 during the
+ *call of the handler for the root element.
+ */
+guint
+cr_style_stream_get_depth (CRStyleStream const * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        return PRIVATE (a_this)->depth;
+}
+
+/**
+ * cr_style_stream_parse_file:
+ *@a_this: the current instance of #CRStyleStream.
+ *@a_path: the path of the xml document to style.
+ *
+ *Reads an xml document with the libxml2 SAX parser, and styles
+ *its elements as they are read, without building the tree of the
+ *document. The elements matched by the type selectors are the ones
+ *of the same local name, and the attributes are looked up by their
+ *local names as well, as with cr_libxml_node_iface_get().
+ *
+ *Returns CR_OK upon successful completion, CR_PARSING_ERROR if the
+ *document is not well formed, an error code otherwise.
+ */
+enum CRStatus
+cr_style_stream_parse_file (CRStyleStream * a_this, const gchar * a_path)
+{
+        xmlParserCtxt *ctxt = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_path,
+                              CR_BAD_PARAM_ERROR);
+
+        ctxt = xmlCreateFileParserCtxt (a_path);
+        if (!ctxt)
+                return CR_ERROR;
+        return parse_document (a_this, ctxt);
+}
+
+/**
+ * cr_style_stream_parse_memory:
+ *@a_this: the current instance of #CRStyleStream.
+ *@a_buf: the xml document to style.
+ *@a_len: the length of @a_buf, in bytes.
+ *
+ *Like cr_style_stream_parse_file(), for a document held in memory.
+ *
+ *Returns CR_OK upon successful completion, CR_PARSING_ERROR if the
+ *document is not well formed, an error code otherwise.
+ */
+enum CRStatus
+cr_style_stream_parse_memory (CRStyleStream * a_this,
+                              const gchar * a_buf, gulong a_len)
+{
+        xmlParserCtxt *ctxt = NULL;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_buf,
+                              CR_BAD_PARAM_ERROR);
+
+        ctxt = xmlCreateMemoryParserCtxt (a_buf, a_len);
+        if (!ctxt)
+                return CR_ERROR;
+        return parse_document (a_this, ctxt);
+}
+
+/**
+ * cr_style_stream_destroy:
+ *@a_this: the current instance of #CRStyleStream.
+ *
+ *The destructor of #CRStyleStream. The selection engine
+ *of the stream gets its former #CRNodeIface back.
+ */
+void
+cr_style_stream_destroy (CRStyleStream * a_this)
+{
+        g_return_if_fail (a_this);
+
+        if (PRIVATE (a_this)) {
+                while (PRIVATE (a_this)->cur)
+                        cr_style_stream_end_element (a_this);
+                stream_node_destroy (PRIVATE (a_this)->last_root);
+                if (PRIVATE (a_this)->sel_eng)
+                        cr_sel_eng_set_node_iface
+                                (PRIVATE (a_this)->sel_eng,
+                                 PRIVATE (a_this)->saved_iface);
+                if (PRIVATE (a_this)->ctxt)
+                        cr_sel_match_context_destroy
+                                (PRIVATE (a_this)->ctxt);
+                g_free (PRIVATE (a_this));
+                PRIVATE (a_this) = NULL;
+        }
+        g_free (a_this);
+}
@@ -0,0 +1,93 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyrights information.
+ */
+
+
+#ifndef __CR_STYLE_STREAM_H__
+#define __CR_STYLE_STREAM_H__
+
+#include "cr-sel-eng.h"
+
+G_BEGIN_DECLS
+
+/**
+ *@file
+ *The declaration of the #CRStyleStream class.
+ */
+
+typedef struct _CRStyleStream CRStyleStream ;
+typedef struct _CRStyleStreamPriv CRStyleStreamPriv ;
+
+/**
+ *The function a #CRStyleStream gives the style of each element to,
+ *in document order, as soon as the start tag of the element is read.
+ *@a_this: the stream.
+ *@a_node: the element. It is only valid during the call, and is read
+ *with the #CRNodeIface of the selection engine of the stream.
+ *@a_style: the computed style of the element, with the inherited
+ *properties resolved. The stream releases it at the end tag of the
+ *element; the handler can keep it with cr_style_ref(), in which
+ *case the parent_style of the style is set to NULL at that time.
+ *@a_user_data: the data given to cr_style_stream_new().
+ */
+typedef void (*CRStyleStreamHandler) (CRStyleStream *a_this,
+                                      CRXMLNodePtr a_node,
+                                      CRStyle *a_style,
+                                      gpointer a_user_data) ;
+
+/**
+ *Styles a document as it is parsed, without building its tree:
+ *only the open elements, and the few previous siblings of each of
+ *them the selectors of the cascade may test, are kept in memory.
+ *The elements are either fed to the stream one start and end tag
+ *at a time, or read by the libxml2 SAX parser, see
+ *cr_style_stream_parse_file().
+ */
+struct _CRStyleStream
+{
+        CRStyleStreamPriv *priv ;
+} ;
+
+CRStyleStream * cr_style_stream_new (CRSelEng *a_sel_eng,
+                                     CRCascade *a_cascade,
+                                     CRStyleStreamHandler a_handler,
+                                     gpointer a_user_data) ;
+
+enum CRStatus cr_style_stream_start_element (CRStyleStream *a_this,
+                                             const gchar *a_name,
+                                             const gchar **a_attrs) ;
+
+enum CRStatus cr_style_stream_end_element (CRStyleStream *a_this) ;
+
+guint cr_style_stream_get_depth (CRStyleStream const *a_this) ;
+
+enum CRStatus cr_style_stream_parse_file (CRStyleStream *a_this,
+                                          const gchar *a_path) ;
+
+enum CRStatus cr_style_stream_parse_memory (CRStyleStream *a_this,
+                                            const gchar *a_buf,
+                                            gulong a_len) ;
+
+void cr_style_stream_destroy (CRStyleStream *a_this) ;
+
+G_END_DECLS
+
+#endif /*__CR_STYLE_STREAM_H__*/
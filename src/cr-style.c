@@ -148,20 +148,15 @@ static CRPropertyDesc gv_prop_table[] = {
 /**
  *A the key/value pair of this hash table
  *are:
- *key => name of the the css propertie found in gv_prop_table
+ *key => atom of the name of the css propertie found in gv_prop_table
  *value => matching property id found in gv_prop_table.
  *So this hash table is here just to retrieval of a property id
  *from a property name.
+ *It is built once, by the first thread that needs it
+ *(see cr_style_init_properties()), and is only read afterwards.
  */
 static GHashTable *gv_prop_hash = NULL;
 
-/**
- *incremented by each new instance of #CRStyle
- *and decremented at the it destroy time.
- *When this reaches zero, gv_prop_hash is destroyed.
- */
-static gulong gv_prop_hash_ref_count = 0;
-
 struct CRNumPropEnumDumpInfo {
         enum CRNumProp code;
         const gchar *str;
@@ -387,39 +382,49 @@ border_style_prop_code_to_string (enum CRBorderStyleProp a_code)
         return gv_border_style_props_dump_infos[a_code].str;
 }
 
+/**
+ *Builds gv_prop_hash, once. Threads calling this function
+ *concurrently wait until the first one has built the table.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
 static enum CRStatus
 cr_style_init_properties (void)
 {
+        static gsize initialized = 0;
 
-        if (!gv_prop_hash) {
+        if (g_once_init_enter (&initialized)) {
+                GHashTable *prop_hash = NULL;
                 gulong i = 0;
 
-                gv_prop_hash = g_hash_table_new (g_str_hash, g_str_equal);
-                if (!gv_prop_hash) {
+                prop_hash = g_hash_table_new (g_direct_hash,
+                                              g_direct_equal);
+                if (!prop_hash) {
                         cr_utils_trace_info ("Out of memory");
-                        return CR_ERROR;
-                }
-
-                /*load gv_prop_hash from gv_prop_table */
-                for (i = 0; gv_prop_table[i].name; i++) {
-                        g_hash_table_insert
-                                (gv_prop_hash,
-                                 (gpointer) gv_prop_table[i].name,
-                                 GINT_TO_POINTER (gv_prop_table[i].prop_id));
+                } else {
+                        /*load prop_hash from gv_prop_table */
+                        for (i = 0; gv_prop_table[i].name; i++) {
+                                g_hash_table_insert
+                                        (prop_hash,
+                                         (gpointer) cr_atom_from_string
+                                         (gv_prop_table[i].name),
+                                         GINT_TO_POINTER
+                                         (gv_prop_table[i].prop_id));
+                        }
                 }
+                gv_prop_hash = prop_hash;
+                g_once_init_leave (&initialized, 1);
         }
 
-        return CR_OK;
+        return gv_prop_hash ? CR_OK : CR_ERROR;
 }
 
 static enum CRPropertyID
-cr_style_get_prop_id (const guchar * a_prop)
+cr_style_get_prop_id_from_atom (CRAtom a_prop)
 {
         gpointer *raw_id = NULL;
 
-        if (!gv_prop_hash) {
-                cr_style_init_properties ();
-        }
+        if (cr_style_init_properties () != CR_OK || !a_prop)
+                return PROP_ID_NOT_KNOWN;
 
         raw_id = g_hash_table_lookup (gv_prop_hash, a_prop);
         if (!raw_id) {
@@ -1719,7 +1724,6 @@ cr_style_new (gboolean a_set_props_to_initial_values)
                 return NULL;
         }
         memset (result, 0, sizeof (CRStyle));
-        gv_prop_hash_ref_count++;
 
         if (a_set_props_to_initial_values == TRUE) {
                 cr_style_set_props_to_initial_values (result);
@@ -2023,8 +2027,8 @@ cr_style_set_style_from_decl (CRStyle * a_this, CRDeclaration * a_decl)
                               && a_decl->property->stryng->str,
                               CR_BAD_PARAM_ERROR);
 
-        prop_id = cr_style_get_prop_id
-                ((const guchar *) a_decl->property->stryng->str);
+        prop_id = cr_style_get_prop_id_from_atom
+                (cr_string_get_atom (a_decl->property));
 
         value = a_decl->value;
         switch (prop_id) {
@@ -2247,7 +2251,7 @@ cr_style_ref (CRStyle * a_this)
 {
         g_return_val_if_fail (a_this, CR_BAD_PARAM_ERROR);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
         return CR_OK;
 }
 
@@ -2265,10 +2269,8 @@ cr_style_unref (CRStyle * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count)
-                a_this->ref_count--;
-
-        if (!a_this->ref_count) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_style_destroy (a_this);
                 return TRUE;
         }
@@ -279,7 +279,7 @@ struct _CRStyle
 
         gboolean inherited_props_resolved ;
         CRStyle *parent_style ;
-        gulong ref_count ;
+        gint ref_count ;
 } ;
 
 enum CRStatus cr_style_white_space_type_to_string (enum CRWhiteSpaceType a_code,
@@ -22,6 +22,8 @@
 
 #include "string.h"
 #include "cr-stylesheet.h"
+#include "cr-rule-index.h"
+#include "cr-arena.h"
 
 /**
  *@file
@@ -137,12 +139,185 @@ cr_stylesheet_statement_get_from_list (CRStyleSheet * a_this, int itemnr)
         return cr_statement_get_from_list (a_this->statements, itemnr);
 }
 
+/*
+ *serializes the building of the rule indexes, see
+ *cr_stylesheet_get_rule_index().
+ */
+G_LOCK_DEFINE_STATIC (rule_index);
+
+/**
+ *Returns the index of the selectors of the stylesheet,
+ *building it if needed. The index is owned by the stylesheet.
+ *Can be called from several threads at once: the index is
+ *built by the first of them, the others wait for it.
+ *@param a_this the current instance of #CRStyleSheet.
+ *@return the index, or NULL in case of error.
+ */
+struct _CRRuleIndex *
+cr_stylesheet_get_rule_index (CRStyleSheet * a_this)
+{
+        CRRuleIndex *index = NULL;
+
+        g_return_val_if_fail (a_this, NULL);
+
+        index = g_atomic_pointer_get (&a_this->rule_index);
+        if (index)
+                return index;
+
+        G_LOCK (rule_index);
+        index = a_this->rule_index;
+        if (!index) {
+                index = cr_rule_index_new (a_this);
+                g_atomic_pointer_set (&a_this->rule_index, index);
+        }
+        G_UNLOCK (rule_index);
+        return index;
+}
+
+/**
+ *Returns the index of the selectors of the stylesheet as seen
+ *when styling for a given medium, building it if needed, see
+ *cr_rule_index_new_for_medium(). The index is owned by the
+ *stylesheet, and is built once per medium.
+ *Can be called from several threads at once.
+ *@param a_this the current instance of #CRStyleSheet.
+ *@param a_medium the lower cased media type, as returned by
+ *cr_media_context_get_media_type(). If NULL, this is the same
+ *as cr_stylesheet_get_rule_index().
+ *@return the index, or NULL in case of error.
+ */
+struct _CRRuleIndex *
+cr_stylesheet_get_rule_index_for_medium (CRStyleSheet * a_this,
+                                         CRAtom a_medium)
+{
+        CRRuleIndex *index = NULL;
+        GSList *cur = NULL;
+
+        g_return_val_if_fail (a_this, NULL);
+
+        if (!a_medium)
+                return cr_stylesheet_get_rule_index (a_this);
+
+        /*
+         *the nodes of the list are never modified once
+         *published, so walking it needs no lock.
+         */
+        for (cur = g_atomic_pointer_get (&a_this->media_rule_indexes);
+             cur; cur = cur->next) {
+                if (cr_rule_index_get_medium (cur->data) == a_medium)
+                        return cur->data;
+        }
+
+        G_LOCK (rule_index);
+        for (cur = a_this->media_rule_indexes; cur; cur = cur->next) {
+                if (cr_rule_index_get_medium (cur->data) == a_medium) {
+                        index = cur->data;
+                        break;
+                }
+        }
+        if (!index) {
+                index = cr_rule_index_new_for_medium (a_this, a_medium);
+                if (index)
+                        g_atomic_pointer_set
+                                (&a_this->media_rule_indexes,
+                                 g_slist_prepend
+                                 (a_this->media_rule_indexes, index));
+        }
+        G_UNLOCK (rule_index);
+        return index;
+}
+
+/**
+ *Destroys a rule index, as a #GDestroyNotify.
+ *@param a_index the #CRRuleIndex to destroy.
+ */
+static void
+destroy_rule_index (gpointer a_index)
+{
+        cr_rule_index_destroy (a_index);
+}
+
+/**
+ *Drops a reference to an imported stylesheet, as a #GDestroyNotify.
+ *@param a_sheet the #CRStyleSheet to unref.
+ */
+static void
+unref_stylesheet (gpointer a_sheet)
+{
+        cr_stylesheet_unref (a_sheet);
+}
+
+/**
+ *Drops the indexes of the selectors of the stylesheet.
+ *cr_statement_append(), cr_statement_prepend(),
+ *cr_statement_unlink() and cr_statement_ruleset_set_sel_list()
+ *call it on the stylesheet of the statements they change.
+ *It must be called after the statements of a stylesheet that has
+ *already been used for selection are modified by other means, and
+ *on the stylesheets that import a modified stylesheet.
+ *@param a_this the current instance of #CRStyleSheet.
+ */
+void
+cr_stylesheet_invalidate_rule_index (CRStyleSheet * a_this)
+{
+        g_return_if_fail (a_this);
+
+        if (a_this->rule_index) {
+                cr_rule_index_destroy (a_this->rule_index);
+                a_this->rule_index = NULL;
+        }
+        if (a_this->media_rule_indexes) {
+                g_slist_free_full (a_this->media_rule_indexes,
+                                   destroy_rule_index);
+                a_this->media_rule_indexes = NULL;
+        }
+}
+
+/**
+ *Resolves an \@import rule of the stylesheet: makes the rule
+ *point to the stylesheet it imports. The stylesheet takes a
+ *reference on @a_sheet, that it drops when it is destroyed, so
+ *a stylesheet can be imported by several others. Once resolved,
+ *the rules of @a_sheet are part of the rule indexes of the
+ *stylesheet, at the place of the \@import rule.
+ *The imports must not form a cycle.
+ *@param a_this the current instance of #CRStyleSheet.
+ *@param a_import_rule an \@import rule of the stylesheet
+ *that has not been resolved yet.
+ *@param a_sheet the stylesheet the rule imports.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+enum CRStatus
+cr_stylesheet_set_imported_sheet (CRStyleSheet * a_this,
+                                  CRStatement * a_import_rule,
+                                  CRStyleSheet * a_sheet)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && a_sheet && a_sheet != a_this
+                              && a_import_rule
+                              && a_import_rule->type == AT_IMPORT_RULE_STMT
+                              && a_import_rule->kind.import_rule
+                              && !a_import_rule->kind.import_rule->sheet,
+                              CR_BAD_PARAM_ERROR);
+
+        status = cr_statement_at_import_rule_set_imported_sheet
+                (a_import_rule, a_sheet);
+        if (status != CR_OK)
+                return status;
+        cr_stylesheet_ref (a_sheet);
+        a_this->imported_sheets = g_slist_prepend (a_this->imported_sheets,
+                                                   a_sheet);
+        cr_stylesheet_invalidate_rule_index (a_this);
+        return CR_OK;
+}
+
 void
 cr_stylesheet_ref (CRStyleSheet * a_this)
 {
         g_return_if_fail (a_this);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
 }
 
 gboolean
@@ -150,10 +325,8 @@ cr_stylesheet_unref (CRStyleSheet * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count)
-                a_this->ref_count--;
-
-        if (!a_this->ref_count) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_stylesheet_destroy (a_this);
                 return TRUE;
         }
@@ -163,16 +336,33 @@ cr_stylesheet_unref (CRStyleSheet * a_this)
 
 /**
  *Destructor of the #CRStyleSheet class.
+ *If the stylesheet owns an arena, the nodes allocated in it
+ *are not freed one by one: the arena is destroyed as a whole.
  *@param a_this the current instance of the #CRStyleSheet class.
  */
 void
 cr_stylesheet_destroy (CRStyleSheet * a_this)
 {
+        CRArena *prev_arena = NULL;
+
         g_return_if_fail (a_this);
 
+        cr_stylesheet_invalidate_rule_index (a_this);
+        if (a_this->imported_sheets) {
+                g_slist_free_full (a_this->imported_sheets,
+                                   unref_stylesheet);
+                a_this->imported_sheets = NULL;
+        }
+        if (a_this->arena)
+                prev_arena = cr_arena_set_current (a_this->arena);
         if (a_this->statements) {
                 cr_statement_destroy (a_this->statements);
                 a_this->statements = NULL;
         }
+        if (a_this->arena) {
+                cr_arena_set_current (prev_arena);
+                cr_arena_destroy (a_this->arena);
+                a_this->arena = NULL;
+        }
         g_free (a_this);
 }
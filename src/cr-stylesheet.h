@@ -26,6 +26,7 @@
 
 #include "cr-utils.h"
 #include "cr-statement.h"
+#include "cr-atom.h"
 
 G_BEGIN_DECLS
 
@@ -64,6 +65,13 @@ struct _CRStyleSheet
         /*the parent import rule, if any.*/
         CRStatement *parent_import_rule ;
 
+        /*
+         *the stylesheets the \@import rules of this one point to,
+         *once per rule, see cr_stylesheet_set_imported_sheet().
+         *The stylesheet holds a reference on each of them.
+         */
+        GSList *imported_sheets ;
+
 	/**custom data used by libcroco*/
 	gpointer croco_data ;
 
@@ -79,7 +87,29 @@ struct _CRStyleSheet
 	 *directly. Use cr_stylesheet_ref()
 	 *and cr_stylesheet_unref() instead.
 	 */
-	gulong ref_count ;
+	gint ref_count ;
+
+        /*
+         *the selector index used by the selection engine.
+         *Built on demand, see cr_stylesheet_get_rule_index().
+         */
+        struct _CRRuleIndex *rule_index ;
+
+        /*
+         *the selector indexes built for given media, see
+         *cr_stylesheet_get_rule_index_for_medium(). A list of
+         *CRRuleIndex, only ever prepended to until invalidated.
+         */
+        GSList *media_rule_indexes ;
+
+        /*
+         *the arena the nodes of the stylesheet are allocated in,
+         *if it was parsed in arena mode (see
+         *cr_om_parser_set_use_arena()). Owned by the stylesheet.
+         *The statements, selectors, declarations and terms of
+         *such a stylesheet must not outlive it.
+         */
+        struct _CRArena *arena ;
 } ;
 
 CRStyleSheet * cr_stylesheet_new (CRStatement *a_stmts) ;
@@ -91,6 +121,17 @@ gint cr_stylesheet_nr_rules (CRStyleSheet const *a_this) ;
 
 CRStatement * cr_stylesheet_statement_get_from_list (CRStyleSheet *a_this, int itemnr) ;
 
+struct _CRRuleIndex * cr_stylesheet_get_rule_index (CRStyleSheet *a_this) ;
+
+struct _CRRuleIndex * cr_stylesheet_get_rule_index_for_medium (CRStyleSheet *a_this,
+                                                              CRAtom a_medium) ;
+
+void cr_stylesheet_invalidate_rule_index (CRStyleSheet *a_this) ;
+
+enum CRStatus cr_stylesheet_set_imported_sheet (CRStyleSheet *a_this,
+                                                CRStatement *a_import_rule,
+                                                CRStyleSheet *a_sheet) ;
+
 void cr_stylesheet_ref (CRStyleSheet *a_this) ;
 
 gboolean cr_stylesheet_unref (CRStyleSheet *a_this) ;
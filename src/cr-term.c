@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "cr-term.h"
+#include "cr-arena.h"
 #include "cr-num.h"
 #include "cr-parser.h"
 
@@ -86,7 +87,7 @@ cr_term_new (void)
 {
         CRTerm *result = NULL;
 
-        result = g_try_malloc (sizeof (CRTerm));
+        result = cr_arena_node_try_alloc (sizeof (CRTerm));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
@@ -739,7 +740,7 @@ cr_term_ref (CRTerm * a_this)
 {
         g_return_if_fail (a_this);
 
-        a_this->ref_count++;
+        g_atomic_int_inc (&a_this->ref_count);
 }
 
 /**
@@ -754,11 +755,8 @@ cr_term_unref (CRTerm * a_this)
 {
         g_return_val_if_fail (a_this, FALSE);
 
-        if (a_this->ref_count) {
-                a_this->ref_count--;
-        }
-
-        if (a_this->ref_count == 0) {
+        if (g_atomic_int_get (&a_this->ref_count) == 0
+            || g_atomic_int_dec_and_test (&a_this->ref_count)) {
                 cr_term_destroy (a_this);
                 return TRUE;
         }
@@ -784,7 +782,7 @@ cr_term_destroy (CRTerm * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_arena_node_free (sizeof (CRTerm), a_this);
         }
 
 }
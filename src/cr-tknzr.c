@@ -31,27 +31,67 @@
 #include "cr-tknzr.h"
 #include "cr-doc-handler.h"
 
+/**
+ *The maximum number of released tokens a #CRTknzr
+ *keeps around for reuse.
+ */
+#define TOKEN_POOL_SIZE 8
+
+/**
+ *The maximum number of tokens a #CRTknzr
+ *can read ahead. See cr_tknzr_peek_token().
+ */
+#define LOOKAHEAD_SIZE 8
+
 struct _CRTknzrPriv {
         /**The parser input stream of bytes*/
         CRInput *input;
 
         /**
-         *A cache where tknzr_unget_token()
-         *puts back the token. tknzr_get_next_token()
-         *first look in this cache, and if and 
-         *only if it's empty, fetches the next token
+         *A ring of the tokens read ahead by cr_tknzr_peek_token()
+         *or put back by cr_tknzr_unget_token().
+         *tknzr_get_next_token() first looks in this ring,
+         *and if and only if it's empty, fetches the next token
          *from the input stream.
+         *lookahead_pos[i] is the position of the input
+         *at the start of lookahead[i]; the input itself
+         *stands at the end of the last token of the ring.
          */
-        CRToken *token_cache;
+        CRToken *lookahead[LOOKAHEAD_SIZE];
+        CRInputPos lookahead_pos[LOOKAHEAD_SIZE];
+        guint lookahead_start;
+        guint nb_lookahead;
 
         /**
-         *The position of the end of the previous token
-         *or char fetched.
+         *The position of the start of the previous token
+         *fetched.
          */
         CRInputPos prev_pos;
 
         CRDocHandler *sac_handler;
 
+        /**
+         *The tokens given back by cr_tknzr_release_token(),
+         *reused by cr_tknzr_get_next_token() instead of
+         *allocating new ones.
+         */
+        CRToken *token_pool[TOKEN_POOL_SIZE];
+        guint nr_pooled_tokens;
+
+        /**
+         *Whether cr_tknzr_get_next_token() uses the table
+         *driven automaton. See cr_tknzr_set_use_dfa().
+         */
+        gboolean use_dfa;
+
+        /**
+         *The number of tokens, and of bytes, scanned from the
+         *input so far, the tokens scanned again after a rewind
+         *included. See cr_tknzr_get_scan_stats().
+         */
+        gulong nb_tokens_scanned;
+        gulong nb_bytes_scanned;
+
         /**
          *The reference count of the current instance
          *of #CRTknzr. Is manipulated by cr_tknzr_ref()
@@ -62,6 +102,13 @@ struct _CRTknzrPriv {
 
 #define PRIVATE(obj) ((obj)->priv)
 
+/**
+ *The index in the lookahead ring of the a_n-th token
+ *read ahead.
+ */
+#define LOOKAHEAD_INDEX(a_this, a_n) \
+((PRIVATE (a_this)->lookahead_start + (a_n)) % LOOKAHEAD_SIZE)
+
 /**
  *return TRUE if the character is a number ([0-9]), FALSE otherwise
  *@param a_char the char to test.
@@ -91,6 +138,9 @@ if ((status) != CR_OK) \
  *Peeks the next char from the input stream of the current tokenizer.
  *invokes CHECK_PARSING_STATUS on the status returned by
  *cr_tknzr_input_peek_char().
+ *Unless tokens have been read ahead, and thus must
+ *be dropped first, goes straight to the input, the ascii fast
+ *path of which avoids decoding utf8.
  *
  *@param the current instance of #CRTkzr.
  *@param to_char a pointer to the char where to store the
@@ -98,7 +148,9 @@ if ((status) != CR_OK) \
  */
 #define PEEK_NEXT_CHAR(a_tknzr, a_to_char) \
 {\
-status = cr_tknzr_peek_char  (a_tknzr, a_to_char) ; \
+status = PRIVATE (a_tknzr)->nb_lookahead \
+        ? cr_tknzr_peek_char (a_tknzr, a_to_char) \
+        : cr_input_peek_char (PRIVATE (a_tknzr)->input, a_to_char) ; \
 CHECK_PARSING_STATUS (status, TRUE) \
 }
 
@@ -106,12 +158,16 @@ CHECK_PARSING_STATUS (status, TRUE) \
  *Reads the next char from the input stream of the current parser.
  *In case of error, jumps to the "error:" label located in the
  *function where this macro is called.
+ *Like PEEK_NEXT_CHAR, goes straight to the input if
+ *no token has been read ahead.
  *@param parser the curent instance of #CRTknzr
  *@param to_char a pointer to the guint32 char where to store
  *the character read.
  */
 #define READ_NEXT_CHAR(a_tknzr, to_char) \
-status = cr_tknzr_read_char (a_tknzr, to_char) ;\
+status = PRIVATE (a_tknzr)->nb_lookahead \
+        ? cr_tknzr_read_char (a_tknzr, to_char) \
+        : cr_input_read_char (PRIVATE (a_tknzr)->input, to_char) ;\
 CHECK_PARSING_STATUS (status, TRUE)
 
 /**
@@ -232,7 +288,9 @@ static enum CRStatus cr_tknzr_parse_string (CRTknzr * a_this,
                                             CRString ** a_str);
 
 static enum CRStatus cr_tknzr_parse_comment (CRTknzr * a_this, 
-                                             CRString ** a_comment);
+                                             const guchar ** a_start,
+                                             gulong * a_len,
+                                             CRParsingLocation * a_loc);
 
 static enum CRStatus cr_tknzr_parse_nmstart (CRTknzr * a_this, 
                                              guint32 * a_char, 
@@ -241,6 +299,10 @@ static enum CRStatus cr_tknzr_parse_nmstart (CRTknzr * a_this,
 static enum CRStatus cr_tknzr_parse_num (CRTknzr * a_this,
                                          CRNum ** a_num);
 
+static void cr_tknzr_drop_lookahead_front (CRTknzr * a_this, guint a_nb);
+
+static void cr_tknzr_drop_lookahead (CRTknzr * a_this);
+
 /**********************************
  *PRIVATE methods
  **********************************/
@@ -290,25 +352,18 @@ cr_tknzr_parse_w (CRTknzr * a_this,
         RECORD_CUR_BYTE_ADDR (a_this, a_start);
         *a_end = *a_start;
 
-        for (;;) {
-                gboolean is_eof = FALSE;
-
-                cr_input_get_end_of_file (PRIVATE (a_this)->input, &is_eof);
-                if (is_eof)
-                        break;
+        {
+                gulong nb_chars = -1; /*consume all spaces */
 
-                status = cr_tknzr_peek_char (a_this, &cur_char);
+                status = cr_input_consume_white_spaces
+                        (PRIVATE (a_this)->input, &nb_chars);
                 if (status == CR_END_OF_INPUT_ERROR) {
-                        break;
+                        status = CR_OK;
                 } else if (status != CR_OK) {
                         goto error;
                 }
-
-                if (cr_utils_is_white_space (cur_char) == TRUE) {
-                        READ_NEXT_CHAR (a_this, &cur_char);
+                if (nb_chars) {
                         RECORD_CUR_BYTE_ADDR (a_this, a_end);
-                } else {
-                        break;
                 }
         }
 
@@ -424,41 +479,84 @@ cr_tknzr_try_to_skip_spaces (CRTknzr * a_this)
  *It also means that comments cannot be nested.
  *So based on that, I've just tried to implement the parsing function
  *simply and in a straight forward manner.
+ *The text of the comment is not copied: it is returned as a slice
+ *of the input buffer.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_start out parameter. The address of the text of the
+ *comment in the input buffer, that is, of what follows the opening
+ *'/''*', up to and including the closing '*''/'.
+ *@param a_len out parameter. The length of the text, in bytes.
+ *@param a_loc out parameter. The location of the comment.
+ *@return CR_OK upon successfull completion, an error code otherwise.
  */
 static enum CRStatus
 cr_tknzr_parse_comment (CRTknzr * a_this, 
-                        CRString ** a_comment)
+                        const guchar ** a_start,
+                        gulong * a_len,
+                        CRParsingLocation * a_loc)
 {
         enum CRStatus status = CR_OK;
         CRInputPos init_pos;
         guint32 cur_char = 0, next_char= 0;
-        CRString *comment = NULL;
-        CRParsingLocation loc = {0} ;
+        glong start = 0, end = 0;
 
         g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && PRIVATE (a_this)->input, 
+                              && PRIVATE (a_this)->input
+                              && a_start && a_len && a_loc,
                               CR_BAD_PARAM_ERROR);
 
         RECORD_INITIAL_POS (a_this, &init_pos);        
         READ_NEXT_CHAR (a_this, &cur_char) ;        
         ENSURE_PARSING_COND (cur_char == '/');
-        cr_tknzr_get_parsing_location (a_this, &loc) ;
+        cr_tknzr_get_parsing_location (a_this, a_loc) ;
 
         READ_NEXT_CHAR (a_this, &cur_char);
         ENSURE_PARSING_COND (cur_char == '*');
-        comment = cr_string_new ();
+        cr_input_get_cur_index (PRIVATE (a_this)->input, &start);
+
+        /*
+         *Fast path: look for the end of the comment without
+         *decoding its text. This is only valid if the text is
+         *ascii, otherwise let the loops below decode it.
+         */
+        {
+                const guchar *text = NULL,
+                        *text_end = NULL;
+                gulong len = 0;
+                gboolean is_ascii = FALSE;
+
+                len = cr_input_get_nb_bytes_left (PRIVATE (a_this)->input);
+                if (len && cr_input_is_ascii (PRIVATE (a_this)->input)) {
+                        text = cr_input_get_byte_addr
+                                (PRIVATE (a_this)->input, start);
+                        text_end = cr_utils_find_comment_end (text, len,
+                                                              NULL);
+                        is_ascii = TRUE;
+                } else if (len) {
+                        text = cr_input_get_byte_addr
+                                (PRIVATE (a_this)->input, start);
+                        text_end = cr_utils_find_comment_end (text, len,
+                                                              &is_ascii);
+                }
+                if (text_end && is_ascii) {
+                        status = cr_input_skip_ascii_chars
+                                (PRIVATE (a_this)->input,
+                                 text_end + 2 - text);
+                        CHECK_PARSING_STATUS (status, TRUE);
+                        goto done;
+                }
+        }
+
         for (;;) { /* [^*]* */
                 PEEK_NEXT_CHAR (a_this, &next_char);
                 if (next_char == '*')
                         break;
                 READ_NEXT_CHAR (a_this, &cur_char);
-                g_string_append_unichar (comment->stryng, cur_char);
         }
         /* Stop condition: next_char == '*' */
         for (;;) { /* \*+ */
                 READ_NEXT_CHAR(a_this, &cur_char);
                 ENSURE_PARSING_COND (cur_char == '*');
-                g_string_append_unichar (comment->stryng, cur_char);
                 PEEK_NEXT_CHAR (a_this, &next_char);
                 if (next_char != '*')
                         break;
@@ -468,19 +566,16 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
                 if (next_char == '/')
                         break;
                 READ_NEXT_CHAR(a_this, &cur_char);
-                g_string_append_unichar (comment->stryng, cur_char);
                 for (;;) { /* [^*]* */
                         PEEK_NEXT_CHAR (a_this, &next_char);
                         if (next_char == '*')
                                 break;
                         READ_NEXT_CHAR (a_this, &cur_char);
-                        g_string_append_unichar (comment->stryng, cur_char);
                 }
                 /* Stop condition: next_char = '*', no need to verify, because peek and read exit to error anyway */
                 for (;;) { /* \*+ */
                         READ_NEXT_CHAR(a_this, &cur_char);
                         ENSURE_PARSING_COND (cur_char == '*');
-                        g_string_append_unichar (comment->stryng, cur_char);
                         PEEK_NEXT_CHAR (a_this, &next_char);
                         if (next_char != '*')
                                 break;
@@ -489,21 +584,17 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
         }
         /* Stop condition: next_char == '\/' */
         READ_NEXT_CHAR(a_this, &cur_char);
-        g_string_append_unichar (comment->stryng, cur_char);
 
+ done:
         if (status == CR_OK) {
-                cr_parsing_location_copy (&comment->location, 
-                                          &loc) ;
-                *a_comment = comment;                
+                cr_input_get_cur_index (PRIVATE (a_this)->input, &end);
+                *a_start = cr_input_get_byte_addr
+                        (PRIVATE (a_this)->input, start);
+                *a_len = end - start;
                 return CR_OK;
         }
  error:
 
-        if (comment) {
-                cr_string_destroy (comment);
-                comment = NULL;
-        }
-
         cr_tknzr_set_cur_pos (a_this, &init_pos);
 
         return status;
@@ -909,6 +1000,35 @@ cr_tknzr_parse_nmchar (CRTknzr * a_this, guint32 * a_char,
         return status;
 }
 
+/**
+ *Appends the run of ascii nmchars (see cr_utils_span_ascii_nmchars())
+ *located at the current position of the input to a string, and
+ *moves past them. This saves decoding and checking these characters
+ *one by one with cr_tknzr_parse_nmchar().
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_str the string to append the characters to.
+ *@return the number of characters appended.
+ */
+static gulong
+cr_tknzr_append_ascii_nmchars (CRTknzr * a_this, GString * a_str)
+{
+        glong index = 0;
+        gulong len = 0;
+        const guchar *run = NULL;
+
+        len = cr_input_get_nb_bytes_left (PRIVATE (a_this)->input);
+        if (!len)
+                return 0;
+        cr_input_get_cur_index (PRIVATE (a_this)->input, &index);
+        run = cr_input_get_byte_addr (PRIVATE (a_this)->input, index);
+        len = cr_utils_span_ascii_nmchars (run, len);
+        if (len) {
+                g_string_append_len (a_str, (const gchar *) run, len);
+                cr_input_skip_ascii_chars (PRIVATE (a_this)->input, len);
+        }
+        return len;
+}
+
 /**
  *Parses an "ident" as defined in css spec [4.1.1]:
  *ident ::= {nmstart}{nmchar}*
@@ -921,6 +1041,7 @@ cr_tknzr_parse_nmchar (CRTknzr * a_this, guint32 * a_char,
  *this function allocates a new instance of CRString. If not, 
  *the function just appends the parsed string to the one passed.
  *In both cases it is up to the caller to free *a_str.
+ *The atom of *a_str is set to the one of its new content.
  *
  *@return CR_OK upon successfull completion, an error code 
  *otherwise.
@@ -964,6 +1085,7 @@ cr_tknzr_parse_ident (CRTknzr * a_this, CRString ** a_str)
         }
         g_string_append_unichar (stringue->stryng, tmp_char);
         for (;;) {
+                cr_tknzr_append_ascii_nmchars (a_this, stringue->stryng);
                 status = cr_tknzr_parse_nmchar (a_this, 
                                                 &tmp_char, 
                                                 NULL);
@@ -984,6 +1106,7 @@ cr_tknzr_parse_ident (CRTknzr * a_this, CRString ** a_str)
                         cr_string_destroy (stringue) ;
                 }
                 stringue = NULL ;
+                (*a_str)->atom = cr_atom_from_string ((*a_str)->stryng->str) ;
         }
 
  error:
@@ -1009,6 +1132,7 @@ cr_tknzr_parse_ident (CRTknzr * a_this, CRString ** a_str)
  *name. If *a_str is set to NULL, this function allocates a new instance
  *of CRString. If not, it just appends the parsed name to the passed *a_str.
  *In both cases, it is up to the caller to free *a_str.
+ *The atom of *a_str is set to the one of its new content.
  *
  *@return CR_OK upon successfull completion, an error code otherwise.
  */
@@ -1049,10 +1173,12 @@ cr_tknzr_parse_name (CRTknzr * a_this,
                         break;                
                 g_string_append_unichar ((*a_str)->stryng, 
                                          tmp_char);
+                cr_tknzr_append_ascii_nmchars (a_this, (*a_str)->stryng);
         }
         if (i > 0) {
                 cr_parsing_location_copy 
                         (&(*a_str)->location, &loc) ;
+                (*a_str)->atom = cr_atom_from_string ((*a_str)->stryng->str) ;
                 return CR_OK;
         }
         if (str_needs_free == TRUE && *a_str) {
@@ -1587,6 +1713,932 @@ cr_tknzr_parse_num (CRTknzr * a_this,
         return status;
 }
 
+/**
+ *Gets a token to fill, from the pool of released tokens
+ *of the tokenizer, or newly allocated if the pool is empty.
+ *@param a_this the current instance of #CRTknzr.
+ *@return the token, or NULL if we ran out of memory.
+ */
+static CRToken *
+cr_tknzr_new_token (CRTknzr * a_this)
+{
+        if (PRIVATE (a_this)->nr_pooled_tokens) {
+                PRIVATE (a_this)->nr_pooled_tokens--;
+                return PRIVATE (a_this)->token_pool
+                        [PRIVATE (a_this)->nr_pooled_tokens];
+        }
+
+        return cr_token_new ();
+}
+
+/*
+ *The table driven tokenizer, see cr_tknzr_set_use_dfa().
+ *
+ *Each byte of the input is mapped to a class by gv_dfa_byte_classes,
+ *then the next state of the automaton is looked up in
+ *gv_dfa_transitions, until there is no transition for the class of
+ *the next byte. The type of the token is then given by the state
+ *the automaton stopped in, see gv_dfa_stop_types.
+ *The automaton only scans the input: the tokenizer moves forward
+ *once, past the whole token, when building it.
+ *Escapes, non ascii characters, url() and rgb() are left to the
+ *cr_tknzr_parse_*() routines.
+ */
+
+/**
+ *The classes of the bytes of the input. The bytes which are
+ *not listed in gv_dfa_byte_classes (NUL, control characters
+ *and non ascii bytes) are of class DFA_C_OTHER.
+ */
+enum CRTknzrDfaClass {
+        DFA_C_OTHER = 0,
+        DFA_C_SPACE,            /* ' ' '\t' */
+        DFA_C_NL,               /* '\n' '\r' '\f' */
+        DFA_C_LETTER,           /* [a-zA-Z] */
+        DFA_C_DIGIT,
+        DFA_C_MINUS,
+        DFA_C_UNDERSCORE,
+        DFA_C_DOT,
+        DFA_C_PLUS,
+        DFA_C_AT,
+        DFA_C_HASH,
+        DFA_C_DQUOTE,
+        DFA_C_SQUOTE,
+        DFA_C_BACKSLASH,
+        DFA_C_SLASH,
+        DFA_C_STAR,
+        DFA_C_LT,
+        DFA_C_GT,
+        DFA_C_BANG,
+        DFA_C_TILDE,
+        DFA_C_PIPE,
+        DFA_C_EQUAL,
+        DFA_C_SEMICOLON,
+        DFA_C_CBO,
+        DFA_C_CBC,
+        DFA_C_PO,
+        DFA_C_PC,
+        DFA_C_BO,
+        DFA_C_BC,
+        DFA_C_PRINTABLE,        /* the other printable ascii chars */
+        NB_DFA_CLASSES
+};
+
+/**
+ *The states of the automaton. DFA_S_STOP is not a state
+ *but the absence of transition.
+ */
+enum CRTknzrDfaState {
+        DFA_S_STOP = 0,
+        DFA_S_START,
+        DFA_S_FALLBACK,
+        DFA_S_DELIM,
+        DFA_S_WS,
+        DFA_S_SLASH,
+        DFA_S_COMMENT,
+        DFA_S_COMMENT_STAR,
+        DFA_S_COMMENT_END,
+        DFA_S_SEMICOLON,
+        DFA_S_CBO,
+        DFA_S_CBC,
+        DFA_S_PO,
+        DFA_S_PC,
+        DFA_S_BO,
+        DFA_S_BC,
+        DFA_S_LT,
+        DFA_S_LT_BANG,
+        DFA_S_LT_BANG_MINUS,
+        DFA_S_CDO,
+        DFA_S_MINUS,
+        DFA_S_MINUS_MINUS,
+        DFA_S_CDC,
+        DFA_S_TILDE,
+        DFA_S_INCLUDES,
+        DFA_S_PIPE,
+        DFA_S_DASHMATCH,
+        DFA_S_IDENT,
+        DFA_S_FUNCTION,
+        DFA_S_DASH_IDENT,       /* an ident which can't be a function */
+        DFA_S_AT,
+        DFA_S_AT_MINUS,
+        DFA_S_ATKEYWORD,
+        DFA_S_HASH_START,
+        DFA_S_HASH,
+        DFA_S_DQ_STRING,
+        DFA_S_SQ_STRING,
+        DFA_S_STRING_END,
+        DFA_S_BANG,
+        DFA_S_PLUS,
+        DFA_S_NUM_INT,
+        DFA_S_NUM_DOT,
+        DFA_S_NUM_FRAC,
+        DFA_S_NUM_ERROR,
+        DFA_S_UNIT,             /* start state of the unit of a DIMEN */
+        DFA_S_UNIT_MINUS,
+        NB_DFA_STATES
+};
+
+static const guchar gv_dfa_byte_classes[256] = {
+        ['\t'] = DFA_C_SPACE, [' '] = DFA_C_SPACE,
+        ['\n'] = DFA_C_NL, ['\r'] = DFA_C_NL, ['\f'] = DFA_C_NL,
+        ['a'] = DFA_C_LETTER, ['b'] = DFA_C_LETTER, ['c'] = DFA_C_LETTER,
+        ['d'] = DFA_C_LETTER, ['e'] = DFA_C_LETTER, ['f'] = DFA_C_LETTER,
+        ['g'] = DFA_C_LETTER, ['h'] = DFA_C_LETTER, ['i'] = DFA_C_LETTER,
+        ['j'] = DFA_C_LETTER, ['k'] = DFA_C_LETTER, ['l'] = DFA_C_LETTER,
+        ['m'] = DFA_C_LETTER, ['n'] = DFA_C_LETTER, ['o'] = DFA_C_LETTER,
+        ['p'] = DFA_C_LETTER, ['q'] = DFA_C_LETTER, ['r'] = DFA_C_LETTER,
+        ['s'] = DFA_C_LETTER, ['t'] = DFA_C_LETTER, ['u'] = DFA_C_LETTER,
+        ['v'] = DFA_C_LETTER, ['w'] = DFA_C_LETTER, ['x'] = DFA_C_LETTER,
+        ['y'] = DFA_C_LETTER, ['z'] = DFA_C_LETTER,
+        ['A'] = DFA_C_LETTER, ['B'] = DFA_C_LETTER, ['C'] = DFA_C_LETTER,
+        ['D'] = DFA_C_LETTER, ['E'] = DFA_C_LETTER, ['F'] = DFA_C_LETTER,
+        ['G'] = DFA_C_LETTER, ['H'] = DFA_C_LETTER, ['I'] = DFA_C_LETTER,
+        ['J'] = DFA_C_LETTER, ['K'] = DFA_C_LETTER, ['L'] = DFA_C_LETTER,
+        ['M'] = DFA_C_LETTER, ['N'] = DFA_C_LETTER, ['O'] = DFA_C_LETTER,
+        ['P'] = DFA_C_LETTER, ['Q'] = DFA_C_LETTER, ['R'] = DFA_C_LETTER,
+        ['S'] = DFA_C_LETTER, ['T'] = DFA_C_LETTER, ['U'] = DFA_C_LETTER,
+        ['V'] = DFA_C_LETTER, ['W'] = DFA_C_LETTER, ['X'] = DFA_C_LETTER,
+        ['Y'] = DFA_C_LETTER, ['Z'] = DFA_C_LETTER,
+        ['0'] = DFA_C_DIGIT, ['1'] = DFA_C_DIGIT, ['2'] = DFA_C_DIGIT,
+        ['3'] = DFA_C_DIGIT, ['4'] = DFA_C_DIGIT, ['5'] = DFA_C_DIGIT,
+        ['6'] = DFA_C_DIGIT, ['7'] = DFA_C_DIGIT, ['8'] = DFA_C_DIGIT,
+        ['9'] = DFA_C_DIGIT,
+        ['-'] = DFA_C_MINUS, ['_'] = DFA_C_UNDERSCORE, ['.'] = DFA_C_DOT,
+        ['+'] = DFA_C_PLUS, ['@'] = DFA_C_AT, ['#'] = DFA_C_HASH,
+        ['"'] = DFA_C_DQUOTE, ['\''] = DFA_C_SQUOTE,
+        ['\\'] = DFA_C_BACKSLASH, ['/'] = DFA_C_SLASH, ['*'] = DFA_C_STAR,
+        ['<'] = DFA_C_LT, ['>'] = DFA_C_GT, ['!'] = DFA_C_BANG,
+        ['~'] = DFA_C_TILDE, ['|'] = DFA_C_PIPE, ['='] = DFA_C_EQUAL,
+        [';'] = DFA_C_SEMICOLON,
+        ['{'] = DFA_C_CBO, ['}'] = DFA_C_CBC,
+        ['('] = DFA_C_PO, [')'] = DFA_C_PC,
+        ['['] = DFA_C_BO, [']'] = DFA_C_BC,
+        ['$'] = DFA_C_PRINTABLE, ['%'] = DFA_C_PRINTABLE,
+        ['&'] = DFA_C_PRINTABLE, [','] = DFA_C_PRINTABLE,
+        [':'] = DFA_C_PRINTABLE, ['?'] = DFA_C_PRINTABLE,
+        ['^'] = DFA_C_PRINTABLE, ['`'] = DFA_C_PRINTABLE
+};
+
+/*
+ *Helpers to fill the rows of gv_dfa_transitions.
+ */
+#define DFA_NMCHARS_TO(a_state) \
+[DFA_C_LETTER] = a_state, [DFA_C_DIGIT] = a_state, \
+[DFA_C_MINUS] = a_state, [DFA_C_UNDERSCORE] = a_state
+
+/*all the classes allowed in a string, but the quotes, '/' and '*'*/
+#define DFA_STRING_CHARS_TO(a_state) \
+DFA_NMCHARS_TO (a_state), \
+[DFA_C_SPACE] = a_state, [DFA_C_DOT] = a_state, [DFA_C_PLUS] = a_state, \
+[DFA_C_AT] = a_state, [DFA_C_HASH] = a_state, [DFA_C_LT] = a_state, \
+[DFA_C_GT] = a_state, [DFA_C_BANG] = a_state, [DFA_C_TILDE] = a_state, \
+[DFA_C_PIPE] = a_state, [DFA_C_EQUAL] = a_state, \
+[DFA_C_SEMICOLON] = a_state, [DFA_C_CBO] = a_state, \
+[DFA_C_CBC] = a_state, [DFA_C_PO] = a_state, [DFA_C_PC] = a_state, \
+[DFA_C_BO] = a_state, [DFA_C_BC] = a_state, [DFA_C_PRINTABLE] = a_state
+
+/*all the classes allowed in a comment, but '/' and '*'*/
+#define DFA_COMMENT_CHARS_TO(a_state) \
+DFA_STRING_CHARS_TO (a_state), \
+[DFA_C_NL] = a_state, [DFA_C_DQUOTE] = a_state, \
+[DFA_C_SQUOTE] = a_state, [DFA_C_BACKSLASH] = a_state
+
+#define DFA_ESCAPES_TO_FALLBACK \
+[DFA_C_OTHER] = DFA_S_FALLBACK, [DFA_C_BACKSLASH] = DFA_S_FALLBACK
+
+static const guchar gv_dfa_transitions[NB_DFA_STATES][NB_DFA_CLASSES] = {
+        [DFA_S_START] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_SPACE] = DFA_S_WS, [DFA_C_NL] = DFA_S_WS,
+                [DFA_C_LETTER] = DFA_S_IDENT,
+                [DFA_C_DIGIT] = DFA_S_NUM_INT,
+                [DFA_C_MINUS] = DFA_S_MINUS,
+                [DFA_C_UNDERSCORE] = DFA_S_DELIM,
+                [DFA_C_DOT] = DFA_S_NUM_DOT,
+                [DFA_C_PLUS] = DFA_S_PLUS,
+                [DFA_C_AT] = DFA_S_AT,
+                [DFA_C_HASH] = DFA_S_HASH_START,
+                [DFA_C_DQUOTE] = DFA_S_DQ_STRING,
+                [DFA_C_SQUOTE] = DFA_S_SQ_STRING,
+                [DFA_C_SLASH] = DFA_S_SLASH,
+                [DFA_C_STAR] = DFA_S_DELIM,
+                [DFA_C_LT] = DFA_S_LT,
+                [DFA_C_GT] = DFA_S_DELIM,
+                [DFA_C_BANG] = DFA_S_BANG,
+                [DFA_C_TILDE] = DFA_S_TILDE,
+                [DFA_C_PIPE] = DFA_S_PIPE,
+                [DFA_C_EQUAL] = DFA_S_DELIM,
+                [DFA_C_SEMICOLON] = DFA_S_SEMICOLON,
+                [DFA_C_CBO] = DFA_S_CBO,
+                [DFA_C_CBC] = DFA_S_CBC,
+                [DFA_C_PO] = DFA_S_PO,
+                [DFA_C_PC] = DFA_S_PC,
+                [DFA_C_BO] = DFA_S_BO,
+                [DFA_C_BC] = DFA_S_BC,
+                [DFA_C_PRINTABLE] = DFA_S_DELIM
+        },
+        [DFA_S_WS] = {
+                [DFA_C_SPACE] = DFA_S_WS, [DFA_C_NL] = DFA_S_WS
+        },
+        [DFA_S_SLASH] = {
+                [DFA_C_STAR] = DFA_S_COMMENT
+        },
+        [DFA_S_COMMENT] = {
+                DFA_COMMENT_CHARS_TO (DFA_S_COMMENT),
+                [DFA_C_OTHER] = DFA_S_FALLBACK,
+                [DFA_C_SLASH] = DFA_S_COMMENT,
+                [DFA_C_STAR] = DFA_S_COMMENT_STAR
+        },
+        [DFA_S_COMMENT_STAR] = {
+                DFA_COMMENT_CHARS_TO (DFA_S_COMMENT),
+                [DFA_C_OTHER] = DFA_S_FALLBACK,
+                [DFA_C_SLASH] = DFA_S_COMMENT_END,
+                [DFA_C_STAR] = DFA_S_COMMENT_STAR
+        },
+        [DFA_S_LT] = {
+                [DFA_C_BANG] = DFA_S_LT_BANG
+        },
+        [DFA_S_LT_BANG] = {
+                [DFA_C_MINUS] = DFA_S_LT_BANG_MINUS
+        },
+        [DFA_S_LT_BANG_MINUS] = {
+                [DFA_C_MINUS] = DFA_S_CDO
+        },
+        [DFA_S_MINUS] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_LETTER] = DFA_S_DASH_IDENT,
+                [DFA_C_MINUS] = DFA_S_MINUS_MINUS,
+                [DFA_C_DIGIT] = DFA_S_NUM_INT,
+                [DFA_C_DOT] = DFA_S_NUM_DOT
+        },
+        [DFA_S_MINUS_MINUS] = {
+                [DFA_C_GT] = DFA_S_CDC
+        },
+        [DFA_S_TILDE] = {
+                [DFA_C_EQUAL] = DFA_S_INCLUDES
+        },
+        [DFA_S_PIPE] = {
+                [DFA_C_EQUAL] = DFA_S_DASHMATCH
+        },
+        [DFA_S_IDENT] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_NMCHARS_TO (DFA_S_IDENT),
+                [DFA_C_PO] = DFA_S_FUNCTION
+        },
+        [DFA_S_DASH_IDENT] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_NMCHARS_TO (DFA_S_DASH_IDENT)
+        },
+        [DFA_S_AT] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_LETTER] = DFA_S_ATKEYWORD,
+                [DFA_C_MINUS] = DFA_S_AT_MINUS
+        },
+        [DFA_S_AT_MINUS] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_LETTER] = DFA_S_ATKEYWORD
+        },
+        [DFA_S_ATKEYWORD] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_NMCHARS_TO (DFA_S_ATKEYWORD)
+        },
+        [DFA_S_HASH_START] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_NMCHARS_TO (DFA_S_HASH)
+        },
+        [DFA_S_HASH] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_NMCHARS_TO (DFA_S_HASH)
+        },
+        [DFA_S_DQ_STRING] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_STRING_CHARS_TO (DFA_S_DQ_STRING),
+                [DFA_C_SLASH] = DFA_S_DQ_STRING,
+                [DFA_C_STAR] = DFA_S_DQ_STRING,
+                [DFA_C_DQUOTE] = DFA_S_STRING_END
+        },
+        [DFA_S_SQ_STRING] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                DFA_STRING_CHARS_TO (DFA_S_SQ_STRING),
+                [DFA_C_SLASH] = DFA_S_SQ_STRING,
+                [DFA_C_STAR] = DFA_S_SQ_STRING,
+                [DFA_C_SQUOTE] = DFA_S_STRING_END
+        },
+        [DFA_S_PLUS] = {
+                [DFA_C_DIGIT] = DFA_S_NUM_INT,
+                [DFA_C_DOT] = DFA_S_NUM_DOT
+        },
+        [DFA_S_NUM_INT] = {
+                [DFA_C_DIGIT] = DFA_S_NUM_INT,
+                [DFA_C_DOT] = DFA_S_NUM_DOT
+        },
+        [DFA_S_NUM_DOT] = {
+                [DFA_C_DIGIT] = DFA_S_NUM_FRAC
+        },
+        [DFA_S_NUM_FRAC] = {
+                [DFA_C_DIGIT] = DFA_S_NUM_FRAC,
+                [DFA_C_DOT] = DFA_S_NUM_ERROR
+        },
+        [DFA_S_UNIT] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_LETTER] = DFA_S_DASH_IDENT,
+                [DFA_C_MINUS] = DFA_S_UNIT_MINUS
+        },
+        [DFA_S_UNIT_MINUS] = {
+                DFA_ESCAPES_TO_FALLBACK,
+                [DFA_C_LETTER] = DFA_S_DASH_IDENT
+        }
+};
+
+#undef DFA_NMCHARS_TO
+#undef DFA_STRING_CHARS_TO
+#undef DFA_COMMENT_CHARS_TO
+#undef DFA_ESCAPES_TO_FALLBACK
+
+/**
+ *The type of the token recognized when the automaton
+ *stops in a given state. DELIM_TK stands for the delimiter
+ *made of the first char scanned, NO_TK for a token to
+ *be left to the cr_tknzr_parse_*() routines.
+ *Numbers are followed by a unit, which is scanned from
+ *DFA_S_UNIT: stopping in DFA_S_DASH_IDENT then means the
+ *number is a DIMEN, stopping in DFA_S_UNIT or
+ *DFA_S_UNIT_MINUS means there is no unit.
+ */
+static const enum CRTokenType gv_dfa_stop_types[NB_DFA_STATES] = {
+        [DFA_S_START] = NO_TK,
+        [DFA_S_FALLBACK] = NO_TK,
+        [DFA_S_DELIM] = DELIM_TK,
+        [DFA_S_WS] = S_TK,
+        [DFA_S_SLASH] = DELIM_TK,
+        [DFA_S_COMMENT] = DELIM_TK,
+        [DFA_S_COMMENT_STAR] = DELIM_TK,
+        [DFA_S_COMMENT_END] = COMMENT_TK,
+        [DFA_S_SEMICOLON] = SEMICOLON_TK,
+        [DFA_S_CBO] = CBO_TK,
+        [DFA_S_CBC] = CBC_TK,
+        [DFA_S_PO] = PO_TK,
+        [DFA_S_PC] = PC_TK,
+        [DFA_S_BO] = BO_TK,
+        [DFA_S_BC] = BC_TK,
+        [DFA_S_LT] = DELIM_TK,
+        [DFA_S_LT_BANG] = DELIM_TK,
+        [DFA_S_LT_BANG_MINUS] = DELIM_TK,
+        [DFA_S_CDO] = CDO_TK,
+        [DFA_S_MINUS] = DELIM_TK,
+        [DFA_S_MINUS_MINUS] = DELIM_TK,
+        [DFA_S_CDC] = CDC_TK,
+        [DFA_S_TILDE] = DELIM_TK,
+        [DFA_S_INCLUDES] = INCLUDES_TK,
+        [DFA_S_PIPE] = DELIM_TK,
+        [DFA_S_DASHMATCH] = DASHMATCH_TK,
+        [DFA_S_IDENT] = IDENT_TK,
+        [DFA_S_FUNCTION] = FUNCTION_TK,
+        [DFA_S_DASH_IDENT] = IDENT_TK,
+        [DFA_S_AT] = DELIM_TK,
+        [DFA_S_AT_MINUS] = DELIM_TK,
+        [DFA_S_ATKEYWORD] = ATKEYWORD_TK,
+        [DFA_S_HASH_START] = DELIM_TK,
+        [DFA_S_HASH] = HASH_TK,
+        [DFA_S_DQ_STRING] = DELIM_TK,
+        [DFA_S_SQ_STRING] = DELIM_TK,
+        [DFA_S_STRING_END] = STRING_TK,
+        [DFA_S_BANG] = IMPORTANT_SYM_TK,
+        [DFA_S_PLUS] = DELIM_TK,
+        [DFA_S_NUM_INT] = NUMBER_TK,
+        [DFA_S_NUM_DOT] = DELIM_TK,
+        [DFA_S_NUM_FRAC] = NUMBER_TK,
+        [DFA_S_NUM_ERROR] = DELIM_TK,
+        [DFA_S_UNIT] = NUMBER_TK,
+        [DFA_S_UNIT_MINUS] = NUMBER_TK
+};
+
+/**
+ *The at-rules keywords recognized by cr_tknzr_get_next_token().
+ *Like there, they are matched as prefixes of the at-keyword.
+ */
+static const struct {
+        const gchar *name;
+        gulong len;
+        enum CRTokenType type;
+} gv_dfa_at_syms[] = {
+        {"font-face", 9, FONT_FACE_SYM_TK},
+        {"charset", 7, CHARSET_SYM_TK},
+        {"import", 6, IMPORT_SYM_TK},
+        {"media", 5, MEDIA_SYM_TK},
+        {"page", 4, PAGE_SYM_TK},
+        {NULL, 0, NO_TK}
+};
+
+/**
+ *The units recognized after a number, in the order
+ *cr_tknzr_get_next_token() tries them.
+ */
+static const struct {
+        const gchar *name;
+        gulong len;
+        enum CRNumType num_type;
+        enum CRTokenType type;
+        enum CRTokenExtraType extra_type;
+} gv_dfa_units[] = {
+        {"em", 2, NUM_LENGTH_EM, EMS_TK, NO_ET},
+        {"ex", 2, NUM_LENGTH_EX, EXS_TK, NO_ET},
+        {"px", 2, NUM_LENGTH_PX, LENGTH_TK, LENGTH_PX_ET},
+        {"cm", 2, NUM_LENGTH_CM, LENGTH_TK, LENGTH_CM_ET},
+        {"mm", 2, NUM_LENGTH_MM, LENGTH_TK, LENGTH_MM_ET},
+        {"in", 2, NUM_LENGTH_IN, LENGTH_TK, LENGTH_IN_ET},
+        {"pt", 2, NUM_LENGTH_PT, LENGTH_TK, LENGTH_PT_ET},
+        {"pc", 2, NUM_LENGTH_PC, LENGTH_TK, LENGTH_PC_ET},
+        {"deg", 3, NUM_ANGLE_DEG, ANGLE_TK, ANGLE_DEG_ET},
+        {"rad", 3, NUM_ANGLE_RAD, ANGLE_TK, ANGLE_RAD_ET},
+        {"grad", 4, NUM_ANGLE_GRAD, ANGLE_TK, ANGLE_GRAD_ET},
+        {"ms", 2, NUM_TIME_MS, TIME_TK, TIME_MS_ET},
+        {"s", 1, NUM_TIME_S, TIME_TK, TIME_S_ET},
+        {"Hz", 2, NUM_FREQ_HZ, FREQ_TK, FREQ_HZ_ET},
+        {"kHz", 3, NUM_FREQ_KHZ, FREQ_TK, FREQ_KHZ_ET},
+        {"%", 1, NUM_PERCENTAGE, PERCENTAGE_TK, NO_ET},
+        {NULL, 0, NUM_GENERIC, NO_TK, NO_ET}
+};
+
+/**
+ *Runs the automaton on a buffer.
+ *The runs of white spaces, of ascii nmchars and the text
+ *of comments are scanned a vector at a time, by the
+ *cr_utils_span_*() and cr_utils_find_comment_end() scanners.
+ *@param a_buf the buffer to scan.
+ *@param a_len the length of a_buf, in bytes.
+ *@param a_state the state to start from.
+ *@param a_nb_bytes out parameter. The number of bytes scanned.
+ *@return the type of the token recognized, as given by
+ *gv_dfa_stop_types.
+ */
+static enum CRTokenType
+cr_tknzr_dfa_scan (const guchar * a_buf, gulong a_len,
+                   enum CRTknzrDfaState a_state, gulong * a_nb_bytes)
+{
+        guchar state = a_state,
+                next_state = DFA_S_STOP;
+        gulong i = 0;
+
+        while (i < a_len) {
+                switch (state) {
+                case DFA_S_WS:
+                        i += cr_utils_span_white_spaces (a_buf + i,
+                                                         a_len - i);
+                        break;
+                case DFA_S_IDENT:
+                case DFA_S_DASH_IDENT:
+                case DFA_S_ATKEYWORD:
+                case DFA_S_HASH:
+                        i += cr_utils_span_ascii_nmchars (a_buf + i,
+                                                          a_len - i);
+                        break;
+                case DFA_S_COMMENT:
+                        {
+                                const guchar *end = NULL;
+                                gboolean is_ascii = FALSE;
+
+                                end = cr_utils_find_comment_end
+                                        (a_buf + i, a_len - i, &is_ascii);
+                                if (end && is_ascii) {
+                                        state = DFA_S_COMMENT_END;
+                                        i = end + 2 - a_buf;
+                                } else {
+                                        state = DFA_S_FALLBACK;
+                                }
+                        }
+                        break;
+                default:
+                        break;
+                }
+                if (i >= a_len)
+                        break;
+                next_state = gv_dfa_transitions[state]
+                        [gv_dfa_byte_classes[a_buf[i]]];
+                if (next_state == DFA_S_STOP)
+                        break;
+                state = next_state;
+                i++;
+        }
+        *a_nb_bytes = i;
+        return gv_dfa_stop_types[state];
+}
+
+/**
+ *Moves the input forward, past ascii characters only, and
+ *gets the parsing location of one of these characters.
+ *@param a_input the input to move.
+ *@param a_nb_bytes the number of bytes to move past.
+ *@param a_loc_offset the number of bytes to move past
+ *before getting the location, at least 1.
+ *@param a_loc out parameter. The location of the
+ *(a_loc_offset)th character.
+ */
+static void
+cr_tknzr_dfa_consume (CRInput * a_input, gulong a_nb_bytes,
+                      gulong a_loc_offset, CRParsingLocation * a_loc)
+{
+        cr_input_skip_ascii_chars (a_input, a_loc_offset);
+        cr_input_get_parsing_location (a_input, a_loc);
+        cr_input_skip_ascii_chars (a_input, a_nb_bytes - a_loc_offset);
+}
+
+/**
+ *Builds a string out of a run of ascii characters.
+ *@param a_buf the characters.
+ *@param a_len the number of characters.
+ *@param a_is_name if TRUE, the atom of the string is set too,
+ *as the cr_tknzr_parse_ident() and cr_tknzr_parse_name() do.
+ *@return the new string, or NULL if we ran out of memory.
+ */
+static CRString *
+cr_tknzr_dfa_string_new (const guchar * a_buf, gulong a_len,
+                         gboolean a_is_name)
+{
+        CRString *result = NULL;
+
+        result = cr_string_new ();
+        if (!result)
+                return NULL;
+        g_string_append_len (result->stryng, (const gchar *) a_buf, a_len);
+        if (a_is_name == TRUE)
+                result->atom = cr_atom_from_string (result->stryng->str);
+        return result;
+}
+
+/**
+ *Builds a number out of the text recognized by the automaton.
+ *Computes its value exactly the way cr_tknzr_parse_num() does,
+ *so that both tokenizers give the very same values.
+ *@param a_buf the text of the number, its sign included.
+ *@param a_len the length of the text.
+ *@return the new number, or NULL if we ran out of memory.
+ */
+static CRNum *
+cr_tknzr_dfa_num_new (const guchar * a_buf, gulong a_len)
+{
+        gdouble numerator = 0,
+                denominator = 1;
+        gboolean parsing_dec = FALSE;
+        int sign = 1;
+        gulong i = 0;
+
+        if (a_buf[0] == '+' || a_buf[0] == '-') {
+                if (a_buf[0] == '-')
+                        sign = -1;
+                i++;
+        }
+        for (; i < a_len; i++) {
+                if (a_buf[i] == '.') {
+                        parsing_dec = TRUE;
+                        continue;
+                }
+                numerator = numerator * 10 + (a_buf[i] - '0');
+                if (parsing_dec)
+                        denominator *= 10;
+        }
+        return cr_num_new_with_val ((numerator / denominator) * sign,
+                                    NUM_GENERIC);
+}
+
+/**
+ *Gets the next token of the input, using the table driven automaton.
+ *The input is not moved if the token is left to the
+ *cr_tknzr_parse_*() routines.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_tk out parameter. The token. Is left to NULL if
+ *the next token involves escapes, non ascii characters, url()
+ *or rgb(), and must be got using the cr_tknzr_parse_*() routines.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+static enum CRStatus
+cr_tknzr_dfa_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
+{
+        enum CRStatus status = CR_OK;
+        enum CRTokenType type = NO_TK;
+        CRInput *input = NULL;
+        CRToken *token = NULL;
+        CRString *str = NULL;
+        CRNum *num = NULL;
+        const guchar *buf = NULL;
+        glong index = 0;
+        gulong len = 0,
+                nb_bytes = 0,
+                unit_len = 0;
+        gint i = 0,
+                unit = -1;
+
+        input = PRIVATE (a_this)->input;
+        len = cr_input_get_nb_bytes_left (input);
+        if (!len)
+                return CR_OK;
+        cr_input_get_cur_index (input, &index);
+        buf = cr_input_get_byte_addr (input, index);
+
+        type = cr_tknzr_dfa_scan (buf, len, DFA_S_START, &nb_bytes);
+
+        /*
+         *Deal with what is not in the tables.
+         */
+        switch (type) {
+        case NO_TK:
+                return CR_OK;
+
+        case FUNCTION_TK:
+                if (nb_bytes == 4
+                    && (!strncmp ((const gchar *) buf, "url", 3)
+                        || !strncmp ((const gchar *) buf, "rgb", 3)))
+                        return CR_OK;
+                break;
+
+        case ATKEYWORD_TK:
+                for (i = 0; gv_dfa_at_syms[i].name; i++) {
+                        if (nb_bytes > gv_dfa_at_syms[i].len
+                            && !strncmp ((const gchar *) buf + 1,
+                                         gv_dfa_at_syms[i].name,
+                                         gv_dfa_at_syms[i].len)) {
+                                type = gv_dfa_at_syms[i].type;
+                                nb_bytes = gv_dfa_at_syms[i].len + 1;
+                                break;
+                        }
+                }
+                break;
+
+        case IMPORTANT_SYM_TK:
+                if (len >= 10
+                    && !strncmp ((const gchar *) buf + 1, "important", 9)) {
+                        nb_bytes = 10;
+                } else if (len > 1
+                           && cr_utils_is_white_space (buf[1]) == TRUE) {
+                        /*let cr_tknzr_parse_important() skip them*/
+                        return CR_OK;
+                } else {
+                        type = DELIM_TK;
+                }
+                break;
+
+        case STRING_TK:
+                /*
+                 *cr_tknzr_parse_string() peeks one byte past
+                 *each char, the closing quote included.
+                 */
+                if (nb_bytes == len)
+                        type = DELIM_TK;
+                break;
+
+        case NUMBER_TK:
+                for (i = 0; gv_dfa_units[i].name; i++) {
+                        if (len - nb_bytes >= gv_dfa_units[i].len
+                            && !strncmp ((const gchar *) buf + nb_bytes,
+                                         gv_dfa_units[i].name,
+                                         gv_dfa_units[i].len)) {
+                                unit = i;
+                                unit_len = gv_dfa_units[i].len;
+                                type = gv_dfa_units[i].type;
+                                break;
+                        }
+                }
+                if (unit < 0 && nb_bytes < len) {
+                        type = cr_tknzr_dfa_scan (buf + nb_bytes,
+                                                  len - nb_bytes,
+                                                  DFA_S_UNIT, &unit_len);
+                        if (type == NO_TK)
+                                return CR_OK;
+                        if (type == IDENT_TK) {
+                                type = DIMEN_TK;
+                        } else {
+                                type = NUMBER_TK;
+                                unit_len = 0;
+                        }
+                }
+                break;
+
+        default:
+                break;
+        }
+
+        token = cr_tknzr_new_token (a_this);
+        if (!token) {
+                cr_utils_trace_info ("Out of memory");
+                return CR_OUT_OF_MEMORY_ERROR;
+        }
+
+        switch (type) {
+        case S_TK:
+                cr_input_skip_ascii_chars (input, nb_bytes);
+                status = cr_token_set_s (token);
+                break;
+
+        case CBO_TK:
+                cr_input_skip_ascii_chars (input, nb_bytes);
+                status = cr_token_set_cbo (token);
+                break;
+
+        case COMMENT_TK:
+                cr_tknzr_dfa_consume (input, nb_bytes, 1, &token->location);
+                status = cr_token_set_comment_slice (token, buf + 2,
+                                                     nb_bytes - 2);
+                break;
+
+        case IDENT_TK:
+        case FUNCTION_TK:
+                str = cr_tknzr_dfa_string_new
+                        (buf, type == FUNCTION_TK ? nb_bytes - 1 : nb_bytes,
+                         TRUE);
+                if (!str)
+                        goto out_of_memory;
+                cr_tknzr_dfa_consume (input, nb_bytes, 1, &str->location);
+                cr_parsing_location_copy (&token->location, &str->location);
+                if (type == FUNCTION_TK)
+                        status = cr_token_set_function (token, str);
+                else
+                        status = cr_token_set_ident (token, str);
+                break;
+
+        case ATKEYWORD_TK:
+                /*
+                 *cr_tknzr_parse_atkeyword() does not set the
+                 *location of at-keywords.
+                 */
+                str = cr_tknzr_dfa_string_new (buf + 1, nb_bytes - 1, TRUE);
+                if (!str)
+                        goto out_of_memory;
+                cr_input_skip_ascii_chars (input, nb_bytes);
+                status = cr_token_set_atkeyword (token, str);
+                break;
+
+        case HASH_TK:
+        case STRING_TK:
+                str = cr_tknzr_dfa_string_new
+                        (buf + 1,
+                         type == STRING_TK ? nb_bytes - 2 : nb_bytes - 1,
+                         type == HASH_TK);
+                if (!str)
+                        goto out_of_memory;
+                cr_tknzr_dfa_consume (input, nb_bytes, 1, &str->location);
+                cr_parsing_location_copy (&token->location, &str->location);
+                if (type == HASH_TK)
+                        status = cr_token_set_hash (token, str);
+                else
+                        status = cr_token_set_string (token, str);
+                break;
+
+        case IMPORTANT_SYM_TK:
+                /*
+                 *Like cr_tknzr_parse_important(), seek past "important",
+                 *which leaves the line and column numbers alone.
+                 */
+                cr_input_skip_ascii_chars (input, 1);
+                status = cr_input_seek_index (input, CR_SEEK_CUR,
+                                              nb_bytes - 1);
+                if (status != CR_OK)
+                        break;
+                cr_input_get_parsing_location (input, &token->location);
+                status = cr_token_set_important_sym (token);
+                break;
+
+        case NUMBER_TK:
+        case DIMEN_TK:
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case PERCENTAGE_TK:
+                num = cr_tknzr_dfa_num_new (buf, nb_bytes);
+                if (!num)
+                        goto out_of_memory;
+                cr_tknzr_dfa_consume (input, nb_bytes,
+                                      (buf[0] == '+' || buf[0] == '-')
+                                      ? 2 : 1,
+                                      &num->location);
+                cr_parsing_location_copy (&token->location, &num->location);
+                if (type == DIMEN_TK) {
+                        str = cr_tknzr_dfa_string_new (buf + nb_bytes,
+                                                       unit_len, TRUE);
+                        if (!str) {
+                                cr_num_destroy (num);
+                                goto out_of_memory;
+                        }
+                        cr_tknzr_dfa_consume (input, unit_len, 1,
+                                              &str->location);
+                        num->type = NUM_UNKNOWN_TYPE;
+                        status = cr_token_set_dimen (token, num, str);
+                        break;
+                }
+                cr_input_skip_ascii_chars (input, unit_len);
+                if (unit < 0) {
+                        status = cr_token_set_number (token, num);
+                        break;
+                }
+                num->type = gv_dfa_units[unit].num_type;
+                switch (type) {
+                case EMS_TK:
+                        status = cr_token_set_ems (token, num);
+                        break;
+                case EXS_TK:
+                        status = cr_token_set_exs (token, num);
+                        break;
+                case LENGTH_TK:
+                        status = cr_token_set_length
+                                (token, num, gv_dfa_units[unit].extra_type);
+                        break;
+                case ANGLE_TK:
+                        status = cr_token_set_angle
+                                (token, num, gv_dfa_units[unit].extra_type);
+                        break;
+                case TIME_TK:
+                        status = cr_token_set_time
+                                (token, num, gv_dfa_units[unit].extra_type);
+                        break;
+                case FREQ_TK:
+                        status = cr_token_set_freq
+                                (token, num, gv_dfa_units[unit].extra_type);
+                        break;
+                default:
+                        status = cr_token_set_percentage (token, num);
+                        break;
+                }
+                break;
+
+        case DELIM_TK:
+                cr_tknzr_dfa_consume (input, 1, 1, &token->location);
+                status = cr_token_set_delim (token, buf[0]);
+                break;
+
+        default:
+                /*
+                 *The other tokens carry no value, and are
+                 *located at their first character.
+                 */
+                cr_tknzr_dfa_consume (input, nb_bytes, 1, &token->location);
+                switch (type) {
+                case SEMICOLON_TK:
+                        status = cr_token_set_semicolon (token);
+                        break;
+                case CBC_TK:
+                        status = cr_token_set_cbc (token);
+                        break;
+                case PO_TK:
+                        status = cr_token_set_po (token);
+                        break;
+                case PC_TK:
+                        status = cr_token_set_pc (token);
+                        break;
+                case BO_TK:
+                        status = cr_token_set_bo (token);
+                        break;
+                case BC_TK:
+                        status = cr_token_set_bc (token);
+                        break;
+                case CDO_TK:
+                        status = cr_token_set_cdo (token);
+                        break;
+                case CDC_TK:
+                        status = cr_token_set_cdc (token);
+                        break;
+                case INCLUDES_TK:
+                        status = cr_token_set_includes (token);
+                        break;
+                case DASHMATCH_TK:
+                        status = cr_token_set_dashmatch (token);
+                        break;
+                case FONT_FACE_SYM_TK:
+                        status = cr_token_set_font_face_sym (token);
+                        break;
+                case CHARSET_SYM_TK:
+                        status = cr_token_set_charset_sym (token);
+                        break;
+                case IMPORT_SYM_TK:
+                        status = cr_token_set_import_sym (token);
+                        break;
+                case MEDIA_SYM_TK:
+                        status = cr_token_set_media_sym (token);
+                        break;
+                case PAGE_SYM_TK:
+                        status = cr_token_set_page_sym (token);
+                        break;
+                default:
+                        status = CR_ERROR;
+                        break;
+                }
+                break;
+        }
+
+        if (status != CR_OK) {
+                cr_tknzr_release_token (a_this, token);
+                return status;
+        }
+        *a_tk = token;
+        return CR_OK;
+
+ out_of_memory:
+        cr_utils_trace_info ("Out of memory");
+        cr_tknzr_release_token (a_this, token);
+        return CR_OUT_OF_MEMORY_ERROR;
+}
+
 /*********************************************
  *PUBLIC methods
  ********************************************/
@@ -1648,7 +2700,7 @@ cr_tknzr_new_from_uri (const guchar * a_file_uri,
         CRTknzr *result = NULL;
         CRInput *input = NULL;
 
-        input = cr_input_new_from_uri ((const gchar *) a_file_uri, a_enc);
+        input = cr_input_new_from_mmap ((const gchar *) a_file_uri, a_enc);
         g_return_val_if_fail (input != NULL, NULL);
 
         result = cr_tknzr_new (input);
@@ -1711,6 +2763,43 @@ cr_tknzr_get_input (CRTknzr * a_this, CRInput ** a_input)
  *Tokenizer input handling routines
  *********************************/
 
+/**
+ *Releases the first a_nb tokens read ahead.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_nb the number of tokens to release.
+ */
+static void
+cr_tknzr_drop_lookahead_front (CRTknzr * a_this, guint a_nb)
+{
+        while (a_nb-- && PRIVATE (a_this)->nb_lookahead) {
+                cr_tknzr_release_token (a_this, PRIVATE (a_this)->lookahead
+                                        [PRIVATE (a_this)->lookahead_start]);
+                PRIVATE (a_this)->lookahead_start =
+                        (PRIVATE (a_this)->lookahead_start + 1)
+                        % LOOKAHEAD_SIZE;
+                PRIVATE (a_this)->nb_lookahead--;
+        }
+}
+
+/**
+ *Releases the tokens read ahead and moves the input back
+ *to the start of the first of them, before a char
+ *or a byte is read from the input.
+ *@param a_this the current instance of #CRTknzr.
+ */
+static void
+cr_tknzr_drop_lookahead (CRTknzr * a_this)
+{
+        if (PRIVATE (a_this)->nb_lookahead == 0)
+                return;
+
+        cr_input_set_cur_pos (PRIVATE (a_this)->input,
+                              &PRIVATE (a_this)->lookahead_pos
+                              [PRIVATE (a_this)->lookahead_start]);
+        cr_tknzr_drop_lookahead_front (a_this,
+                                       PRIVATE (a_this)->nb_lookahead);
+}
+
 /**
  *Reads the next byte from the parser input stream.
  *@param a_this the "this pointer" of the current instance of
@@ -1725,6 +2814,8 @@ cr_tknzr_read_byte (CRTknzr * a_this, guchar * a_byte)
 {
         g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
 
+        cr_tknzr_drop_lookahead (a_this);
+
         return cr_input_read_byte (PRIVATE (a_this)->input, a_byte);
 
 }
@@ -1743,12 +2834,7 @@ cr_tknzr_read_char (CRTknzr * a_this, guint32 * a_char)
                               && PRIVATE (a_this)->input
                               && a_char, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_read_char (PRIVATE (a_this)->input, a_char);
 }
@@ -1768,12 +2854,7 @@ cr_tknzr_peek_char (CRTknzr * a_this, guint32 * a_char)
                               && PRIVATE (a_this)->input
                               && a_char, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_peek_char (PRIVATE (a_this)->input, a_char);
 }
@@ -1794,12 +2875,7 @@ cr_tknzr_peek_byte (CRTknzr * a_this, gulong a_offset, guchar * a_byte)
                               && PRIVATE (a_this)->input && a_byte,
                               CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_peek_byte (PRIVATE (a_this)->input,
                                    CR_SEEK_CUR, a_offset, a_byte);
@@ -1821,6 +2897,8 @@ cr_tknzr_peek_byte2 (CRTknzr * a_this, gulong a_offset, gboolean * a_eof)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->input, 0);
 
+        cr_tknzr_drop_lookahead (a_this);
+
         return cr_input_peek_byte2 (PRIVATE (a_this)->input, a_offset, a_eof);
 }
 
@@ -1836,12 +2914,7 @@ cr_tknzr_get_nb_bytes_left (CRTknzr * a_this)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_get_nb_bytes_left (PRIVATE (a_this)->input);
 }
@@ -1853,11 +2926,15 @@ cr_tknzr_get_cur_pos (CRTknzr * a_this, CRInputPos * a_pos)
                               && PRIVATE (a_this)->input
                               && a_pos, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
+        /*
+         *the tokens read ahead are kept: the position is the one
+         *of the start of the first of them.
+         */
+        if (PRIVATE (a_this)->nb_lookahead) {
+                memcpy (a_pos, &PRIVATE (a_this)->lookahead_pos
+                        [PRIVATE (a_this)->lookahead_start],
+                        sizeof (CRInputPos));
+                return CR_OK;
         }
 
         return cr_input_get_cur_pos (PRIVATE (a_this)->input, a_pos);
@@ -1872,6 +2949,24 @@ cr_tknzr_get_parsing_location (CRTknzr *a_this,
                               && a_loc,
                               CR_BAD_PARAM_ERROR) ;
 
+        /*
+         *As if only the next token was read ahead: the
+         *location is the one of the end of that token.
+         */
+        if (PRIVATE (a_this)->nb_lookahead > 1) {
+                CRInputPos cur_pos;
+                enum CRStatus status = CR_OK;
+
+                cr_input_get_cur_pos (PRIVATE (a_this)->input, &cur_pos);
+                cr_input_set_cur_pos (PRIVATE (a_this)->input,
+                                      &PRIVATE (a_this)->lookahead_pos
+                                      [LOOKAHEAD_INDEX (a_this, 1)]);
+                status = cr_input_get_parsing_location 
+                        (PRIVATE (a_this)->input, a_loc) ;
+                cr_input_set_cur_pos (PRIVATE (a_this)->input, &cur_pos);
+                return status;
+        }
+
         return cr_input_get_parsing_location 
                 (PRIVATE (a_this)->input, a_loc) ;
 }
@@ -1881,12 +2976,7 @@ cr_tknzr_get_cur_byte_addr (CRTknzr * a_this, guchar ** a_addr)
 {
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_get_cur_byte_addr (PRIVATE (a_this)->input, a_addr);
 }
@@ -1897,16 +2987,29 @@ cr_tknzr_seek_index (CRTknzr * a_this, enum CRSeekPos a_origin, gint a_pos)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         return cr_input_seek_index (PRIVATE (a_this)->input, a_origin, a_pos);
 }
 
+/**
+ *Releases the tokens the tokenizer has read ahead and moves
+ *the input back to the start of the first of them, so that
+ *the next token is scanned again from the input.
+ *@param a_this the current instance of #CRTknzr.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_tknzr_flush_lookahead (CRTknzr * a_this)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
+
+        cr_tknzr_drop_lookahead (a_this);
+
+        return CR_OK;
+}
+
 enum CRStatus
 cr_tknzr_consume_chars (CRTknzr * a_this, guint32 a_char, glong * a_nb_char)
 {
@@ -1915,12 +3018,7 @@ cr_tknzr_consume_chars (CRTknzr * a_this, guint32 a_char, glong * a_nb_char)
         g_return_val_if_fail (a_this && PRIVATE (a_this)
                               && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_input_set_cur_pos (PRIVATE (a_this)->input,
-                                      &PRIVATE (a_this)->prev_pos);
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
-        }
+        cr_tknzr_drop_lookahead (a_this);
 
         status = cr_input_consume_chars (PRIVATE (a_this)->input,
                                          a_char, &consumed);
@@ -1932,24 +3030,212 @@ enum CRStatus
 cr_tknzr_set_cur_pos (CRTknzr * a_this, CRInputPos * a_pos)
 {
         g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && PRIVATE (a_this)->input, CR_BAD_PARAM_ERROR);
+                              && PRIVATE (a_this)->input
+                              && a_pos, CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
+        /*
+         *Going back to the start of a token read ahead,
+         *or to the end of the last of them, keeps the
+         *tokens that follow, so they are not scanned again.
+         */
+        if (PRIVATE (a_this)->nb_lookahead) {
+                CRInputPos cur_pos;
+                guint i = 0;
+
+                for (i = 0; i < PRIVATE (a_this)->nb_lookahead; i++) {
+                        if (PRIVATE (a_this)->lookahead_pos
+                            [LOOKAHEAD_INDEX (a_this, i)].next_byte_index
+                            == a_pos->next_byte_index)
+                                break;
+                }
+                if (i < PRIVATE (a_this)->nb_lookahead) {
+                        cr_tknzr_drop_lookahead_front (a_this, i);
+                        return CR_OK;
+                }
+                cr_input_get_cur_pos (PRIVATE (a_this)->input, &cur_pos);
+                cr_tknzr_drop_lookahead_front
+                        (a_this, PRIVATE (a_this)->nb_lookahead);
+                if (cur_pos.next_byte_index == a_pos->next_byte_index)
+                        return CR_OK;
         }
 
         return cr_input_set_cur_pos (PRIVATE (a_this)->input, a_pos);
 }
 
+/**
+ *Puts back the token returned by the last call to
+ *cr_tknzr_get_next_token(), so that the next call returns it again.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_token the token to put back.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
 enum CRStatus
 cr_tknzr_unget_token (CRTknzr * a_this, CRToken * a_token)
 {
         g_return_val_if_fail (a_this && PRIVATE (a_this)
-                              && PRIVATE (a_this)->token_cache == NULL,
+                              && a_token
+                              && PRIVATE (a_this)->nb_lookahead
+                              < LOOKAHEAD_SIZE,
                               CR_BAD_PARAM_ERROR);
 
-        PRIVATE (a_this)->token_cache = a_token;
+        PRIVATE (a_this)->lookahead_start =
+                (PRIVATE (a_this)->lookahead_start + LOOKAHEAD_SIZE - 1)
+                % LOOKAHEAD_SIZE;
+        PRIVATE (a_this)->lookahead[PRIVATE (a_this)->lookahead_start] =
+                a_token;
+        memcpy (&PRIVATE (a_this)->lookahead_pos
+                [PRIVATE (a_this)->lookahead_start],
+                &PRIVATE (a_this)->prev_pos, sizeof (CRInputPos));
+        PRIVATE (a_this)->nb_lookahead++;
+
+        return CR_OK;
+}
+
+/**
+ *Peeks the a_n-th next token of the input stream, without
+ *consuming it: the next calls to cr_tknzr_get_next_token() return
+ *the tokens peeked, without scanning them again.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_n the index of the token to peek, 0 being the index
+ *of the token cr_tknzr_get_next_token() returns next.
+ *Must be smaller than 8.
+ *@param a_tk out parameter. The peeked token. It still belongs
+ *to the tokenizer and must not be released, nor modified.
+ *@return CR_OK upon successfull completion, CR_END_OF_INPUT_ERROR
+ *if the input ends before the a_n-th token, an error code otherwise.
+ */
+enum CRStatus
+cr_tknzr_peek_token (CRTknzr * a_this, guint a_n, CRToken ** a_tk)
+{
+        enum CRStatus status = CR_OK;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this)
+                              && PRIVATE (a_this)->input
+                              && a_n < LOOKAHEAD_SIZE
+                              && a_tk, CR_BAD_PARAM_ERROR);
+
+        while (PRIVATE (a_this)->nb_lookahead <= a_n) {
+                CRToken *token = NULL;
+                CRInputPos pos,
+                        prev_pos;
+                guint nb_lookahead = PRIVATE (a_this)->nb_lookahead,
+                        index = LOOKAHEAD_INDEX (a_this, nb_lookahead);
+
+                /*
+                 *the input stands at the end of the ring: scan
+                 *the next token from there, the ring being put
+                 *aside for a moment.
+                 */
+                cr_input_get_cur_pos (PRIVATE (a_this)->input, &pos);
+                memcpy (&prev_pos, &PRIVATE (a_this)->prev_pos,
+                        sizeof (CRInputPos));
+                PRIVATE (a_this)->nb_lookahead = 0;
+                status = cr_tknzr_get_next_token (a_this, &token);
+                PRIVATE (a_this)->nb_lookahead = nb_lookahead;
+                memcpy (&PRIVATE (a_this)->prev_pos, &prev_pos,
+                        sizeof (CRInputPos));
+                if (status != CR_OK)
+                        return status;
+
+                PRIVATE (a_this)->lookahead[index] = token;
+                memcpy (&PRIVATE (a_this)->lookahead_pos[index], &pos,
+                        sizeof (CRInputPos));
+                PRIVATE (a_this)->nb_lookahead++;
+        }
+
+        *a_tk = PRIVATE (a_this)->lookahead[LOOKAHEAD_INDEX (a_this, a_n)];
+
+        return CR_OK;
+}
+
+/**
+ *Gives back a token returned by cr_tknzr_get_next_token()
+ *once the caller is done with it. The token is cleared and kept
+ *around to be reused by the next calls to cr_tknzr_get_next_token(),
+ *so tokenizing does not allocate a new #CRToken for each token.
+ *Steal the payload of the token (by setting the relevant
+ *field to NULL) before releasing it to keep the payload alive.
+ *@param a_this the current instance of #CRTknzr. If NULL,
+ *the token is destroyed.
+ *@param a_token the token to release.
+ */
+void
+cr_tknzr_release_token (CRTknzr * a_this, CRToken * a_token)
+{
+        g_return_if_fail (a_token);
+
+        if (a_this == NULL || PRIVATE (a_this) == NULL
+            || PRIVATE (a_this)->nr_pooled_tokens >= TOKEN_POOL_SIZE) {
+                cr_token_destroy (a_token);
+                return;
+        }
+
+        cr_token_reset (a_token);
+        PRIVATE (a_this)->token_pool
+                [PRIVATE (a_this)->nr_pooled_tokens++] = a_token;
+}
+
+/**
+ *Sets whether cr_tknzr_get_next_token() recognizes the tokens
+ *with the table driven automaton, in one forward pass over the
+ *input, or with the cr_tknzr_parse_*() routines. Both give the
+ *same tokens; the automaton leaves the tokens involving escapes,
+ *non ascii characters, url() or rgb() to the routines.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_use_dfa TRUE to use the automaton.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_tknzr_set_use_dfa (CRTknzr * a_this, gboolean a_use_dfa)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        PRIVATE (a_this)->use_dfa = a_use_dfa;
+
+        return CR_OK;
+}
+
+/**
+ *Gets whether cr_tknzr_get_next_token() uses the table
+ *driven automaton. See cr_tknzr_set_use_dfa().
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_use_dfa out parameter. TRUE if the automaton is used.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_tknzr_get_use_dfa (CRTknzr const * a_this, gboolean * a_use_dfa)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this) && a_use_dfa,
+                              CR_BAD_PARAM_ERROR);
+
+        *a_use_dfa = PRIVATE (a_this)->use_dfa;
+
+        return CR_OK;
+}
+
+/**
+ *Gets the number of tokens, and of bytes, scanned from the input
+ *of the tokenizer so far. Tokens scanned again after the
+ *position of the tokenizer has been moved backward are counted
+ *each time, so comparing the number of bytes scanned to the length
+ *of the input gives how many times each byte has been tokenized.
+ *@param a_this the current instance of #CRTknzr.
+ *@param a_nb_tokens out parameter. The number of tokens scanned.
+ *Can be NULL.
+ *@param a_nb_bytes out parameter. The number of bytes scanned.
+ *Can be NULL.
+ *@return CR_OK upon successfull completion, an error code otherwise.
+ */
+enum CRStatus
+cr_tknzr_get_scan_stats (CRTknzr const * a_this, gulong * a_nb_tokens,
+                         gulong * a_nb_bytes)
+{
+        g_return_val_if_fail (a_this && PRIVATE (a_this), CR_BAD_PARAM_ERROR);
+
+        if (a_nb_tokens)
+                *a_nb_tokens = PRIVATE (a_this)->nb_tokens_scanned;
+        if (a_nb_bytes)
+                *a_nb_bytes = PRIVATE (a_this)->nb_bytes_scanned;
 
         return CR_OK;
 }
@@ -1984,9 +3270,16 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
                               && PRIVATE (a_this)->input, 
                               CR_BAD_PARAM_ERROR);
 
-        if (PRIVATE (a_this)->token_cache) {
-                *a_tk = PRIVATE (a_this)->token_cache;
-                PRIVATE (a_this)->token_cache = NULL;
+        if (PRIVATE (a_this)->nb_lookahead) {
+                guint index = PRIVATE (a_this)->lookahead_start;
+
+                *a_tk = PRIVATE (a_this)->lookahead[index];
+                memcpy (&PRIVATE (a_this)->prev_pos,
+                        &PRIVATE (a_this)->lookahead_pos[index],
+                        sizeof (CRInputPos));
+                PRIVATE (a_this)->lookahead_start =
+                        (index + 1) % LOOKAHEAD_SIZE;
+                PRIVATE (a_this)->nb_lookahead--;
                 return CR_OK;
         }
 
@@ -2003,8 +3296,16 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
 
         input = PRIVATE (a_this)->input;
 
+        if (PRIVATE (a_this)->use_dfa == TRUE) {
+                status = cr_tknzr_dfa_get_next_token (a_this, &token);
+                if (status != CR_OK)
+                        goto error;
+                if (token)
+                        goto done;
+        }
+
         PEEK_NEXT_CHAR (a_this, &next_char);
-        token = cr_token_new ();
+        token = cr_tknzr_new_token (a_this);
         ENSURE_PARSING_COND (token);
 
         switch (next_char) {
@@ -2224,16 +3525,18 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
 
         case '/':
                 if (BYTE (input, 2, NULL) == '*') {
-                        status = cr_tknzr_parse_comment (a_this, &str);
+                        const guchar *start = NULL;
+                        gulong len = 0;
+
+                        status = cr_tknzr_parse_comment (a_this, &start,
+                                                         &len, &location);
 
                         if (status == CR_OK) {
-                                status = cr_token_set_comment (token, str);
-                                str = NULL;
+                                status = cr_token_set_comment_slice
+                                        (token, start, len);
                                 CHECK_PARSING_STATUS (status, TRUE);
-                                if (str) {
-                                        cr_parsing_location_copy (&token->location, 
-                                                                  &str->location) ;
-                                }
+                                cr_parsing_location_copy (&token->location, 
+                                                          &location) ;
                                 goto done;
                         }
                 }
@@ -2601,6 +3904,12 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
  done:
 
         if (status == CR_OK && token) {
+                glong index = 0;
+
+                cr_input_get_cur_index (PRIVATE (a_this)->input, &index);
+                PRIVATE (a_this)->nb_tokens_scanned++;
+                PRIVATE (a_this)->nb_bytes_scanned +=
+                        index - init_pos.next_byte_index;
                 *a_tk = token;
                 /*
                  *store the previous position input stream pos.
@@ -2612,7 +3921,7 @@ cr_tknzr_get_next_token (CRTknzr * a_this, CRToken ** a_tk)
 
  error:
         if (token) {
-                cr_token_destroy (token);
+                cr_tknzr_release_token (a_this, token);
                 token = NULL;
         }
 
@@ -2665,13 +3974,23 @@ cr_tknzr_parse_token (CRTknzr * a_this, enum CRTokenType a_type,
                 case HASH_TK:
                 case ATKEYWORD_TK:
                 case FUNCTION_TK:
-                case COMMENT_TK:
                 case URI_TK:
                         *((CRString **) a_res) = token->u.str;
                         token->u.str = NULL;
                         status = CR_OK;
                         break;
 
+                case COMMENT_TK:
+                        if (token->u.str) {
+                                *((CRString **) a_res) = token->u.str;
+                                token->u.str = NULL;
+                        } else {
+                                *((CRString **) a_res) =
+                                        cr_token_dup_slice (token);
+                        }
+                        status = CR_OK;
+                        break;
+
                 case EMS_TK:
                 case EXS_TK:
                 case PERCENTAGE_TK:
@@ -2716,7 +4035,7 @@ cr_tknzr_parse_token (CRTknzr * a_this, enum CRTokenType a_type,
                         break;
                 }
 
-                cr_token_destroy (token);
+                cr_tknzr_release_token (a_this, token);
                 token = NULL;
         } else {
                 cr_tknzr_unget_token (a_this, token);
@@ -2748,9 +4067,19 @@ cr_tknzr_destroy (CRTknzr * a_this)
                 }
         }
 
-        if (PRIVATE (a_this)->token_cache) {
-                cr_token_destroy (PRIVATE (a_this)->token_cache);
-                PRIVATE (a_this)->token_cache = NULL;
+        while (PRIVATE (a_this)->nb_lookahead) {
+                cr_token_destroy (PRIVATE (a_this)->lookahead
+                                  [PRIVATE (a_this)->lookahead_start]);
+                PRIVATE (a_this)->lookahead_start =
+                        (PRIVATE (a_this)->lookahead_start + 1)
+                        % LOOKAHEAD_SIZE;
+                PRIVATE (a_this)->nb_lookahead--;
+        }
+
+        while (PRIVATE (a_this)->nr_pooled_tokens) {
+                PRIVATE (a_this)->nr_pooled_tokens--;
+                cr_token_destroy (PRIVATE (a_this)->token_pool
+                                  [PRIVATE (a_this)->nr_pooled_tokens]);
         }
 
         if (PRIVATE (a_this)) {
@@ -90,6 +90,8 @@ enum CRStatus cr_tknzr_seek_index (CRTknzr *a_this,
                                    enum CRSeekPos a_origin,
                                    gint a_pos) ;
 
+enum CRStatus cr_tknzr_flush_lookahead (CRTknzr *a_this) ;
+
 enum CRStatus cr_tknzr_get_cur_byte_addr (CRTknzr *a_this, guchar **a_addr) ;
 
 
@@ -100,6 +102,20 @@ enum CRStatus cr_tknzr_get_next_token (CRTknzr *a_this, CRToken ** a_tk) ;
 
 enum CRStatus cr_tknzr_unget_token (CRTknzr *a_this, CRToken *a_token) ;
 
+enum CRStatus cr_tknzr_peek_token (CRTknzr *a_this, guint a_n,
+                                   CRToken **a_tk) ;
+
+void cr_tknzr_release_token (CRTknzr *a_this, CRToken *a_token) ;
+
+enum CRStatus cr_tknzr_set_use_dfa (CRTknzr *a_this, gboolean a_use_dfa) ;
+
+enum CRStatus cr_tknzr_get_use_dfa (CRTknzr const *a_this,
+                                    gboolean *a_use_dfa) ;
+
+enum CRStatus cr_tknzr_get_scan_stats (CRTknzr const *a_this,
+                                       gulong *a_nb_tokens,
+                                       gulong *a_nb_bytes) ;
+
 
 enum CRStatus cr_tknzr_parse_token (CRTknzr *a_this, enum CRTokenType a_type,
                                     enum CRTokenExtraType a_et, gpointer a_res,
@@ -123,6 +123,8 @@ cr_token_clear (CRToken * a_this)
         }
 
         a_this->type = NO_TK;
+        a_this->slice = NULL;
+        a_this->slice_len = 0;
 }
 
 /**
@@ -147,6 +149,27 @@ cr_token_new (void)
         return result;
 }
 
+/**
+ *Frees the attributes of the current instance of #CRToken
+ *and resets it to the state of a newly built token, so
+ *that it can be reused.
+ *@param a_this the current instance of #CRToken.
+ */
+void
+cr_token_reset (CRToken * a_this)
+{
+        g_return_if_fail (a_this);
+
+        cr_token_clear (a_this);
+
+        if (a_this->dimen) {
+                cr_string_destroy (a_this->dimen);
+                a_this->dimen = NULL;
+        }
+
+        memset (a_this, 0, sizeof (CRToken));
+}
+
 /**
  *Sets the type of curren instance of
  *#CRToken to 'S_TK' (S in the css2 spec)
@@ -253,6 +276,63 @@ cr_token_set_comment (CRToken * a_this, CRString * a_str)
         return CR_OK;
 }
 
+/**
+ *Sets the type of the current instance of #CRToken
+ *to COMMENT_TK, without copying the text of the comment.
+ *The token just refers to the text, in the buffer
+ *of the input it has been read from.
+ *@param a_this the current instance of #CRToken.
+ *@param a_start the first byte of the comment text.
+ *@param a_len the length of the comment text, in bytes.
+ *@return CR_OK upon successfull completion, an error
+ *code otherwise.
+ */
+enum CRStatus
+cr_token_set_comment_slice (CRToken * a_this,
+                            const guchar * a_start, gulong a_len)
+{
+        g_return_val_if_fail (a_this && (a_start || !a_len),
+                              CR_BAD_PARAM_ERROR);
+
+        cr_token_clear (a_this);
+        a_this->type = COMMENT_TK;
+        a_this->slice = a_start;
+        a_this->slice_len = a_len;
+        return CR_OK;
+}
+
+/**
+ *Copies the text the current instance of #CRToken
+ *refers to in the input buffer into a new #CRString.
+ *The location of the new string is the location of the token.
+ *@param a_this the current instance of #CRToken.
+ *@return the new string, or NULL if the token does not
+ *refer to the input buffer. The caller must free it using
+ *cr_string_destroy().
+ */
+CRString *
+cr_token_dup_slice (CRToken const * a_this)
+{
+        CRString *result = NULL;
+
+        g_return_val_if_fail (a_this, NULL);
+
+        if (a_this->slice == NULL)
+                return NULL;
+
+        result = cr_string_new ();
+        if (result == NULL) {
+                cr_utils_trace_info ("Out of memory");
+                return NULL;
+        }
+        g_string_append_len (result->stryng,
+                             (const gchar *) a_this->slice,
+                             a_this->slice_len);
+        cr_parsing_location_copy (&result->location,
+                                  &a_this->location);
+        return result;
+}
+
 enum CRStatus
 cr_token_set_string (CRToken * a_this, CRString * a_str)
 {
@@ -114,10 +114,23 @@ struct _CRToken
 
         CRString * dimen ;
         CRParsingLocation location ;
+
+        /**
+         *The text of the token, as a slice of the
+         *buffer of the #CRInput it has been read from.
+         *Only set for the tokens whose text is not copied out
+         *of the input, like the comments returned by the
+         *tokenizer. The token does not own these bytes, so they
+         *are only valid as long as the input buffer is.
+         */
+        const guchar *slice ;
+        gulong slice_len ;
 } ;
 
 CRToken* cr_token_new (void) ;
 
+void cr_token_reset (CRToken *a_this) ;
+
 enum CRStatus cr_token_set_s (CRToken *a_this) ;
 
 enum CRStatus cr_token_set_cdo (CRToken *a_this) ;
@@ -130,6 +143,12 @@ enum CRStatus cr_token_set_dashmatch (CRToken *a_this) ;
 
 enum CRStatus cr_token_set_comment (CRToken *a_this, CRString *a_str) ;
 
+enum CRStatus cr_token_set_comment_slice (CRToken *a_this,
+                                          const guchar *a_start,
+                                          gulong a_len) ;
+
+CRString * cr_token_dup_slice (CRToken const *a_this) ;
+
 enum CRStatus cr_token_set_string (CRToken *a_this, CRString *a_str) ;
 
 enum CRStatus cr_token_set_ident (CRToken *a_this, CRString * a_ident) ;
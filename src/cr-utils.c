@@ -24,6 +24,12 @@
 #include "cr-utils.h"
 #include "cr-string.h"
 
+#if defined (__AVX2__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /**
  *@file:
  *Some misc utility functions used
@@ -1250,6 +1256,256 @@ cr_utils_is_nonascii (guint32 a_char)
         return TRUE;
 }
 
+/*
+ *The scanners below look at 32 bytes at a time when the library is
+ *built for AVX2, at 16 bytes at a time when it is built for SSE2, and
+ *fall back to a byte by byte loop otherwise and on the tail of the
+ *buffer. All the vector loads are unaligned and never go past
+ *a_buf + a_len.
+ */
+
+#if defined (__AVX2__)
+#define VECTOR_SIZE 32
+typedef __m256i CRVector;
+#define VECTOR_LOAD(p) _mm256_loadu_si256 ((const __m256i *) (p))
+#define VECTOR_SET1(c) _mm256_set1_epi8 ((char) (c))
+#define VECTOR_EQ(a, b) _mm256_cmpeq_epi8 ((a), (b))
+#define VECTOR_GT(a, b) _mm256_cmpgt_epi8 ((a), (b))
+#define VECTOR_OR(a, b) _mm256_or_si256 ((a), (b))
+#define VECTOR_AND(a, b) _mm256_and_si256 ((a), (b))
+#define VECTOR_MASK(a) ((guint32) _mm256_movemask_epi8 (a))
+#define VECTOR_FULL_MASK 0xffffffffU
+#elif defined (__SSE2__)
+#define VECTOR_SIZE 16
+typedef __m128i CRVector;
+#define VECTOR_LOAD(p) _mm_loadu_si128 ((const __m128i *) (p))
+#define VECTOR_SET1(c) _mm_set1_epi8 ((char) (c))
+#define VECTOR_EQ(a, b) _mm_cmpeq_epi8 ((a), (b))
+#define VECTOR_GT(a, b) _mm_cmpgt_epi8 ((a), (b))
+#define VECTOR_OR(a, b) _mm_or_si128 ((a), (b))
+#define VECTOR_AND(a, b) _mm_and_si128 ((a), (b))
+#define VECTOR_MASK(a) ((guint32) _mm_movemask_epi8 (a))
+#define VECTOR_FULL_MASK 0xffffU
+#endif
+
+#define IS_ASCII_CHAR(c) ((c) && (c) < 0x80)
+
+#define IS_ASCII_WHITE_SPACE(c) \
+((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r' || (c) == '\f')
+
+#define IS_ASCII_NMCHAR(c) \
+(((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') \
+ || ((c) >= '0' && (c) <= '9') || (c) == '-' || (c) == '_')
+
+/**
+ *Gets the length of the run of white spaces (as defined
+ *by cr_utils_is_white_space()) located at the beginning of a buffer.
+ *@param a_buf the buffer to scan.
+ *@param a_len the length of a_buf, in bytes.
+ *@return the number of leading white space bytes of a_buf.
+ */
+gulong
+cr_utils_span_white_spaces (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_buf || !a_len, 0);
+
+#ifdef VECTOR_SIZE
+        {
+                CRVector space = VECTOR_SET1 (' '),
+                        tab = VECTOR_SET1 ('\t'),
+                        lf = VECTOR_SET1 ('\n'),
+                        cr = VECTOR_SET1 ('\r'),
+                        ff = VECTOR_SET1 ('\f');
+
+                for (; i + VECTOR_SIZE <= a_len; i += VECTOR_SIZE) {
+                        CRVector chunk = VECTOR_LOAD (a_buf + i);
+                        guint32 mask = VECTOR_MASK
+                                (VECTOR_OR
+                                 (VECTOR_OR (VECTOR_EQ (chunk, space),
+                                             VECTOR_EQ (chunk, tab)),
+                                  VECTOR_OR (VECTOR_OR (VECTOR_EQ (chunk, lf),
+                                                        VECTOR_EQ (chunk, cr)),
+                                             VECTOR_EQ (chunk, ff))));
+
+                        if (mask != VECTOR_FULL_MASK)
+                                return i + g_bit_nth_lsf (~mask, -1);
+                }
+        }
+#endif
+        for (; i < a_len; i++) {
+                if (!IS_ASCII_WHITE_SPACE (a_buf[i]))
+                        break;
+        }
+        return i;
+}
+
+/**
+ *Gets the length of the run of ascii name characters,
+ *that is, of characters in [a-zA-Z0-9_-], located at the
+ *beginning of a buffer. This is the part of the
+ *nmchar production of the css spec that needs neither
+ *escapes nor utf8 decoding.
+ *@param a_buf the buffer to scan.
+ *@param a_len the length of a_buf, in bytes.
+ *@return the number of leading ascii name character bytes of a_buf.
+ */
+gulong
+cr_utils_span_ascii_nmchars (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_buf || !a_len, 0);
+
+#ifdef VECTOR_SIZE
+        {
+                /*
+                 *The comparisons are signed, so the bytes >= 0x80
+                 *are negative and fail all the lower bounds.
+                 */
+                CRVector case_bit = VECTOR_SET1 (0x20),
+                        before_a = VECTOR_SET1 ('a' - 1),
+                        after_z = VECTOR_SET1 ('z' + 1),
+                        before_0 = VECTOR_SET1 ('0' - 1),
+                        after_9 = VECTOR_SET1 ('9' + 1),
+                        dash = VECTOR_SET1 ('-'),
+                        underscore = VECTOR_SET1 ('_');
+
+                for (; i + VECTOR_SIZE <= a_len; i += VECTOR_SIZE) {
+                        CRVector chunk = VECTOR_LOAD (a_buf + i),
+                                lower = VECTOR_OR (chunk, case_bit),
+                                alpha, digit;
+                        guint32 mask = 0;
+
+                        alpha = VECTOR_AND (VECTOR_GT (lower, before_a),
+                                            VECTOR_GT (after_z, lower));
+                        digit = VECTOR_AND (VECTOR_GT (chunk, before_0),
+                                            VECTOR_GT (after_9, chunk));
+                        mask = VECTOR_MASK
+                                (VECTOR_OR
+                                 (VECTOR_OR (alpha, digit),
+                                  VECTOR_OR (VECTOR_EQ (chunk, dash),
+                                             VECTOR_EQ (chunk, underscore))));
+
+                        if (mask != VECTOR_FULL_MASK)
+                                return i + g_bit_nth_lsf (~mask, -1);
+                }
+        }
+#endif
+        for (; i < a_len; i++) {
+                if (!IS_ASCII_NMCHAR (a_buf[i]))
+                        break;
+        }
+        return i;
+}
+
+/**
+ *Tells whether a buffer only holds ascii characters, that is,
+ *bytes in [0x01, 0x7F], each of them being a whole character that
+ *cr_utils_read_char_from_utf8_buf() decodes as itself.
+ *@param a_buf the buffer to scan.
+ *@param a_len the length of a_buf, in bytes.
+ *@return TRUE if a_buf only holds ascii characters, FALSE otherwise.
+ */
+gboolean
+cr_utils_is_ascii (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        g_return_val_if_fail (a_buf || !a_len, FALSE);
+
+#ifdef VECTOR_SIZE
+        {
+                CRVector zero = VECTOR_SET1 (0);
+
+                for (; i + VECTOR_SIZE <= a_len; i += VECTOR_SIZE) {
+                        CRVector chunk = VECTOR_LOAD (a_buf + i);
+
+                        if (VECTOR_MASK (VECTOR_OR (chunk,
+                                                    VECTOR_EQ (chunk, zero))))
+                                return FALSE;
+                }
+        }
+#endif
+        for (; i < a_len; i++) {
+                if (!IS_ASCII_CHAR (a_buf[i]))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Looks for the "*" "/" sequence that ends a comment.
+ *@param a_buf the buffer to scan, starting right after the
+ *"/" "*" sequence that opens the comment.
+ *@param a_len the length of a_buf, in bytes.
+ *@param a_is_ascii out parameter. Set to TRUE if all
+ *the bytes located before the returned address are ascii
+ *characters, as defined by cr_utils_is_ascii(). Can be NULL.
+ *@return the address of the "*" of the first "*" "/" sequence
+ *of a_buf, or NULL if a_buf holds no such sequence.
+ */
+const guchar *
+cr_utils_find_comment_end (const guchar * a_buf, gulong a_len,
+                           gboolean * a_is_ascii)
+{
+        gulong i = 0;
+        gboolean is_ascii = TRUE;
+
+        g_return_val_if_fail (a_buf || !a_len, NULL);
+
+        if (a_is_ascii)
+                *a_is_ascii = FALSE;
+
+#ifdef VECTOR_SIZE
+        {
+                CRVector star = VECTOR_SET1 ('*'),
+                        slash = VECTOR_SET1 ('/'),
+                        zero = VECTOR_SET1 (0);
+                guint32 non_ascii = 0;
+
+                /*
+                 *Compare each byte to '*' and the byte that
+                 *follows it to '/', hence the extra byte.
+                 */
+                for (; i + VECTOR_SIZE + 1 <= a_len; i += VECTOR_SIZE) {
+                        CRVector chunk = VECTOR_LOAD (a_buf + i);
+                        guint32 mask = VECTOR_MASK
+                                (VECTOR_AND
+                                 (VECTOR_EQ (chunk, star),
+                                  VECTOR_EQ (VECTOR_LOAD (a_buf + i + 1),
+                                             slash)));
+                        guint32 chunk_non_ascii = VECTOR_MASK
+                                (VECTOR_OR (chunk, VECTOR_EQ (chunk, zero)));
+
+                        if (mask) {
+                                gint end = g_bit_nth_lsf (mask, -1);
+
+                                non_ascii |= chunk_non_ascii
+                                        & ((1U << end) - 1);
+                                if (a_is_ascii)
+                                        *a_is_ascii = non_ascii == 0;
+                                return a_buf + i + end;
+                        }
+                        non_ascii |= chunk_non_ascii;
+                }
+                if (non_ascii)
+                        is_ascii = FALSE;
+        }
+#endif
+        for (; i + 1 < a_len; i++) {
+                if (a_buf[i] == '*' && a_buf[i + 1] == '/') {
+                        if (a_is_ascii)
+                                *a_is_ascii = is_ascii;
+                        return a_buf + i;
+                }
+                if (!IS_ASCII_CHAR (a_buf[i]))
+                        is_ascii = FALSE;
+        }
+        return NULL;
+}
+
 /**
  *Dumps a character a_nb times on a file.
  *@param a_char the char to dump
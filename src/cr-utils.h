@@ -221,6 +221,19 @@ cr_utils_is_nonascii (guint32 a_char) ;
 gboolean
 cr_utils_is_hexa_char (guint32 a_char) ;
 
+gboolean
+cr_utils_is_ascii (const guchar *a_buf, gulong a_len) ;
+
+gulong
+cr_utils_span_white_spaces (const guchar *a_buf, gulong a_len) ;
+
+gulong
+cr_utils_span_ascii_nmchars (const guchar *a_buf, gulong a_len) ;
+
+const guchar *
+cr_utils_find_comment_end (const guchar *a_buf, gulong a_len,
+                           gboolean *a_is_ascii) ;
+
 
 /**********************************
  *Miscellaneous utility functions
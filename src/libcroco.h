@@ -24,6 +24,8 @@
 #include "libcroco-config.h"
 
 #include "cr-utils.h"
+#include "cr-atom.h"
+#include "cr-arena.h"
 #include "cr-pseudo.h"
 #include "cr-term.h"
 #include "cr-attr-sel.h"
@@ -37,7 +39,13 @@
 #include "cr-stylesheet.h"
 #include "cr-om-parser.h"
 #include "cr-prop-list.h"
+#include "cr-media-context.h"
+#include "cr-node-iface.h"
+#include "cr-libxml-node-iface.h"
+#include "cr-sel-prog.h"
+#include "cr-rule-index.h"
 #include "cr-sel-eng.h"
+#include "cr-style-stream.h"
 #include "cr-style.h"
 #include "cr-string.h"
 
@@ -0,0 +1,277 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the parallel parsing of a stylesheet
+ *(cr_om_parser_set_nb_threads()) builds the same
+ *object model as the parsing in a single thread.
+ */
+
+/**
+ *The stylesheet parsed is the file given in argument,
+ *repeated until it is at least that big, so that it
+ *is split in several chunks.
+ */
+#define SHEET_SIZE (256 * 1024)
+
+#define NB_THREADS 4
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  dump_location (GString * a_str, CRParsingLocation * a_loc);
+
+static void
+  dump_declarations (GString * a_str, CRDeclaration * a_decls);
+
+static void
+  dump_statements (GString * a_str, CRStatement * a_stmts,
+                   CRStyleSheet * a_sheet);
+
+static GString *
+  parse_and_dump (guchar * a_buf, gulong a_len, guint a_nb_threads,
+                  gboolean a_use_arena, gint * a_nb_stmts);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Parses a big stylesheet made of copies of "
+                 "the file in one thread,\nthen in %d threads, and "
+                 "compares the resulting object models.\n",
+                 NB_THREADS);
+        fprintf (stdout, "Returns OK if they are identical, "
+                 "KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CROMParser class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+dump_location (GString * a_str, CRParsingLocation * a_loc)
+{
+        g_string_append_printf (a_str, " @%u:%u:%u", a_loc->line,
+                                a_loc->column, a_loc->byte_offset);
+}
+
+static void
+dump_declarations (GString * a_str, CRDeclaration * a_decls)
+{
+        CRDeclaration *cur = NULL;
+        CRTerm *term = NULL;
+
+        for (cur = a_decls; cur; cur = cur->next) {
+                g_string_append (a_str, "  declaration");
+                dump_location (a_str, &cur->location);
+                for (term = cur->value; term; term = term->next)
+                        dump_location (a_str, &term->location);
+                g_string_append (a_str, "\n");
+        }
+}
+
+/**
+ *Dumps statements, with the parsing locations of their
+ *parts and the consistency of their links.
+ */
+static void
+dump_statements (GString * a_str, CRStatement * a_stmts,
+                 CRStyleSheet * a_sheet)
+{
+        CRStatement *cur = NULL;
+        CRSelector *sel = NULL;
+        guchar *str = NULL;
+
+        for (cur = a_stmts; cur; cur = cur->next) {
+                str = (guchar *) cr_statement_to_string (cur, 0);
+                if (str) {
+                        g_string_append_printf (a_str, "%s\n", str);
+                        g_free (str);
+                        str = NULL;
+                }
+                g_string_append (a_str, "statement");
+                dump_location (a_str, &cur->location);
+                if (cur->parent_sheet != a_sheet)
+                        g_string_append (a_str, " (bad parent sheet)");
+                if (cur->next && cur->next->prev != cur)
+                        g_string_append (a_str, " (bad next statement)");
+                g_string_append (a_str, "\n");
+
+                switch (cur->type) {
+                case RULESET_STMT:
+                        for (sel = cur->kind.ruleset->sel_list;
+                             sel; sel = sel->next) {
+                                g_string_append (a_str, "  selector");
+                                dump_location (a_str, &sel->location);
+                                g_string_append (a_str, "\n");
+                        }
+                        dump_declarations (a_str,
+                                           cur->kind.ruleset->decl_list);
+                        break;
+                case AT_MEDIA_RULE_STMT:
+                        dump_statements (a_str,
+                                         cur->kind.media_rule->rulesets,
+                                         a_sheet);
+                        break;
+                case AT_PAGE_RULE_STMT:
+                        dump_declarations (a_str,
+                                           cur->kind.page_rule->decl_list);
+                        break;
+                case AT_FONT_FACE_RULE_STMT:
+                        dump_declarations
+                                (a_str, cur->kind.font_face_rule->decl_list);
+                        break;
+                default:
+                        break;
+                }
+        }
+}
+
+/**
+ *Parses a buffer and dumps the resulting stylesheet.
+ *@param a_buf the buffer to parse.
+ *@param a_len the length of a_buf.
+ *@param a_nb_threads the number of threads to parse a_buf with.
+ *@param a_use_arena whether to parse a_buf in arena mode.
+ *@param a_nb_stmts out parameter. The number of top level
+ *statements of the stylesheet.
+ *@return the dump, or NULL if the parsing failed.
+ */
+static GString *
+parse_and_dump (guchar * a_buf, gulong a_len, guint a_nb_threads,
+                gboolean a_use_arena, gint * a_nb_stmts)
+{
+        CROMParser *parser = NULL;
+        CRStyleSheet *sheet = NULL;
+        enum CRStatus status = CR_OK;
+        GString *result = NULL;
+
+        parser = cr_om_parser_new (NULL);
+        g_return_val_if_fail (parser, NULL);
+        cr_om_parser_set_nb_threads (parser, a_nb_threads);
+        cr_om_parser_set_use_arena (parser, a_use_arena);
+
+        status = cr_om_parser_parse_buf (parser, a_buf, a_len,
+                                         CR_UTF_8, &sheet);
+        cr_om_parser_destroy (parser);
+        if (status != CR_OK || !sheet)
+                return NULL;
+
+        result = g_string_new (NULL);
+        dump_statements (result, sheet->statements, sheet);
+        *a_nb_stmts = cr_stylesheet_nr_rules (sheet);
+        cr_stylesheet_destroy (sheet);
+        return result;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        gchar *buf = NULL;
+        gsize len = 0;
+        GString *sheet = NULL,
+                *serial = NULL,
+                *parallel = NULL;
+        gint nb_stmts = 0,
+                nb_parallel_stmts = 0;
+        gboolean is_ok = TRUE;
+        gint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (!g_file_get_contents (options.files_list[0], &buf, &len, NULL)
+            || !len) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        sheet = g_string_new (NULL);
+        while (sheet->len < SHEET_SIZE)
+                g_string_append_len (sheet, buf, len);
+        g_free (buf);
+
+        serial = parse_and_dump ((guchar *) sheet->str, sheet->len, 1,
+                                 FALSE, &nb_stmts);
+        if (!serial) {
+                fprintf (stdout, "KO\n");
+                g_string_free (sheet, TRUE);
+                return 0;
+        }
+
+        for (i = 0; i < 2; i++) {
+                parallel = parse_and_dump ((guchar *) sheet->str,
+                                           sheet->len, NB_THREADS,
+                                           i == 1, &nb_parallel_stmts);
+                if (!parallel || strcmp (parallel->str, serial->str)) {
+                        fprintf (stdout, "the parallel parsing%s differs\n",
+                                 i == 1 ? " in arena mode" : "");
+                        is_ok = FALSE;
+                }
+                if (parallel)
+                        g_string_free (parallel, TRUE);
+        }
+
+        fprintf (stdout, "%d statements, %s\n", nb_stmts,
+                 is_ok == TRUE ? "the same in parallel" : "KO");
+
+        g_string_free (serial, TRUE);
+        g_string_free (sheet, TRUE);
+        return 0;
+}
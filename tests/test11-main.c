@@ -0,0 +1,339 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Stresses the use of the library from several threads at once:
+ *each thread parses the stylesheet and styles a document on its
+ *own, while all of them ref, unref and read a stylesheet they share.
+ */
+
+#define NB_THREADS 8
+
+#define NB_ITERATIONS 25
+
+static const gchar *gv_xml_content =
+        "<html><body id=\"body\">"
+        "<div class=\"header\"><h1>title</h1><p class=\"intro\">"
+        "<em>intro</em> text</p></div>"
+        "<div class=\"content\" id=\"main\">"
+        "<ul><li>one</li><li class=\"odd\">two</li><li>three</li></ul>"
+        "<p>text <a href=\"x\">link</a> <strong>strong</strong></p>"
+        "<table><tr><td>a</td><td class=\"num\">1</td></tr></table>"
+        "</div>"
+        "<div class=\"footer\"><p lang=\"fr\">pied</p></div>"
+        "</body></html>";
+
+/**
+ *What a thread works on, and what it found.
+ */
+struct ThreadData {
+        const guchar *css;
+        gulong css_len;
+
+        /*the stylesheet all the threads share*/
+        CRStyleSheet *shared_sheet;
+        const gchar *shared_sheet_str;
+
+        /*the styles of the document, as computed by the thread*/
+        GString *styles;
+
+        /*the index of the shared stylesheet seen by the thread*/
+        CRRuleIndex *shared_index;
+
+        gboolean is_ok;
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  style_nodes (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+               xmlNode * a_node, CRStyle * a_parent_style,
+               GString * a_styles);
+
+static GString *
+  style_document (const guchar * a_css, gulong a_len,
+                  gboolean a_use_arena);
+
+static void
+  run_thread (gpointer a_data, gpointer a_user_data);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Parses the file and styles a document with "
+                 "it in %d threads at once,\n%d times in each "
+                 "thread, and compares the results.\n",
+                 NB_THREADS, NB_ITERATIONS);
+        fprintf (stdout, "Returns OK if all the threads compute the "
+                 "same styles, KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco thread safety test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Dumps the styles of a list of sibling elements and
+ *of their descendants.
+ */
+static void
+style_nodes (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+             xmlNode * a_node, CRStyle * a_parent_style,
+             GString * a_styles)
+{
+        xmlNode *cur = NULL;
+        CRStyle *style = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                style = NULL;
+                g_string_append_printf (a_styles, "%s:\n", cur->name);
+                if (cr_sel_eng_get_matched_style
+                    (a_sel_eng, a_cascade, cur, a_parent_style,
+                     &style, FALSE) != CR_OK) {
+                        g_string_append (a_styles, "error\n");
+                } else if (style) {
+                        cr_style_to_string (style, &a_styles, 0);
+                        g_string_append (a_styles, "\n");
+                }
+
+                cr_sel_eng_push_element (a_sel_eng, cur);
+                style_nodes (a_sel_eng, a_cascade, cur->children,
+                             style ? style : a_parent_style, a_styles);
+                cr_sel_eng_pop_element (a_sel_eng, cur);
+
+                if (style) {
+                        cr_style_destroy (style);
+                        style = NULL;
+                }
+        }
+}
+
+/**
+ *Parses a stylesheet and styles gv_xml_content with it.
+ *@param a_css the stylesheet.
+ *@param a_len the length of a_css.
+ *@param a_use_arena whether to parse a_css in arena mode.
+ *@return the dump of the styles of the elements of the
+ *document, or NULL if the parsing failed.
+ */
+static GString *
+style_document (const guchar * a_css, gulong a_len, gboolean a_use_arena)
+{
+        CROMParser *parser = NULL;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *result = NULL;
+
+        parser = cr_om_parser_new (NULL);
+        g_return_val_if_fail (parser, NULL);
+        cr_om_parser_set_use_arena (parser, a_use_arena);
+        cr_om_parser_parse_buf (parser, a_css, a_len, CR_UTF_8, &sheet);
+        cr_om_parser_destroy (parser);
+        if (!sheet)
+                return NULL;
+
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (cascade && xml_doc && sel_eng) {
+                result = g_string_new (NULL);
+                style_nodes (sel_eng, cascade, xmlDocGetRootElement (xml_doc),
+                             NULL, result);
+        }
+
+        if (sel_eng)
+                cr_sel_eng_destroy (sel_eng);
+        if (xml_doc)
+                xmlFreeDoc (xml_doc);
+        if (cascade)
+                cr_cascade_unref (cascade);
+        else
+                cr_stylesheet_destroy (sheet);
+        return result;
+}
+
+/**
+ *The body of a thread: styles the document NB_ITERATIONS
+ *times, with and without arena, reading the shared stylesheet
+ *in the meantime.
+ */
+static void
+run_thread (gpointer a_data, gpointer a_user_data)
+{
+        struct ThreadData *data = a_data;
+        GString *styles = NULL;
+        CRRuleIndex *index = NULL;
+        gchar *str = NULL;
+        gint i = 0;
+
+        for (i = 0; i < NB_ITERATIONS; i++) {
+                cr_stylesheet_ref (data->shared_sheet);
+
+                styles = style_document (data->css, data->css_len, i % 2);
+                if (!styles) {
+                        data->is_ok = FALSE;
+                } else if (!data->styles) {
+                        data->styles = styles;
+                } else {
+                        if (strcmp (styles->str, data->styles->str))
+                                data->is_ok = FALSE;
+                        g_string_free (styles, TRUE);
+                }
+                styles = NULL;
+
+                str = cr_stylesheet_to_string (data->shared_sheet);
+                if (!str || strcmp (str, data->shared_sheet_str))
+                        data->is_ok = FALSE;
+                g_free (str);
+                str = NULL;
+
+                index = cr_stylesheet_get_rule_index (data->shared_sheet);
+                if (!index
+                    || (data->shared_index && index != data->shared_index))
+                        data->is_ok = FALSE;
+                data->shared_index = index;
+
+                if (cr_stylesheet_unref (data->shared_sheet) == TRUE)
+                        data->is_ok = FALSE;
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        struct ThreadData data[NB_THREADS];
+        GThreadPool *pool = NULL;
+        CRStyleSheet *shared_sheet = NULL;
+        GString *styles = NULL;
+        gchar *buf = NULL,
+                *shared_sheet_str = NULL;
+        gsize len = 0;
+        gboolean is_ok = TRUE;
+        gint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (!g_file_get_contents (options.files_list[0], &buf, &len, NULL)
+            || cr_om_parser_simply_parse_buf ((guchar *) buf, len, CR_UTF_8,
+                                              &shared_sheet) != CR_OK
+            || !shared_sheet) {
+                fprintf (stdout, "KO\n");
+                g_free (buf);
+                return 0;
+        }
+
+        xmlInitParser ();
+
+        cr_stylesheet_ref (shared_sheet);
+        shared_sheet_str = cr_stylesheet_to_string (shared_sheet);
+
+        /*
+         *the threads are started before anything has been styled,
+         *so that they race to initialize the global tables as well.
+         */
+        pool = g_thread_pool_new (run_thread, NULL, NB_THREADS, TRUE, NULL);
+        if (!pool) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        memset (data, 0, sizeof (data));
+        for (i = 0; i < NB_THREADS; i++) {
+                data[i].css = (guchar *) buf;
+                data[i].css_len = len;
+                data[i].shared_sheet = shared_sheet;
+                data[i].shared_sheet_str = shared_sheet_str;
+                data[i].is_ok = TRUE;
+                g_thread_pool_push (pool, &data[i], NULL);
+        }
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+        styles = style_document ((guchar *) buf, len, FALSE);
+        for (i = 0; i < NB_THREADS; i++) {
+                if (data[i].is_ok == FALSE || !styles || !data[i].styles
+                    || strcmp (data[i].styles->str, styles->str)
+                    || data[i].shared_index != shared_sheet->rule_index) {
+                        fprintf (stdout, "thread #%d differs\n", i);
+                        is_ok = FALSE;
+                }
+                if (data[i].styles)
+                        g_string_free (data[i].styles, TRUE);
+        }
+        if (cr_stylesheet_unref (shared_sheet) == FALSE) {
+                fprintf (stdout, "the shared stylesheet is still "
+                         "referenced\n");
+                is_ok = FALSE;
+        }
+
+        fprintf (stdout, "%d threads, %d iterations each: %s\n",
+                 NB_THREADS, NB_ITERATIONS,
+                 is_ok == TRUE ? "the same styles in every thread" : "KO");
+
+        if (styles)
+                g_string_free (styles, TRUE);
+        g_free (shared_sheet_str);
+        g_free (buf);
+        return 0;
+}
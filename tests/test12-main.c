@@ -0,0 +1,347 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that one selection engine and one cascade can be shared
+ *by several threads that each select in their own match context
+ *(cr_sel_eng_get_matched_style_in_context()), and that a pseudo
+ *class handler can select again from within a selection.
+ */
+
+#define NB_THREADS 8
+
+#define NB_ITERATIONS 4
+
+/**
+ *The number of sections of the document styled.
+ */
+#define NB_SECTIONS 16
+
+static const gchar *gv_ua_sheet =
+        "p { display: block; margin: 1em 0 }"
+        "li { display: list-item }"
+        "em { font-style: italic }";
+
+/**
+ *The author stylesheet. The :styled-parent
+ *pseudo class handler selects against it.
+ */
+static CRStyleSheet *gv_author_sheet = NULL;
+
+struct ThreadData {
+        CRSelEng *sel_eng;
+        CRCascade *cascade;
+        xmlDoc *xml_doc;
+        GString *styles;
+        gboolean is_ok;
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static gboolean
+  styled_parent_pseudo_class_handler (CRSelEng * a_this,
+                                      CRAdditionalSel * a_sel,
+                                      xmlNode * a_node);
+
+static void
+  style_nodes (CRSelEng * a_sel_eng, CRSelMatchContext * a_ctxt,
+               CRCascade * a_cascade, xmlNode * a_node,
+               GString * a_styles, gint * a_nb_elements);
+
+static void
+  run_thread (gpointer a_data, gpointer a_user_data);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Styles a document with the file in %d threads "
+                 "sharing one selection engine\nand one cascade, and "
+                 "compares the styles with the ones computed by one "
+                 "thread.\n", NB_THREADS);
+        fprintf (stdout, "Returns OK if they are identical, "
+                 "KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *The handler of the :styled-parent pseudo class, that matches
+ *the elements whose parent matches a ruleset of the author
+ *stylesheet. It selects the rulesets of the parent in a match
+ *context of its own, while the engine is in the middle of the
+ *selection of the rulesets of the element.
+ */
+static gboolean
+styled_parent_pseudo_class_handler (CRSelEng * a_this,
+                                    CRAdditionalSel * a_sel,
+                                    xmlNode * a_node)
+{
+        CRSelMatchContext *ctxt = NULL;
+        CRStatement **rulesets = NULL;
+        gulong len = 0;
+        gboolean result = FALSE;
+
+        if (!a_node->parent || a_node->parent->type != XML_ELEMENT_NODE)
+                return FALSE;
+
+        ctxt = cr_sel_match_context_new ();
+        g_return_val_if_fail (ctxt, FALSE);
+        if (cr_sel_eng_get_matched_rulesets_in_context
+            (a_this, ctxt, gv_author_sheet, a_node->parent,
+             &rulesets, &len) == CR_OK && len)
+                result = TRUE;
+        g_free (rulesets);
+        cr_sel_match_context_destroy (ctxt);
+        return result;
+}
+
+/**
+ *Dumps the styles of a list of sibling elements and
+ *of their descendants. If a_ctxt is NULL, the styles are
+ *computed with the context of the engine.
+ */
+static void
+style_nodes (CRSelEng * a_sel_eng, CRSelMatchContext * a_ctxt,
+             CRCascade * a_cascade, xmlNode * a_node,
+             GString * a_styles, gint * a_nb_elements)
+{
+        xmlNode *cur = NULL;
+        CRStyle *style = NULL;
+        enum CRStatus status = CR_OK;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                style = NULL;
+                if (a_ctxt)
+                        status = cr_sel_eng_get_matched_style_in_context
+                                (a_sel_eng, a_ctxt, a_cascade, cur, NULL,
+                                 &style, FALSE);
+                else
+                        status = cr_sel_eng_get_matched_style
+                                (a_sel_eng, a_cascade, cur, NULL,
+                                 &style, FALSE);
+                g_string_append_printf (a_styles, "%s:\n", cur->name);
+                if (status != CR_OK) {
+                        g_string_append (a_styles, "error\n");
+                } else if (style) {
+                        cr_style_to_string (style, &a_styles, 0);
+                        g_string_append (a_styles, "\n");
+                        cr_style_destroy (style);
+                        style = NULL;
+                }
+                (*a_nb_elements)++;
+
+                if (a_ctxt) {
+                        cr_sel_eng_push_element_in_context
+                                (a_sel_eng, a_ctxt, cur);
+                        style_nodes (a_sel_eng, a_ctxt, a_cascade,
+                                     cur->children, a_styles,
+                                     a_nb_elements);
+                        cr_sel_eng_pop_element_in_context
+                                (a_sel_eng, a_ctxt, cur);
+                } else {
+                        cr_sel_eng_push_element (a_sel_eng, cur);
+                        style_nodes (a_sel_eng, NULL, a_cascade,
+                                     cur->children, a_styles,
+                                     a_nb_elements);
+                        cr_sel_eng_pop_element (a_sel_eng, cur);
+                }
+        }
+}
+
+/**
+ *The body of a thread: styles the whole document
+ *NB_ITERATIONS times in a match context of its own.
+ */
+static void
+run_thread (gpointer a_data, gpointer a_user_data)
+{
+        struct ThreadData *data = a_data;
+        CRSelMatchContext *ctxt = NULL;
+        GString *styles = NULL;
+        gint i = 0,
+                nb_elements = 0;
+
+        ctxt = cr_sel_match_context_new ();
+        if (!ctxt) {
+                data->is_ok = FALSE;
+                return;
+        }
+        for (i = 0; i < NB_ITERATIONS; i++) {
+                styles = g_string_new (NULL);
+                style_nodes (data->sel_eng, ctxt, data->cascade,
+                             xmlDocGetRootElement (data->xml_doc),
+                             styles, &nb_elements);
+                if (!data->styles) {
+                        data->styles = styles;
+                } else {
+                        if (strcmp (styles->str, data->styles->str))
+                                data->is_ok = FALSE;
+                        g_string_free (styles, TRUE);
+                }
+                styles = NULL;
+        }
+        cr_sel_match_context_destroy (ctxt);
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        struct ThreadData data[NB_THREADS];
+        GThreadPool *pool = NULL;
+        CRStyleSheet *ua_sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *xml = NULL,
+                *styles = NULL;
+        gboolean is_ok = TRUE;
+        gint i = 0,
+                nb_elements = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file ((guchar *) options.files_list[0],
+                                            CR_ASCII, &gv_author_sheet)
+            != CR_OK
+            || cr_om_parser_simply_parse_buf ((guchar *) gv_ua_sheet,
+                                              strlen (gv_ua_sheet), CR_UTF_8,
+                                              &ua_sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        cascade = cr_cascade_new (gv_author_sheet, NULL, ua_sheet);
+
+        xmlInitParser ();
+
+        xml = g_string_new ("<html><body>");
+        for (i = 0; i < NB_SECTIONS; i++) {
+                g_string_append_printf
+                        (xml, "<div class=\"section%s\" id=\"s%d\">"
+                         "<h2>title</h2>"
+                         "<p class=\"intro %s\">some <em>text</em> and "
+                         "<a href=\"#s%d\">a link</a></p>"
+                         "<ul><li>one</li><li class=\"odd\">two</li>"
+                         "<li lang=\"fr-ca\">trois</li></ul></div>",
+                         i % 3 ? "" : " wide", i, i % 2 ? "odd" : "even",
+                         (i + 1) % NB_SECTIONS);
+        }
+        g_string_append (xml, "</body></html>");
+        xml_doc = xmlParseMemory (xml->str, xml->len);
+        g_string_free (xml, TRUE);
+
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        cr_sel_eng_register_pseudo_class_sel_handler
+                (sel_eng, (guchar *) "styled-parent", IDENT_PSEUDO,
+                 styled_parent_pseudo_class_handler);
+
+        /*
+         *the threads are started before anything has been selected,
+         *so that they race to index the stylesheets as well.
+         */
+        pool = g_thread_pool_new (run_thread, NULL, NB_THREADS, TRUE, NULL);
+        if (!pool) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        memset (data, 0, sizeof (data));
+        for (i = 0; i < NB_THREADS; i++) {
+                data[i].sel_eng = sel_eng;
+                data[i].cascade = cascade;
+                data[i].xml_doc = xml_doc;
+                data[i].is_ok = TRUE;
+                g_thread_pool_push (pool, &data[i], NULL);
+        }
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+        /*the styles computed with the engine's own context*/
+        styles = g_string_new (NULL);
+        style_nodes (sel_eng, NULL, cascade, xmlDocGetRootElement (xml_doc),
+                     styles, &nb_elements);
+
+        for (i = 0; i < NB_THREADS; i++) {
+                if (data[i].is_ok == FALSE || !data[i].styles
+                    || strcmp (data[i].styles->str, styles->str)) {
+                        fprintf (stdout, "thread #%d differs\n", i);
+                        is_ok = FALSE;
+                }
+                if (data[i].styles)
+                        g_string_free (data[i].styles, TRUE);
+        }
+
+        fprintf (stdout, "%d threads sharing one engine: %s for the %d "
+                 "elements\n", NB_THREADS,
+                 is_ok == TRUE ? "the same styles" : "KO", nb_elements);
+
+        g_string_free (styles, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
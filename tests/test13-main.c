@@ -0,0 +1,263 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that cr_sel_eng_style_document() computes, in one
+ *thread as in several, the styles a walk of the document
+ *with cr_sel_eng_get_matched_style() computes.
+ */
+
+#define NB_THREADS 4
+
+/**
+ *The number of sections of the document styled.
+ */
+#define NB_SECTIONS 64
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  walk_and_dump (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+                 xmlNode * a_node, CRStyle * a_parent_style,
+                 GString * a_dump, gint * a_nb_elements);
+
+static void
+  dump_styles (GHashTable * a_styles, xmlNode * a_node,
+               CRStyle * a_parent_style, GString * a_dump);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Styles a document with the file element by "
+                 "element, then with\ncr_sel_eng_style_document() in "
+                 "1 and %d threads, and compares the styles.\n",
+                 NB_THREADS);
+        fprintf (stdout, "Returns OK if they are identical, "
+                 "KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Styles a list of sibling elements and their descendants one
+ *element at a time, the way cr_sel_eng_style_document() is
+ *documented to, and dumps the styles.
+ */
+static void
+walk_and_dump (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+               xmlNode * a_node, CRStyle * a_parent_style,
+               GString * a_dump, gint * a_nb_elements)
+{
+        xmlNode *cur = NULL;
+        CRStyle *style = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_string_append_printf (a_dump, "%s:\n", cur->name);
+                style = cr_style_new (a_parent_style ? FALSE : TRUE);
+                if (!style
+                    || cr_sel_eng_get_matched_style
+                    (a_sel_eng, a_cascade, cur, a_parent_style, &style,
+                     a_parent_style ? FALSE : TRUE) != CR_OK) {
+                        g_string_append (a_dump, "error\n");
+                        if (style)
+                                cr_style_destroy (style);
+                        continue;
+                }
+                if (a_parent_style) {
+                        style->parent_style = a_parent_style;
+                        cr_style_resolve_inherited_properties (style);
+                }
+                cr_style_to_string (style, &a_dump, 0);
+                g_string_append (a_dump, "\n");
+                (*a_nb_elements)++;
+
+                cr_sel_eng_push_element (a_sel_eng, cur);
+                walk_and_dump (a_sel_eng, a_cascade, cur->children,
+                               style, a_dump, a_nb_elements);
+                cr_sel_eng_pop_element (a_sel_eng, cur);
+                cr_style_destroy (style);
+                style = NULL;
+        }
+}
+
+/**
+ *Dumps the styles cr_sel_eng_style_document() computed
+ *for a list of sibling elements and their descendants.
+ */
+static void
+dump_styles (GHashTable * a_styles, xmlNode * a_node,
+             CRStyle * a_parent_style, GString * a_dump)
+{
+        xmlNode *cur = NULL;
+        CRStyle *style = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_string_append_printf (a_dump, "%s:\n", cur->name);
+                style = g_hash_table_lookup (a_styles, cur);
+                if (!style) {
+                        g_string_append (a_dump, "no style\n");
+                        continue;
+                }
+                if (style->parent_style != a_parent_style)
+                        g_string_append (a_dump, "bad parent style\n");
+                cr_style_to_string (style, &a_dump, 0);
+                g_string_append (a_dump, "\n");
+                dump_styles (a_styles, cur->children, style, a_dump);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GHashTable *styles = NULL;
+        GString *xml = NULL,
+                *reference = NULL,
+                *dump = NULL;
+        guint nb_threads[] = { 1, NB_THREADS };
+        gboolean is_ok = TRUE;
+        gint i = 0,
+                nb_elements = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file ((guchar *) options.files_list[0],
+                                            CR_ASCII, &sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+
+        xml = g_string_new ("<html><body>");
+        for (i = 0; i < NB_SECTIONS; i++) {
+                g_string_append_printf
+                        (xml, "<div class=\"section%s\" id=\"s%d\">"
+                         "<h2>title</h2>"
+                         "<p class=\"intro %s\">some <em>text</em> and "
+                         "<a href=\"#s%d\">a link</a></p>"
+                         "<ul><li>one</li><li class=\"odd\">two</li>"
+                         "<li>three</li></ul>"
+                         "<div class=\"box\"><div><p>deep <span>text"
+                         "</span></p><div><p>deeper</p></div></div></div>"
+                         "</div>",
+                         i % 3 ? "" : " wide", i, i % 2 ? "odd" : "even",
+                         (i + 1) % NB_SECTIONS);
+        }
+        g_string_append (xml, "</body></html>");
+        xml_doc = xmlParseMemory (xml->str, xml->len);
+        g_string_free (xml, TRUE);
+
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        reference = g_string_new (NULL);
+        walk_and_dump (sel_eng, cascade, xmlDocGetRootElement (xml_doc),
+                       NULL, reference, &nb_elements);
+
+        for (i = 0; i < (gint) G_N_ELEMENTS (nb_threads); i++) {
+                styles = NULL;
+                if (cr_sel_eng_style_document
+                    (sel_eng, cascade, (xmlNode *) xml_doc, NULL,
+                     nb_threads[i], &styles) != CR_OK || !styles) {
+                        fprintf (stdout, "styling in %u threads failed\n",
+                                 nb_threads[i]);
+                        is_ok = FALSE;
+                        continue;
+                }
+                dump = g_string_new (NULL);
+                dump_styles (styles, xmlDocGetRootElement (xml_doc), NULL,
+                             dump);
+                if ((gint) g_hash_table_size (styles) != nb_elements
+                    || strcmp (dump->str, reference->str)) {
+                        fprintf (stdout, "the styles computed in %u "
+                                 "threads differ\n", nb_threads[i]);
+                        is_ok = FALSE;
+                }
+                g_string_free (dump, TRUE);
+                g_hash_table_destroy (styles);
+        }
+
+        if (is_ok == TRUE)
+                fprintf (stdout, "%d elements: the same styles in 1 and "
+                         "%d threads\n", nb_elements, NB_THREADS);
+        else
+                fprintf (stdout, "%d elements: KO\n", nb_elements);
+
+        g_string_free (reference, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
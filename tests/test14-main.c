@@ -0,0 +1,252 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Dumps the selector programs (see cr_sel_prog_new()) of the
+ *selectors of a stylesheet and the elements each of them
+ *matches in a small document. Some attributes of the document
+ *come from its DTD, or hold entity references.
+ */
+
+static const gchar *gv_xml_content =
+        "<!DOCTYPE html ["
+        "<!ATTLIST dfn class CDATA \"d x\">"
+        "<!ENTITY w \"world\">"
+        "]>"
+        "<html><body>"
+        "<div id=\"a\" class=\"x y\">"
+        "<p class=\"intro\">one <em>e1</em></p>"
+        "<p lang=\"en-US\" title=\"hello world\">two "
+        "<span class=\"x\">s1</span></p>"
+        "</div>"
+        "<div class=\"y\">"
+        "<ul><li>l1</li><li class=\"odd x\">l2</li><li>l3</li></ul>"
+        "<p><a href=\"#a\" rel=\"next prev\">link</a></p>"
+        "</div>"
+        "<section><div class=\"x\"><p><span>deep</span></p></div>"
+        "<dfn title=\"big &w;\">d1</dfn><dfn class=\"y\">d2</dfn></section>"
+        "</body></html>";
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  collect_elements (xmlNode * a_node, GPtrArray * a_elements);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Dumps the compiled selectors of the file and "
+                 "the elements of a test\ndocument they match.\n");
+        fprintf (stdout, "Reports the elements for which the rulesets "
+                 "found with the rule index\ndiffer from the ones "
+                 "found by matching every selector.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelInstr test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Appends the elements of a subtree to a_elements,
+ *in document order.
+ */
+static void
+collect_elements (xmlNode * a_node, GPtrArray * a_elements)
+{
+        xmlNode *cur = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                g_ptr_array_add (a_elements, cur);
+                collect_elements (cur->children, a_elements);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CRStyleSheet *sheet = NULL;
+        CRSelEng *sel_eng = NULL;
+        CRStatement *stmt = NULL;
+        CRSelector *sel = NULL;
+        CRSelInstr *prog = NULL;
+        CRStatement **rulesets = NULL;
+        xmlDoc *xml_doc = NULL;
+        xmlNode *node = NULL;
+        GPtrArray *elements = NULL;
+        GHashTable *matched = NULL;
+        guchar *str = NULL;
+        gchar *prog_str = NULL;
+        gboolean matches = FALSE,
+                is_ok = TRUE;
+        gulong len = 0,
+                nb_matched = 0,
+                i = 0,
+                j = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file ((guchar *) options.files_list[0],
+                                            CR_ASCII, &sheet) != CR_OK
+            || !sheet) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        elements = g_ptr_array_new ();
+        collect_elements (xmlDocGetRootElement (xml_doc), elements);
+
+        for (stmt = sheet->statements; stmt; stmt = stmt->next) {
+                if (stmt->type != RULESET_STMT)
+                        continue;
+                for (sel = stmt->kind.ruleset->sel_list; sel;
+                     sel = sel->next) {
+                        str = cr_simple_sel_to_string (sel->simple_sel);
+                        prog = cr_sel_prog_new (sel->simple_sel);
+                        prog_str = prog ? cr_sel_prog_to_string (prog)
+                                : NULL;
+                        fprintf (stdout, "selector: %s\nprogram: %s\n"
+                                 "matches:", str ? (gchar *) str : "",
+                                 prog_str ? prog_str : "");
+                        for (i = 0; i < elements->len; i++) {
+                                node = g_ptr_array_index (elements, i);
+                                if (cr_sel_eng_matches_node
+                                    (sel_eng, sel->simple_sel, node,
+                                     &matches) == CR_OK
+                                    && matches == TRUE)
+                                        fprintf (stdout, " %lu:%s", i,
+                                                 (const char *) node->name);
+                        }
+                        fprintf (stdout, "\n\n");
+                        g_free (str);
+                        g_free (prog_str);
+                        if (prog)
+                                cr_sel_prog_destroy (prog);
+                        str = NULL;
+                        prog_str = NULL;
+                        prog = NULL;
+                }
+        }
+
+        /*
+         *the rulesets the engine finds through the rule index,
+         *which runs the programs it compiled, must be the ones
+         *that have a matching selector.
+         */
+        matched = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (i = 0; i < elements->len; i++) {
+                node = g_ptr_array_index (elements, i);
+                g_hash_table_remove_all (matched);
+                nb_matched = 0;
+                for (stmt = sheet->statements; stmt; stmt = stmt->next) {
+                        if (stmt->type != RULESET_STMT)
+                                continue;
+                        for (sel = stmt->kind.ruleset->sel_list; sel;
+                             sel = sel->next) {
+                                if (cr_sel_eng_matches_node
+                                    (sel_eng, sel->simple_sel, node,
+                                     &matches) == CR_OK
+                                    && matches == TRUE) {
+                                        g_hash_table_insert (matched, stmt,
+                                                             stmt);
+                                        nb_matched++;
+                                        break;
+                                }
+                        }
+                }
+                rulesets = NULL;
+                len = 0;
+                if (cr_sel_eng_get_matched_rulesets
+                    (sel_eng, sheet, node, &rulesets, &len) != CR_OK
+                    || len != nb_matched) {
+                        is_ok = FALSE;
+                } else {
+                        for (j = 0; j < len; j++) {
+                                if (!g_hash_table_lookup (matched,
+                                                          rulesets[j]))
+                                        is_ok = FALSE;
+                        }
+                }
+                if (is_ok == FALSE) {
+                        fprintf (stdout, "the rulesets of %lu:%s differ\n",
+                                 i, (const char *) node->name);
+                        break;
+                }
+                g_free (rulesets);
+                rulesets = NULL;
+        }
+        fprintf (stdout, "%s\n", is_ok == TRUE
+                 ? "the same rulesets through the rule index" : "KO");
+
+        g_free (rulesets);
+        g_hash_table_destroy (matched);
+        g_ptr_array_free (elements, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_stylesheet_unref (sheet);
+        return 0;
+}
@@ -0,0 +1,231 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks the precedence the cascade gives to the declarations
+ *that apply to a node: origin and importance, then specificity,
+ *then source order. Dumps, for each element of a document, the
+ *author rulesets that match it with their specificity, and the
+ *declarations that win the cascade.
+ */
+
+static const gchar *gv_ua_sheet =
+        "* { display: block }"
+        "p { color: black; margin-left: 1px !important;"
+        " margin-right: 1px !important }"
+        "em { display: inline }";
+
+static const gchar *gv_user_sheet =
+        "p { color: green !important; font-size: 10px; margin-right: 2px }"
+        "em { font-weight: bold; font-style: oblique !important }";
+
+static const gchar *gv_xml_content =
+        "<doc>"
+        "<p id=\"x\" class=\"a\">one <em>two</em></p>"
+        "<p class=\"a\">three</p>"
+        "<p>four</p>"
+        "</doc>";
+
+static const gchar *gv_origins[] = { "ua", "user", "author" };
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+             xmlNode * a_node, GString * a_dump);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Cascades the file, as author stylesheet, with "
+                 "a user agent and\na user stylesheet, and dumps the "
+                 "declarations that apply to\nthe elements of a "
+                 "document.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Dumps the author rulesets and the declarations that
+ *apply to an element and to its descendants.
+ */
+static void
+dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+           xmlNode * a_node, GString * a_dump)
+{
+        xmlNode *cur = NULL;
+        CRStatement **rulesets = NULL;
+        CRPropList *props = NULL,
+                *pair = NULL;
+        CRDeclaration *decl = NULL;
+        gchar *str = NULL;
+        gulong len = 0,
+                i = 0;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_string_append_printf (a_dump, "%s", cur->name);
+                str = (gchar *) xmlGetProp (cur, (const xmlChar *) "id");
+                if (str)
+                        g_string_append_printf (a_dump, "#%s", str);
+                xmlFree (str);
+                str = (gchar *) xmlGetProp (cur,
+                                            (const xmlChar *) "class");
+                if (str)
+                        g_string_append_printf (a_dump, ".%s", str);
+                xmlFree (str);
+                str = NULL;
+                g_string_append (a_dump, ":\n");
+
+                if (cr_sel_eng_get_matched_rulesets
+                    (a_sel_eng,
+                     cr_cascade_get_sheet (a_cascade, ORIGIN_AUTHOR),
+                     cur, &rulesets, &len) != CR_OK) {
+                        g_string_append (a_dump, "  error\n");
+                        continue;
+                }
+                for (i = 0; i < len; i++) {
+                        str = cr_statement_to_string (rulesets[i], 0);
+                        g_string_append_printf
+                                (a_dump, "  [%lu] %s\n",
+                                 rulesets[i]->specificity, str);
+                        g_free (str);
+                        str = NULL;
+                }
+                g_free (rulesets);
+                rulesets = NULL;
+
+                if (cr_sel_eng_get_matched_properties_from_cascade
+                    (a_sel_eng, a_cascade, cur, &props) != CR_OK) {
+                        g_string_append (a_dump, "  error\n");
+                        continue;
+                }
+                for (pair = props; pair;
+                     pair = cr_prop_list_get_next (pair)) {
+                        decl = NULL;
+                        cr_prop_list_get_decl (pair, &decl);
+                        if (!decl)
+                                continue;
+                        str = cr_declaration_to_string (decl, 0);
+                        g_string_append_printf
+                                (a_dump, "  %s (%s)\n", str,
+                                 gv_origins[decl->parent_statement->
+                                            parent_sheet->origin]);
+                        g_free (str);
+                        str = NULL;
+                }
+                if (props) {
+                        cr_prop_list_destroy (props);
+                        props = NULL;
+                }
+
+                dump_node (a_sel_eng, a_cascade, cur->children, a_dump);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CRStyleSheet *author_sheet = NULL,
+                *user_sheet = NULL,
+                *ua_sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *dump = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file
+            ((const guchar *) options.files_list[0], CR_UTF_8,
+             &author_sheet) != CR_OK
+            || cr_om_parser_simply_parse_buf
+            ((const guchar *) gv_user_sheet, strlen (gv_user_sheet),
+             CR_UTF_8, &user_sheet) != CR_OK
+            || cr_om_parser_simply_parse_buf
+            ((const guchar *) gv_ua_sheet, strlen (gv_ua_sheet),
+             CR_UTF_8, &ua_sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        cascade = cr_cascade_new (author_sheet, user_sheet, ua_sheet);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        dump = g_string_new (NULL);
+        dump_node (sel_eng, cascade, xmlDocGetRootElement (xml_doc), dump);
+        fprintf (stdout, "%s", dump->str);
+
+        g_string_free (dump, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
@@ -0,0 +1,208 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the selection engine only finds the rulesets
+ *of the \@media rules that apply to its media context, all the
+ *rulesets of these rules, and that the stylesheet evaluates the
+ *\@media rules once per media type.
+ */
+
+static const gchar *gv_xml_content =
+        "<doc><p class=\"a\">one <em>two</em></p><p>three</p></doc>";
+
+/**
+ *The media types the document is styled for.
+ *NULL stands for no media context.
+ */
+static const gchar *gv_media[] = { NULL, "screen", "PRINT", "aural" };
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+  dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+             xmlNode * a_node, GString * a_dump);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Styles a document with the file for several "
+                 "media types, and dumps\nthe declarations that apply "
+                 "to its elements.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRMediaContext class test "
+                 "program.\n", prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Dumps the declarations that apply to an
+ *element and to its descendants.
+ */
+static void
+dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+           xmlNode * a_node, GString * a_dump)
+{
+        xmlNode *cur = NULL;
+        CRPropList *props = NULL,
+                *pair = NULL;
+        CRDeclaration *decl = NULL;
+        gchar *str = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_string_append_printf (a_dump, "  %s:", cur->name);
+                if (cr_sel_eng_get_matched_properties_from_cascade
+                    (a_sel_eng, a_cascade, cur, &props) != CR_OK) {
+                        g_string_append (a_dump, " error\n");
+                        continue;
+                }
+                for (pair = props; pair;
+                     pair = cr_prop_list_get_next (pair)) {
+                        decl = NULL;
+                        cr_prop_list_get_decl (pair, &decl);
+                        if (!decl)
+                                continue;
+                        str = cr_declaration_to_string (decl, 0);
+                        g_string_append_printf (a_dump, " %s;", str);
+                        g_free (str);
+                        str = NULL;
+                }
+                g_string_append (a_dump, "\n");
+                if (props) {
+                        cr_prop_list_destroy (props);
+                        props = NULL;
+                }
+
+                dump_node (a_sel_eng, a_cascade, cur->children, a_dump);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        CRMediaContext *media = NULL;
+        CRRuleIndex *index = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *dump = NULL;
+        guint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file
+            ((const guchar *) options.files_list[0], CR_UTF_8,
+             &sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        dump = g_string_new (NULL);
+        for (i = 0; i < G_N_ELEMENTS (gv_media); i++) {
+                CRAtom medium = NULL;
+
+                media = NULL;
+                if (gv_media[i]) {
+                        media = cr_media_context_new (gv_media[i]);
+                        if (!media) {
+                                fprintf (stdout, "KO\n");
+                                return 0;
+                        }
+                        medium = cr_media_context_get_media_type (media);
+                }
+                cr_sel_eng_set_media_context (sel_eng, media);
+
+                index = cr_stylesheet_get_rule_index_for_medium
+                        (sheet, medium);
+                /*the index of a medium is only built once*/
+                if (!index
+                    || index != cr_stylesheet_get_rule_index_for_medium
+                    (sheet, medium)) {
+                        fprintf (stdout, "KO\n");
+                        return 0;
+                }
+                g_string_append_printf
+                        (dump, "%s: %lu selectors\n",
+                         medium ? medium : "no media context",
+                         cr_rule_index_get_nr_entries (index));
+                dump_node (sel_eng, cascade, xmlDocGetRootElement (xml_doc),
+                           dump);
+        }
+        fprintf (stdout, "%s", dump->str);
+
+        g_string_free (dump, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
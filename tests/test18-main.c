@@ -0,0 +1,265 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks the resolution of the \@import rules by the om parser:
+ *a stylesheet imported by several others is parsed once, circular
+ *and unresolvable imports are ignored, and the rulesets of the
+ *imported stylesheets are selected in cascade order, for the media
+ *their \@import rules apply to.
+ */
+
+static const gchar *gv_xml_content =
+        "<doc><p>one <em>two</em></p></doc>";
+
+/**
+ *The media types the document is styled for.
+ *NULL stands for no media context.
+ */
+static const gchar *gv_media[] = { NULL, "print" };
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static CRStyleSheet *
+  get_imported_sheet (CRStyleSheet * a_sheet, gint a_index);
+
+static void
+  dump_imports (CRStyleSheet * a_sheet, guint a_depth, GString * a_dump);
+
+static void
+  dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+             xmlNode * a_node, GString * a_dump);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Parses the file and the stylesheets it imports, "
+                 "dumps its @import\nrules, then the declarations that "
+                 "apply to the elements of a\ndocument styled with it.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CROMParser class test "
+                 "program.\n", prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Returns the stylesheet imported by the a_index'th
+ *\@import rule of a stylesheet, NULL if there is none.
+ */
+static CRStyleSheet *
+get_imported_sheet (CRStyleSheet * a_sheet, gint a_index)
+{
+        CRStatement *cur = NULL;
+
+        for (cur = a_sheet->statements; cur; cur = cur->next) {
+                if (cur->type != AT_IMPORT_RULE_STMT)
+                        continue;
+                if (a_index-- == 0)
+                        return cur->kind.import_rule->sheet;
+        }
+        return NULL;
+}
+
+/**
+ *Dumps the \@import rules of a stylesheet and,
+ *indented, the ones of the stylesheets they import.
+ */
+static void
+dump_imports (CRStyleSheet * a_sheet, guint a_depth, GString * a_dump)
+{
+        CRStatement *cur = NULL;
+        CRAtImportRule *rule = NULL;
+        guint i = 0;
+
+        for (cur = a_sheet->statements; cur; cur = cur->next) {
+                if (cur->type != AT_IMPORT_RULE_STMT)
+                        continue;
+                rule = cur->kind.import_rule;
+                for (i = 0; i <= a_depth; i++)
+                        g_string_append (a_dump, "  ");
+                g_string_append_printf (a_dump, "@import %s: %s\n",
+                                        rule->url->stryng->str,
+                                        rule->sheet ?
+                                        "resolved" : "unresolved");
+                if (rule->sheet)
+                        dump_imports (rule->sheet, a_depth + 1, a_dump);
+        }
+}
+
+/**
+ *Dumps the declarations that apply to an
+ *element and to its descendants.
+ */
+static void
+dump_node (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+           xmlNode * a_node, GString * a_dump)
+{
+        xmlNode *cur = NULL;
+        CRPropList *props = NULL,
+                *pair = NULL;
+        CRDeclaration *decl = NULL;
+        gchar *str = NULL;
+
+        for (cur = a_node; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+
+                g_string_append_printf (a_dump, "  %s:", cur->name);
+                if (cr_sel_eng_get_matched_properties_from_cascade
+                    (a_sel_eng, a_cascade, cur, &props) != CR_OK) {
+                        g_string_append (a_dump, " error\n");
+                        continue;
+                }
+                for (pair = props; pair;
+                     pair = cr_prop_list_get_next (pair)) {
+                        decl = NULL;
+                        cr_prop_list_get_decl (pair, &decl);
+                        if (!decl)
+                                continue;
+                        str = cr_declaration_to_string (decl, 0);
+                        g_string_append_printf (a_dump, " %s;", str);
+                        g_free (str);
+                        str = NULL;
+                }
+                g_string_append (a_dump, "\n");
+                if (props) {
+                        cr_prop_list_destroy (props);
+                        props = NULL;
+                }
+
+                dump_node (a_sel_eng, a_cascade, cur->children, a_dump);
+        }
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CROMParser *parser = NULL;
+        CRStyleSheet *sheet = NULL,
+                *base_a = NULL,
+                *base_b = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL;
+        CRMediaContext *media = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *dump = NULL;
+        guint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        parser = cr_om_parser_new (NULL);
+        if (!parser
+            || cr_om_parser_set_resolve_imports (parser, TRUE) != CR_OK
+            || cr_om_parser_parse_file
+            (parser, (const guchar *) options.files_list[0], CR_UTF_8,
+             &sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        /*the imported stylesheets must outlive the parser*/
+        cr_om_parser_destroy (parser);
+        parser = NULL;
+
+        dump = g_string_new (NULL);
+        g_string_append (dump, "imports:\n");
+        dump_imports (sheet, 0, dump);
+
+        /*both themes must share the one parsing of the base sheet*/
+        base_a = get_imported_sheet (get_imported_sheet (sheet, 0), 0);
+        base_b = get_imported_sheet (get_imported_sheet (sheet, 1), 0);
+        if (!base_a || base_a != base_b) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        g_string_append (dump, "the base sheet is parsed once\n");
+
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        for (i = 0; i < G_N_ELEMENTS (gv_media); i++) {
+                media = NULL;
+                if (gv_media[i]) {
+                        media = cr_media_context_new (gv_media[i]);
+                        if (!media) {
+                                fprintf (stdout, "KO\n");
+                                return 0;
+                        }
+                }
+                cr_sel_eng_set_media_context (sel_eng, media);
+                g_string_append_printf
+                        (dump, "%s:\n",
+                         gv_media[i] ? gv_media[i] : "no media context");
+                dump_node (sel_eng, cascade, xmlDocGetRootElement (xml_doc),
+                           dump);
+        }
+        fprintf (stdout, "%s", dump->str);
+
+        g_string_free (dump, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
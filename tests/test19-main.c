@@ -0,0 +1,463 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the selection engine styles a document held in a
+ *tree of its own, read through a #CRNodeIface, the way it styles
+ *the same document held in a libxml2 tree.
+ */
+
+static const gchar *gv_xml_content =
+        "<doc>"
+        "<section id=\"main\">"
+        "<p class=\"note big\">one <em title=\"x\">two</em></p>"
+        "<!-- comment -->"
+        "<p lang=\"en-GB\">three <em>four</em></p>"
+        "<p lang=\"fr\"><em title=\"y\">five</em></p>"
+        "</section>"
+        "<p class=\"note\">six</p>"
+        "</doc>";
+
+/**
+ *A node of the compact tree the test styles: an element
+ *and the few attributes the selectors look at.
+ */
+typedef struct _TestNode TestNode;
+struct _TestNode {
+        gchar *name;
+        gchar *id;
+        gchar *classes;
+        gchar *lang;
+        gchar *title;
+        TestNode *parent;
+        TestNode *first_child;
+        TestNode *next;
+        TestNode *prev;
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Styles a document held in a tree of its own "
+                 "with the file, and dumps\nthe declarations that apply "
+                 "to its elements.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRNodeIface test "
+                 "program.\n", prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static gboolean
+test_node_is_element (CRXMLNodePtr a_node)
+{
+        (void) a_node;
+        return TRUE;
+}
+
+static CRXMLNodePtr
+test_node_get_parent (CRXMLNodePtr a_node)
+{
+        return ((TestNode *) a_node)->parent;
+}
+
+static CRXMLNodePtr
+test_node_get_first_child (CRXMLNodePtr a_node)
+{
+        return ((TestNode *) a_node)->first_child;
+}
+
+static CRXMLNodePtr
+test_node_get_next (CRXMLNodePtr a_node)
+{
+        return ((TestNode *) a_node)->next;
+}
+
+static CRXMLNodePtr
+test_node_get_prev (CRXMLNodePtr a_node)
+{
+        return ((TestNode *) a_node)->prev;
+}
+
+static const gchar *
+test_node_get_name (CRXMLNodePtr a_node)
+{
+        return ((TestNode *) a_node)->name;
+}
+
+static const gchar *
+test_node_get_id (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        *a_copy = NULL;
+        return ((TestNode *) a_node)->id;
+}
+
+static const gchar *
+test_node_get_classes (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        *a_copy = NULL;
+        return ((TestNode *) a_node)->classes;
+}
+
+static const gchar *
+test_node_get_lang (CRXMLNodePtr a_node, gchar ** a_copy)
+{
+        *a_copy = NULL;
+        return ((TestNode *) a_node)->lang;
+}
+
+static const gchar *
+test_node_get_attribute (CRXMLNodePtr a_node, const gchar * a_name,
+                         gboolean * a_is_set, gchar ** a_copy)
+{
+        TestNode *node = a_node;
+        const gchar *result = NULL;
+
+        *a_copy = NULL;
+        if (!strcmp (a_name, "id"))
+                result = node->id;
+        else if (!strcmp (a_name, "class"))
+                result = node->classes;
+        else if (!strcmp (a_name, "lang"))
+                result = node->lang;
+        else if (!strcmp (a_name, "title"))
+                /*built on the fly, for the engine to free*/
+                result = *a_copy = g_strdup (node->title);
+        *a_is_set = result ? TRUE : FALSE;
+        return result;
+}
+
+static CRNodeIface const gv_test_node_iface = {
+        test_node_is_element,
+        test_node_get_parent,
+        test_node_get_first_child,
+        test_node_get_next,
+        test_node_get_prev,
+        test_node_get_name,
+        test_node_get_id,
+        test_node_get_classes,
+        test_node_get_attribute,
+        test_node_get_lang
+};
+
+/**
+ *Copies the elements of a libxml2 tree in a tree of
+ *#TestNode, and records the copy of each element.
+ */
+static TestNode *
+test_node_copy (xmlNode * a_node, TestNode * a_parent,
+                GHashTable * a_copies)
+{
+        TestNode *result = NULL,
+                *child = NULL,
+                *last = NULL;
+        xmlNode *cur = NULL;
+
+        result = g_new0 (TestNode, 1);
+        result->name = g_strdup ((const gchar *) a_node->name);
+        result->id = (gchar *) xmlGetProp (a_node, (const xmlChar *) "id");
+        result->classes = (gchar *) xmlGetProp (a_node,
+                                                (const xmlChar *) "class");
+        result->lang = (gchar *) xmlGetProp (a_node,
+                                             (const xmlChar *) "lang");
+        result->title = (gchar *) xmlGetProp (a_node,
+                                              (const xmlChar *) "title");
+        result->parent = a_parent;
+        g_hash_table_insert (a_copies, a_node, result);
+        for (cur = a_node->children; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                child = test_node_copy (cur, result, a_copies);
+                child->prev = last;
+                if (last)
+                        last->next = child;
+                else
+                        result->first_child = child;
+                last = child;
+        }
+        return result;
+}
+
+static void
+test_node_destroy (TestNode * a_node)
+{
+        TestNode *cur = NULL,
+                *next = NULL;
+
+        for (cur = a_node->first_child; cur; cur = next) {
+                next = cur->next;
+                test_node_destroy (cur);
+        }
+        g_free (a_node->name);
+        xmlFree (a_node->id);
+        xmlFree (a_node->classes);
+        xmlFree (a_node->lang);
+        xmlFree (a_node->title);
+        g_free (a_node);
+}
+
+/**
+ *The :titled pseudo class of the libxml2 engine, registered
+ *with cr_sel_eng_register_pseudo_class_sel_handler(): the
+ *element has a title attribute.
+ */
+static gboolean
+xml_titled_pseudo_class_handler (CRSelEng * a_this,
+                                 CRAdditionalSel * a_sel, xmlNode * a_node)
+{
+        (void) a_this;
+        (void) a_sel;
+        return xmlHasProp (a_node, (const xmlChar *) "title") != NULL;
+}
+
+/**
+ *The :titled pseudo class of the engine that reads the
+ *#TestNode tree, registered with
+ *cr_sel_eng_register_node_pseudo_class_sel_handler().
+ */
+static gboolean
+titled_pseudo_class_handler (CRSelEng * a_this,
+                             CRAdditionalSel * a_sel, CRXMLNodePtr a_node)
+{
+        (void) a_this;
+        (void) a_sel;
+        return ((TestNode *) a_node)->title != NULL;
+}
+
+/**
+ *Checks which handlers each of the getters gives.
+ *@return TRUE if they are the expected ones, FALSE otherwise.
+ */
+static gboolean
+check_pseudo_class_handlers (CRSelEng * a_xml_sel_eng, CRSelEng * a_sel_eng)
+{
+        CRPseudoClassSelectorHandler handler = NULL;
+        CRNodePseudoClassSelectorHandler node_handler = NULL;
+
+        if (cr_sel_eng_get_pseudo_class_selector_handler
+            (a_xml_sel_eng, (guchar *) "titled", IDENT_PSEUDO, &handler)
+            != CR_OK
+            || handler != xml_titled_pseudo_class_handler)
+                return FALSE;
+        /*an xmlNode handler can't be given other nodes*/
+        if (cr_sel_eng_get_node_pseudo_class_selector_handler
+            (a_xml_sel_eng, (guchar *) "titled", IDENT_PSEUDO,
+             &node_handler) != CR_PSEUDO_CLASS_SEL_HANDLER_NOT_FOUND_ERROR)
+                return FALSE;
+        if (cr_sel_eng_get_node_pseudo_class_selector_handler
+            (a_sel_eng, (guchar *) "titled", IDENT_PSEUDO, &node_handler)
+            != CR_OK
+            || node_handler != titled_pseudo_class_handler)
+                return FALSE;
+        /*the built in handlers take any node*/
+        node_handler = NULL;
+        if (cr_sel_eng_get_node_pseudo_class_selector_handler
+            (a_sel_eng, (guchar *) "first-child", IDENT_PSEUDO,
+             &node_handler) != CR_OK || !node_handler)
+                return FALSE;
+        return TRUE;
+}
+
+/**
+ *Dumps the declarations that apply to a node.
+ *@return the dump, to be freed with g_free(), or NULL
+ *if an error occurred.
+ */
+static gchar *
+dump_props (CRSelEng * a_sel_eng, CRCascade * a_cascade,
+            CRXMLNodePtr a_node)
+{
+        CRPropList *props = NULL,
+                *pair = NULL;
+        CRDeclaration *decl = NULL;
+        GString *dump = NULL;
+        gchar *str = NULL;
+
+        if (cr_sel_eng_get_matched_properties_from_cascade
+            (a_sel_eng, a_cascade, a_node, &props) != CR_OK)
+                return NULL;
+        dump = g_string_new (NULL);
+        for (pair = props; pair; pair = cr_prop_list_get_next (pair)) {
+                decl = NULL;
+                cr_prop_list_get_decl (pair, &decl);
+                if (!decl)
+                        continue;
+                str = cr_declaration_to_string (decl, 0);
+                g_string_append_printf (dump, " %s;", str);
+                g_free (str);
+        }
+        if (props)
+                cr_prop_list_destroy (props);
+        return g_string_free (dump, FALSE);
+}
+
+/**
+ *Styles the elements of a libxml2 tree, and their copies
+ *in the #TestNode tree, and dumps the declarations found for
+ *the copies. Those found for the elements must be the same.
+ *@return TRUE if they are, FALSE otherwise.
+ */
+static gboolean
+dump_node (CRSelEng * a_xml_sel_eng, CRSelEng * a_sel_eng,
+           CRCascade * a_cascade, xmlNode * a_node,
+           GHashTable * a_copies, GString * a_dump)
+{
+        xmlNode *cur = NULL;
+        TestNode *copy = NULL;
+        gchar *xml_props = NULL,
+                *props = NULL;
+        gboolean result = TRUE;
+
+        for (cur = a_node; cur && result; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                copy = g_hash_table_lookup (a_copies, cur);
+                xml_props = dump_props (a_xml_sel_eng, a_cascade, cur);
+                props = dump_props (a_sel_eng, a_cascade, copy);
+                if (!xml_props || !props || strcmp (xml_props, props))
+                        result = FALSE;
+                else
+                        g_string_append_printf (a_dump, "%s:%s\n",
+                                                copy->name, props);
+                g_free (xml_props);
+                g_free (props);
+                if (result)
+                        result = dump_node (a_xml_sel_eng, a_sel_eng,
+                                            a_cascade, cur->children,
+                                            a_copies, a_dump);
+        }
+        return result;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *xml_sel_eng = NULL,
+                *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        TestNode *root = NULL;
+        GHashTable *copies = NULL,
+                *styles = NULL;
+        GString *dump = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file
+            ((const guchar *) options.files_list[0], CR_UTF_8,
+             &sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        xml_sel_eng = cr_sel_eng_new ();
+        sel_eng = cr_sel_eng_new ();
+        if (!cascade || !xml_doc || !xml_sel_eng || !sel_eng
+            || cr_sel_eng_get_node_iface (xml_sel_eng)
+            != cr_libxml_node_iface_get ()
+            || cr_sel_eng_set_node_iface (sel_eng, &gv_test_node_iface)
+            != CR_OK
+            || cr_sel_eng_register_pseudo_class_sel_handler
+            (xml_sel_eng, (guchar *) "titled", IDENT_PSEUDO,
+             xml_titled_pseudo_class_handler) != CR_OK
+            || cr_sel_eng_register_node_pseudo_class_sel_handler
+            (sel_eng, (guchar *) "titled", IDENT_PSEUDO,
+             titled_pseudo_class_handler) != CR_OK
+            || check_pseudo_class_handlers (xml_sel_eng, sel_eng) != TRUE) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        copies = g_hash_table_new (g_direct_hash, g_direct_equal);
+        root = test_node_copy (xmlDocGetRootElement (xml_doc), NULL, copies);
+        dump = g_string_new (NULL);
+        if (dump_node (xml_sel_eng, sel_eng, cascade,
+                       xmlDocGetRootElement (xml_doc), copies,
+                       dump) != TRUE) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        /*a whole tree of its own is styled the same way*/
+        if (cr_sel_eng_style_document (sel_eng, cascade, root, NULL, 2,
+                                       &styles) != CR_OK
+            || g_hash_table_size (styles) != g_hash_table_size (copies)) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        g_string_append_printf (dump, "%u elements styled\n",
+                                g_hash_table_size (styles));
+        fprintf (stdout, "%s", dump->str);
+
+        g_hash_table_destroy (styles);
+        g_string_free (dump, TRUE);
+        g_hash_table_destroy (copies);
+        test_node_destroy (root);
+        cr_sel_eng_destroy (sel_eng);
+        cr_sel_eng_destroy (xml_sel_eng);
+        xmlFreeDoc (xml_doc);
+        cr_cascade_unref (cascade);
+        return 0;
+}
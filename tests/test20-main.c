@@ -0,0 +1,259 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the styles a #CRStyleStream computes while
+ *a document is parsed are the ones computed on its tree.
+ */
+
+static const gchar *gv_xml_content =
+        "<!DOCTYPE list [\n"
+        "<!ATTLIST item kind CDATA \"plain\">\n"
+        "<!ENTITY amp2 \"&#38;#38;\">\n"
+        "]>\n"
+        "<list xml:lang=\"fr\">"
+        "<item class=\"a\">one</item>"
+        "<item kind=\"special\">two</item>"
+        "<!-- not an element -->"
+        "<item title=\"a &amp; b\">three</item>"
+        "<item title=\"a &amp2; b\">four</item>"
+        "<item>five"
+        "<list lang=\"en\"><item/><item class=\"a\"/><item/><item/></list>"
+        "</item>"
+        "<item id=\"last\">six</item>"
+        "</list>";
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Styles a document with the file while it is "
+                 "parsed, and checks the\nstyles are the ones computed "
+                 "on the tree of the document.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRStyleStream test "
+                 "program.\n", prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+silent_error (void *a_ctx, const char *a_msg, ...)
+{
+        (void) a_ctx;
+        (void) a_msg;
+}
+
+/**
+ *What the handler of the stream records of the elements.
+ */
+struct StreamDump {
+        CRSelEng *sel_eng;
+        /*the dumps of the styles, in document order*/
+        GPtrArray *styles;
+        /*the names of the elements, indented*/
+        GString *names;
+};
+
+static void
+stream_handler (CRStyleStream * a_stream, CRXMLNodePtr a_node,
+                CRStyle * a_style, gpointer a_user_data)
+{
+        struct StreamDump *dump = a_user_data;
+        CRNodeIface const *iface = NULL;
+        GString *str = NULL;
+
+        iface = cr_sel_eng_get_node_iface (dump->sel_eng);
+        g_string_append_printf (dump->names, "%*s%s\n",
+                                2 * (cr_style_stream_get_depth
+                                     (a_stream) - 1), "",
+                                iface->get_local_name (a_node));
+        str = g_string_new (NULL);
+        cr_style_to_string (a_style, &str, 0);
+        g_ptr_array_add (dump->styles, g_string_free (str, FALSE));
+}
+
+/**
+ *Compares the styles computed on the tree for a list of
+ *sibling elements and their descendants to the ones
+ *the stream found.
+ *@return TRUE if they are the same, FALSE otherwise.
+ */
+static gboolean
+compare_styles (GHashTable * a_styles, xmlNode * a_node,
+                struct StreamDump * a_dump, guint * a_index)
+{
+        xmlNode *cur = NULL;
+        CRStyle *style = NULL;
+        GString *str = NULL;
+        gboolean result = TRUE;
+
+        for (cur = a_node; cur && result == TRUE; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                style = g_hash_table_lookup (a_styles, cur);
+                if (!style || *a_index >= a_dump->styles->len)
+                        return FALSE;
+                str = g_string_new (NULL);
+                cr_style_to_string (style, &str, 0);
+                if (strcmp (str->str, g_ptr_array_index (a_dump->styles,
+                                                         *a_index)))
+                        result = FALSE;
+                g_string_free (str, TRUE);
+                (*a_index)++;
+                if (result == TRUE)
+                        result = compare_styles (a_styles, cur->children,
+                                                 a_dump, a_index);
+        }
+        return result;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        struct StreamDump dump;
+        CRStyleSheet *sheet = NULL;
+        CRCascade *cascade = NULL;
+        CRSelEng *sel_eng = NULL,
+                *tree_sel_eng = NULL;
+        CRStyleStream *stream = NULL;
+        xmlDoc *xml_doc = NULL;
+        GHashTable *styles = NULL;
+        guint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (cr_om_parser_simply_parse_file
+            ((const guchar *) options.files_list[0], CR_UTF_8,
+             &sheet) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        cascade = cr_cascade_new (sheet, NULL, NULL);
+        sel_eng = cr_sel_eng_new ();
+        tree_sel_eng = cr_sel_eng_new ();
+        if (!cascade || !sel_eng || !tree_sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        memset (&dump, 0, sizeof (dump));
+        dump.sel_eng = sel_eng;
+        dump.styles = g_ptr_array_new ();
+        dump.names = g_string_new (NULL);
+        stream = cr_style_stream_new (sel_eng, cascade, stream_handler,
+                                      &dump);
+        if (!stream
+            || cr_style_stream_parse_memory
+            (stream, gv_xml_content, strlen (gv_xml_content)) != CR_OK
+            || cr_style_stream_get_depth (stream) != 0) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        cr_style_stream_destroy (stream);
+        stream = NULL;
+
+        /*a document that is not well formed is an error*/
+        xmlSetGenericErrorFunc (NULL, silent_error);
+        stream = cr_style_stream_new (sel_eng, cascade, NULL, NULL);
+        if (!stream
+            || cr_style_stream_parse_memory
+            (stream, "<list><item></list>", 19) != CR_PARSING_ERROR
+            || cr_style_stream_get_depth (stream) != 0) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        cr_style_stream_destroy (stream);
+        stream = NULL;
+        xmlSetGenericErrorFunc (NULL, NULL);
+        if (cr_sel_eng_get_node_iface (sel_eng)
+            != cr_libxml_node_iface_get ()) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        if (!xml_doc
+            || cr_sel_eng_style_document (tree_sel_eng, cascade,
+                                          (CRXMLNodePtr) xml_doc, NULL, 1,
+                                          &styles) != CR_OK
+            || compare_styles (styles, xmlDocGetRootElement (xml_doc),
+                               &dump, &i) != TRUE
+            || i != dump.styles->len) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        fprintf (stdout, "%s", dump.names->str);
+        fprintf (stdout, "%u elements: the same styles streamed and "
+                 "computed on the tree\n", dump.styles->len);
+
+        g_hash_table_destroy (styles);
+        xmlFreeDoc (xml_doc);
+        for (i = 0; i < dump.styles->len; i++)
+                g_free (g_ptr_array_index (dump.styles, i));
+        g_ptr_array_free (dump.styles, TRUE);
+        g_string_free (dump.names, TRUE);
+        cr_sel_eng_destroy (tree_sel_eng);
+        cr_sel_eng_destroy (sel_eng);
+        cr_cascade_unref (cascade);
+        return 0;
+}
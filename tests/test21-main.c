@@ -0,0 +1,382 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that cr_sel_eng_query_all() finds the elements
+ *cr_sel_eng_matches_node() says match the selectors, and that
+ *several threads can query with one engine, each in a match
+ *context of its own (cr_sel_eng_query_all_in_context()).
+ */
+
+#define NB_THREADS 4
+
+#define NB_ITERATIONS 4
+
+static const gchar *gv_xml_content =
+        "<doc>"
+        "<p id=\"p1\" class=\"note\">one</p>"
+        "<section id=\"main\" lang=\"fr\">"
+        "<p id=\"p2\"><em id=\"e1\" title=\"x\">two</em></p>"
+        "<p id=\"p3\" class=\"note big\">three</p>"
+        "<p id=\"p4\"><em id=\"e2\" title=\"y\">four</em></p>"
+        "<ul id=\"u1\"><li id=\"l1\"><p id=\"p5\">five</p></li>"
+        "<li id=\"l2\"><em id=\"e3\">six</em></li></ul>"
+        "</section>"
+        "<section id=\"other\">"
+        "<p id=\"p6\"><em id=\"e4\">seven</em></p>"
+        "</section>"
+        "</doc>";
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Looks for the elements of a document that "
+                 "match the lists of\nselectors of the file, one list "
+                 "per line.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco cr_sel_eng_query_all() test "
+                 "program.\n", prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *What the handler of the queries records, and returns.
+ */
+struct QueryResult {
+        GString *ids;
+        enum CRSelQueryAction action;
+        guint nr_found;
+};
+
+struct ThreadData {
+        CRSelEng *sel_eng;
+        xmlDoc *xml_doc;
+        /*the lists of selectors, and the ids each one finds*/
+        GPtrArray *sels;
+        GPtrArray *ids;
+        gboolean is_ok;
+};
+
+static enum CRSelQueryAction
+query_handler (CRSelEng * a_sel_eng, CRXMLNodePtr a_node,
+               gpointer a_user_data)
+{
+        struct QueryResult *result = a_user_data;
+        xmlChar *id = NULL;
+
+        (void) a_sel_eng;
+
+        id = xmlGetProp ((xmlNode *) a_node, (const xmlChar *) "id");
+        g_string_append_printf (result->ids, " %s",
+                                id ? (const gchar *) id : "?");
+        if (id)
+                xmlFree (id);
+        result->nr_found++;
+        return result->action;
+}
+
+/**
+ *Looks for the descendants of a node that match a list of
+ *selectors the slow way, one node and one selector at a time.
+ */
+static void
+match_descendants (CRSelEng * a_sel_eng, CRSelector * a_sel,
+                   xmlNode * a_node, struct QueryResult *a_result)
+{
+        xmlNode *cur = NULL;
+        CRSelector *sel = NULL;
+        gboolean matches = FALSE;
+
+        for (cur = a_node->children; cur; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                for (sel = a_sel; sel; sel = sel->next) {
+                        matches = FALSE;
+                        cr_sel_eng_matches_node (a_sel_eng,
+                                                 sel->simple_sel, cur,
+                                                 &matches);
+                        if (matches == TRUE) {
+                                query_handler (a_sel_eng, cur, a_result);
+                                break;
+                        }
+                }
+                match_descendants (a_sel_eng, a_sel, cur, a_result);
+        }
+}
+
+/**
+ *Looks for the descendants of a node that match a list of
+ *selectors, and dumps them.
+ *@return TRUE if cr_sel_eng_query_all() found the
+ *expected nodes, FALSE otherwise.
+ */
+static gboolean
+query (CRSelEng * a_sel_eng, CRSelector * a_sel, xmlNode * a_root,
+       const gchar * a_root_name, GString * a_dump)
+{
+        struct QueryResult result,
+                expected;
+        gboolean is_ok = FALSE;
+
+        memset (&result, 0, sizeof (result));
+        memset (&expected, 0, sizeof (expected));
+        result.ids = g_string_new (NULL);
+        expected.ids = g_string_new (NULL);
+        if (cr_sel_eng_query_all (a_sel_eng, (CRXMLNodePtr) a_root, a_sel,
+                                  query_handler, &result) == CR_OK) {
+                match_descendants (a_sel_eng, a_sel, a_root, &expected);
+                is_ok = !strcmp (result.ids->str, expected.ids->str);
+        }
+        if (is_ok == TRUE)
+                g_string_append_printf (a_dump, "  in %s:%s\n",
+                                        a_root_name, result.ids->str);
+        g_string_free (result.ids, TRUE);
+        g_string_free (expected.ids, TRUE);
+        return is_ok;
+}
+
+/**
+ *The body of a thread: runs each query NB_ITERATIONS
+ *times in a match context of its own.
+ */
+static void
+run_thread (gpointer a_data, gpointer a_user_data)
+{
+        struct ThreadData *data = a_data;
+        CRSelMatchContext *ctxt = NULL;
+        struct QueryResult result;
+        guint i = 0,
+                j = 0;
+
+        (void) a_user_data;
+
+        ctxt = cr_sel_match_context_new ();
+        if (!ctxt) {
+                data->is_ok = FALSE;
+                return;
+        }
+        memset (&result, 0, sizeof (result));
+        result.ids = g_string_new (NULL);
+        for (i = 0; i < NB_ITERATIONS; i++) {
+                for (j = 0; j < data->sels->len; j++) {
+                        g_string_truncate (result.ids, 0);
+                        if (cr_sel_eng_query_all_in_context
+                            (data->sel_eng, ctxt,
+                             (CRXMLNodePtr) data->xml_doc,
+                             g_ptr_array_index (data->sels, j),
+                             query_handler, &result) != CR_OK
+                            || strcmp (result.ids->str,
+                                       g_ptr_array_index (data->ids, j)))
+                                data->is_ok = FALSE;
+                }
+        }
+        g_string_free (result.ids, TRUE);
+        cr_sel_match_context_destroy (ctxt);
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        struct QueryResult result;
+        struct ThreadData data[NB_THREADS];
+        CRSelEng *sel_eng = NULL;
+        CRSelector *sel = NULL;
+        xmlDoc *xml_doc = NULL;
+        xmlNode *main_node = NULL;
+        GThreadPool *pool = NULL;
+        GPtrArray *sels = NULL,
+                *ids = NULL;
+        GString *dump = NULL;
+        gchar *content = NULL,
+                **lines = NULL,
+                *str = NULL;
+        guint i = 0;
+        gboolean is_ok = TRUE;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (!g_file_get_contents (options.files_list[0], &content,
+                                  NULL, NULL)) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        /*the second child of the root element*/
+        main_node = xmlDocGetRootElement (xml_doc)->children->next;
+
+        dump = g_string_new (NULL);
+        sels = g_ptr_array_new ();
+        lines = g_strsplit (content, "\n", 0);
+        for (i = 0; lines[i]; i++) {
+                if (!*lines[i])
+                        continue;
+                g_string_append_printf (dump, "%s\n", lines[i]);
+                sel = cr_selector_parse_from_buf ((const guchar *) lines[i],
+                                                  CR_UTF_8);
+                if (!sel) {
+                        g_string_append (dump, "  not a selector\n");
+                        continue;
+                }
+                str = (gchar *) cr_selector_to_string (sel);
+                g_string_append_printf (dump, "  parsed as %s\n", str);
+                g_free (str);
+                if (query (sel_eng, sel, (xmlNode *) xml_doc, "doc",
+                           dump) != TRUE
+                    || query (sel_eng, sel, main_node, "#main",
+                              dump) != TRUE) {
+                        fprintf (stdout, "KO\n");
+                        return 0;
+                }
+                g_ptr_array_add (sels, sel);
+        }
+
+        /*the same queries, from several threads at once*/
+        ids = g_ptr_array_new ();
+        memset (&result, 0, sizeof (result));
+        for (i = 0; i < sels->len; i++) {
+                result.ids = g_string_new (NULL);
+                if (cr_sel_eng_query_all (sel_eng, (CRXMLNodePtr) xml_doc,
+                                          g_ptr_array_index (sels, i),
+                                          query_handler, &result)
+                    != CR_OK) {
+                        fprintf (stdout, "KO\n");
+                        return 0;
+                }
+                g_ptr_array_add (ids, g_string_free (result.ids, FALSE));
+        }
+        pool = g_thread_pool_new (run_thread, NULL, NB_THREADS, TRUE, NULL);
+        if (!pool) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        memset (data, 0, sizeof (data));
+        for (i = 0; i < NB_THREADS; i++) {
+                data[i].sel_eng = sel_eng;
+                data[i].xml_doc = xml_doc;
+                data[i].sels = sels;
+                data[i].ids = ids;
+                data[i].is_ok = TRUE;
+                g_thread_pool_push (pool, &data[i], NULL);
+        }
+        g_thread_pool_free (pool, FALSE, TRUE);
+        for (i = 0; i < NB_THREADS; i++) {
+                if (data[i].is_ok == FALSE)
+                        is_ok = FALSE;
+        }
+        g_string_append_printf (dump, "%d threads, each in a match context "
+                                "of its own: %s\n", NB_THREADS,
+                                is_ok == TRUE ? "the same elements" : "KO");
+        for (i = 0; i < sels->len; i++) {
+                cr_selector_unref (g_ptr_array_index (sels, i));
+                g_free (g_ptr_array_index (ids, i));
+        }
+        g_ptr_array_free (sels, TRUE);
+        g_ptr_array_free (ids, TRUE);
+
+        /*an empty buffer is not a selector either*/
+        sel = cr_selector_parse_from_buf ((const guchar *) "", CR_UTF_8);
+        if (sel) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        g_string_append (dump, "the empty string: not a selector\n");
+
+        /*the handler prunes the walk, or stops it*/
+        sel = cr_selector_parse_from_buf ((const guchar *) "section, p",
+                                          CR_UTF_8);
+        memset (&result, 0, sizeof (result));
+        result.ids = g_string_new (NULL);
+        result.action = CR_SEL_QUERY_SKIP_CHILDREN;
+        if (!sel
+            || cr_sel_eng_query_all (sel_eng, (CRXMLNodePtr) xml_doc, sel,
+                                     query_handler, &result) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        g_string_append_printf (dump, "section, p without descendants:%s\n",
+                                result.ids->str);
+        g_string_truncate (result.ids, 0);
+        result.action = CR_SEL_QUERY_STOP;
+        if (cr_sel_eng_query_all (sel_eng, (CRXMLNodePtr) xml_doc, sel,
+                                  query_handler, &result) != CR_OK) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        g_string_append_printf (dump, "section, p until the first:%s\n",
+                                result.ids->str);
+        fprintf (stdout, "%s", dump->str);
+
+        g_string_free (result.ids, TRUE);
+        cr_selector_unref (sel);
+        g_string_free (dump, TRUE);
+        g_strfreev (lines);
+        g_free (content);
+        cr_sel_eng_destroy (sel_eng);
+        xmlFreeDoc (xml_doc);
+        return 0;
+}
@@ -0,0 +1,197 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the selection engine sees the changes made to
+ *the statements of a stylesheet it has already selected in.
+ */
+
+static const gchar *gv_xml_content = "<doc><p class=\"a\"/></doc>";
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Edits the stylesheet between selections "
+                 "and dumps the rulesets\nthat match each time.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Dumps the selectors of the rulesets of a stylesheet that
+ *match a node.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+dump_matched_rulesets (CRSelEng * a_sel_eng, CRStyleSheet * a_sheet,
+                       xmlNode * a_node, const gchar * a_step)
+{
+        enum CRStatus status = CR_OK;
+        CRStatement **rulesets = NULL;
+        gulong len = 0,
+                i = 0;
+        guchar *str = NULL;
+
+        status = cr_sel_eng_get_matched_rulesets (a_sel_eng, a_sheet,
+                                                  (CRXMLNodePtr) a_node,
+                                                  &rulesets, &len);
+        if (status != CR_OK)
+                return status;
+        fprintf (stdout, "%s:", a_step);
+        for (i = 0; i < len; i++) {
+                str = cr_selector_to_string
+                        (rulesets[i]->kind.ruleset->sel_list);
+                fprintf (stdout, " {%s}", str ? (const gchar *) str : "");
+                g_free (str);
+        }
+        fprintf (stdout, "\n");
+        g_free (rulesets);
+        return CR_OK;
+}
+
+/**
+ *Parses a ruleset of the stylesheet.
+ */
+static CRStatement *
+parse_ruleset (CRStyleSheet * a_sheet, const gchar * a_buf)
+{
+        CRStatement *result = NULL;
+
+        result = cr_statement_ruleset_parse_from_buf
+                ((const guchar *) a_buf, CR_UTF_8);
+        if (result)
+                cr_statement_set_parent_sheet (result, a_sheet);
+        return result;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *sheet = NULL;
+        CRStatement *stmt = NULL;
+        CRSelector *sel = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        xmlNode *node = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = cr_om_parser_simply_parse_file
+                ((const guchar *) options.files_list[0], CR_ASCII, &sheet);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (status != CR_OK || !sheet || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        node = xmlDocGetRootElement (xml_doc)->children;
+
+        status = dump_matched_rulesets (sel_eng, sheet, node, "parsed");
+
+        /*the first ruleset is removed*/
+        if (status == CR_OK) {
+                stmt = cr_statement_unlink (sheet->statements);
+                cr_statement_destroy (stmt);
+                status = dump_matched_rulesets (sel_eng, sheet, node,
+                                                "first ruleset removed");
+        }
+
+        /*a ruleset is appended*/
+        if (status == CR_OK) {
+                stmt = parse_ruleset (sheet, "p.a { color: green }");
+                sheet->statements = cr_statement_append (sheet->statements,
+                                                         stmt);
+                status = dump_matched_rulesets (sel_eng, sheet, node,
+                                                "ruleset appended");
+        }
+
+        /*the selector of the first ruleset is changed*/
+        if (status == CR_OK) {
+                sel = cr_selector_parse_from_buf ((const guchar *) "div",
+                                                  CR_UTF_8);
+                /*the statement takes the only reference on sel*/
+                cr_statement_ruleset_set_sel_list (sheet->statements, sel);
+                status = dump_matched_rulesets (sel_eng, sheet, node,
+                                                "selector changed");
+        }
+
+        /*a ruleset is prepended*/
+        if (status == CR_OK) {
+                stmt = parse_ruleset (sheet, "* { color: black }");
+                sheet->statements = cr_statement_prepend (sheet->statements,
+                                                          stmt);
+                status = dump_matched_rulesets (sel_eng, sheet, node,
+                                                "ruleset prepended");
+        }
+
+        if (status != CR_OK)
+                fprintf (stdout, "KO\n");
+
+        cr_sel_eng_destroy (sel_eng);
+        cr_stylesheet_unref (sheet);
+        xmlFreeDoc (xml_doc);
+        return 0;
+}
@@ -0,0 +1,217 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that pushing the ancestors of the elements to the
+ *selection engine (cr_sel_eng_push_element()) does not change
+ *the rulesets that match them.
+ */
+
+static const gchar *gv_xml_content =
+        "<body>"
+        "<p id=\"p1\">one</p>"
+        "<section id=\"main\">"
+        "<div id=\"d1\"><p id=\"p2\" class=\"note\"><em id=\"e1\">two</em>"
+        "</p></div>"
+        "<ul id=\"u1\"><li id=\"l1\"><p id=\"p3\" class=\"note\">"
+        "<em id=\"e2\">three</em></p></li></ul>"
+        "</section>"
+        "<div id=\"d2\" class=\"x\"><div id=\"d3\" class=\"y\">"
+        "<div id=\"d4\" class=\"z w\"><p id=\"p4\" class=\"v\">four</p>"
+        "<p id=\"p5\" class=\"w\"><em id=\"e3\" class=\"v\">five</em></p>"
+        "</div></div></div>"
+        "<ol id=\"o1\"><li id=\"l2\"><em id=\"e4\">six</em></li></ol>"
+        "</body>";
+
+/*
+ *How the elements are walked: without pushing their ancestors,
+ *pushing all of them, or only the ones at an even depth, so that
+ *the engine sometimes has to do without the filter.
+ */
+enum WalkMode {
+        WALK_NO_PUSH,
+        WALK_PUSH_ALL,
+        WALK_PUSH_EVEN_DEPTHS
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Looks up the rulesets that match the elements "
+                 "of a document, with\nand without their ancestors "
+                 "pushed to the selection engine.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Walks the elements under a_node and logs the selectors of the
+ *rulesets that match each of them.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+walk (CRSelEng * a_sel_eng, CRStyleSheet * a_sheet, xmlNode * a_node,
+      enum WalkMode a_mode, guint a_depth, GString * a_log)
+{
+        enum CRStatus status = CR_OK;
+        CRStatement **rulesets = NULL;
+        gulong len = 0,
+                i = 0;
+        xmlNode *cur = NULL;
+        xmlChar *id = NULL;
+        guchar *str = NULL;
+        gboolean push = FALSE;
+
+        for (cur = a_node; cur && status == CR_OK; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                status = cr_sel_eng_get_matched_rulesets
+                        (a_sel_eng, a_sheet, (CRXMLNodePtr) cur,
+                         &rulesets, &len);
+                if (status != CR_OK)
+                        break;
+                id = xmlGetProp (cur, (const xmlChar *) "id");
+                g_string_append_printf (a_log, "%s:",
+                                        id ? (const gchar *) id
+                                        : (const gchar *) cur->name);
+                if (id)
+                        xmlFree (id);
+                for (i = 0; i < len; i++) {
+                        str = cr_selector_to_string
+                                (rulesets[i]->kind.ruleset->sel_list);
+                        g_string_append_printf (a_log, " {%s}",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                g_string_append (a_log, "\n");
+                g_free (rulesets);
+                rulesets = NULL;
+
+                push = a_mode == WALK_PUSH_ALL
+                        || (a_mode == WALK_PUSH_EVEN_DEPTHS
+                            && !(a_depth % 2));
+                if (push == TRUE)
+                        cr_sel_eng_push_element (a_sel_eng,
+                                                 (CRXMLNodePtr) cur);
+                status = walk (a_sel_eng, a_sheet, cur->children, a_mode,
+                               a_depth + 1, a_log);
+                if (push == TRUE)
+                        cr_sel_eng_pop_element (a_sel_eng,
+                                                (CRXMLNodePtr) cur);
+        }
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *sheet = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *log = NULL,
+                *pushed_log = NULL,
+                *even_log = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = cr_om_parser_simply_parse_file
+                ((const guchar *) options.files_list[0], CR_ASCII, &sheet);
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (status != CR_OK || !sheet || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        log = g_string_new (NULL);
+        pushed_log = g_string_new (NULL);
+        even_log = g_string_new (NULL);
+        status = walk (sel_eng, sheet, xmlDocGetRootElement (xml_doc),
+                       WALK_NO_PUSH, 0, log);
+        if (status == CR_OK)
+                status = walk (sel_eng, sheet,
+                               xmlDocGetRootElement (xml_doc),
+                               WALK_PUSH_ALL, 0, pushed_log);
+        if (status == CR_OK)
+                status = walk (sel_eng, sheet,
+                               xmlDocGetRootElement (xml_doc),
+                               WALK_PUSH_EVEN_DEPTHS, 0, even_log);
+        if (status != CR_OK
+            || strcmp (log->str, pushed_log->str)
+            || strcmp (log->str, even_log->str)) {
+                fprintf (stdout, "KO\n");
+        } else {
+                fprintf (stdout, "%s", log->str);
+        }
+
+        g_string_free (log, TRUE);
+        g_string_free (pushed_log, TRUE);
+        g_string_free (even_log, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        cr_stylesheet_unref (sheet);
+        xmlFreeDoc (xml_doc);
+        return 0;
+}
@@ -0,0 +1,288 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the ancestor filter of the selection engine
+ *doesn't change the rulesets that match the elements of a
+ *document whose ancestors saturate its counters, or carry
+ *class names that fall in the same counters as the ones the
+ *rulesets require.
+ */
+
+/*
+ *The number of nested elements of the deep branch of the
+ *document: more than the 255 a counter of the filter can count.
+ */
+#define DEEP_DEPTH 300
+
+/*
+ *Class names whose hashes have the same 24 low bits, and so
+ *set the same two counters of the filter.
+ */
+static const gchar *gv_colliding_classes[][2] = {
+        {"c49819", "c50822"},
+        {"c49818", "c50823"}
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Looks up the rulesets that match the elements "
+                 "of a deep document,\nwith and without the ancestor "
+                 "filter of the selection engine.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRSelEng class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Hashes a class name the way the rule index hashes the keys
+ *of the ancestor filter: FNV-1a, seeded by the key type.
+ */
+static guint32
+hash_class (const gchar * a_class)
+{
+        guint32 hash = 2166136261u;
+        const gchar *cur = NULL;
+
+        hash = (hash ^ (CR_RULE_INDEX_KEY_CLASS + 1)) * 16777619u;
+        for (cur = a_class; *cur; cur++)
+                hash = (hash ^ (guchar) *cur) * 16777619u;
+        return hash;
+}
+
+/**
+ *@return TRUE if the names of gv_colliding_classes
+ *do collide in the ancestor filter, FALSE otherwise.
+ */
+static gboolean
+classes_collide (void)
+{
+        guint32 hash = 0,
+                other_hash = 0;
+        gulong i = 0;
+
+        for (i = 0; i < G_N_ELEMENTS (gv_colliding_classes); i++) {
+                hash = hash_class (gv_colliding_classes[i][0]);
+                other_hash = hash_class (gv_colliding_classes[i][1]);
+                if ((hash & 0xffffff) != (other_hash & 0xffffff))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Builds the document to style.
+ *@return the newly built document, or NULL if it could not be parsed.
+ */
+static xmlDoc *
+build_document (void)
+{
+        GString *content = NULL;
+        xmlDoc *result = NULL;
+        gulong i = 0;
+
+        content = g_string_new ("<body>");
+        g_string_append (content, "<div id=\"deep\" class=\"a c49819\">");
+        for (i = 1; i < DEEP_DEPTH; i++)
+                g_string_append (content, "<div class=\"a c49819\">");
+        g_string_append (content,
+                         "<p id=\"p1\" class=\"c49818\">one</p>"
+                         "<p id=\"p2\"><em id=\"e1\">two</em></p>");
+        for (i = 0; i < DEEP_DEPTH; i++)
+                g_string_append (content, "</div>");
+        g_string_append (content,
+                         "<p id=\"p3\">three</p>"
+                         "<div id=\"d1\" class=\"c50822\">"
+                         "<p id=\"p4\">four</p></div>"
+                         "<div id=\"d2\" class=\"c50823\">"
+                         "<div class=\"c49819\"><p id=\"p5\">five</p>"
+                         "</div></div>"
+                         "<div id=\"d3\" class=\"c49818\">"
+                         "<p id=\"p6\">six</p></div>"
+                         "<section id=\"s1\"><div class=\"b\">"
+                         "<em id=\"e2\">seven</em></div></section>"
+                         "</body>");
+        /*libxml2 refuses documents deeper than 256 without XML_PARSE_HUGE*/
+        result = xmlReadMemory (content->str, content->len, NULL, NULL,
+                                XML_PARSE_HUGE);
+        g_string_free (content, TRUE);
+        return result;
+}
+
+/**
+ *Walks the elements under a_node and logs the selectors of the
+ *rulesets that match each of them in a_log, and in a_id_log for
+ *the elements that have an id.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+walk (CRSelEng * a_sel_eng, CRStyleSheet * a_sheet, xmlNode * a_node,
+      gboolean a_push, GString * a_log, GString * a_id_log)
+{
+        enum CRStatus status = CR_OK;
+        CRStatement **rulesets = NULL;
+        gulong len = 0,
+                i = 0;
+        xmlNode *cur = NULL;
+        xmlChar *id = NULL;
+        guchar *str = NULL;
+        GString *line = NULL;
+
+        line = g_string_new (NULL);
+        for (cur = a_node; cur && status == CR_OK; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                status = cr_sel_eng_get_matched_rulesets
+                        (a_sel_eng, a_sheet, (CRXMLNodePtr) cur,
+                         &rulesets, &len);
+                if (status != CR_OK)
+                        break;
+                id = xmlGetProp (cur, (const xmlChar *) "id");
+                g_string_truncate (line, 0);
+                g_string_append_printf (line, "%s:",
+                                        id ? (const gchar *) id
+                                        : (const gchar *) cur->name);
+                for (i = 0; i < len; i++) {
+                        str = cr_selector_to_string
+                                (rulesets[i]->kind.ruleset->sel_list);
+                        g_string_append_printf (line, " {%s}",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                g_string_append (line, "\n");
+                g_string_append (a_log, line->str);
+                if (id) {
+                        g_string_append (a_id_log, line->str);
+                        xmlFree (id);
+                }
+                g_free (rulesets);
+                rulesets = NULL;
+
+                if (a_push == TRUE)
+                        cr_sel_eng_push_element (a_sel_eng,
+                                                 (CRXMLNodePtr) cur);
+                status = walk (a_sel_eng, a_sheet, cur->children, a_push,
+                               a_log, a_id_log);
+                if (a_push == TRUE)
+                        cr_sel_eng_pop_element (a_sel_eng,
+                                                (CRXMLNodePtr) cur);
+        }
+        g_string_free (line, TRUE);
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *sheet = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *log = NULL,
+                *id_log = NULL,
+                *filtered_log = NULL,
+                *filtered_id_log = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (classes_collide () == FALSE) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        status = cr_om_parser_simply_parse_file
+                ((const guchar *) options.files_list[0], CR_ASCII, &sheet);
+        xml_doc = build_document ();
+        sel_eng = cr_sel_eng_new ();
+        if (status != CR_OK || !sheet || !xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        log = g_string_new (NULL);
+        id_log = g_string_new (NULL);
+        filtered_log = g_string_new (NULL);
+        filtered_id_log = g_string_new (NULL);
+        status = walk (sel_eng, sheet, xmlDocGetRootElement (xml_doc),
+                       FALSE, log, id_log);
+        if (status == CR_OK)
+                status = walk (sel_eng, sheet,
+                               xmlDocGetRootElement (xml_doc),
+                               TRUE, filtered_log, filtered_id_log);
+        if (status != CR_OK || strcmp (log->str, filtered_log->str)) {
+                fprintf (stdout, "KO\n");
+        } else {
+                fprintf (stdout, "%s", id_log->str);
+        }
+
+        g_string_free (log, TRUE);
+        g_string_free (id_log, TRUE);
+        g_string_free (filtered_log, TRUE);
+        g_string_free (filtered_id_log, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        cr_stylesheet_unref (sheet);
+        xmlFreeDoc (xml_doc);
+        return 0;
+}
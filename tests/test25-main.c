@@ -0,0 +1,296 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Tests the atoms (CRAtom): the interning of strings, the atoms of
+ *the idents and names read by the tokenizer, which keep their case,
+ *and the lookup of the candidate rulesets of the elements by atom,
+ *compared to matching every selector of the stylesheet by string.
+ */
+
+static const gchar *gv_xml_content =
+        "<div id=\"main\">"
+        "<p id=\"p1\" class=\"note\">one</p>"
+        "<P id=\"p2\" class=\"Note note\">two</P>"
+        "<p id=\"p3\" class=\"NOTE\">three</p>"
+        "<P id=\"Main\" class=\"nOtE\">four</P>"
+        "</div>";
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Tests the interning of the idents of a "
+                 "stylesheet, and the lookup\nof the rulesets that "
+                 "match the elements of a document by atom.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRAtom test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *@return TRUE if equal strings intern to the same atom
+ *and strings that only differ by their case don't.
+ */
+static gboolean
+check_interning (void)
+{
+        gchar *note = NULL,
+                *other_note = NULL;
+        CRAtom atom = NULL;
+        gboolean result = TRUE;
+
+        note = g_strdup ("note");
+        other_note = g_strdup ("note");
+        atom = cr_atom_from_string (note);
+        if (!atom || atom == note || strcmp (atom, "note")
+            || cr_atom_from_string (other_note) != atom
+            || cr_atom_lookup (other_note) != atom)
+                result = FALSE;
+        if (cr_atom_from_string ("Note") == atom
+            || cr_atom_from_string ("NOTE") == atom
+            || cr_atom_from_string ("NOTE")
+            == cr_atom_from_string ("Note"))
+                result = FALSE;
+        if (cr_atom_lookup ("nOtE") != NULL
+            || cr_atom_from_string (NULL) != NULL
+            || cr_atom_lookup (NULL) != NULL)
+                result = FALSE;
+        g_free (note);
+        g_free (other_note);
+        return result;
+}
+
+/**
+ *@return TRUE if a_str is NULL or has the atom of its content.
+ */
+static gboolean
+check_string_atom (CRString * a_str)
+{
+        if (!a_str || !a_str->stryng || !a_str->stryng->str)
+                return TRUE;
+        return cr_string_get_atom (a_str)
+                == cr_atom_lookup (a_str->stryng->str);
+}
+
+/**
+ *@return TRUE if the element names, classes and ids of the
+ *selectors of a_sheet have the atoms of their content.
+ */
+static gboolean
+check_selector_atoms (CRStyleSheet * a_sheet)
+{
+        CRStatement *stmt = NULL;
+        CRSelector *sel = NULL;
+        CRSimpleSel *simple_sel = NULL;
+        CRAdditionalSel *add_sel = NULL;
+
+        for (stmt = a_sheet->statements; stmt; stmt = stmt->next) {
+                if (stmt->type != RULESET_STMT)
+                        continue;
+                for (sel = stmt->kind.ruleset->sel_list; sel;
+                     sel = sel->next) {
+                        for (simple_sel = sel->simple_sel; simple_sel;
+                             simple_sel = simple_sel->next) {
+                                if (!check_string_atom (simple_sel->name))
+                                        return FALSE;
+                                for (add_sel = simple_sel->add_sel;
+                                     add_sel; add_sel = add_sel->next) {
+                                        if (add_sel->type
+                                            == CLASS_ADD_SELECTOR
+                                            && !check_string_atom
+                                            (add_sel->content.class_name))
+                                                return FALSE;
+                                        if (add_sel->type == ID_ADD_SELECTOR
+                                            && !check_string_atom
+                                            (add_sel->content.id_name))
+                                                return FALSE;
+                                }
+                        }
+                }
+        }
+        return TRUE;
+}
+
+/**
+ *Matches every selector of every ruleset of a_sheet against
+ *the elements under a_node, and checks that the rulesets the
+ *selection engine looks up by atom are the ones that match.
+ *Logs the matching rulesets of each element.
+ *@return CR_OK upon successful completion, CR_ERROR if the
+ *lookup by atom gives other rulesets, another error code otherwise.
+ */
+static enum CRStatus
+walk (CRSelEng * a_sel_eng, CRStyleSheet * a_sheet, xmlNode * a_node,
+      GString * a_log)
+{
+        enum CRStatus status = CR_OK;
+        CRStatement **rulesets = NULL,
+                *stmt = NULL;
+        CRSelector *sel = NULL;
+        gulong len = 0,
+                i = 0,
+                nr_matching = 0;
+        gboolean matches = FALSE,
+                found = FALSE;
+        xmlNode *cur = NULL;
+        xmlChar *id = NULL;
+        guchar *str = NULL;
+
+        for (cur = a_node; cur && status == CR_OK; cur = cur->next) {
+                if (cur->type != XML_ELEMENT_NODE)
+                        continue;
+                status = cr_sel_eng_get_matched_rulesets
+                        (a_sel_eng, a_sheet, (CRXMLNodePtr) cur,
+                         &rulesets, &len);
+                if (status != CR_OK)
+                        break;
+                id = xmlGetProp (cur, (const xmlChar *) "id");
+                g_string_append_printf (a_log, "%s:", (const gchar *) id);
+                xmlFree (id);
+                nr_matching = 0;
+                for (stmt = a_sheet->statements;
+                     stmt && status == CR_OK; stmt = stmt->next) {
+                        if (stmt->type != RULESET_STMT)
+                                continue;
+                        matches = FALSE;
+                        for (sel = stmt->kind.ruleset->sel_list;
+                             sel && matches == FALSE
+                             && status == CR_OK; sel = sel->next) {
+                                status = cr_sel_eng_matches_node
+                                        (a_sel_eng, sel->simple_sel,
+                                         (CRXMLNodePtr) cur, &matches);
+                        }
+                        if (matches == FALSE)
+                                continue;
+                        nr_matching++;
+                        found = FALSE;
+                        for (i = 0; i < len && found == FALSE; i++)
+                                found = rulesets[i] == stmt;
+                        if (found == FALSE)
+                                status = CR_ERROR;
+                        str = cr_selector_to_string
+                                (stmt->kind.ruleset->sel_list);
+                        g_string_append_printf (a_log, " {%s}",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                if (status == CR_OK && nr_matching != len)
+                        status = CR_ERROR;
+                g_string_append (a_log, "\n");
+                g_free (rulesets);
+                rulesets = NULL;
+                if (status == CR_OK)
+                        status = walk (a_sel_eng, a_sheet, cur->children,
+                                       a_log);
+        }
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *sheet = NULL;
+        CRSelEng *sel_eng = NULL;
+        xmlDoc *xml_doc = NULL;
+        GString *log = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (check_interning () == FALSE) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        fprintf (stdout, "interning: OK\n");
+
+        status = cr_om_parser_simply_parse_file
+                ((const guchar *) options.files_list[0], CR_ASCII, &sheet);
+        if (status != CR_OK || !sheet
+            || check_selector_atoms (sheet) == FALSE) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        fprintf (stdout, "selector atoms: OK\n");
+
+        xml_doc = xmlParseMemory (gv_xml_content, strlen (gv_xml_content));
+        sel_eng = cr_sel_eng_new ();
+        if (!xml_doc || !sel_eng) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        log = g_string_new (NULL);
+        status = walk (sel_eng, sheet, xmlDocGetRootElement (xml_doc),
+                       log);
+        if (status != CR_OK) {
+                fprintf (stdout, "KO\n");
+        } else {
+                fprintf (stdout, "%s", log->str);
+        }
+
+        g_string_free (log, TRUE);
+        cr_sel_eng_destroy (sel_eng);
+        cr_stylesheet_unref (sheet);
+        xmlFreeDoc (xml_doc);
+        return 0;
+}
@@ -0,0 +1,396 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Tests the recycling of the tokens of the tokenizer
+ *(cr_tknzr_release_token()) and the comments it returns as
+ *slices of its input (cr_token_dup_slice()).
+ */
+
+/*
+ *Tokens with all kinds of payloads, tokenized first to fill
+ *the pool of the tokenizer with tokens that have held them.
+ */
+static const gchar *gv_other_css =
+        "12px 50% 3em \"a string\" #abc url(x.png) rgb(10, 20, 30) "
+        "foo( @media 4dpi 5kHz 1s ! important /* other */ ident";
+
+/*
+ *A stylesheet fed to a streaming input in two chunks: the
+ *second window of the input reuses the buffer of the first one.
+ */
+static const gchar *gv_first_chunk = "/* first */ a { b: c }\n";
+
+static const gchar *gv_second_chunk = "/* second */ d { e: 1em }\n";
+
+static const gchar *gv_token_names[] = {
+        "NO_TK", "S_TK", "CDO_TK", "CDC_TK", "INCLUDES_TK",
+        "DASHMATCH_TK", "COMMENT_TK", "STRING_TK", "IDENT_TK", "HASH_TK",
+        "IMPORT_SYM_TK", "PAGE_SYM_TK", "MEDIA_SYM_TK", "FONT_FACE_SYM_TK",
+        "CHARSET_SYM_TK", "ATKEYWORD_TK", "IMPORTANT_SYM_TK", "EMS_TK",
+        "EXS_TK", "LENGTH_TK", "ANGLE_TK", "TIME_TK", "FREQ_TK",
+        "DIMEN_TK", "PERCENTAGE_TK", "NUMBER_TK", "RGB_TK", "URI_TK",
+        "FUNCTION_TK", "UNICODERANGE_TK", "SEMICOLON_TK", "CBO_TK",
+        "CBC_TK", "PO_TK", "PC_TK", "BO_TK", "BC_TK", "DELIM_TK"
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Tokenizes a file with a fresh tokenizer and "
+                 "with a tokenizer whose\ntokens have been recycled, "
+                 "and checks that both give the same tokens.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRTknzr class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *@return TRUE if a_token only holds the payload its type
+ *calls for, FALSE if it carries a value left over by a token
+ *it has been recycled from.
+ */
+static gboolean
+token_is_clean (CRToken * a_token)
+{
+        if (a_token->slice && a_token->type != COMMENT_TK)
+                return FALSE;
+        if (a_token->dimen && a_token->type != DIMEN_TK)
+                return FALSE;
+        switch (a_token->type) {
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+                return a_token->extra_type != NO_ET;
+        case S_TK:
+        case CDO_TK:
+        case CDC_TK:
+        case INCLUDES_TK:
+        case DASHMATCH_TK:
+        case IMPORT_SYM_TK:
+        case PAGE_SYM_TK:
+        case MEDIA_SYM_TK:
+        case FONT_FACE_SYM_TK:
+        case CHARSET_SYM_TK:
+        case IMPORTANT_SYM_TK:
+        case SEMICOLON_TK:
+        case CBO_TK:
+        case CBC_TK:
+        case PO_TK:
+        case PC_TK:
+        case BO_TK:
+        case BC_TK:
+                return a_token->u.str == NULL
+                        && a_token->extra_type == NO_ET;
+        default:
+                return a_token->extra_type == NO_ET;
+        }
+}
+
+/**
+ *Appends the type, the payload and the location of a_token to a_log.
+ */
+static void
+log_token (CRToken * a_token, GString * a_log)
+{
+        guchar *str = NULL;
+
+        g_string_append_printf (a_log, "%u:%u %s",
+                                a_token->location.line,
+                                a_token->location.column,
+                                a_token->type < G_N_ELEMENTS
+                                (gv_token_names) ?
+                                gv_token_names[a_token->type] : "?");
+        switch (a_token->type) {
+        case COMMENT_TK:
+                g_string_append (a_log, " '");
+                if (a_token->slice)
+                        g_string_append_len (a_log,
+                                             (const gchar *) a_token->slice,
+                                             a_token->slice_len);
+                else if (a_token->u.str && a_token->u.str->stryng)
+                        g_string_append (a_log,
+                                         a_token->u.str->stryng->str);
+                g_string_append (a_log, "'");
+                break;
+        case STRING_TK:
+        case IDENT_TK:
+        case HASH_TK:
+        case ATKEYWORD_TK:
+        case URI_TK:
+        case FUNCTION_TK:
+        case UNICODERANGE_TK:
+                if (a_token->u.str && a_token->u.str->stryng)
+                        g_string_append_printf (a_log, " '%s'",
+                                                a_token->u.str->stryng->str);
+                break;
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case DIMEN_TK:
+        case PERCENTAGE_TK:
+        case NUMBER_TK:
+                if (a_token->u.num) {
+                        str = cr_num_to_string (a_token->u.num);
+                        g_string_append_printf (a_log, " %s",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                if (a_token->dimen && a_token->dimen->stryng)
+                        g_string_append_printf (a_log, " '%s'",
+                                                a_token->dimen->stryng->str);
+                break;
+        case RGB_TK:
+                if (a_token->u.rgb) {
+                        str = cr_rgb_to_string (a_token->u.rgb);
+                        g_string_append_printf (a_log, " %s",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                break;
+        case DELIM_TK:
+                g_string_append_printf (a_log, " '%c'",
+                                        (gchar) a_token->u.unichar);
+                break;
+        default:
+                break;
+        }
+        g_string_append (a_log, "\n");
+}
+
+/**
+ *Reads all the tokens of the input of a_tknzr,
+ *logs them in a_log if it is not NULL, and gives them back
+ *to the tokenizer.
+ *@return CR_OK if all the tokens have been read and are clean,
+ *an error code otherwise.
+ */
+static enum CRStatus
+tokenize (CRTknzr * a_tknzr, GString * a_log)
+{
+        enum CRStatus status = CR_OK;
+        CRToken *token = NULL;
+
+        for (;;) {
+                status = cr_tknzr_get_next_token (a_tknzr, &token);
+                if (status == CR_END_OF_INPUT_ERROR)
+                        return CR_OK;
+                if (status != CR_OK || !token)
+                        return CR_ERROR;
+                if (token_is_clean (token) == FALSE)
+                        status = CR_ERROR;
+                if (a_log)
+                        log_token (token, a_log);
+                cr_tknzr_release_token (a_tknzr, token);
+                token = NULL;
+                if (status != CR_OK)
+                        return status;
+        }
+}
+
+/**
+ *Tokenizes a_file_path with a new tokenizer, and with a tokenizer
+ *that has been used to tokenize gv_other_css before, and checks
+ *that both give the same tokens.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+test_recycled_tokens (const gchar * a_file_path)
+{
+        enum CRStatus status = CR_OK;
+        CRTknzr *tknzr = NULL,
+                *used_tknzr = NULL;
+        CRInput *input = NULL;
+        GString *log = NULL,
+                *used_log = NULL;
+
+        log = g_string_new (NULL);
+        used_log = g_string_new (NULL);
+
+        input = cr_input_new_from_uri (a_file_path, CR_UTF_8);
+        tknzr = cr_tknzr_new (input);
+        if (!tknzr) {
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        status = tokenize (tknzr, log);
+        if (status != CR_OK)
+                goto cleanup;
+
+        used_tknzr = cr_tknzr_new_from_buf ((guchar *) gv_other_css,
+                                            strlen (gv_other_css),
+                                            CR_UTF_8, FALSE);
+        if (!used_tknzr) {
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        status = tokenize (used_tknzr, NULL);
+        if (status != CR_OK)
+                goto cleanup;
+        input = cr_input_new_from_uri (a_file_path, CR_UTF_8);
+        cr_tknzr_set_input (used_tknzr, input);
+        status = tokenize (used_tknzr, used_log);
+        if (status != CR_OK)
+                goto cleanup;
+
+        if (strcmp (log->str, used_log->str)) {
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        fprintf (stdout, "%s", log->str);
+
+ cleanup:
+        if (tknzr)
+                cr_tknzr_destroy (tknzr);
+        if (used_tknzr)
+                cr_tknzr_destroy (used_tknzr);
+        g_string_free (log, TRUE);
+        g_string_free (used_log, TRUE);
+        return status;
+}
+
+/**
+ *Feeds gv_first_chunk then gv_second_chunk to a streaming input,
+ *keeps a copy of the slice of the first comment, and checks that
+ *the copy survives the reuse of the input buffer by the second
+ *window.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+test_slices (void)
+{
+        enum CRStatus status = CR_OK;
+        CRInput *input = NULL;
+        CRTknzr *tknzr = NULL;
+        CRToken *token = NULL;
+        CRString *first_comment = NULL;
+        GString *log = NULL;
+
+        input = cr_input_new_streaming ();
+        tknzr = cr_tknzr_new (input);
+        if (!tknzr)
+                return CR_ERROR;
+        log = g_string_new (NULL);
+
+        status = cr_input_append_buf (input, (const guchar *) gv_first_chunk,
+                                      strlen (gv_first_chunk));
+        if (status == CR_OK)
+                status = cr_input_next_window (input, FALSE);
+        if (status == CR_OK)
+                status = cr_tknzr_get_next_token (tknzr, &token);
+        if (status != CR_OK || !token || token->type != COMMENT_TK
+            || !token->slice) {
+                status = CR_ERROR;
+                goto cleanup;
+        }
+        first_comment = cr_token_dup_slice (token);
+        cr_tknzr_release_token (tknzr, token);
+        token = NULL;
+        status = tokenize (tknzr, log);
+        if (status != CR_OK || !first_comment)
+                goto cleanup;
+
+        cr_tknzr_flush_lookahead (tknzr);
+        status = cr_input_append_buf (input,
+                                      (const guchar *) gv_second_chunk,
+                                      strlen (gv_second_chunk));
+        if (status == CR_OK)
+                status = cr_input_next_window (input, TRUE);
+        if (status == CR_OK)
+                status = tokenize (tknzr, log);
+        if (status != CR_OK)
+                goto cleanup;
+
+        fprintf (stdout, "first comment: %u:%u '%s'\n",
+                 first_comment->location.line,
+                 first_comment->location.column,
+                 first_comment->stryng->str);
+        fprintf (stdout, "%s", log->str);
+
+ cleanup:
+        if (token)
+                cr_tknzr_release_token (tknzr, token);
+        if (first_comment)
+                cr_string_destroy (first_comment);
+        cr_tknzr_destroy (tknzr);
+        g_string_free (log, TRUE);
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (test_recycled_tokens (options.files_list[0]) != CR_OK)
+                fprintf (stdout, "KO\n");
+        if (test_slices () != CR_OK)
+                fprintf (stdout, "KO\n");
+        return 0;
+}
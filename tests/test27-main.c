@@ -0,0 +1,365 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks the vectorized scanners of cr-utils.c
+ *(cr_utils_span_white_spaces(), cr_utils_span_ascii_nmchars(),
+ *cr_utils_is_ascii() and cr_utils_find_comment_end()) against
+ *byte by byte versions of them, around the boundaries of the
+ *chunks they load, on their tail bytes, and on non ascii bytes.
+ */
+
+/*
+ *Buffers up to that length are checked exhaustively: three
+ *chunks of the widest vectors, and a tail.
+ */
+#define MAX_LEN 100
+
+/*the offsets of the buffers from an aligned address*/
+static const gulong gv_offsets[] = {0, 1, 7, 15, 16, 31};
+
+/*
+ *The bytes put in a run of white spaces or name characters
+ *to end it: ascii ones, and bytes that are negative when
+ *compared as signed chars.
+ */
+static const guchar gv_stop_bytes[] = {
+        0x00, 'x', ' ', '*', '/', 0x7f, 0x80, 0xa0, 0xc3, 0xff
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to scan\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Checks the vectorized scanners of cr-utils.c "
+                 "against byte by byte\nversions of them.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco cr-utils test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static gboolean
+is_white_space (guchar a_byte)
+{
+        return a_byte == ' ' || a_byte == '\t' || a_byte == '\n'
+                || a_byte == '\r' || a_byte == '\f';
+}
+
+static gboolean
+is_ascii_nmchar (guchar a_byte)
+{
+        return (a_byte >= 'a' && a_byte <= 'z')
+                || (a_byte >= 'A' && a_byte <= 'Z')
+                || (a_byte >= '0' && a_byte <= '9')
+                || a_byte == '-' || a_byte == '_';
+}
+
+static gboolean
+is_ascii_char (guchar a_byte)
+{
+        return a_byte && a_byte < 0x80;
+}
+
+static gulong
+ref_span_white_spaces (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_len && is_white_space (a_buf[i]); i++) ;
+        return i;
+}
+
+static gulong
+ref_span_ascii_nmchars (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_len && is_ascii_nmchar (a_buf[i]); i++) ;
+        return i;
+}
+
+static gboolean
+ref_is_ascii (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_len; i++) {
+                if (!is_ascii_char (a_buf[i]))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+static const guchar *
+ref_find_comment_end (const guchar * a_buf, gulong a_len,
+                      gboolean * a_is_ascii)
+{
+        gulong i = 0;
+
+        for (i = 0; i + 1 < a_len; i++) {
+                if (a_buf[i] == '*' && a_buf[i + 1] == '/') {
+                        *a_is_ascii = ref_is_ascii (a_buf, i);
+                        return a_buf + i;
+                }
+        }
+        return NULL;
+}
+
+/**
+ *Runs the four scanners on a_buf, and compares their
+ *results with the ones of the byte by byte versions.
+ *a_buf is copied at the end of a block of its exact size,
+ *at a_offset bytes from an aligned address, so that a
+ *scanner reading past its end reads past the block.
+ *@return TRUE if all the scanners agree, FALSE otherwise.
+ */
+static gboolean
+check_buf (const guchar * a_buf, gulong a_len, gulong a_offset)
+{
+        guchar *block = NULL,
+                *buf = NULL;
+        const guchar *end = NULL,
+                *ref_end = NULL;
+        gboolean is_ascii = FALSE,
+                ref_is_ascii_before_end = FALSE,
+                result = TRUE;
+
+        block = g_malloc (a_offset + a_len + 1);
+        buf = block + a_offset;
+        if (a_len)
+                memcpy (buf, a_buf, a_len);
+
+        if (cr_utils_span_white_spaces (buf, a_len)
+            != ref_span_white_spaces (buf, a_len))
+                result = FALSE;
+        if (cr_utils_span_ascii_nmchars (buf, a_len)
+            != ref_span_ascii_nmchars (buf, a_len))
+                result = FALSE;
+        if (cr_utils_is_ascii (buf, a_len) != ref_is_ascii (buf, a_len))
+                result = FALSE;
+        end = cr_utils_find_comment_end (buf, a_len, &is_ascii);
+        ref_end = ref_find_comment_end (buf, a_len,
+                                        &ref_is_ascii_before_end);
+        if (end != ref_end
+            || (end && is_ascii != ref_is_ascii_before_end))
+                result = FALSE;
+
+        g_free (block);
+        return result;
+}
+
+/**
+ *Checks buffers of every length up to MAX_LEN made of a run of
+ *white spaces, of name characters or of ascii characters ended,
+ *at every position, by each of gv_stop_bytes.
+ *@return TRUE if all the scanners agree, FALSE otherwise.
+ */
+static gboolean
+check_runs (void)
+{
+        static const gchar *fillers[] = {
+                " \t\n\r\f",
+                "azAZ09-_",
+                "a{b:c;}"
+        };
+        guchar buf[MAX_LEN];
+        gulong len = 0,
+                pos = 0,
+                i = 0,
+                j = 0,
+                k = 0,
+                filler_len = 0;
+
+        for (i = 0; i < G_N_ELEMENTS (fillers); i++) {
+                filler_len = strlen (fillers[i]);
+                for (len = 0; len <= MAX_LEN; len++) {
+                        for (j = 0; j < len; j++)
+                                buf[j] = fillers[i][j % filler_len];
+                        for (k = 0; k < G_N_ELEMENTS (gv_offsets); k++) {
+                                if (!check_buf (buf, len, gv_offsets[k]))
+                                        return FALSE;
+                        }
+                        for (pos = 0; pos < len; pos++) {
+                                guchar saved = buf[pos];
+
+                                for (j = 0;
+                                     j < G_N_ELEMENTS (gv_stop_bytes); j++) {
+                                        buf[pos] = gv_stop_bytes[j];
+                                        for (k = 0;
+                                             k < G_N_ELEMENTS (gv_offsets);
+                                             k++) {
+                                                if (!check_buf
+                                                    (buf, len,
+                                                     gv_offsets[k]))
+                                                        return FALSE;
+                                        }
+                                }
+                                buf[pos] = saved;
+                        }
+                }
+        }
+        return TRUE;
+}
+
+/**
+ *Checks buffers of every length up to MAX_LEN that hold a
+ *"*" "/" sequence, or a lone "*" or "/", at every position,
+ *and a non ascii byte at either end of the buffer or right
+ *before or after that sequence.
+ *@return TRUE if all the scanners agree, FALSE otherwise.
+ */
+static gboolean
+check_comment_ends (void)
+{
+        static const gchar *ends[] = {"*/", "*", "/", "**/"};
+        guchar buf[MAX_LEN];
+        gulong len = 0,
+                pos = 0,
+                non_ascii_pos[5],
+                end_len = 0,
+                i = 0,
+                j = 0,
+                k = 0;
+
+        for (i = 0; i < G_N_ELEMENTS (ends); i++) {
+                end_len = strlen (ends[i]);
+                for (len = end_len; len <= MAX_LEN; len++) {
+                        for (pos = 0; pos + end_len <= len; pos++) {
+                                /*
+                                 *a position of len means there is
+                                 *no non ascii byte, and pos - 1 wraps
+                                 *around when pos is 0.
+                                 */
+                                non_ascii_pos[0] = len;
+                                non_ascii_pos[1] = 0;
+                                non_ascii_pos[2] = len - 1;
+                                non_ascii_pos[3] = pos - 1;
+                                non_ascii_pos[4] = pos + end_len;
+                                for (j = 0; j < G_N_ELEMENTS (non_ascii_pos);
+                                     j++) {
+                                        if (non_ascii_pos[j] > len
+                                            || (non_ascii_pos[j] >= pos
+                                                && non_ascii_pos[j]
+                                                < pos + end_len))
+                                                continue;
+                                        memset (buf, 'a', len);
+                                        memcpy (buf + pos, ends[i], end_len);
+                                        if (non_ascii_pos[j] < len)
+                                                buf[non_ascii_pos[j]] = 0xc3;
+                                        for (k = 0;
+                                             k < G_N_ELEMENTS (gv_offsets);
+                                             k++) {
+                                                if (!check_buf
+                                                    (buf, len,
+                                                     gv_offsets[k]))
+                                                        return FALSE;
+                                        }
+                                }
+                        }
+                }
+        }
+        return TRUE;
+}
+
+/**
+ *Checks every suffix of a_buf.
+ *@return TRUE if all the scanners agree, FALSE otherwise.
+ */
+static gboolean
+check_suffixes (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0,
+                k = 0;
+
+        for (i = 0; i <= a_len; i++) {
+                for (k = 0; k < G_N_ELEMENTS (gv_offsets); k++) {
+                        if (!check_buf (a_buf + i, a_len - i,
+                                        gv_offsets[k]))
+                                return FALSE;
+                }
+        }
+        return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        gchar *content = NULL;
+        gsize len = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        fprintf (stdout, "runs: %s\n", check_runs () ? "OK" : "KO");
+        fprintf (stdout, "comment ends: %s\n",
+                 check_comment_ends () ? "OK" : "KO");
+        if (!g_file_get_contents (options.files_list[0], &content,
+                                  &len, NULL)) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        fprintf (stdout, "file: %s\n",
+                 check_suffixes ((const guchar *) content, len) ?
+                 "OK" : "KO");
+        g_free (content);
+        return 0;
+}
@@ -0,0 +1,386 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Tests the ring of the tokens the tokenizer reads ahead:
+ *peeking (cr_tknzr_peek_token()) and consuming many more tokens
+ *than the ring holds, so that it wraps around again and again,
+ *putting tokens back (cr_tknzr_unget_token()), and moving the
+ *tokenizer (cr_tknzr_set_cur_pos()) back before the tokens read
+ *ahead or onto one of them, across a wrap around of the ring.
+ */
+
+/*the number of tokens the ring holds*/
+#define RING_SIZE 8
+
+/*
+ *The tokens of the file, as read by a tokenizer that never
+ *looks ahead, and the position of the input before each of them.
+ */
+typedef struct _RefTokens RefTokens;
+
+struct _RefTokens {
+        GPtrArray *keys;
+        GArray *positions;
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Peeks, consumes and rewinds the tokens of a file "
+                 "through the\nlookahead ring of the tokenizer.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRTknzr class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *@return a string made of the type, the payload and the
+ *location of a_token. The caller must free it with g_free().
+ */
+static gchar *
+token_key (CRToken * a_token)
+{
+        GString *key = NULL;
+        guchar *str = NULL;
+
+        key = g_string_new (NULL);
+        g_string_append_printf (key, "%d %u:%u", a_token->type,
+                                a_token->location.line,
+                                a_token->location.column);
+        if (a_token->slice)
+                g_string_append_len (key, (const gchar *) a_token->slice,
+                                     a_token->slice_len);
+        switch (a_token->type) {
+        case STRING_TK:
+        case IDENT_TK:
+        case HASH_TK:
+        case ATKEYWORD_TK:
+        case URI_TK:
+        case FUNCTION_TK:
+                if (a_token->u.str && a_token->u.str->stryng)
+                        g_string_append_printf (key, " %s",
+                                                a_token->u.str->stryng->str);
+                break;
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case DIMEN_TK:
+        case PERCENTAGE_TK:
+        case NUMBER_TK:
+                if (a_token->u.num) {
+                        str = cr_num_to_string (a_token->u.num);
+                        g_string_append_printf (key, " %s",
+                                                (const gchar *) str);
+                        g_free (str);
+                }
+                break;
+        case DELIM_TK:
+                g_string_append_printf (key, " %u", a_token->u.unichar);
+                break;
+        default:
+                break;
+        }
+        return g_string_free (key, FALSE);
+}
+
+/**
+ *Reads the tokens of a_file_path one after the other.
+ *@return CR_OK upon successful completion, an error code otherwise.
+ */
+static enum CRStatus
+read_ref_tokens (const gchar * a_file_path, RefTokens * a_ref)
+{
+        enum CRStatus status = CR_OK;
+        CRTknzr *tknzr = NULL;
+        CRToken *token = NULL;
+        CRInputPos pos;
+
+        tknzr = cr_tknzr_new (cr_input_new_from_uri (a_file_path,
+                                                     CR_UTF_8));
+        if (!tknzr)
+                return CR_ERROR;
+        for (;;) {
+                cr_tknzr_get_cur_pos (tknzr, &pos);
+                status = cr_tknzr_get_next_token (tknzr, &token);
+                if (status != CR_OK)
+                        break;
+                g_ptr_array_add (a_ref->keys, token_key (token));
+                g_array_append_val (a_ref->positions, pos);
+                cr_tknzr_release_token (tknzr, token);
+                token = NULL;
+        }
+        /*the position of the end of the input*/
+        g_array_append_val (a_ref->positions, pos);
+        cr_tknzr_destroy (tknzr);
+        return status == CR_END_OF_INPUT_ERROR ? CR_OK : status;
+}
+
+/**
+ *@return TRUE if a_token is the a_index-th token of a_ref,
+ *FALSE otherwise.
+ */
+static gboolean
+is_ref_token (RefTokens * a_ref, guint a_index, CRToken * a_token)
+{
+        gchar *key = NULL;
+        gboolean result = FALSE;
+
+        if (a_index >= a_ref->keys->len || !a_token)
+                return FALSE;
+        key = token_key (a_token);
+        result = !strcmp (key, g_ptr_array_index (a_ref->keys, a_index));
+        g_free (key);
+        return result;
+}
+
+/**
+ *Peeks the next a_nb tokens of a_tknzr, the a_index-th token of
+ *a_ref being the next one, and checks them.
+ *@return TRUE if the tokens are the ones of a_ref, FALSE otherwise.
+ */
+static gboolean
+peek_tokens (CRTknzr * a_tknzr, RefTokens * a_ref, guint a_index,
+             guint a_nb)
+{
+        enum CRStatus status = CR_OK;
+        CRToken *token = NULL;
+        guint i = 0;
+
+        for (i = 0; i < a_nb; i++) {
+                token = NULL;
+                status = cr_tknzr_peek_token (a_tknzr, i, &token);
+                if (a_index + i >= a_ref->keys->len) {
+                        if (status != CR_END_OF_INPUT_ERROR)
+                                return FALSE;
+                        break;
+                }
+                if (status != CR_OK
+                    || !is_ref_token (a_ref, a_index + i, token))
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Consumes the next token of a_tknzr and checks it is the
+ *a_index-th token of a_ref.
+ *@return TRUE if it is, FALSE otherwise.
+ */
+static gboolean
+consume_token (CRTknzr * a_tknzr, RefTokens * a_ref, guint a_index)
+{
+        CRToken *token = NULL;
+        gboolean result = FALSE;
+
+        if (cr_tknzr_get_next_token (a_tknzr, &token) != CR_OK)
+                return FALSE;
+        result = is_ref_token (a_ref, a_index, token);
+        cr_tknzr_release_token (a_tknzr, token);
+        return result;
+}
+
+/**
+ *Walks the tokens of a_file_path through the lookahead ring:
+ *at each step, peeks up to RING_SIZE tokens, puts a token back
+ *or not, consumes a few tokens and, now and then, moves back
+ *to the start of the step or onto one of the tokens peeked.
+ *@return CR_OK if all the tokens are the ones of a_ref,
+ *CR_ERROR otherwise.
+ */
+static enum CRStatus
+walk_ring (const gchar * a_file_path, RefTokens * a_ref,
+           gulong * a_nb_steps)
+{
+        CRTknzr *tknzr = NULL;
+        CRToken *token = NULL;
+        CRInputPos pos;
+        guint index = 0,
+                step_index = 0,
+                nb_peeked = 0,
+                nb_consumed = 0,
+                i = 0,
+                step = 0;
+        gboolean result = TRUE;
+
+        tknzr = cr_tknzr_new (cr_input_new_from_uri (a_file_path,
+                                                     CR_UTF_8));
+        if (!tknzr)
+                return CR_ERROR;
+
+        for (step = 0; result == TRUE && index < a_ref->keys->len;
+             step++) {
+                step_index = index;
+
+                cr_tknzr_get_cur_pos (tknzr, &pos);
+                if (pos.next_byte_index
+                    != g_array_index (a_ref->positions, CRInputPos,
+                                      index).next_byte_index) {
+                        result = FALSE;
+                        break;
+                }
+
+                nb_peeked = step % (RING_SIZE + 1);
+                result = peek_tokens (tknzr, a_ref, index, nb_peeked);
+                if (result == FALSE)
+                        break;
+
+                if (step % 3 == 1) {
+                        /*consume a token and put it back*/
+                        token = NULL;
+                        if (cr_tknzr_get_next_token (tknzr, &token)
+                            != CR_OK
+                            || !is_ref_token (a_ref, index, token)) {
+                                if (token)
+                                        cr_tknzr_release_token (tknzr,
+                                                                token);
+                                result = FALSE;
+                                break;
+                        }
+                        cr_tknzr_unget_token (tknzr, token);
+                }
+
+                nb_consumed = (step * 3) % 5 + 1;
+                for (i = 0; i < nb_consumed
+                     && index < a_ref->keys->len; i++) {
+                        result = consume_token (tknzr, a_ref, index);
+                        if (result == FALSE)
+                                break;
+                        index++;
+                }
+                if (result == FALSE)
+                        break;
+
+                if (step % 4 == 0) {
+                        /*
+                         *move back to the start of the step, before
+                         *the tokens left in the ring: they are
+                         *dropped and scanned again.
+                         */
+                        cr_tknzr_set_cur_pos
+                                (tknzr, &g_array_index (a_ref->positions,
+                                                        CRInputPos,
+                                                        step_index));
+                        index = step_index;
+                        result = consume_token (tknzr, a_ref, index);
+                        index++;
+                } else if (step % 4 == 2 && nb_peeked > nb_consumed + 1
+                           && step_index + nb_peeked <= a_ref->keys->len) {
+                        /*
+                         *move onto the last token peeked: the
+                         *ones before it are dropped, and it is not
+                         *scanned again.
+                         */
+                        index = step_index + nb_peeked - 1;
+                        cr_tknzr_set_cur_pos
+                                (tknzr, &g_array_index (a_ref->positions,
+                                                        CRInputPos,
+                                                        index));
+                }
+        }
+
+        if (result == TRUE) {
+                token = NULL;
+                if (cr_tknzr_get_next_token (tknzr, &token)
+                    != CR_END_OF_INPUT_ERROR)
+                        result = FALSE;
+                if (token)
+                        cr_tknzr_release_token (tknzr, token);
+        }
+        cr_tknzr_destroy (tknzr);
+        *a_nb_steps = step;
+        return result == TRUE ? CR_OK : CR_ERROR;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        RefTokens ref;
+        gulong nb_steps = 0;
+        guint i = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        ref.keys = g_ptr_array_new ();
+        ref.positions = g_array_new (FALSE, FALSE, sizeof (CRInputPos));
+        if (read_ref_tokens (options.files_list[0], &ref) != CR_OK
+            || ref.keys->len < 4 * RING_SIZE) {
+                fprintf (stdout, "KO\n");
+        } else if (walk_ring (options.files_list[0], &ref, &nb_steps)
+                   != CR_OK) {
+                fprintf (stdout, "KO\n");
+        } else {
+                fprintf (stdout, "%u tokens read through the ring "
+                         "in %lu steps: OK\n", ref.keys->len, nb_steps);
+        }
+
+        for (i = 0; i < ref.keys->len; i++)
+                g_free (g_ptr_array_index (ref.keys, i));
+        g_ptr_array_free (ref.keys, TRUE);
+        g_array_free (ref.positions, TRUE);
+        return 0;
+}
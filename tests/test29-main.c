@@ -0,0 +1,324 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Tests the lists of property/declaration pairs (CRPropList):
+ *checks that cr_prop_list_lookup_prop(), which looks the
+ *properties up in the index of the list, finds the pairs a walk
+ *of the list finds, and that the pairs are linked in the same
+ *order, after each change of the list.
+ */
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Builds lists of the properties of the first "
+                 "ruleset of the file,\nchanges them, and looks the "
+                 "properties up after each change.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRPropList class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static const gchar *
+get_prop_name (CRPropList * a_pair)
+{
+        CRString *prop = NULL;
+
+        cr_prop_list_get_prop (a_pair, &prop);
+        if (!prop)
+                return NULL;
+        return cr_string_peek_raw_str (prop);
+}
+
+/**
+ *Looks a property up the slow way, walking the list.
+ *@return the first pair of a_list that holds the property,
+ *or NULL if there is none.
+ */
+static CRPropList *
+lookup_by_walk (CRPropList * a_list, const gchar * a_name)
+{
+        CRPropList *cur = NULL;
+
+        for (cur = a_list; cur; cur = cr_prop_list_get_next (cur)) {
+                if (get_prop_name (cur)
+                    && !strcmp (get_prop_name (cur), a_name))
+                        return cur;
+        }
+        return NULL;
+}
+
+/**
+ *Checks that cr_prop_list_lookup_prop() finds, from a
+ *pair of a list, the pair a walk of the list finds.
+ */
+static gboolean
+check_lookup (CRPropList * a_from, const gchar * a_name)
+{
+        CRString *name = NULL;
+        CRPropList *pair = NULL,
+                *expected = NULL;
+        enum CRStatus status = CR_OK;
+
+        name = cr_string_new_from_string (a_name);
+        status = cr_prop_list_lookup_prop (a_from, name, &pair);
+        cr_string_destroy (name);
+        expected = lookup_by_walk (a_from, a_name);
+        if (!expected)
+                return status == CR_VALUE_NOT_FOUND_ERROR;
+        return status == CR_OK && pair == expected;
+}
+
+/**
+ *Checks a list: the links between its pairs, and the lookup
+ *of the properties of a_decls, and of a property it doesn't
+ *hold, from its head and from its second pair.
+ *@param a_list the list to check.
+ *@param a_decls the declarations whose properties to look up.
+ *@param a_dump where to dump the properties of the list, in order.
+ *@return TRUE if the list is consistent, FALSE otherwise.
+ */
+static gboolean
+check_list (CRPropList * a_list, CRDeclaration * a_decls,
+            GString * a_dump)
+{
+        CRPropList *cur = NULL,
+                *prev = NULL;
+        CRDeclaration *decl = NULL;
+
+        for (cur = a_list; cur; cur = cr_prop_list_get_next (cur)) {
+                if (cr_prop_list_get_prev (cur) != prev)
+                        return FALSE;
+                g_string_append_printf (a_dump, " %s",
+                                        get_prop_name (cur));
+                prev = cur;
+        }
+        g_string_append (a_dump, "\n");
+
+        for (decl = a_decls; decl; decl = decl->next) {
+                const gchar *name =
+                        cr_string_peek_raw_str (decl->property);
+
+                if (check_lookup (a_list, name) == FALSE)
+                        return FALSE;
+                if (a_list && cr_prop_list_get_next (a_list)
+                    && check_lookup (cr_prop_list_get_next (a_list),
+                                     name) == FALSE)
+                        return FALSE;
+        }
+        if (check_lookup (a_list, "height") == FALSE
+            || check_lookup (a_list, "absent") == FALSE)
+                return FALSE;
+        return TRUE;
+}
+
+/**
+ *Unlinks a pair from a list, and destroys it.
+ *@return the new head of the list.
+ */
+static CRPropList *
+remove_pair (CRPropList * a_list, CRPropList * a_pair)
+{
+        a_list = cr_prop_list_unlink (a_list, a_pair);
+        cr_prop_list_destroy (a_pair);
+        return a_list;
+}
+
+/**
+ *Builds a list of the properties of a_decls, and changes it:
+ *prepends and appends pairs and lists, renames properties,
+ *and unlinks the head, the tail, and a pair in the middle.
+ *@param a_decls the declarations to build the list from.
+ *@param a_height a property none of a_decls holds.
+ *@param a_check_each_step if TRUE, the list is checked, and its
+ *index built, after each change. Otherwise it is only checked at
+ *the end, so that the index is built then.
+ *@param a_dump where to dump the lists checked.
+ *@return TRUE if the checks succeeded, FALSE otherwise.
+ */
+static gboolean
+build_and_change (CRDeclaration * a_decls, CRString * a_height,
+                  gboolean a_check_each_step, GString * a_dump)
+{
+        CRPropList *list = NULL,
+                *other = NULL,
+                *cur = NULL;
+        CRDeclaration *decl = NULL,
+                *third = NULL,
+                *last = NULL;
+        gboolean is_ok = TRUE;
+        gint i = 0;
+
+        for (decl = a_decls; decl; decl = decl->next) {
+                list = cr_prop_list_append2 (list, decl->property, decl);
+                if (i++ == 2)
+                        third = decl;
+                last = decl;
+        }
+        if (!list || !third || !a_decls->next)
+                return FALSE;
+        if (a_check_each_step == TRUE) {
+                g_string_append (a_dump, "appended:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+
+        /*a duplicate of a property further on, at the head*/
+        list = cr_prop_list_prepend2 (list, third->property, third);
+        if (is_ok == TRUE && a_check_each_step == TRUE) {
+                g_string_append (a_dump, "prepended:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+
+        /*a property renamed to a duplicate, and another to a new one*/
+        for (cur = list, i = 0; cur && i < 4;
+             cur = cr_prop_list_get_next (cur), i++) ;
+        if (cur) {
+                cr_prop_list_set_prop (cur, last->property);
+                cur = cr_prop_list_get_next (cur);
+        }
+        if (cur)
+                cr_prop_list_set_prop (cur, a_height);
+        if (is_ok == TRUE && a_check_each_step == TRUE) {
+                g_string_append (a_dump, "renamed:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+
+        /*the head, the tail, and the first pair of a duplicated property*/
+        list = remove_pair (list, list);
+        for (cur = list; cur && cr_prop_list_get_next (cur);
+             cur = cr_prop_list_get_next (cur)) ;
+        if (cur)
+                list = remove_pair (list, cur);
+        cur = lookup_by_walk (list, cr_string_peek_raw_str
+                              (a_decls->next->property));
+        if (cur)
+                list = remove_pair (list, cur);
+        if (is_ok == TRUE && a_check_each_step == TRUE) {
+                g_string_append (a_dump, "unlinked:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+
+        /*lists of several pairs, at both ends*/
+        other = cr_prop_list_append2 (NULL, a_decls->property, a_decls);
+        other = cr_prop_list_append2 (other, last->property, last);
+        list = cr_prop_list_append (list, other);
+        if (is_ok == TRUE && a_check_each_step == TRUE) {
+                g_string_append (a_dump, "list appended:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+        other = cr_prop_list_append2 (NULL, last->property, last);
+        other = cr_prop_list_append2 (other, third->property, third);
+        list = cr_prop_list_prepend (list, other);
+        if (is_ok == TRUE) {
+                g_string_append (a_dump, "list prepended:");
+                is_ok = check_list (list, a_decls, a_dump);
+        }
+
+        if (list)
+                cr_prop_list_destroy (list);
+        return is_ok;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        CRStyleSheet *sheet = NULL;
+        CRDeclaration *decls = NULL;
+        CRString *height = NULL;
+        GString *dump = NULL,
+                *lazy_dump = NULL;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = cr_om_parser_simply_parse_file
+                ((const guchar *) options.files_list[0], CR_ASCII, &sheet);
+        if (status != CR_OK || !sheet || !sheet->statements
+            || sheet->statements->type != RULESET_STMT
+            || !sheet->statements->kind.ruleset->decl_list) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+        decls = sheet->statements->kind.ruleset->decl_list;
+        height = cr_string_new_from_string ("height");
+
+        dump = g_string_new (NULL);
+        lazy_dump = g_string_new (NULL);
+        if (build_and_change (decls, height, TRUE, dump) == FALSE
+            || build_and_change (decls, height, FALSE,
+                                 lazy_dump) == FALSE
+            || !g_str_has_suffix (dump->str, lazy_dump->str)) {
+                fprintf (stdout, "KO\n");
+        } else {
+                fprintf (stdout, "%s", dump->str);
+        }
+
+        g_string_free (dump, TRUE);
+        g_string_free (lazy_dump, TRUE);
+        cr_string_destroy (height);
+        cr_stylesheet_unref (sheet);
+        return 0;
+}
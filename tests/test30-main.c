@@ -0,0 +1,363 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that cr_input_read_char() and cr_input_peek_char(), which
+ *return ascii characters without going through the utf8 decoder,
+ *return the characters, the lines and the columns the decoder
+ *gives, on ascii inputs, on inputs holding non ascii characters
+ *or NUL bytes, and on streaming inputs appended chunk by chunk.
+ */
+
+/*
+ *The sequences inserted in the ascii file at various positions:
+ *two, three and four bytes long utf8 characters, and a NUL byte.
+ */
+static const struct {
+        const gchar *name;
+        const gchar *bytes;
+        gulong len;
+} gv_insertions[] = {
+        {"c3 a9", "\xc3\xa9", 2},
+        {"e2 82 ac", "\xe2\x82\xac", 3},
+        {"f0 9f 98 80", "\xf0\x9f\x98\x80", 4},
+        {"00", "\0", 1}
+};
+
+/*
+ *The value the characters read are set to before each read.
+ *The decoder skips a NUL byte without setting the character.
+ */
+#define NO_CHAR 0xFFFFFFFF
+
+/*the sizes of the chunks streaming inputs are appended by*/
+static const gulong gv_chunk_sizes[] = {1, 5, 64};
+
+/**
+ *A character as the utf8 decoder reads it, with the
+ *location cr_input_get_parsing_location() gives after it.
+ */
+struct ExpectedChar {
+        guint32 c;
+        guint line;
+        guint column;
+        guint byte_offset;
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Reads the file, and copies of it holding non "
+                 "ascii characters or NUL,\ncharacter by character, whole "
+                 "and chunk by chunk, and checks the characters and\n"
+                 "their locations against the ones the utf8 decoder "
+                 "gives.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRInput class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Reads a buffer with the utf8 decoder only, the way
+ *cr_input_read_char() did before its ascii fast path.
+ *@param a_buf the buffer to read.
+ *@param a_len the length of a_buf.
+ *@param a_nb_chars out parameter. The number of characters
+ *read before the end of a_buf, or before the first byte the
+ *decoder rejects.
+ *@return the characters read.
+ */
+static struct ExpectedChar *
+read_with_decoder (const guchar * a_buf, gulong a_len, gulong * a_nb_chars)
+{
+        struct ExpectedChar *result = NULL;
+        gulong index = 0,
+                consumed = 0,
+                nb_chars = 0;
+        guint line = 1,
+                column = 0;
+        gboolean end_of_line = FALSE;
+        guint32 c = 0;
+
+        result = g_new0 (struct ExpectedChar, a_len + 1);
+        while (index < a_len) {
+                c = NO_CHAR;
+                if (cr_utils_read_char_from_utf8_buf
+                    (a_buf + index, a_len - index, &c, &consumed) != CR_OK)
+                        break;
+                index += consumed;
+                if (end_of_line == TRUE) {
+                        column = 1;
+                        line++;
+                        end_of_line = FALSE;
+                } else if (c != '\n') {
+                        column++;
+                }
+                if (c == '\n')
+                        end_of_line = TRUE;
+                result[nb_chars].c = c;
+                result[nb_chars].line = line;
+                result[nb_chars].column = column;
+                result[nb_chars].byte_offset = index - 1;
+                nb_chars++;
+        }
+        *a_nb_chars = nb_chars;
+        return result;
+}
+
+/**
+ *Reads the characters of an input until its end or its first
+ *error, checking each of them, and its location, against the
+ *expected ones.
+ *@param a_input the input to read.
+ *@param a_expected the expected characters.
+ *@param a_nb_expected the number of expected characters.
+ *@param a_nb_read in/out parameter. The number of characters
+ *read from the input so far.
+ *@return CR_END_OF_INPUT_ERROR if the end of the input was
+ *reached, the status of the first read that failed if any,
+ *or CR_ERROR if a character or a location differs.
+ */
+static enum CRStatus
+read_and_check (CRInput * a_input, struct ExpectedChar *a_expected,
+                gulong a_nb_expected, gulong * a_nb_read)
+{
+        enum CRStatus status = CR_OK,
+                peek_status = CR_OK;
+        guint32 c = 0,
+                peeked = 0;
+        CRParsingLocation loc;
+        struct ExpectedChar *expected = NULL;
+
+        for (;;) {
+                c = peeked = NO_CHAR;
+                peek_status = cr_input_peek_char (a_input, &peeked);
+                status = cr_input_read_char (a_input, &c);
+                if (status != peek_status)
+                        return CR_ERROR;
+                if (status != CR_OK)
+                        return status;
+                if (*a_nb_read >= a_nb_expected)
+                        return CR_ERROR;
+                expected = &a_expected[*a_nb_read];
+                cr_input_get_parsing_location (a_input, &loc);
+                if (c != expected->c || peeked != expected->c
+                    || loc.line != expected->line
+                    || loc.column != expected->column
+                    || loc.byte_offset != expected->byte_offset)
+                        return CR_ERROR;
+                (*a_nb_read)++;
+        }
+}
+
+/**
+ *Tells whether a buffer only holds ascii characters,
+ *NUL excluded, byte by byte.
+ */
+static gboolean
+is_ascii (const guchar * a_buf, gulong a_len)
+{
+        gulong i = 0;
+
+        for (i = 0; i < a_len; i++) {
+                if (!a_buf[i] || a_buf[i] >= 0x80)
+                        return FALSE;
+        }
+        return TRUE;
+}
+
+/**
+ *Reads a buffer through a #CRInput built on it,
+ *and through streaming inputs it is appended to in chunks,
+ *and checks the characters read against the ones the decoder
+ *reads.
+ *@return TRUE if all the reads give the expected
+ *characters, FALSE otherwise.
+ */
+static gboolean
+check_buf (const guchar * a_buf, gulong a_len, gulong * a_nb_chars)
+{
+        CRInput *input = NULL;
+        struct ExpectedChar *expected = NULL;
+        gulong nb_expected = 0,
+                nb_read = 0,
+                offset = 0,
+                chunk_len = 0,
+                i = 0;
+        enum CRStatus status = CR_OK;
+        gboolean is_ok = TRUE;
+
+        expected = read_with_decoder (a_buf, a_len, &nb_expected);
+        *a_nb_chars = nb_expected;
+
+        input = cr_input_new_from_buf ((guchar *) a_buf, a_len, CR_UTF_8,
+                                       FALSE);
+        if (!input || cr_input_is_ascii (input) != is_ascii (a_buf, a_len))
+                is_ok = FALSE;
+        if (is_ok == TRUE) {
+                status = read_and_check (input, expected, nb_expected,
+                                         &nb_read);
+                if (status == CR_ERROR || nb_read != nb_expected)
+                        is_ok = FALSE;
+        }
+        if (input)
+                cr_input_destroy (input);
+
+        for (i = 0; is_ok == TRUE && i < G_N_ELEMENTS (gv_chunk_sizes);
+             i++) {
+                input = cr_input_new_streaming ();
+                if (!input) {
+                        is_ok = FALSE;
+                        break;
+                }
+                nb_read = 0;
+                status = CR_END_OF_INPUT_ERROR;
+                for (offset = 0;
+                     offset < a_len && status == CR_END_OF_INPUT_ERROR;
+                     offset += chunk_len) {
+                        chunk_len = MIN (gv_chunk_sizes[i], a_len - offset);
+                        cr_input_append_buf (input, a_buf + offset,
+                                             chunk_len);
+                        if (cr_input_is_ascii (input)
+                            != is_ascii (a_buf, offset + chunk_len)) {
+                                status = CR_ERROR;
+                                break;
+                        }
+                        if (cr_input_next_window (input, FALSE) == CR_OK)
+                                status = read_and_check
+                                        (input, expected, nb_expected,
+                                         &nb_read);
+                }
+                if (status == CR_END_OF_INPUT_ERROR
+                    && cr_input_next_window (input, TRUE) == CR_OK)
+                        status = read_and_check (input, expected,
+                                                 nb_expected, &nb_read);
+                if (status == CR_ERROR || nb_read != nb_expected)
+                        is_ok = FALSE;
+                cr_input_destroy (input);
+        }
+
+        g_free (expected);
+        return is_ok;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        gchar *content = NULL;
+        gsize len = 0;
+        GString *buf = NULL;
+        gulong nb_chars = 0,
+                i = 0,
+                j = 0;
+        gulong positions[5];
+        gboolean is_ok = TRUE;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (!g_file_get_contents (options.files_list[0], &content, &len,
+                                  NULL)
+            || len < 2 || !is_ascii ((const guchar *) content, len)) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        if (check_buf ((const guchar *) content, len, &nb_chars) == FALSE) {
+                fprintf (stdout, "KO\n");
+                g_free (content);
+                return 0;
+        }
+        fprintf (stdout, "ascii: %lu characters: OK\n", nb_chars);
+
+        /*the first, second, middle, last byte, and the end*/
+        positions[0] = 0;
+        positions[1] = 1;
+        positions[2] = len / 2;
+        positions[3] = len - 1;
+        positions[4] = len;
+        buf = g_string_new (NULL);
+        for (i = 0; i < G_N_ELEMENTS (gv_insertions); i++) {
+                for (j = 0; is_ok == TRUE && j < G_N_ELEMENTS (positions);
+                     j++) {
+                        g_string_truncate (buf, 0);
+                        g_string_append_len (buf, content, positions[j]);
+                        g_string_append_len (buf, gv_insertions[i].bytes,
+                                             gv_insertions[i].len);
+                        g_string_append_len (buf, content + positions[j],
+                                             len - positions[j]);
+                        is_ok = check_buf ((const guchar *) buf->str,
+                                           buf->len, &nb_chars);
+                }
+                fprintf (stdout, "%s inserted at %lu positions: %s\n",
+                         gv_insertions[i].name, j,
+                         is_ok == TRUE ? "OK" : "KO");
+                if (is_ok == FALSE)
+                        break;
+        }
+
+        g_string_free (buf, TRUE);
+        g_free (content);
+        return 0;
+}
@@ -60,6 +60,10 @@ static  void display_about (char *prg_name);
 
 static enum  CRStatus test_cr_parser_parse (guchar * a_file_uri);
 
+static enum CRStatus test_cr_om_parser_arena (guchar * a_file_uri);
+
+static enum CRStatus test_cr_om_parser_arena_unlink (guchar * a_file_uri);
+
 /**
  *Displays the usage of the test
  *facility.
@@ -127,6 +131,151 @@ test_cr_parser_parse (guchar * a_file_uri)
         return status;
 }
 
+/**
+ *Parses a_file_uri twice, with and without
+ *arena mode, and checks that both parsings end
+ *the same way and that both object models
+ *serialize the same way.
+ *@param a_file_uri the file to parse.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_om_parser_arena (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK,
+                arena_status = CR_OK;
+        CROMParser *parser = NULL;
+        CRStyleSheet *stylesheet = NULL,
+                *arena_stylesheet = NULL;
+        gchar *str = NULL,
+                *arena_str = NULL;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        status = cr_om_parser_simply_parse_file (a_file_uri, CR_ASCII,
+                                                 &stylesheet);
+
+        parser = cr_om_parser_new (NULL);
+        cr_om_parser_set_use_arena (parser, TRUE);
+        arena_status = cr_om_parser_parse_file (parser, a_file_uri,
+                                                CR_ASCII,
+                                                &arena_stylesheet);
+        cr_om_parser_destroy (parser);
+
+        if (arena_status != status)
+                status = CR_ERROR;
+        else if (arena_stylesheet && !arena_stylesheet->arena)
+                status = CR_ERROR;
+        else if (stylesheet && arena_stylesheet) {
+                str = cr_stylesheet_to_string (stylesheet);
+                arena_str = cr_stylesheet_to_string (arena_stylesheet);
+                status = g_strcmp0 (str, arena_str) ? CR_ERROR : CR_OK;
+        } else if (stylesheet || arena_stylesheet)
+                status = CR_ERROR;
+        else
+                status = CR_OK;
+
+        if (str)
+                g_free (str);
+        if (arena_str)
+                g_free (arena_str);
+        if (arena_stylesheet)
+                cr_stylesheet_destroy (arena_stylesheet);
+        if (stylesheet)
+                cr_stylesheet_destroy (stylesheet);
+
+        return status;
+}
+
+/**
+ *Unlinks the first and the last statements of a_sheet
+ *and destroys them: the first one with no current arena,
+ *the last one with a_arena as the current arena.
+ *@param a_sheet the stylesheet to remove the statements from.
+ *@param a_arena the arena to make current.
+ */
+static void
+remove_first_and_last_statements (CRStyleSheet * a_sheet,
+                                  CRArena * a_arena)
+{
+        CRStatement *stmt = NULL;
+        CRArena *prev_arena = NULL;
+
+        if (!a_sheet->statements)
+                return;
+        prev_arena = cr_arena_set_current (NULL);
+        stmt = cr_statement_unlink (a_sheet->statements);
+        cr_statement_destroy (stmt);
+        cr_arena_set_current (prev_arena);
+
+        for (stmt = a_sheet->statements; stmt && stmt->next;
+             stmt = stmt->next) ;
+        if (!stmt)
+                return;
+        prev_arena = cr_arena_set_current (a_arena);
+        stmt = cr_statement_unlink (stmt);
+        cr_statement_destroy (stmt);
+        cr_arena_set_current (prev_arena);
+}
+
+/**
+ *Parses a_file_uri twice, with and without
+ *arena mode, removes statements from both stylesheets
+ *while the arena of the stylesheet is not the current one,
+ *and checks that both object models still serialize
+ *the same way.
+ *@param a_file_uri the file to parse.
+ *@return CR_OK upon successfull completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_om_parser_arena_unlink (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK;
+        CROMParser *parser = NULL;
+        CRStyleSheet *stylesheet = NULL,
+                *arena_stylesheet = NULL;
+        CRArena *arena = NULL;
+        gchar *str = NULL,
+                *arena_str = NULL;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        cr_om_parser_simply_parse_file (a_file_uri, CR_ASCII, &stylesheet);
+        parser = cr_om_parser_new (NULL);
+        cr_om_parser_set_use_arena (parser, TRUE);
+        cr_om_parser_parse_file (parser, a_file_uri, CR_ASCII,
+                                 &arena_stylesheet);
+        cr_om_parser_destroy (parser);
+        if (!stylesheet || !arena_stylesheet) {
+                status = stylesheet || arena_stylesheet ?
+                        CR_ERROR : CR_OK;
+                goto cleanup;
+        }
+
+        arena = cr_arena_new (0);
+        remove_first_and_last_statements (stylesheet, arena);
+        remove_first_and_last_statements (arena_stylesheet, arena);
+        cr_arena_destroy (arena);
+
+        str = cr_stylesheet_to_string (stylesheet);
+        arena_str = cr_stylesheet_to_string (arena_stylesheet);
+        status = g_strcmp0 (str, arena_str) ? CR_ERROR : CR_OK;
+
+ cleanup:
+        if (str)
+                g_free (str);
+        if (arena_str)
+                g_free (arena_str);
+        if (arena_stylesheet)
+                cr_stylesheet_destroy (arena_stylesheet);
+        if (stylesheet)
+                cr_stylesheet_destroy (stylesheet);
+
+        return status;
+}
+
 static enum CRStatus
 test_cr_statement_at_page_rule_parse_from_buf (void)
 {
@@ -431,5 +580,17 @@ main (int argc, char **argv)
                 g_print ("\nKO\n");
         }
 
+        status = test_cr_om_parser_arena ((guchar *) options.files_list[0]);
+        if (status != CR_OK) {
+                g_print ("\ntest cr_om_parser_set_use_arena() failed\n");
+        }
+
+        status = test_cr_om_parser_arena_unlink
+                ((guchar *) options.files_list[0]);
+        if (status != CR_OK) {
+                g_print ("\ntest of the statements removed from an "
+                         "arena stylesheet failed\n");
+        }
+
         return 0;
 }
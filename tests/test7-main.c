@@ -0,0 +1,371 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms 
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the 
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Some test facilities for the streaming mode of
+ *the #CRParser class (cr_parser_feed()).
+ */
+
+/*
+ *The size of the chunks the file is fed with.
+ *Kept small so that most statements span several chunks.
+ */
+#define TEST_CHUNK_SIZE 5
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static enum CRStatus
+  test_cr_parser_feed (guchar * a_file_uri);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Tests the cr_parser_feed () method.\n");
+        fprintf (stdout, "Returns OK if the status is CR_OK, KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRParser class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/***************************
+ *Some SAC document handlers
+ *for TEST PURPOSES. They log
+ *the callbacks in the GString
+ *of the app_data of the handler.
+ ***************************/
+
+static void
+test_start_document (CRDocHandler * a_handler)
+{
+        g_string_append (a_handler->app_data, "start_document\n");
+}
+
+static void
+test_end_document (CRDocHandler * a_handler)
+{
+        g_string_append (a_handler->app_data, "end_document\n");
+}
+
+static void
+test_charset (CRDocHandler * a_handler, CRString * a_charset,
+              CRParsingLocation * a_location)
+{
+        g_string_append_printf (a_handler->app_data, "charset: %s\n",
+                                cr_string_peek_raw_str (a_charset));
+}
+
+static void
+test_import_style (CRDocHandler * a_handler,
+                   GList * a_media_list,
+                   CRString * a_uri,
+                   CRString * a_uri_default_ns,
+                   CRParsingLocation * a_location)
+{
+        GList *cur = NULL;
+
+        g_string_append_printf (a_handler->app_data, "import_style: %s",
+                                a_uri ? cr_string_peek_raw_str (a_uri) : "");
+        for (cur = a_media_list; cur; cur = cur->next) {
+                g_string_append_printf
+                        (a_handler->app_data, " %s",
+                         cr_string_peek_raw_str ((CRString *) cur->data));
+        }
+        g_string_append (a_handler->app_data, "\n");
+}
+
+static void
+test_start_selector (CRDocHandler * a_handler,
+                     CRSelector * a_selector_list)
+{
+        guchar *str = NULL;
+
+        str = cr_selector_to_string (a_selector_list);
+        g_string_append_printf (a_handler->app_data, "start_selector: %s\n",
+                                str ? (const gchar *) str : "");
+        g_free (str);
+}
+
+static void
+test_end_selector (CRDocHandler * a_handler,
+                   CRSelector * a_selector_list)
+{
+        g_string_append (a_handler->app_data, "end_selector\n");
+}
+
+static void
+test_property (CRDocHandler * a_handler,
+               CRString * a_name, CRTerm * a_expr, gboolean a_important)
+{
+        guchar *str = NULL;
+
+        str = cr_term_to_string (a_expr);
+        g_string_append_printf (a_handler->app_data,
+                                "  property: %s: %s "
+                                "(line:%d column:%d byte offset:%d)\n",
+                                cr_string_peek_raw_str (a_name),
+                                str ? (const gchar *) str : "",
+                                a_name->location.line,
+                                a_name->location.column,
+                                a_name->location.byte_offset);
+        g_free (str);
+}
+
+static void
+test_start_font_face (CRDocHandler * a_handler,
+                      CRParsingLocation * a_location)
+{
+        g_string_append (a_handler->app_data, "start_font_face\n");
+}
+
+static void
+test_end_font_face (CRDocHandler * a_handler)
+{
+        g_string_append (a_handler->app_data, "end_font_face\n");
+}
+
+static void
+test_start_media (CRDocHandler * a_handler,
+                  GList * a_media_list, CRParsingLocation * a_location)
+{
+        GList *cur = NULL;
+
+        g_string_append (a_handler->app_data, "start_media:");
+        for (cur = a_media_list; cur; cur = cur->next) {
+                g_string_append_printf
+                        (a_handler->app_data, " %s",
+                         cr_string_peek_raw_str ((CRString *) cur->data));
+        }
+        g_string_append (a_handler->app_data, "\n");
+}
+
+static void
+test_end_media (CRDocHandler * a_handler, GList * a_media_list)
+{
+        g_string_append (a_handler->app_data, "end_media\n");
+}
+
+static void
+test_start_page (CRDocHandler * a_handler,
+                 CRString * a_name,
+                 CRString * a_pseudo_page, CRParsingLocation * a_location)
+{
+        g_string_append_printf (a_handler->app_data, "start_page: %s\n",
+                                a_pseudo_page
+                                ? cr_string_peek_raw_str (a_pseudo_page)
+                                : "");
+}
+
+static void
+test_end_page (CRDocHandler * a_handler,
+               CRString * a_name, CRString * a_pseudo_page)
+{
+        g_string_append (a_handler->app_data, "end_page\n");
+}
+
+static void
+test_error (CRDocHandler * a_handler)
+{
+        g_string_append (a_handler->app_data, "error\n");
+}
+
+static void
+test_unrecoverable_error (CRDocHandler * a_handler)
+{
+        g_string_append (a_handler->app_data, "unrecoverable_error\n");
+}
+
+static void
+init_test_sac_handler (CRDocHandler * a_handler, GString * a_log)
+{
+        a_handler->app_data = a_log;
+        a_handler->start_document = test_start_document;
+        a_handler->end_document = test_end_document;
+        a_handler->charset = test_charset;
+        a_handler->import_style = test_import_style;
+        a_handler->start_selector = test_start_selector;
+        a_handler->end_selector = test_end_selector;
+        a_handler->property = test_property;
+        a_handler->start_font_face = test_start_font_face;
+        a_handler->end_font_face = test_end_font_face;
+        a_handler->start_media = test_start_media;
+        a_handler->end_media = test_end_media;
+        a_handler->start_page = test_start_page;
+        a_handler->end_page = test_end_page;
+        a_handler->error = test_error;
+        a_handler->unrecoverable_error = test_unrecoverable_error;
+}
+
+/***************************
+ *END of TEST SAC document
+ *handlers.
+ ***************************/
+
+/**
+ *Feeds a buffer TEST_CHUNK_SIZE bytes at a time to a streaming
+ *parser, or parses it in one go, and logs the SAC callbacks.
+ *@param a_buf the stylesheet to parse.
+ *@param a_len the length of a_buf.
+ *@param a_streaming TRUE to feed the stylesheet a chunk at a time.
+ *@param a_log the string to log the callbacks in.
+ *@return the status of the parsing.
+ */
+static enum CRStatus
+parse_buf (const guchar * a_buf, gulong a_len, gboolean a_streaming,
+           GString * a_log)
+{
+        enum CRStatus status = CR_OK;
+        CRParser *parser = NULL;
+        CRDocHandler *sac_handler = NULL;
+        gulong i = 0;
+
+        if (a_streaming == TRUE) {
+                parser = cr_parser_new_from_input
+                        (cr_input_new_streaming ());
+        } else {
+                parser = cr_parser_new_from_buf ((guchar *) a_buf, a_len,
+                                                 CR_UTF_8, FALSE);
+        }
+        sac_handler = cr_doc_handler_new ();
+        init_test_sac_handler (sac_handler, a_log);
+        cr_parser_set_sac_handler (parser, sac_handler);
+        cr_doc_handler_unref (sac_handler);
+
+        if (a_streaming == TRUE) {
+                /*
+                 *keep feeding after an error: the parser must
+                 *ignore what follows it, as cr_parser_parse() does.
+                 */
+                for (i = 0; i < a_len; i += TEST_CHUNK_SIZE) {
+                        cr_parser_feed (parser, a_buf + i,
+                                        MIN (TEST_CHUNK_SIZE, a_len - i));
+                }
+                status = cr_parser_finish (parser);
+        } else {
+                status = cr_parser_parse (parser);
+        }
+
+        cr_parser_destroy (parser);
+
+        return status;
+}
+
+/**
+ *Reads a_file_uri TEST_CHUNK_SIZE bytes at a time and
+ *feeds each chunk to a streaming parser, then checks the SAC
+ *callbacks are the ones of a regular parse of the whole file.
+ *@param a_file_uri the file to parse.
+ *@return CR_OK upon successful completion of the
+ *function, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_parser_feed (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK,
+                expected_status = CR_OK;
+        GString *log = NULL,
+                *expected_log = NULL;
+        gchar *buf = NULL;
+        gsize len = 0;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        if (!g_file_get_contents ((const gchar *) a_file_uri, &buf,
+                                  &len, NULL))
+                return CR_ERROR;
+
+        log = g_string_new (NULL);
+        expected_log = g_string_new (NULL);
+        status = parse_buf ((const guchar *) buf, len, TRUE, log);
+        expected_status = parse_buf ((const guchar *) buf, len, FALSE,
+                                     expected_log);
+        fprintf (stdout, "%s", log->str);
+        if (status != expected_status
+            || strcmp (log->str, expected_log->str))
+                status = CR_ERROR;
+        else
+                status = CR_OK;
+
+        g_string_free (log, TRUE);
+        g_string_free (expected_log, TRUE);
+        g_free (buf);
+
+        return status;
+}
+
+/**
+ *The entry point of the testing routine.
+ */
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = test_cr_parser_feed ((guchar *) options.files_list[0]);
+
+        if (status != CR_OK) {
+                fprintf (stdout, "KO\n");
+        }
+
+        return 0;
+}
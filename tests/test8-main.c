@@ -0,0 +1,308 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms 
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the 
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks that the table driven tokenizer (cr_tknzr_set_use_dfa())
+ *gives the same tokens as the cr_tknzr_parse_*() routines.
+ */
+
+static const gchar *gv_token_type_names[] = {
+        "NO_TK", "S_TK", "CDO_TK", "CDC_TK", "INCLUDES_TK",
+        "DASHMATCH_TK", "COMMENT_TK", "STRING_TK", "IDENT_TK",
+        "HASH_TK", "IMPORT_SYM_TK", "PAGE_SYM_TK", "MEDIA_SYM_TK",
+        "FONT_FACE_SYM_TK", "CHARSET_SYM_TK", "ATKEYWORD_TK",
+        "IMPORTANT_SYM_TK", "EMS_TK", "EXS_TK", "LENGTH_TK",
+        "ANGLE_TK", "TIME_TK", "FREQ_TK", "DIMEN_TK",
+        "PERCENTAGE_TK", "NUMBER_TK", "RGB_TK", "URI_TK",
+        "FUNCTION_TK", "UNICODERANGE_TK", "SEMICOLON_TK", "CBO_TK",
+        "CBC_TK", "PO_TK", "PC_TK", "BO_TK", "BC_TK", "DELIM_TK"
+};
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static enum CRStatus
+  test_cr_tknzr_use_dfa (guchar * a_file_uri);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Tokenizes the file with and without the table "
+                 "driven tokenizer,\ndumps the tokens and checks "
+                 "both tokenizers give the same ones.\n");
+        fprintf (stdout, "Returns OK if they do, KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRTknzr class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+static gboolean
+locations_equal (CRParsingLocation const * a_loc1,
+                 CRParsingLocation const * a_loc2)
+{
+        return a_loc1->line == a_loc2->line
+                && a_loc1->column == a_loc2->column
+                && a_loc1->byte_offset == a_loc2->byte_offset;
+}
+
+static gboolean
+strings_equal (CRString const * a_str1, CRString const * a_str2)
+{
+        if (!a_str1 || !a_str2)
+                return a_str1 == a_str2;
+        return !strcmp (a_str1->stryng->str, a_str2->stryng->str)
+                && a_str1->atom == a_str2->atom
+                && locations_equal (&a_str1->location, &a_str2->location);
+}
+
+static gboolean
+tokens_equal (CRToken const * a_tk1, CRToken const * a_tk2)
+{
+        if (a_tk1->type != a_tk2->type
+            || a_tk1->extra_type != a_tk2->extra_type
+            || !locations_equal (&a_tk1->location, &a_tk2->location)
+            || a_tk1->slice_len != a_tk2->slice_len
+            || (a_tk1->slice_len
+                && memcmp (a_tk1->slice, a_tk2->slice, a_tk1->slice_len))
+            || !strings_equal (a_tk1->dimen, a_tk2->dimen))
+                return FALSE;
+
+        switch (a_tk1->type) {
+        case COMMENT_TK:
+        case STRING_TK:
+        case IDENT_TK:
+        case HASH_TK:
+        case ATKEYWORD_TK:
+        case URI_TK:
+        case FUNCTION_TK:
+                return strings_equal (a_tk1->u.str, a_tk2->u.str);
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case DIMEN_TK:
+        case PERCENTAGE_TK:
+        case NUMBER_TK:
+                return a_tk1->u.num->val == a_tk2->u.num->val
+                        && a_tk1->u.num->type == a_tk2->u.num->type
+                        && locations_equal (&a_tk1->u.num->location,
+                                            &a_tk2->u.num->location);
+        case RGB_TK:
+                return a_tk1->u.rgb->red == a_tk2->u.rgb->red
+                        && a_tk1->u.rgb->green == a_tk2->u.rgb->green
+                        && a_tk1->u.rgb->blue == a_tk2->u.rgb->blue
+                        && a_tk1->u.rgb->is_percentage
+                        == a_tk2->u.rgb->is_percentage;
+        case DELIM_TK:
+                return a_tk1->u.unichar == a_tk2->u.unichar;
+        default:
+                return TRUE;
+        }
+}
+
+static void
+dump_token (CRToken const * a_tk)
+{
+        fprintf (stdout, "%s", gv_token_type_names[a_tk->type]);
+        switch (a_tk->type) {
+        case COMMENT_TK:
+                fprintf (stdout, " (%lu bytes)", a_tk->u.str
+                         ? (gulong) a_tk->u.str->stryng->len
+                         : a_tk->slice_len);
+                break;
+        case STRING_TK:
+        case IDENT_TK:
+        case HASH_TK:
+        case ATKEYWORD_TK:
+        case URI_TK:
+        case FUNCTION_TK:
+                if (a_tk->u.str)
+                        fprintf (stdout, " '%s'", a_tk->u.str->stryng->str);
+                break;
+        case EMS_TK:
+        case EXS_TK:
+        case LENGTH_TK:
+        case ANGLE_TK:
+        case TIME_TK:
+        case FREQ_TK:
+        case DIMEN_TK:
+        case PERCENTAGE_TK:
+        case NUMBER_TK:
+                fprintf (stdout, " %g", a_tk->u.num->val);
+                if (a_tk->extra_type)
+                        fprintf (stdout, " (extra type %d)",
+                                 a_tk->extra_type);
+                if (a_tk->dimen)
+                        fprintf (stdout, " '%s'", a_tk->dimen->stryng->str);
+                break;
+        case RGB_TK:
+                fprintf (stdout, " %ld,%ld,%ld", a_tk->u.rgb->red,
+                         a_tk->u.rgb->green, a_tk->u.rgb->blue);
+                break;
+        case DELIM_TK:
+                if (a_tk->u.unichar > ' ' && a_tk->u.unichar < 0x7F)
+                        fprintf (stdout, " '%c'", a_tk->u.unichar);
+                else
+                        fprintf (stdout, " U+%04X", a_tk->u.unichar);
+                break;
+        default:
+                break;
+        }
+        fprintf (stdout, " at %ld:%ld:%ld\n",
+                 (glong) a_tk->location.line,
+                 (glong) a_tk->location.column,
+                 (glong) a_tk->location.byte_offset);
+}
+
+/**
+ *Tokenizes a file using both tokenizers, dumps the tokens
+ *and checks they are the same.
+ *@param a_file_uri the file to tokenize.
+ *@return CR_OK if both tokenizers give the same tokens,
+ *an error code otherwise.
+ */
+static enum CRStatus
+test_cr_tknzr_use_dfa (guchar * a_file_uri)
+{
+        enum CRStatus status = CR_OK,
+                dfa_status = CR_OK;
+        gchar *buf = NULL;
+        gsize len = 0;
+        CRTknzr *tknzr = NULL,
+                *dfa_tknzr = NULL;
+        CRToken *token = NULL,
+                *dfa_token = NULL;
+        gulong nr_tokens = 0;
+
+        g_return_val_if_fail (a_file_uri, CR_BAD_PARAM_ERROR);
+
+        if (!g_file_get_contents ((const gchar *) a_file_uri,
+                                  &buf, &len, NULL)) {
+                return CR_ERROR;
+        }
+        tknzr = cr_tknzr_new_from_buf ((guchar *) buf, len, CR_UTF_8, FALSE);
+        dfa_tknzr = cr_tknzr_new_from_buf ((guchar *) buf, len, CR_UTF_8,
+                                           FALSE);
+        g_return_val_if_fail (tknzr && dfa_tknzr, CR_ERROR);
+        cr_tknzr_set_use_dfa (dfa_tknzr, TRUE);
+
+        for (;;) {
+                status = cr_tknzr_get_next_token (tknzr, &token);
+                dfa_status = cr_tknzr_get_next_token (dfa_tknzr,
+                                                      &dfa_token);
+                if (status != dfa_status) {
+                        fprintf (stdout, "token #%lu: status %d, "
+                                 "but %d with the table driven tokenizer\n",
+                                 nr_tokens, status, dfa_status);
+                        status = CR_ERROR;
+                        break;
+                }
+                if (status != CR_OK) {
+                        if (status == CR_END_OF_INPUT_ERROR)
+                                status = CR_OK;
+                        break;
+                }
+                dump_token (dfa_token);
+                if (tokens_equal (token, dfa_token) == FALSE) {
+                        fprintf (stdout, "token #%lu differs, the "
+                                 "cr_tknzr_parse_*() routines give ",
+                                 nr_tokens);
+                        dump_token (token);
+                        status = CR_ERROR;
+                        break;
+                }
+                nr_tokens++;
+                cr_token_destroy (token);
+                cr_token_destroy (dfa_token);
+                token = dfa_token = NULL;
+        }
+        if (status == CR_OK) {
+                fprintf (stdout, "%lu tokens, the same with both "
+                         "tokenizers\n", nr_tokens);
+        }
+
+        if (token)
+                cr_token_destroy (token);
+        if (dfa_token)
+                cr_token_destroy (dfa_token);
+        cr_tknzr_destroy (tknzr);
+        cr_tknzr_destroy (dfa_tknzr);
+        g_free (buf);
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        status = test_cr_tknzr_use_dfa ((guchar *) options.files_list[0]);
+
+        if (status != CR_OK) {
+                fprintf (stdout, "KO\n");
+        }
+
+        return 0;
+}
@@ -0,0 +1,255 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset:8 -*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms
+ * of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the
+ * GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cr-test-utils.h"
+#include "libcroco.h"
+
+/**
+ *@file
+ *Checks the lookahead of the tokenizer (cr_tknzr_peek_token())
+ *and that the parser tokenizes each byte of its input once.
+ */
+
+/**
+ *The number of tokens peeked ahead of the current one.
+ */
+#define NB_PEEKED 4
+
+static void
+  display_help (char *prg_name);
+
+static void
+  display_about (char *prg_name);
+
+static enum CRStatus
+  test_cr_tknzr_peek_token (guchar * a_buf, gulong a_len);
+
+static enum CRStatus
+  test_cr_parser_scan_stats (guchar * a_buf, gulong a_len);
+
+static void
+display_help (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "usage: %s <file-to-parse>\n", prg_name);
+        fprintf (stdout, "\t <file-to-parse>: the file to parse\n");
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "Tokenizes the file peeking tokens ahead, "
+                 "then parses it and\nreports how many times its "
+                 "bytes have been tokenized.\n");
+        fprintf (stdout, "Returns OK if each byte has been tokenized "
+                 "once, KO otherwise\n");
+        fprintf (stdout, "\n\n");
+}
+
+static void
+display_about (char *prg_name)
+{
+        fprintf (stdout, "\n\n");
+        fprintf (stdout, "%s is a libcroco CRTknzr class test program.\n",
+                 prg_name);
+        fprintf (stdout, "It should run on GNU compliants systems.\n");
+        fprintf (stdout, "\n\n");
+}
+
+/**
+ *Tokenizes a buffer twice, once token by token, and once peeking
+ *NB_PEEKED tokens ahead of the current one, and checks both
+ *give the same tokens, without any token being scanned twice.
+ *@param a_buf the buffer to tokenize.
+ *@param a_len the length of a_buf.
+ *@return CR_OK if the test passes, an error code otherwise.
+ */
+static enum CRStatus
+test_cr_tknzr_peek_token (guchar * a_buf, gulong a_len)
+{
+        enum CRStatus status = CR_OK;
+        CRTknzr *tknzr = NULL;
+        CRToken *token = NULL,
+                *peeked = NULL;
+        CRInputPos pos;
+        GArray *types = NULL;
+        guint i = 0,
+                n = 0;
+        gulong nb_tokens = 0,
+                nb_bytes = 0;
+
+        types = g_array_new (FALSE, FALSE, sizeof (enum CRTokenType));
+        tknzr = cr_tknzr_new_from_buf (a_buf, a_len, CR_UTF_8, FALSE);
+        g_return_val_if_fail (types && tknzr, CR_ERROR);
+        while (cr_tknzr_get_next_token (tknzr, &token) == CR_OK) {
+                g_array_append_val (types, token->type);
+                cr_tknzr_release_token (tknzr, token);
+                token = NULL;
+        }
+        cr_tknzr_destroy (tknzr);
+
+        tknzr = cr_tknzr_new_from_buf (a_buf, a_len, CR_UTF_8, FALSE);
+        g_return_val_if_fail (tknzr, CR_ERROR);
+        for (i = 0; i < types->len; i++) {
+                for (n = 0; n < NB_PEEKED && i + n < types->len; n++) {
+                        status = cr_tknzr_peek_token (tknzr, n, &peeked);
+                        if (status != CR_OK
+                            || peeked->type != g_array_index
+                            (types, enum CRTokenType, i + n)) {
+                                fprintf (stdout, "token #%u peeked from "
+                                         "token #%u differs\n", i + n, i);
+                                status = CR_ERROR;
+                                goto out;
+                        }
+                }
+                if (i + n == types->len
+                    && cr_tknzr_peek_token (tknzr, n, &peeked)
+                    != CR_END_OF_INPUT_ERROR) {
+                        fprintf (stdout, "peeked past the end "
+                                 "of the input\n");
+                        status = CR_ERROR;
+                        goto out;
+                }
+
+                /*
+                 *read the current token, put it back and
+                 *rewind to it: it must stay read ahead.
+                 */
+                cr_tknzr_peek_token (tknzr, 0, &peeked);
+                cr_tknzr_get_cur_pos (tknzr, &pos);
+                status = cr_tknzr_get_next_token (tknzr, &token);
+                if (status != CR_OK || token != peeked) {
+                        fprintf (stdout, "token #%u is not the "
+                                 "one peeked\n", i);
+                        status = CR_ERROR;
+                        goto out;
+                }
+                cr_tknzr_unget_token (tknzr, token);
+                token = NULL;
+                cr_tknzr_set_cur_pos (tknzr, &pos);
+
+                status = cr_tknzr_get_next_token (tknzr, &token);
+                if (status != CR_OK || token != peeked) {
+                        fprintf (stdout, "token #%u has been lost "
+                                 "by a rewind\n", i);
+                        status = CR_ERROR;
+                        goto out;
+                }
+                cr_tknzr_release_token (tknzr, token);
+                token = NULL;
+        }
+
+        cr_tknzr_get_scan_stats (tknzr, &nb_tokens, &nb_bytes);
+        fprintf (stdout, "%u tokens peeked %d ahead, %lu tokens and "
+                 "%lu bytes scanned for %lu bytes of input\n",
+                 types->len, NB_PEEKED, nb_tokens, nb_bytes, a_len);
+        if (nb_tokens != types->len || nb_bytes != a_len)
+                status = CR_ERROR;
+
+ out:
+        if (token)
+                cr_tknzr_release_token (tknzr, token);
+        cr_tknzr_destroy (tknzr);
+        g_array_free (types, TRUE);
+        return status;
+}
+
+/**
+ *Parses a buffer and reports the number of tokens
+ *and bytes scanned to do so.
+ *@param a_buf the buffer to parse.
+ *@param a_len the length of a_buf.
+ *@return CR_OK if each byte has been tokenized once,
+ *an error code otherwise.
+ */
+static enum CRStatus
+test_cr_parser_scan_stats (guchar * a_buf, gulong a_len)
+{
+        enum CRStatus status = CR_OK;
+        CRParser *parser = NULL;
+        CRTknzr *tknzr = NULL;
+        gulong nb_tokens = 0,
+                nb_bytes = 0;
+
+        parser = cr_parser_new_from_buf (a_buf, a_len, CR_UTF_8, FALSE);
+        g_return_val_if_fail (parser, CR_ERROR);
+        cr_parser_set_default_sac_handler (parser);
+
+        status = cr_parser_parse (parser);
+        if (status == CR_OK)
+                status = cr_parser_get_tknzr (parser, &tknzr);
+        if (status == CR_OK)
+                status = cr_tknzr_get_scan_stats (tknzr, &nb_tokens,
+                                                  &nb_bytes);
+        if (status == CR_OK) {
+                fprintf (stdout, "parsing: %lu tokens and %lu bytes "
+                         "scanned for %lu bytes of input\n",
+                         nb_tokens, nb_bytes, a_len);
+                if (nb_bytes != a_len)
+                        status = CR_ERROR;
+        }
+
+        cr_parser_destroy (parser);
+        return status;
+}
+
+int
+main (int argc, char **argv)
+{
+        struct Options options;
+        enum CRStatus status = CR_OK;
+        gchar *buf = NULL;
+        gsize len = 0;
+
+        cr_test_utils_parse_cmd_line (argc, argv, &options);
+
+        if (options.display_help == TRUE) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (options.display_about == TRUE) {
+                display_about (argv[0]);
+                return 0;
+        }
+
+        if (options.files_list == NULL) {
+                display_help (argv[0]);
+                return 0;
+        }
+
+        if (!g_file_get_contents (options.files_list[0], &buf, &len, NULL)) {
+                fprintf (stdout, "KO\n");
+                return 0;
+        }
+
+        status = test_cr_tknzr_peek_token ((guchar *) buf, len);
+        if (status == CR_OK)
+                status = test_cr_parser_scan_stats ((guchar *) buf, len);
+
+        if (status != CR_OK) {
+                fprintf (stdout, "KO\n");
+        }
+
+        g_free (buf);
+        return 0;
+}